@@ -535,8 +535,16 @@ int64_t xine_get_current_vpts(xine_stream_t *stream) XINE_PROTECTED;
  * resources.
  * The caller should have acquired a port ticket while calling these features.
  *
+ * With XINE_GRAB_VIDEO_FRAME_FLAGS_ZERO_COPY, grab() does not copy or convert anything.
+ * Instead, it holds a reference to the displayed frame, and returns its YUV planes in
+ * format/frame_width/frame_height/planes/pitches. The caller may read them directly,
+ * and/or call convert() to get the usual RGB image in img. The reference stays valid
+ * until release(), the next grab() or dispose(). Release it soon: a held frame is not
+ * available to the decoder.
+ * Ports that do not support this leave release() NULL, and ignore the flag.
  */
 #define HAVE_XINE_GRAB_VIDEO_FRAME      1
+#define HAVE_XINE_GRAB_VIDEO_FRAME_ZERO_COPY 1
 
 /*
  * frame structure used for grabbing video frames of format RGB.
@@ -575,10 +583,32 @@ struct xine_grab_video_frame_s {
 
   int timeout;       /* Max. time to wait for next displayed frame in milliseconds */
   int flags;         /* Controlling flags. See XINE_GRAB_VIDEO_FRAME_FLAGS_* definitions */
+
+  /*
+   *  zero copy mode only: convert the held frame to RGB img, like grab() does
+   *  without XINE_GRAB_VIDEO_FRAME_FLAGS_ZERO_COPY.
+   *  returns 0 if conversion is successful, 1 if no frame is held and -1 on error
+   */
+  int (*convert) (xine_grab_video_frame_t *self);
+
+  /*
+   *  zero copy mode only: drop the reference to the held frame.
+   *  planes become invalid.
+   */
+  void (*release) (xine_grab_video_frame_t *self);
+
+  /*
+   * Held frame in zero copy mode, source cropping already applied.
+   */
+  int format;                  /* XINE_IMGFMT_YV12 or XINE_IMGFMT_YUY2 */
+  int frame_width, frame_height;
+  uint8_t *planes[3];          /* YUY2 uses planes[0] only */
+  int pitches[3];
 };
 
 #define XINE_GRAB_VIDEO_FRAME_FLAGS_CONTINUOUS  0x01    /* optimize resource allocation for continuous frame grabbing */
 #define XINE_GRAB_VIDEO_FRAME_FLAGS_WAIT_NEXT   0x02    /* wait for next display frame instead of using last displayed frame */
+#define XINE_GRAB_VIDEO_FRAME_FLAGS_ZERO_COPY   0x04    /* hold a reference to the frame planes, convert to RGB on request only */
 
 #define XINE_GRAB_VIDEO_FRAME_DEFAULT_TIMEOUT   500
 
@@ -997,6 +1027,39 @@ int  xine_get_pos_length (xine_stream_t *stream,
 			  int *length_time) /* milliseconds */
   XINE_PROTECTED;
 
+/*
+ * pipeline latency statistics.
+ * enable with config "engine.performance.pipeline_stats". all times are in
+ * microseconds, per stage and per stream (side streams count to their master).
+ * hist[n] counts values from 2^n to 2^(n+1) - 1, hist[0] also counts 0.
+ * max is the highest value since the stream was created, not since reset.
+ */
+#define XINE_PSTATS_BUCKETS 24
+
+typedef struct {
+  uint32_t count;
+  uint32_t hist[XINE_PSTATS_BUCKETS];
+  int64_t  sum;
+  int64_t  max;
+} xine_pstats_hist_t;
+
+typedef struct {
+  xine_pstats_hist_t video_queue;  /* demux put -> video decoder get */
+  xine_pstats_hist_t video_decode; /* video decoder busy per buffer */
+  xine_pstats_hist_t video_ready;  /* decoder frame draw -> display */
+  xine_pstats_hist_t video_late;   /* display past frame due time */
+  xine_pstats_hist_t audio_queue;  /* demux put -> audio decoder get */
+  xine_pstats_hist_t audio_decode; /* audio decoder busy per buffer */
+  xine_pstats_hist_t audio_sync;   /* audio output a/v sync error */
+} xine_pstats_t;
+
+/*
+ * get a snapshot of pipeline statistics since last reset.
+ * reset != 0 starts a new period after reading.
+ * returns 1 on success, 0 if statistics are disabled.
+ */
+int  xine_query_stats (xine_stream_t *stream, xine_pstats_t *stats, int reset) XINE_PROTECTED;
+
 /*
  * get information about the stream such as
  * video width/height, codecs, audio format, title, author...
@@ -1044,6 +1107,9 @@ const char *xine_get_meta_info   (xine_stream_t *stream, int info) XINE_PROTECTE
 #define XINE_STREAM_INFO_DVD_CHAPTER_COUNT  33
 #define XINE_STREAM_INFO_DVD_ANGLE_NUMBER   34
 #define XINE_STREAM_INFO_DVD_ANGLE_COUNT    35
+#define XINE_STREAM_INFO_VARIANT_NUMBER     36 /* multirate streams (hls): playing variant */
+#define XINE_STREAM_INFO_VARIANT_COUNT      37
+#define XINE_STREAM_INFO_VARIANT_BITRATE    38 /* as announced by the playlist */
 
 /* possible values for XINE_STREAM_INFO_VIDEO_AFD */
 #define XINE_VIDEO_AFD_NOT_PRESENT         -1
@@ -1846,6 +1912,7 @@ void xine_config_reset (xine_t *self) XINE_PROTECTED;
 #define XINE_EVENT_MRL_REFERENCE_EXT     13 /* demuxer->frontend: MRL reference(s) for the real stream */
 #define XINE_EVENT_AUDIO_AMP_LEVEL       14 /* report current audio amp level (l/r/mute) */
 #define XINE_EVENT_NBC_STATS             15 /* nbc buffer status */
+#define XINE_EVENT_VARIANT_CHANGE        16 /* multirate input switched to another variant */
 
 
 /* input events coming from frontend */
@@ -2048,6 +2115,19 @@ typedef struct {
   int                 type;         /* 0=buffer put, 1=buffer get */
 } xine_nbc_stats_data_t;
 
+/*
+ * multirate variant switch
+ */
+typedef struct {
+  int                 index;        /* new variant, 0..count-1 */
+  int                 count;
+  int                 bitrate;      /* announced bits/s */
+  int                 width;        /* 0 if unknown or audio only */
+  int                 height;
+  int                 throughput;   /* measured bits/s, 0 if unknown */
+  int                 buffered;     /* play time in fifos in ms, -1 if unknown */
+} xine_variant_data_t;
+
 /*
  * mrl reference data is sent by demuxers when a reference stream is found.
  * this stream just contains pointers (urls) to the real data, which are
@@ -698,6 +698,34 @@ struct fifo_buffer_s
  */
 fifo_buffer_t *_x_fifo_buffer_new (int num_buffers, uint32_t buf_size) XINE_PROTECTED;
 
+/** Plain bufs bypass fifo->mutex, and fifo->first/last lists. Fine for 1 demux and
+ *  1 decoder thread. Other threads may still put () occasionally, insert () and clear (). */
+#define FIFO_FLAG_SPSC 0x0001
+/** Single bufs are freed to, and allocated from, a lock free cache in front of the pool. */
+#define FIFO_FLAG_BUF_CACHE 0x0002
+
+/**
+ * @brief Allocate and initialise new (empty) FIFO buffers.
+ * @param num_buffer Number of buffers to allocate.
+ * @param buf_size Size of each buffer.
+ * @param flags FIFO_FLAG_*. Unsupported flags are silently ignored.
+ * @internal Only used by video and audio decoder loops.
+ */
+fifo_buffer_t *_x_fifo_buffer_new_flags (int num_buffers, uint32_t buf_size, uint32_t flags) XINE_PROTECTED;
+
+typedef struct {
+  uint32_t alloc_hits, alloc_misses;
+  uint32_t free_hits, free_misses;
+} fifo_buffer_cache_stats_t;
+
+/**
+ * @brief Get FIFO_FLAG_BUF_CACHE statistics.
+ * @param fifo The fifo.
+ * @param stats Where to store the counters.
+ * @return 0 if fifo has no buffer cache.
+ */
+int _x_fifo_buffer_cache_stats (fifo_buffer_t *fifo, fifo_buffer_cache_stats_t *stats) XINE_PROTECTED;
+
 /**
  * @brief Allocate and initialise new dummy FIFO buffers.
  * @param num_buffer Number of dummy buffers to allocate.
@@ -404,6 +404,26 @@ struct input_plugin_s {
 /* ask plugin to generate a new preview from the current position,
  * eg to skip a large ID3v2 tag. data is ignored. */
 #define INPUT_OPTIONAL_DATA_NEW_PREVIEW 19
+/* data is an int[2] receiving the bytes read ahead of the current position,
+ * and the size of the read ahead buffer. supported by the engine cache layer. */
+#define INPUT_OPTIONAL_DATA_CACHE_FILL 20
+/* data is an int64_t[INPUT_NET_STATS_SIZE] receiving the datagram counters
+ * of a packet based input (rtp/udp). */
+#define INPUT_OPTIONAL_DATA_NET_STATS 21
+#define INPUT_NET_STATS_PACKETS   0 /* datagrams received */
+#define INPUT_NET_STATS_LOST      1 /* rtp sequence numbers never seen */
+#define INPUT_NET_STATS_REORDERED 2 /* datagrams put back into order */
+#define INPUT_NET_STATS_DROPPED   3 /* late, duplicate, truncated or broken datagrams */
+#define INPUT_NET_STATS_SYSCALLS  4 /* receive system calls */
+#define INPUT_NET_STATS_SIZE      5
+/* data is an int * telling how many bytes the demuxer is going to read sequentially
+ * from the current position, eg a whole matroska cluster. the engine cache layer then
+ * fetches them in fewer and larger main input reads. just a hint, may be ignored. */
+#define INPUT_OPTIONAL_DATA_READAHEAD 22
+/* data is a const char * holding the mrl that will most likely follow by
+ * INPUT_OPTIONAL_DATA_NEW_MRL. a network input may send that request early on the
+ * same connection (http pipelining). just a hint, may be ignored. */
+#define INPUT_OPTIONAL_DATA_NEXT_MRL  23
 
 #define MAX_MRL_ENTRIES 255
 #define MAX_PREVIEW_SIZE 4096
@@ -413,6 +433,8 @@ typedef struct xine_nbc_st xine_nbc_t;
 xine_nbc_t *xine_nbc_init (xine_stream_t *stream) XINE_PROTECTED;
 /* returns a combinwd demux pts position, starting with 0 at stream start. */
 int64_t xine_nbc_get_pos_pts (xine_nbc_t *nbc) XINE_PROTECTED;
+/* returns the play time buffered ahead in ms (the shorter of audio and video), or -1 if unknown. */
+int xine_nbc_get_fill_ms (xine_nbc_t *nbc) XINE_PROTECTED;
 void xine_nbc_close (xine_nbc_t *nbc) XINE_PROTECTED;
 
 
@@ -176,6 +176,7 @@ struct vo_frame_s {
 
   int                        id; /* debugging - track this frame */
   int                        is_first;
+  int64_t                    draw_time; /* pipeline stats, 0 = unset */
 };
 
 
@@ -286,7 +287,14 @@ struct xine_video_port_s {
 #define VO_PROP_MAX_VIDEO_HEIGHT      29 /* read-only */
 #define VO_PROP_CAPS2                 30 /* read-only. second capability flags, see below. */
 #define VO_PROP_TRANSFORM             31 /* XINE_VO_TRANSFORM_* */
-#define VO_NUM_PROPERTIES             32
+/* read-only frame pacing statistics of video_out.c, in microseconds.
+ * error is measured against the planned display time, over the last
+ * 64 frames. misses counts frames more than 2ms late since port open. */
+/* 32...36 are taken by XINE_PARAM_VO_CROP_* and XINE_PARAM_VO_SINGLE_STEP. */
+#define VO_PROP_PACING_ERROR          37
+#define VO_PROP_PACING_ERROR_MAX      38
+#define VO_PROP_PACING_MISSES         39
+#define VO_NUM_PROPERTIES             40
 
 /* number of colors in the overlay palette. Currently limited to 256
    at most, because some alphablend functions use an 8-bit index into
@@ -366,7 +374,7 @@ struct xine_video_port_s {
  * from generic vo functions.
  */
 
-#define VIDEO_OUT_DRIVER_IFACE_VERSION  22
+#define VIDEO_OUT_DRIVER_IFACE_VERSION  23
 
 struct vo_driver_s {
 
@@ -171,6 +171,7 @@ typedef struct {
 #define MM_ACCEL_X86_SSE4       0x01000000
 #define MM_ACCEL_X86_SSE42      0x00800000
 #define MM_ACCEL_X86_AVX        0x00400000
+#define MM_ACCEL_X86_AVX2       0x00200000
 
 /* powerpc accelerations and features */
 #define MM_ACCEL_PPC_ALTIVEC    0x04000000
@@ -181,6 +182,9 @@ typedef struct {
 #define MM_ACCEL_SPARC_VIS      0x01000000
 #define MM_ACCEL_SPARC_VIS2     0x00800000
 
+/* ARM accelerations */
+#define MM_ACCEL_ARM_NEON       0x80000000
+
 /* x86 compat defines */
 #define MM_MMX                  MM_ACCEL_X86_MMX
 #define MM_3DNOW                MM_ACCEL_X86_3DNOW
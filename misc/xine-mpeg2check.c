@@ -0,0 +1,345 @@
+/*
+ * Copyright (C) 2021 the xine-project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ *
+ * xine-mpeg2check: bit exactness check of the libmpeg2 SIMD IDCT and
+ * motion compensation against the C reference.
+ *
+ * The libmpeg2 sources are linked in directly. mpeg2_idct_init () and
+ * mpeg2_mc_init () just set function pointers, thus we call them once with
+ * no accel to get the C versions, and once more per SIMD level. Every
+ * function then runs on the same random input, and the outputs must match
+ * byte for byte. The MMX versions are not checked, they use a different
+ * IDCT algorithm by design.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <xine.h>
+#include <xine/xineutils.h>
+
+#include "video_dec/libmpeg2/mpeg2_internal.h"
+
+#define XINE_MPEG2CHECK_VERSION_N(x,y) #x"."#y
+#define XINE_MPEG2CHECK_VERSION XINE_MPEG2CHECK_VERSION_N(XINE_MAJOR_VERSION,XINE_MINOR_VERSION)
+
+/* header.c is not linked. the MMX IDCT init would permute these,
+ * but we never select it. */
+uint8_t mpeg2_scan_norm[64];
+uint8_t mpeg2_scan_alt[64];
+
+typedef struct {
+  const char *name;
+  uint32_t flag;
+} mc_level_t;
+
+static const mc_level_t mc_levels[] = {
+#ifdef LIBMPEG2_AVX2
+  { "avx2", MM_ACCEL_X86_AVX2 },
+#endif
+#ifdef LIBMPEG2_NEON
+  { "neon", MM_ACCEL_ARM_NEON },
+#endif
+  { NULL, 0 }
+};
+
+typedef struct {
+  void (*copy) (int16_t *block, uint8_t *dest, int stride);
+  void (*add) (int16_t *block, uint8_t *dest, int stride);
+  void (*idct) (int16_t *block);
+  mpeg2_mc_t mc;
+} mc_funcs_t;
+
+static void mc_get_funcs (mc_funcs_t *f, uint32_t accel) {
+  mpeg2_idct_init (accel);
+  mpeg2_mc_init (accel);
+  f->copy = mpeg2_idct_copy;
+  f->add  = mpeg2_idct_add;
+  f->idct = mpeg2_idct;
+  f->mc   = mpeg2_mc;
+}
+
+static uint32_t mc_seed;
+
+static uint32_t mc_rand (void) {
+  mc_seed = mc_seed * 1103515245 + 12345;
+  return mc_seed >> 16;
+}
+
+static void mc_fill (uint8_t *p, size_t size) {
+  while (size--)
+    *p++ = mc_rand ();
+}
+
+/* a coefficient block as seen after dequantization. mostly sparse with
+ * low frequencies, sometimes dense, sometimes at the range limits to
+ * exercise clipping and the intermediate precision. */
+static void mc_block (int16_t *block) {
+  int i, n, mode = mc_rand () & 7;
+
+  memset (block, 0, 64 * sizeof (*block));
+  switch (mode) {
+    case 0:
+      for (i = 0; i < 64; i++)
+        block[i] = (int)(mc_rand () & 4095) - 2048;
+      break;
+    case 1:
+      for (i = 0; i < 64; i++)
+        block[i] = (mc_rand () & 1) ? 2047 : -2048;
+      break;
+    case 2:
+      block[0] = (int)(mc_rand () & 4095) - 2048;
+      break;
+    default:
+      n = 1 + (mc_rand () % 12);
+      while (n--) {
+        i = mc_rand () & 63;
+        if (mc_rand () & 1)
+          i &= 0x1b; /* low frequencies */
+        block[i] = (int)(mc_rand () % 1024) - 512;
+      }
+      break;
+  }
+}
+
+/* 8x8 block in a 32 byte wide window, with guard bytes around. */
+#define MC_IDCT_STRIDE 32
+#define MC_IDCT_SIZE   (MC_IDCT_STRIDE * 10)
+#define MC_IDCT_OFFS   (MC_IDCT_STRIDE + 8)
+
+/* the C version clips through a table covering -384...639 only.
+ * streams do not go beyond that, random blocks may. */
+static int mc_in_clip_range (const int16_t *block) {
+  int i;
+
+  for (i = 0; i < 64; i++) {
+    if ((block[i] < -384) || (block[i] > 384))
+      return 0;
+  }
+  return 1;
+}
+
+static int mc_check_idct (const mc_funcs_t *ref, const mc_funcs_t *simd, int rounds, int *skipped) {
+  int16_t in[64] ATTR_ALIGN(16), b1[64] ATTR_ALIGN(16), b2[64] ATTR_ALIGN(16);
+  uint8_t d1[MC_IDCT_SIZE], d2[MC_IDCT_SIZE];
+  int r, errors = 0;
+
+  for (r = 0; r < rounds; r++) {
+    mc_block (in);
+
+    /* plain */
+    memcpy (b1, in, sizeof (in));
+    memcpy (b2, in, sizeof (in));
+    ref->idct (b1);
+    simd->idct (b2);
+    if (memcmp (b1, b2, sizeof (b1))) {
+      errors++;
+      fprintf (stderr, "xine-mpeg2check: idct mismatch in round %d.\n", r);
+    }
+    if (!mc_in_clip_range (b1)) {
+      (*skipped)++;
+      continue;
+    }
+
+    /* copy */
+    mc_fill (d1, sizeof (d1));
+    memcpy (d2, d1, sizeof (d1));
+    memcpy (b1, in, sizeof (in));
+    memcpy (b2, in, sizeof (in));
+    ref->copy (b1, d1 + MC_IDCT_OFFS, MC_IDCT_STRIDE);
+    simd->copy (b2, d2 + MC_IDCT_OFFS, MC_IDCT_STRIDE);
+    if (memcmp (d1, d2, sizeof (d1)) || memcmp (b1, b2, sizeof (b1))) {
+      errors++;
+      fprintf (stderr, "xine-mpeg2check: idct_copy mismatch in round %d.\n", r);
+    }
+
+    /* add */
+    mc_fill (d1, sizeof (d1));
+    memcpy (d2, d1, sizeof (d1));
+    memcpy (b1, in, sizeof (in));
+    memcpy (b2, in, sizeof (in));
+    ref->add (b1, d1 + MC_IDCT_OFFS, MC_IDCT_STRIDE);
+    simd->add (b2, d2 + MC_IDCT_OFFS, MC_IDCT_STRIDE);
+    if (memcmp (d1, d2, sizeof (d1)) || memcmp (b1, b2, sizeof (b1))) {
+      errors++;
+      fprintf (stderr, "xine-mpeg2check: idct_add mismatch in round %d.\n", r);
+    }
+  }
+  return errors;
+}
+
+/* reference picture and prediction target, with room for unaligned
+ * positions, field strides and guard bytes. */
+#define MC_PIC_STRIDE 64
+#define MC_PIC_SIZE   (MC_PIC_STRIDE * 40)
+
+static const char * const mc_names[8] = {
+  "o_16", "x_16", "y_16", "xy_16", "o_8", "x_8", "y_8", "xy_8"
+};
+
+static int mc_check_mc (const mc_funcs_t *ref, const mc_funcs_t *simd, int rounds) {
+  uint8_t pic[MC_PIC_SIZE], d1[MC_PIC_SIZE], d2[MC_PIC_SIZE];
+  int r, errors = 0;
+
+  for (r = 0; r < rounds; r++) {
+    int avg, i;
+
+    mc_fill (pic, sizeof (pic));
+    for (avg = 0; avg < 2; avg++) {
+      for (i = 0; i < 8; i++) {
+        /* frame or field prediction. */
+        int field = mc_rand () & 1;
+        int stride = MC_PIC_STRIDE << field;
+        int height = (i < 4 ? 16 : 8) >> field;
+        int src = MC_PIC_STRIDE + (mc_rand () % 40);
+        int dst = MC_PIC_STRIDE + ((mc_rand () % 5) << 3);
+
+        mc_fill (d1, sizeof (d1));
+        memcpy (d2, d1, sizeof (d1));
+        if (avg) {
+          ref->mc.avg[i] (d1 + dst, pic + src, stride, height);
+          simd->mc.avg[i] (d2 + dst, pic + src, stride, height);
+        } else {
+          ref->mc.put[i] (d1 + dst, pic + src, stride, height);
+          simd->mc.put[i] (d2 + dst, pic + src, stride, height);
+        }
+        if (memcmp (d1, d2, sizeof (d1))) {
+          errors++;
+          fprintf (stderr, "xine-mpeg2check: %s_%s mismatch in round %d (stride %d, height %d).\n",
+            avg ? "avg" : "put", mc_names[i], r, stride, height);
+        }
+      }
+    }
+  }
+  return errors;
+}
+
+int main (int argc, char *argv[])
+{
+  mc_funcs_t ref, simd;
+  uint32_t accel;
+  int optstate = 0, rounds = 100000, checked = 0, failed = 0, i;
+
+  mc_seed = 1;
+
+  for (;;)
+  {
+#define OPTS "hvn:s:"
+#ifdef HAVE_GETOPT_LONG
+    static const struct option longopts[] = {
+      { "help", no_argument, NULL, 'h' },
+      { "version", no_argument, NULL, 'v' },
+      { "rounds", required_argument, NULL, 'n' },
+      { "seed", required_argument, NULL, 's' },
+      { NULL, no_argument, NULL, 0 }
+    };
+    int index = 0;
+    int opt = getopt_long (argc, argv, OPTS, longopts, &index);
+#else
+    int opt = getopt(argc, argv, OPTS);
+#endif
+    if (opt == -1)
+      break;
+
+    switch (opt)
+    {
+    case 'h':
+      optstate |= 1;
+      break;
+    case 'v':
+      optstate |= 4;
+      break;
+    case 'n':
+      rounds = atoi (optarg);
+      if (rounds < 1)
+        optstate |= 2;
+      break;
+    case 's':
+      mc_seed = strtoul (optarg, NULL, 0);
+      break;
+    default:
+      optstate |= 2;
+      break;
+    }
+  }
+
+  if (optstate & 1)
+    printf ("\
+xine-mpeg2check-"XINE_MPEG2CHECK_VERSION" %s\n\
+using xine-lib %s\n\
+usage: %s [options]\n\
+options:\n\
+  -h, --help		this help text\n\
+  -n, --rounds NUM	random blocks per function (100000)\n\
+  -s, --seed NUM	random seed (1)\n\
+\n\
+Runs the libmpeg2 SIMD IDCT and motion compensation on random data,\n\
+and compares the output against the C version byte for byte.\n\
+Returns 0 if all supported levels match.\n\
+\n", XINE_VERSION, xine_get_version_string (), argv[0]);
+  else if (optstate & 4)
+    printf ("\
+xine-mpeg2check %s\n\
+using xine-lib %s\n\
+(c) 2021 the xine project team\n\
+This is free software; see the source for copying conditions.  There is NO\n\
+warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE,\n\
+to the extent permitted by law.\n",
+	     XINE_VERSION, xine_get_version_string ());
+
+  if (optstate & 2)
+  {
+    fputs ("xine-mpeg2check: invalid option (try -h or --help)\n", stderr);
+    return 1;
+  }
+
+  if (optstate)
+    return 0;
+
+  /* this also sets up the C clip table. */
+  mc_get_funcs (&ref, 0);
+
+  accel = xine_mm_accel ();
+  for (i = 0; mc_levels[i].name; i++) {
+    int e, skipped = 0;
+
+    if (!(accel & mc_levels[i].flag)) {
+      printf ("%-8s not supported by this cpu, skipped.\n", mc_levels[i].name);
+      continue;
+    }
+    mc_get_funcs (&simd, mc_levels[i].flag);
+    checked++;
+    e = mc_check_idct (&ref, &simd, rounds, &skipped);
+    printf ("%-8s idct %s (%d out of clip range blocks checked plain only)",
+      mc_levels[i].name, e ? "FAILED" : "ok", skipped);
+    failed += e;
+    e = mc_check_mc (&ref, &simd, rounds / 8 + 1);
+    printf (", mc %s\n", e ? "FAILED" : "ok");
+    failed += e;
+  }
+  if (!checked)
+    printf ("no SIMD level to check.\n");
+
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,835 @@
+/*
+ * Copyright (C) 2021 the xine-project
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301
+ * USA
+ *
+ * xine-pixbench: speed and consistency check of the xine-utils pixel kernels.
+ *
+ * xine_mm_accel () is evaluated only once per process. Thus every accel
+ * level runs in a child process with the debug only XINE_ACCEL_MASK set
+ * (see cpu_accel.c), and reports its timings and a sample output through
+ * a pipe. The parent compares the sample outputs against a reference
+ * level, see pb_kernel_t.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/time.h>
+#include <getopt.h>
+
+#include <xine.h>
+#include <xine/xineutils.h>
+#include <xine/video_out.h>
+#include <xine/alphablend.h>
+
+#include "yuv2rgb.h"
+
+#define XINE_PIXBENCH_VERSION_N(x,y) #x"."#y
+#define XINE_PIXBENCH_VERSION XINE_PIXBENCH_VERSION_N(XINE_MAJOR_VERSION,XINE_MINOR_VERSION)
+
+/*
+ * frames
+ */
+
+typedef struct {
+  int width, height;
+} pb_size_t;
+
+static const pb_size_t pb_sizes[] = {
+  {  720,  576 },
+  { 1920, 1080 },
+  { 3840, 2160 }
+};
+#define PB_NUM_SIZES (int)(sizeof (pb_sizes) / sizeof (pb_sizes[0]))
+
+/* odd size for the output check, to exercise the loop tails. */
+#define PB_CHECK_WIDTH  722
+#define PB_CHECK_HEIGHT 578
+
+typedef struct {
+  const uint8_t *ptr;
+  int pitch, bytes, rows;
+} pb_plane_t;
+
+typedef struct {
+  int width, height;
+  /* sources */
+  uint8_t *y, *u, *v, *uv, *yuy2, *rgb;
+  int y_pitch, uv_pitch, nv_pitch, yuy2_pitch, rgb_pitch;
+  /* destination */
+  uint8_t *out[3];
+  int out_pitch[3];
+  /* helpers */
+  rgb2yuy2_t *rgb2yuy2;
+  yuv2rgb_t *rgb32, *rgb16;
+  vo_overlay_t overlay;
+  alphablend_t blend;
+} pb_frame_t;
+
+typedef struct {
+  xine_t *xine;
+  yuv2rgb_factory_t *factory32, *factory16;
+} pb_ctx_t;
+
+static uint32_t pb_seed;
+
+static void pb_fill (uint8_t *p, size_t size) {
+  while (size--) {
+    pb_seed = pb_seed * 1103515245 + 12345;
+    *p++ = pb_seed >> 16;
+  }
+}
+
+static void pb_frame_free (pb_frame_t *f) {
+  int i;
+
+  xine_freep_aligned (&f->y);
+  xine_freep_aligned (&f->u);
+  xine_freep_aligned (&f->v);
+  xine_freep_aligned (&f->uv);
+  xine_freep_aligned (&f->yuy2);
+  xine_freep_aligned (&f->rgb);
+  for (i = 0; i < 3; i++)
+    xine_freep_aligned (&f->out[i]);
+  if (f->rgb2yuy2)
+    rgb2yuy2_free (f->rgb2yuy2);
+  if (f->rgb32)
+    f->rgb32->dispose (f->rgb32);
+  if (f->rgb16)
+    f->rgb16->dispose (f->rgb16);
+  free (f->overlay.rle);
+  _x_alphablend_free (&f->blend);
+  memset (f, 0, sizeof (*f));
+}
+
+static int pb_frame_init (pb_ctx_t *ctx, pb_frame_t *f, int width, int height) {
+  int w2 = (width + 1) >> 1, h2 = (height + 1) >> 1, x, y, i, n;
+  rle_elem_t *rle;
+
+  memset (f, 0, sizeof (*f));
+  f->width  = width;
+  f->height = height;
+
+  f->y_pitch    = (width + 31) & ~31;
+  f->uv_pitch   = (w2 + 31) & ~31;
+  f->nv_pitch   = (2 * w2 + 31) & ~31;
+  f->yuy2_pitch = (2 * width + 31) & ~31;
+  f->rgb_pitch  = (3 * width + 31) & ~31;
+  f->out_pitch[0] = (4 * width + 31) & ~31;
+  f->out_pitch[1] = f->out_pitch[2] = (2 * w2 + 31) & ~31;
+
+  pb_seed = width * height;
+  f->y    = xine_mallocz_aligned (f->y_pitch * height);
+  f->u    = xine_mallocz_aligned (f->uv_pitch * h2);
+  f->v    = xine_mallocz_aligned (f->uv_pitch * h2);
+  f->uv   = xine_mallocz_aligned (f->nv_pitch * h2);
+  f->yuy2 = xine_mallocz_aligned (f->yuy2_pitch * height);
+  f->rgb  = xine_mallocz_aligned (f->rgb_pitch * height);
+  for (i = 0; i < 3; i++)
+    f->out[i] = xine_mallocz_aligned (f->out_pitch[i] * (i ? h2 : height));
+  if (!f->y || !f->u || !f->v || !f->uv || !f->yuy2 || !f->rgb || !f->out[0] || !f->out[1] || !f->out[2])
+    goto fail;
+  pb_fill (f->y, f->y_pitch * height);
+  pb_fill (f->u, f->uv_pitch * h2);
+  pb_fill (f->v, f->uv_pitch * h2);
+  pb_fill (f->uv, f->nv_pitch * h2);
+  pb_fill (f->yuy2, f->yuy2_pitch * height);
+  pb_fill (f->rgb, f->rgb_pitch * height);
+
+  f->rgb2yuy2 = rgb2yuy2_alloc (CM_SD, "rgb");
+  f->rgb32 = ctx->factory32->create_converter (ctx->factory32);
+  f->rgb16 = ctx->factory16->create_converter (ctx->factory16);
+  if (!f->rgb2yuy2 || !f->rgb32 || !f->rgb16)
+    goto fail;
+
+  /* a full frame overlay with short runs of all transparency levels,
+   * and a highlight area in the middle. */
+  n = height * (width / 7 + 1);
+  rle = f->overlay.rle = malloc (n * sizeof (*rle));
+  if (!rle)
+    goto fail;
+  i = 0;
+  for (y = 0; y < height; y++) {
+    for (x = 0; x < width; x += rle[-1].len) {
+      rle->len = 7 + (i * 13) % 64;
+      if (rle->len > width - x)
+        rle->len = width - x;
+      rle->color = i & (OVL_PALETTE_SIZE - 1);
+      rle++;
+      i++;
+    }
+  }
+  f->overlay.num_rle   = rle - f->overlay.rle;
+  f->overlay.data_size = n * sizeof (*rle);
+  f->overlay.width     = width;
+  f->overlay.height    = height;
+  pb_fill ((uint8_t *)f->overlay.color, sizeof (f->overlay.color));
+  pb_fill ((uint8_t *)f->overlay.hili_color, sizeof (f->overlay.hili_color));
+  for (i = 0; i < OVL_PALETTE_SIZE; i++) {
+    f->overlay.trans[i] = i;
+    f->overlay.hili_trans[i] = 15 - i;
+  }
+  f->overlay.hili_top    = height / 4;
+  f->overlay.hili_bottom = height * 3 / 4;
+  f->overlay.hili_left   = width / 4;
+  f->overlay.hili_right  = width * 3 / 4;
+  _x_alphablend_init (&f->blend, ctx->xine);
+  return 1;
+
+ fail:
+  pb_frame_free (f);
+  return 0;
+}
+
+/*
+ * kernels
+ */
+
+typedef struct {
+  const char *name;
+  /* called once before a series of runs. */
+  void (*prepare) (pb_frame_t *f);
+  /* returns the number of output planes. */
+  int (*run) (pb_frame_t *f, pb_plane_t *planes);
+  /* the accel flag of the level that higher levels shall match exactly, or 0 for C. */
+  uint32_t ref;
+  /* known rounding difference per colour component against C, for levels that
+   * cannot be checked against ref. output is rgb565 if rgb565 is set. */
+  uint8_t tol, rgb565;
+} pb_kernel_t;
+
+/* yuv2rgb SSE2, AVX2 and NEON use the MMX arithmetic, not the C tables. */
+#if defined(__i386__) || defined(__x86_64__)
+#  define PB_REF_MMX MM_ACCEL_X86_MMX
+#else
+#  define PB_REF_MMX 0
+#endif
+
+#define PB_PLANE(n,p,b,r) do { \
+  planes[n].ptr = f->out[p]; planes[n].pitch = f->out_pitch[p]; \
+  planes[n].bytes = (b); planes[n].rows = (r); \
+} while (0)
+
+static int pb_yv12_planes (pb_frame_t *f, pb_plane_t *planes) {
+  PB_PLANE (0, 0, f->width, f->height);
+  PB_PLANE (1, 1, (f->width + 1) >> 1, (f->height + 1) >> 1);
+  PB_PLANE (2, 2, (f->width + 1) >> 1, (f->height + 1) >> 1);
+  return 3;
+}
+
+static int pb_yv12_to_yuy2 (pb_frame_t *f, pb_plane_t *planes) {
+  yv12_to_yuy2 (f->y, f->y_pitch, f->u, f->uv_pitch, f->v, f->uv_pitch,
+    f->out[0], f->out_pitch[0], f->width, f->height, 1);
+  PB_PLANE (0, 0, 2 * f->width, f->height);
+  return 1;
+}
+
+static int pb_yv12_to_yuy2_i (pb_frame_t *f, pb_plane_t *planes) {
+  yv12_to_yuy2 (f->y, f->y_pitch, f->u, f->uv_pitch, f->v, f->uv_pitch,
+    f->out[0], f->out_pitch[0], f->width, f->height, 0);
+  PB_PLANE (0, 0, 2 * f->width, f->height);
+  return 1;
+}
+
+static int pb_yuy2_to_yv12 (pb_frame_t *f, pb_plane_t *planes) {
+  yuy2_to_yv12 (f->yuy2, f->yuy2_pitch, f->out[0], f->out_pitch[0],
+    f->out[1], f->out_pitch[1], f->out[2], f->out_pitch[2], f->width, f->height);
+  return pb_yv12_planes (f, planes);
+}
+
+static int pb_rgb2yv12_slice (pb_frame_t *f, pb_plane_t *planes) {
+  rgb2yv12_slice (f->rgb2yuy2, f->rgb, f->rgb_pitch, f->out[0], f->out_pitch[0],
+    f->out[1], f->out_pitch[1], f->out[2], f->out_pitch[2], f->width, f->height);
+  return pb_yv12_planes (f, planes);
+}
+
+static int pb_nv12_to_yv12 (pb_frame_t *f, pb_plane_t *planes) {
+  _x_nv12_to_yv12 (f->y, f->y_pitch, f->uv, f->nv_pitch, f->out[0], f->out_pitch[0],
+    f->out[1], f->out_pitch[1], f->out[2], f->out_pitch[2], f->width, f->height);
+  return pb_yv12_planes (f, planes);
+}
+
+static int pb_yuy2_to_nv12 (pb_frame_t *f, pb_plane_t *planes) {
+  _x_yuy2_to_nv12 (f->yuy2, f->yuy2_pitch, f->out[0], f->out_pitch[0],
+    f->out[1], f->out_pitch[1], f->width, f->height);
+  PB_PLANE (0, 0, f->width, f->height);
+  PB_PLANE (1, 1, 2 * ((f->width + 1) >> 1), (f->height + 1) >> 1);
+  return 2;
+}
+
+static int pb_yuv2rgb_rgb32 (pb_frame_t *f, pb_plane_t *planes) {
+  f->rgb32->configure (f->rgb32, f->width, f->height, f->y_pitch, f->uv_pitch,
+    f->width, f->height, f->out_pitch[0]);
+  f->rgb32->yuv2rgb_frame_fun (f->rgb32, f->out[0], f->y, f->u, f->v);
+  /* C and MMX only convert whole groups of 8 pixels. */
+  PB_PLANE (0, 0, 4 * (f->width & ~7), f->height);
+  return 1;
+}
+
+static int pb_yuv2rgb_rgb16 (pb_frame_t *f, pb_plane_t *planes) {
+  f->rgb16->configure (f->rgb16, f->width, f->height, f->y_pitch, f->uv_pitch,
+    f->width, f->height, f->out_pitch[0]);
+  f->rgb16->yuv2rgb_frame_fun (f->rgb16, f->out[0], f->y, f->u, f->v);
+  PB_PLANE (0, 0, 2 * (f->width & ~7), f->height);
+  return 1;
+}
+
+static int pb_yuy22rgb_rgb32 (pb_frame_t *f, pb_plane_t *planes) {
+  f->rgb32->configure (f->rgb32, f->width, f->height, f->yuy2_pitch, 0,
+    f->width, f->height, f->out_pitch[0]);
+  f->rgb32->yuy22rgb_frame_fun (f->rgb32, f->out[0], f->yuy2);
+  PB_PLANE (0, 0, 4 * (f->width & ~7), f->height);
+  return 1;
+}
+
+static void pb_blend_yuv_prepare (pb_frame_t *f) {
+  int h2 = (f->height + 1) >> 1;
+
+  memcpy (f->out[0], f->y, f->y_pitch * f->height);
+  memcpy (f->out[1], f->u, f->uv_pitch * h2);
+  memcpy (f->out[2], f->v, f->uv_pitch * h2);
+}
+
+static int pb_blend_yuv (pb_frame_t *f, pb_plane_t *planes) {
+  int pitches[3];
+
+  pitches[0] = f->y_pitch;
+  pitches[1] = pitches[2] = f->uv_pitch;
+  _x_blend_yuv (f->out, &f->overlay, f->width, f->height, pitches, &f->blend);
+  planes[0].ptr = f->out[0]; planes[0].pitch = f->y_pitch;
+  planes[0].bytes = f->width; planes[0].rows = f->height;
+  planes[1].ptr = f->out[1]; planes[1].pitch = f->uv_pitch;
+  planes[1].bytes = (f->width + 1) >> 1; planes[1].rows = (f->height + 1) >> 1;
+  planes[2] = planes[1];
+  planes[2].ptr = f->out[2];
+  return 3;
+}
+
+static void pb_blend_yuy2_prepare (pb_frame_t *f) {
+  memcpy (f->out[0], f->yuy2, f->yuy2_pitch * f->height);
+}
+
+static int pb_blend_yuy2 (pb_frame_t *f, pb_plane_t *planes) {
+  _x_blend_yuy2 (f->out[0], &f->overlay, f->width, f->height, f->yuy2_pitch, &f->blend);
+  planes[0].ptr = f->out[0]; planes[0].pitch = f->yuy2_pitch;
+  planes[0].bytes = 2 * f->width; planes[0].rows = f->height;
+  return 1;
+}
+
+static const pb_kernel_t pb_kernels[] = {
+  { "yv12_to_yuy2",   NULL, pb_yv12_to_yuy2, 0, 0, 0 },
+  { "yv12_to_yuy2_i", NULL, pb_yv12_to_yuy2_i, 0, 0, 0 },
+  { "yuy2_to_yv12",   NULL, pb_yuy2_to_yv12, 0, 0, 0 },
+  { "rgb2yv12_slice", NULL, pb_rgb2yv12_slice, 0, 0, 0 },
+  { "nv12_to_yv12",   NULL, pb_nv12_to_yv12, 0, 0, 0 },
+  { "yuy2_to_nv12",   NULL, pb_yuy2_to_nv12, 0, 0, 0 },
+  { "yuv2rgb_rgb32",  NULL, pb_yuv2rgb_rgb32, PB_REF_MMX, 2, 0 },
+  { "yuv2rgb_rgb16",  NULL, pb_yuv2rgb_rgb16, PB_REF_MMX, 1, 1 },
+  /* there is no MMX yuy22rgb. */
+  { "yuy22rgb_rgb32", NULL, pb_yuy22rgb_rgb32, 0, 2, 0 },
+  { "blend_yuv",      pb_blend_yuv_prepare,  pb_blend_yuv, 0, 0, 0 },
+  { "blend_yuy2",     pb_blend_yuy2_prepare, pb_blend_yuy2, 0, 0, 0 }
+};
+#define PB_NUM_KERNELS (int)(sizeof (pb_kernels) / sizeof (pb_kernels[0]))
+
+/*
+ * child -> parent messages
+ */
+
+typedef enum {
+  PB_MSG_DONE = 0,
+  PB_MSG_SPEED,
+  PB_MSG_CHECK
+} pb_msg_type_t;
+
+typedef struct {
+  int type;
+  int kernel;
+  int size;
+  int len;
+  double mpix;
+} pb_msg_t;
+
+static int pb_write (int fd, const void *buf, size_t len) {
+  const uint8_t *p = buf;
+
+  while (len > 0) {
+    ssize_t r = write (fd, p, len);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return 0;
+    }
+    p += r;
+    len -= r;
+  }
+  return 1;
+}
+
+static int pb_read (int fd, void *buf, size_t len) {
+  uint8_t *p = buf;
+
+  while (len > 0) {
+    ssize_t r = read (fd, p, len);
+    if (r < 0) {
+      if (errno == EINTR)
+        continue;
+      return 0;
+    }
+    if (r == 0)
+      return 0;
+    p += r;
+    len -= r;
+  }
+  return 1;
+}
+
+/*
+ * child side
+ */
+
+static double pb_speed (const pb_kernel_t *k, pb_frame_t *f, int msec) {
+  pb_plane_t planes[3];
+  struct timeval t0, t1;
+  double usec;
+  int n = 0;
+
+  if (k->prepare)
+    k->prepare (f);
+  /* warm up caches and lazy inits. */
+  k->run (f, planes);
+  xine_monotonic_clock (&t0, NULL);
+  do {
+    k->run (f, planes);
+    n++;
+    xine_monotonic_clock (&t1, NULL);
+    usec = (double)(t1.tv_sec - t0.tv_sec) * 1e6 + (double)(t1.tv_usec - t0.tv_usec);
+  } while (usec < msec * 1000.0);
+  return (double)f->width * f->height * n / usec;
+}
+
+static int pb_check (int fd, int kernel, pb_frame_t *f) {
+  const pb_kernel_t *k = pb_kernels + kernel;
+  pb_plane_t planes[3];
+  pb_msg_t msg;
+  int n, i, y;
+
+  for (i = 0; i < 3; i++)
+    memset (f->out[i], 0, f->out_pitch[i] * (i ? (f->height + 1) >> 1 : f->height));
+  if (k->prepare)
+    k->prepare (f);
+  n = k->run (f, planes);
+
+  memset (&msg, 0, sizeof (msg));
+  msg.type   = PB_MSG_CHECK;
+  msg.kernel = kernel;
+  msg.size   = -1;
+  for (i = 0; i < n; i++)
+    msg.len += planes[i].bytes * planes[i].rows;
+  if (!pb_write (fd, &msg, sizeof (msg)))
+    return 0;
+  for (i = 0; i < n; i++) {
+    for (y = 0; y < planes[i].rows; y++) {
+      if (!pb_write (fd, planes[i].ptr + y * planes[i].pitch, planes[i].bytes))
+        return 0;
+    }
+  }
+  return 1;
+}
+
+static int pb_child (int fd, uint32_t mask, const uint8_t *enable, int msec) {
+  pb_ctx_t ctx;
+  pb_frame_t frame;
+  pb_msg_t msg;
+  char buf[32];
+  int s, k, ok = 1;
+
+  snprintf (buf, sizeof (buf), "0x%08x", (unsigned int)mask);
+  setenv ("XINE_ACCEL_MASK", buf, 1);
+
+  ctx.xine = xine_new ();
+  if (!ctx.xine)
+    return 1;
+  xine_set_flags (ctx.xine, XINE_FLAG_NO_WRITE_CACHE);
+  xine_engine_set_param (ctx.xine, XINE_ENGINE_PARAM_VERBOSITY, XINE_VERBOSITY_NONE);
+  /* sets up xine_fast_memcpy and the color tables. */
+  xine_init (ctx.xine);
+
+  ctx.factory32 = yuv2rgb_factory_init (MODE_32_RGB, 0, NULL);
+  ctx.factory16 = yuv2rgb_factory_init (MODE_16_RGB, 0, NULL);
+  if (!ctx.factory32 || !ctx.factory16)
+    ok = 0;
+
+  if (ok && pb_frame_init (&ctx, &frame, PB_CHECK_WIDTH, PB_CHECK_HEIGHT)) {
+    for (k = 0; ok && (k < PB_NUM_KERNELS); k++) {
+      if (enable[k])
+        ok = pb_check (fd, k, &frame);
+    }
+    pb_frame_free (&frame);
+  }
+
+  for (s = 0; ok && (s < PB_NUM_SIZES); s++) {
+    if (!pb_frame_init (&ctx, &frame, pb_sizes[s].width, pb_sizes[s].height))
+      continue;
+    for (k = 0; ok && (k < PB_NUM_KERNELS); k++) {
+      if (!enable[k])
+        continue;
+      memset (&msg, 0, sizeof (msg));
+      msg.type   = PB_MSG_SPEED;
+      msg.kernel = k;
+      msg.size   = s;
+      msg.mpix   = pb_speed (pb_kernels + k, &frame, msec);
+      ok = pb_write (fd, &msg, sizeof (msg));
+    }
+    pb_frame_free (&frame);
+  }
+
+  if (ok) {
+    memset (&msg, 0, sizeof (msg));
+    msg.type = PB_MSG_DONE;
+    ok = pb_write (fd, &msg, sizeof (msg));
+  }
+
+  if (ctx.factory32)
+    ctx.factory32->dispose (ctx.factory32);
+  if (ctx.factory16)
+    ctx.factory16->dispose (ctx.factory16);
+  xine_exit (ctx.xine);
+  return !ok;
+}
+
+/*
+ * parent side
+ */
+
+typedef struct {
+  const char *name;
+  uint32_t mask;
+  double speed[PB_NUM_KERNELS][PB_NUM_SIZES];
+  uint8_t *out[PB_NUM_KERNELS];
+  int len[PB_NUM_KERNELS];
+  int ok;
+} pb_level_t;
+
+static const struct {
+  const char *name;
+  uint32_t flag;
+} pb_accel_flags[] = {
+#if defined(__i386__) || defined(__x86_64__)
+  { "mmx",    MM_ACCEL_X86_MMX },
+  { "mmxext", MM_ACCEL_X86_MMXEXT },
+  { "sse2",   MM_ACCEL_X86_SSE2 },
+  { "avx2",   MM_ACCEL_X86_AVX2 },
+#endif
+#if defined(__arm__) || defined(__aarch64__)
+  { "neon",   MM_ACCEL_ARM_NEON },
+#endif
+  { NULL, 0 }
+};
+
+#define PB_MAX_LEVELS 8
+
+static pid_t pb_spawn (int *fd, uint32_t mask, const uint8_t *enable, int msec) {
+  int fds[2];
+  pid_t pid;
+
+  if (pipe (fds) < 0)
+    return -1;
+  fflush (stdout);
+  pid = fork ();
+  if (pid == 0) {
+    close (fds[0]);
+    _exit (pb_child (fds[1], mask, enable, msec));
+  }
+  close (fds[1]);
+  if (pid < 0) {
+    close (fds[0]);
+    return -1;
+  }
+  *fd = fds[0];
+  return pid;
+}
+
+static uint32_t pb_probe_accel (void) {
+  uint32_t accel = 0;
+  int fds[2];
+  pid_t pid;
+
+  /* keep the parent free of the cached value. */
+  if (pipe (fds) < 0)
+    return 0;
+  pid = fork ();
+  if (pid == 0) {
+    close (fds[0]);
+    accel = xine_mm_accel ();
+    _exit (!pb_write (fds[1], &accel, sizeof (accel)));
+  }
+  close (fds[1]);
+  if (pid > 0) {
+    if (!pb_read (fds[0], &accel, sizeof (accel)))
+      accel = 0;
+    waitpid (pid, NULL, 0);
+  }
+  close (fds[0]);
+  return accel;
+}
+
+static int pb_run_level (pb_level_t *level, const uint8_t *enable, int msec) {
+  pb_msg_t msg;
+  pid_t pid;
+  int fd, status;
+
+  pid = pb_spawn (&fd, level->mask, enable, msec);
+  if (pid < 0)
+    return 0;
+  while (pb_read (fd, &msg, sizeof (msg))) {
+    if (msg.type == PB_MSG_DONE) {
+      level->ok = 1;
+      break;
+    }
+    if ((msg.kernel < 0) || (msg.kernel >= PB_NUM_KERNELS))
+      break;
+    if (msg.type == PB_MSG_SPEED) {
+      if ((msg.size >= 0) && (msg.size < PB_NUM_SIZES))
+        level->speed[msg.kernel][msg.size] = msg.mpix;
+    } else if (msg.type == PB_MSG_CHECK) {
+      uint8_t *buf = malloc (msg.len);
+      if (!buf || !pb_read (fd, buf, msg.len)) {
+        free (buf);
+        break;
+      }
+      free (level->out[msg.kernel]);
+      level->out[msg.kernel] = buf;
+      level->len[msg.kernel] = msg.len;
+    }
+  }
+  close (fd);
+  waitpid (pid, &status, 0);
+  return level->ok;
+}
+
+static void pb_compare (const uint8_t *a, const uint8_t *b, int len, int rgb565, int *diff, int *max) {
+  int i;
+
+  *diff = *max = 0;
+  if (rgb565) {
+    for (i = 0; i + 1 < len; i += 2) {
+      int pa = a[i] | (a[i + 1] << 8), pb = b[i] | (b[i + 1] << 8), c;
+      for (c = 0; c < 3; c++) {
+        static const uint8_t shift[3] = { 0, 5, 11 }, mask[3] = { 31, 63, 31 };
+        int va = (pa >> shift[c]) & mask[c], vb = (pb >> shift[c]) & mask[c];
+        int d = va > vb ? va - vb : vb - va;
+        if (d) {
+          (*diff)++;
+          if (d > *max)
+            *max = d;
+        }
+      }
+    }
+    return;
+  }
+  for (i = 0; i < len; i++) {
+    int d = a[i] > b[i] ? a[i] - b[i] : b[i] - a[i];
+    if (d) {
+      (*diff)++;
+      if (d > *max)
+        *max = d;
+    }
+  }
+}
+
+static void pb_print_check (const pb_level_t *levels, int l, int k) {
+  const pb_kernel_t *kernel = pb_kernels + k;
+  const pb_level_t *ref = levels, *level = levels + l;
+  char buf[32];
+  int diff, max, i, tol = 0;
+
+  /* the first level with the ref flag is the reference for the levels above it.
+   * that one itself, and levels without such a reference, are checked against C. */
+  if (kernel->ref) {
+    for (i = 1; i < l; i++) {
+      if (levels[i].mask & kernel->ref) {
+        ref = levels + i;
+        break;
+      }
+    }
+  }
+  if (ref == levels)
+    tol = kernel->tol;
+
+  if (!ref->out[k] || !level->out[k] || (ref->len[k] != level->len[k])) {
+    printf (" %12s", "n/a");
+    return;
+  }
+  pb_compare (ref->out[k], level->out[k], ref->len[k], kernel->rgb565, &diff, &max);
+  if (!diff)
+    snprintf (buf, sizeof (buf), "ok");
+  else if (max <= tol)
+    snprintf (buf, sizeof (buf), "~%d", max);
+  else
+    snprintf (buf, sizeof (buf), "%d@%d", diff, max);
+  printf (" %12s", buf);
+}
+
+int main (int argc, char *argv[])
+{
+  pb_level_t levels[PB_MAX_LEVELS];
+  uint8_t enable[PB_NUM_KERNELS];
+  const char *filter = NULL;
+  uint32_t accel;
+  int optstate = 0, msec = 200;
+  int num_levels, i, k, s;
+
+  for (;;)
+  {
+#define OPTS "hvk:t:"
+#ifdef HAVE_GETOPT_LONG
+    static const struct option longopts[] = {
+      { "help", no_argument, NULL, 'h' },
+      { "version", no_argument, NULL, 'v' },
+      { "kernel", required_argument, NULL, 'k' },
+      { "time", required_argument, NULL, 't' },
+      { NULL, no_argument, NULL, 0 }
+    };
+    int index = 0;
+    int opt = getopt_long (argc, argv, OPTS, longopts, &index);
+#else
+    int opt = getopt(argc, argv, OPTS);
+#endif
+    if (opt == -1)
+      break;
+
+    switch (opt)
+    {
+    case 'h':
+      optstate |= 1;
+      break;
+    case 'v':
+      optstate |= 4;
+      break;
+    case 'k':
+      filter = optarg;
+      break;
+    case 't':
+      msec = atoi (optarg);
+      if (msec < 1)
+        optstate |= 2;
+      break;
+    default:
+      optstate |= 2;
+      break;
+    }
+  }
+
+  if (optstate & 1)
+    printf ("\
+xine-pixbench-"XINE_PIXBENCH_VERSION" %s\n\
+using xine-lib %s\n\
+usage: %s [options]\n\
+options:\n\
+  -h, --help		this help text\n\
+  -k, --kernel NAME	run only kernels whose name contains NAME\n\
+  -t, --time MSEC	time to spend per kernel and frame size (200)\n\
+\n\
+Speeds are in MPix/s. The check row lists differing values@max difference\n\
+against the C level, on a %dx%d frame. yuv2rgb SSE2, AVX2 and NEON use the\n\
+MMX arithmetic: they are checked against the MMX level when there is one, and\n\
+else shown as ~N when within the known rounding difference N to C.\n\
+\n", XINE_VERSION, xine_get_version_string (), argv[0], PB_CHECK_WIDTH, PB_CHECK_HEIGHT);
+  else if (optstate & 4)
+    printf ("\
+xine-pixbench %s\n\
+using xine-lib %s\n\
+(c) 2021 the xine project team\n\
+This is free software; see the source for copying conditions.  There is NO\n\
+warranty; not even for MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE,\n\
+to the extent permitted by law.\n",
+	     XINE_VERSION, xine_get_version_string ());
+
+  if (optstate & 2)
+  {
+    fputs ("xine-pixbench: invalid option (try -h or --help)\n", stderr);
+    return 1;
+  }
+
+  if (optstate)
+    return 0;
+
+  for (k = 0; k < PB_NUM_KERNELS; k++)
+    enable[k] = !filter || strstr (pb_kernels[k].name, filter);
+
+  /* the C level, and every supported level above.
+   * flags are sorted by descending value within an arch. */
+  accel = pb_probe_accel ();
+  memset (levels, 0, sizeof (levels));
+  levels[0].name = "c";
+  levels[0].mask = 0;
+  num_levels = 1;
+  for (i = 0; pb_accel_flags[i].name && (num_levels < PB_MAX_LEVELS); i++) {
+    if (!(accel & pb_accel_flags[i].flag))
+      continue;
+    levels[num_levels].name = pb_accel_flags[i].name;
+    levels[num_levels].mask = accel & ~(pb_accel_flags[i].flag - 1);
+    num_levels++;
+  }
+
+  for (i = 0; i < num_levels; i++) {
+    fprintf (stderr, "xine-pixbench: running level %s (mask 0x%08x).\n",
+      levels[i].name, (unsigned int)levels[i].mask);
+    if (!pb_run_level (levels + i, enable, msec))
+      fprintf (stderr, "xine-pixbench: level %s failed.\n", levels[i].name);
+  }
+
+  printf ("%-16s %-10s", "kernel", "size");
+  for (i = 0; i < num_levels; i++)
+    printf (" %12s", levels[i].name);
+  printf ("\n");
+  for (k = 0; k < PB_NUM_KERNELS; k++) {
+    if (!enable[k])
+      continue;
+    for (s = 0; s < PB_NUM_SIZES; s++) {
+      char buf[32];
+      snprintf (buf, sizeof (buf), "%dx%d", pb_sizes[s].width, pb_sizes[s].height);
+      printf ("%-16s %-10s", pb_kernels[k].name, buf);
+      for (i = 0; i < num_levels; i++)
+        printf (" %12.1f", levels[i].speed[k][s]);
+      printf ("\n");
+    }
+    printf ("%-16s %-10s %12s", pb_kernels[k].name, "check", "ref");
+    for (i = 1; i < num_levels; i++)
+      pb_print_check (levels, i, k);
+    printf ("\n");
+  }
+
+  for (i = 0; i < num_levels; i++) {
+    for (k = 0; k < PB_NUM_KERNELS; k++)
+      free (levels[i].out[k]);
+  }
+  for (i = 0; i < num_levels; i++) {
+    if (!levels[i].ok)
+      return 1;
+  }
+  return 0;
+}
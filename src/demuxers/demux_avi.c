@@ -63,6 +63,8 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
 
 #define LOG_MODULE "demux_avi"
 #define LOG_VERBOSE
@@ -175,6 +177,27 @@ typedef struct{
                             /* to find the next A/V frame */
 } idx_grow_t;
 
+/* The background index scanner reads a clone of the input, and stages
+ * what it finds here until the demux thread merges it into the real
+ * indices. While it runs, it is the only one that grows the index. */
+typedef struct{
+  input_plugin_t   *input;
+  pthread_t         thread;
+  int               quit;
+
+  /* scan thread only, until it has finished */
+  uint32_t          block_no[MAX_AUDIO_STREAMS];
+  off_t             audio_tot[MAX_AUDIO_STREAMS];
+
+  pthread_mutex_t   mutex;
+  pthread_cond_t    cond;
+  /* protected by mutex */
+  int               running;
+  off_t             nexttagoffset;
+  video_index_t     video_idx;
+  audio_index_t     audio_idx[MAX_AUDIO_STREAMS];
+} idx_scan_t;
+
 
 typedef struct{
   uint32_t  dwInitialFrames;
@@ -260,6 +283,7 @@ typedef struct demux_avi_s {
   avi_t               *avi;
 
   idx_grow_t           idx_grow;
+  idx_scan_t          *idx_scan;
 
   uint8_t              no_audio:1;
 
@@ -359,9 +383,7 @@ static void check_newpts (demux_avi_t *this, int64_t pts, int video) {
 }
 
 /* Append an index entry for a newly-found video frame */
-static int video_index_append(avi_t *AVI, off_t pos, uint32_t len, uint32_t flags) {
-  video_index_t *vit = &(AVI->video_idx);
-
+static int video_index_append(video_index_t *vit, off_t pos, uint32_t len, uint32_t flags) {
   /* Make sure there's room */
   if (vit->video_frames == vit->alloc_frames) {
     long newalloc = vit->alloc_frames + 4096;
@@ -382,10 +404,8 @@ static int video_index_append(avi_t *AVI, off_t pos, uint32_t len, uint32_t flag
 }
 
 /* Append an index entry for a newly-found audio frame */
-static int audio_index_append(avi_t *AVI, int stream, off_t pos, uint32_t len,
+static int audio_index_append(audio_index_t *ait, off_t pos, uint32_t len,
                               off_t tot, uint32_t block_no) {
-  audio_index_t *ait = &(AVI->audio[stream]->audio_idx);
-
   /* Make sure there's room */
   if (ait->audio_chunks == ait->alloc_chunks) {
     uint32_t newalloc = ait->alloc_chunks + 4096;
@@ -501,6 +521,271 @@ static int start_time_stopper(demux_avi_t *this, void *data) {
   return -1;
 }
 
+/* Returns the index flags of the video chunk whose data input is at, or -1.
+ * FIXME:
+ *   UGLY hack to detect a keyframe parsing decoder data
+ *   AVI chuncks doesn't provide this info and we need it during
+ *   index building
+ *   this hack comes from mplayer (aviheader.c)
+ *   i've added XVID which looks like iso mpeg 4
+ */
+static int idx_video_flags(demux_avi_t *this, input_plugin_t *input) {
+  uint8_t  data2[4];
+  uint32_t tmp;
+  int      flags = AVIIF_KEYFRAME;
+
+  if (input->read(input, data2, 4) != 4)
+    return -1;
+  tmp = data2[3] | (data2[2]<<8) | (data2[1]<<16) | (data2[0]<<24);
+  switch(this->avi->video_type) {
+    case BUF_VIDEO_MSMPEG4_V1:
+      if (input->read(input, data2, 4) != 4)
+        return -1;
+      tmp = data2[3] | (data2[2]<<8) | (data2[1]<<16) | (data2[0]<<24);
+      tmp = tmp << 5;
+      /* fall through */
+    case BUF_VIDEO_MSMPEG4_V2:
+    case BUF_VIDEO_MSMPEG4_V3:
+      if (tmp & 0x40000000) flags = 0;
+      break;
+    case BUF_VIDEO_DIVX5:
+    case BUF_VIDEO_MPEG4:
+    case BUF_VIDEO_XVID:
+      if (tmp == 0x000001B6) flags = 0;
+      break;
+  }
+  return flags;
+}
+
+static void idx_progress(demux_avi_t *this, int percent) {
+  xine_event_t             event;
+  xine_progress_data_t     prg;
+
+  prg.description = _("Restoring index...");
+  prg.percent = percent;
+
+  event.type = XINE_EVENT_PROGRESS;
+  event.data = &prg;
+  event.data_length = sizeof (xine_progress_data_t);
+
+  xine_event_send (this->stream, &event);
+}
+
+static void *idx_scan_loop(void *data) {
+  demux_avi_t    *this = (demux_avi_t *)data;
+  idx_scan_t     *scan = this->idx_scan;
+  input_plugin_t *input = scan->input;
+  uint8_t         head[AVI_HEADER_SIZE];
+  off_t           chunk_pos = scan->nexttagoffset;
+  int             num_read = 0;
+
+  while (!scan->quit) {
+    off_t    next;
+    uint32_t chunk_len;
+    int      i;
+
+    if ((input->seek(input, chunk_pos, SEEK_SET) != chunk_pos) ||
+        (input->read(input, head, AVI_HEADER_SIZE) != AVI_HEADER_SIZE))
+      break;
+
+    /* Dive into RIFF and LIST entries */
+    if (strncasecmp(head, "LIST", 4) == 0 ||
+        strncasecmp(head, "RIFF", 4) == 0) {
+      chunk_pos += AVI_HEADER_SIZE + 4;
+      continue;
+    }
+
+    chunk_len = _X_LE_32(head + 4);
+    next = chunk_pos + PAD_EVEN(chunk_len + AVI_HEADER_SIZE);
+
+    if ((head[0] == this->avi->video_tag[0]) &&
+        (head[1] == this->avi->video_tag[1])) {
+      int flags = idx_video_flags(this, input);
+      if (flags < 0)
+        break;
+      pthread_mutex_lock(&scan->mutex);
+      video_index_append(&scan->video_idx, chunk_pos + AVI_HEADER_SIZE, chunk_len, flags);
+      pthread_mutex_unlock(&scan->mutex);
+    } else {
+      for (i = 0; i < this->avi->n_audio; i++) {
+        avi_audio_t *audio = this->avi->audio[i];
+        if ((head[0] == audio->audio_tag[0]) &&
+            (head[1] == audio->audio_tag[1])) {
+          /* VBR streams (hack from mplayer) */
+          if (audio->wavex && audio->wavex->nBlockAlign) {
+            scan->block_no[i] += (chunk_len + audio->wavex->nBlockAlign - 1) /
+                                 audio->wavex->nBlockAlign;
+          } else {
+            scan->block_no[i] += 1;
+          }
+          pthread_mutex_lock(&scan->mutex);
+          audio_index_append(&scan->audio_idx[i], chunk_pos + AVI_HEADER_SIZE, chunk_len,
+                             scan->audio_tot[i], scan->block_no[i]);
+          pthread_mutex_unlock(&scan->mutex);
+          scan->audio_tot[i] += chunk_len;
+          break;
+        }
+      }
+      if (i >= this->avi->n_audio)
+        xine_log(this->stream->xine, XINE_LOG_MSG, _("demux_avi: invalid avi chunk \"%c%c%c%c\" at pos %" PRIdMAX "\n"), head[0], head[1], head[2], head[3], (intmax_t)chunk_pos);
+    }
+
+    chunk_pos = next;
+    pthread_mutex_lock(&scan->mutex);
+    scan->nexttagoffset = chunk_pos;
+    if (!(++num_read & 255))
+      pthread_cond_signal(&scan->cond);
+    pthread_mutex_unlock(&scan->mutex);
+  }
+
+  pthread_mutex_lock(&scan->mutex);
+  scan->running = 0;
+  pthread_cond_signal(&scan->cond);
+  pthread_mutex_unlock(&scan->mutex);
+  return NULL;
+}
+
+/* Build the index in the background, if there is none in the file. */
+static void idx_scan_start(demux_avi_t *this) {
+  idx_scan_t     *scan;
+  input_plugin_t *input = NULL;
+  int             i;
+
+  if (this->has_index || this->streaming || this->idx_scan)
+    return;
+  if (!(this->input->get_capabilities(this->input) & INPUT_CAP_CLONE))
+    return;
+  if ((this->input->get_optional_data(this->input, &input, INPUT_OPTIONAL_DATA_CLONE) != INPUT_OPTIONAL_SUCCESS) ||
+      !input)
+    return;
+  scan = calloc(1, sizeof(*scan));
+  if (!scan) {
+    input->dispose(input);
+    return;
+  }
+
+  scan->input = input;
+  scan->nexttagoffset = this->idx_grow.nexttagoffset;
+  for (i = 0; i < this->avi->n_audio; i++) {
+    scan->block_no[i]  = this->avi->audio[i]->block_no;
+    scan->audio_tot[i] = this->avi->audio[i]->audio_tot;
+  }
+  scan->running = 1;
+  pthread_mutex_init(&scan->mutex, NULL);
+  pthread_cond_init(&scan->cond, NULL);
+
+  this->idx_scan = scan;
+  if (pthread_create(&scan->thread, NULL, idx_scan_loop, this)) {
+    this->idx_scan = NULL;
+    pthread_cond_destroy(&scan->cond);
+    pthread_mutex_destroy(&scan->mutex);
+    input->dispose(input);
+    free(scan);
+    return;
+  }
+  xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+          "demux_avi: building index in the background.\n");
+}
+
+static void idx_scan_stop(demux_avi_t *this) {
+  idx_scan_t *scan = this->idx_scan;
+  int         i;
+
+  if (!scan)
+    return;
+  this->idx_scan = NULL;
+
+  scan->quit = 1;
+  pthread_join(scan->thread, NULL);
+  scan->input->dispose(scan->input);
+  pthread_cond_destroy(&scan->cond);
+  pthread_mutex_destroy(&scan->mutex);
+  free(scan->video_idx.vindex);
+  for (i = 0; i < MAX_AUDIO_STREAMS; i++)
+    free(scan->audio_idx[i].aindex);
+  free(scan);
+}
+
+/* Move what the scanner found into the real indices. When it has finished,
+ * let idx_grow () take over from where it stopped, for growing files. */
+static void idx_scan_merge(demux_avi_t *this) {
+  idx_scan_t *scan = this->idx_scan;
+  uint32_t    u;
+  int         i, running;
+
+  pthread_mutex_lock(&scan->mutex);
+  for (u = 0; u < scan->video_idx.video_frames; u++) {
+    video_index_entry_t *e = &scan->video_idx.vindex[u];
+    video_index_append(&this->avi->video_idx, e->pos, e->len, e->flags);
+  }
+  scan->video_idx.video_frames = 0;
+  for (i = 0; i < this->avi->n_audio; i++) {
+    for (u = 0; u < scan->audio_idx[i].audio_chunks; u++) {
+      audio_index_entry_t *e = &scan->audio_idx[i].aindex[u];
+      audio_index_append(&this->avi->audio[i]->audio_idx, e->pos, e->len, e->tot, e->block_no);
+    }
+    scan->audio_idx[i].audio_chunks = 0;
+  }
+  running = scan->running;
+  pthread_mutex_unlock(&scan->mutex);
+
+  if (!running) {
+    this->idx_grow.nexttagoffset = scan->nexttagoffset;
+    for (i = 0; i < this->avi->n_audio; i++) {
+      this->avi->audio[i]->block_no  = scan->block_no[i];
+      this->avi->audio[i]->audio_tot = scan->audio_tot[i];
+    }
+    xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+            "demux_avi: background index done, %u frames.\n", this->avi->video_idx.video_frames);
+    idx_scan_stop(this);
+  }
+}
+
+/* idx_grow () while the scanner runs: wait for it to find what we need. */
+static int idx_scan_wait(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
+                         void *stopdata) {
+  int retval, waits = 0;
+
+  while (1) {
+    idx_scan_t *scan;
+    off_t       done;
+
+    idx_scan_merge(this);
+    retval = stopper(this, stopdata);
+    scan = this->idx_scan;
+    if ((retval >= 0) || !scan || _x_action_pending(this->stream))
+      break;
+
+    pthread_mutex_lock(&scan->mutex);
+    if (scan->running) {
+      struct timeval  tv;
+      struct timespec ts;
+
+      gettimeofday(&tv, NULL);
+      ts.tv_sec  = tv.tv_sec;
+      ts.tv_nsec = (tv.tv_usec + 100000) * 1000;
+      if (ts.tv_nsec >= 1000000000) {
+        ts.tv_sec  += 1;
+        ts.tv_nsec -= 1000000000;
+      }
+      pthread_cond_timedwait(&scan->cond, &scan->mutex, &ts);
+    }
+    done = scan->nexttagoffset;
+    pthread_mutex_unlock(&scan->mutex);
+
+    /* tell frontend if this takes a while. */
+    if (!(++waits % 10)) {
+      off_t file_len = this->input->get_length (this->input);
+      if (file_len > 0)
+        idx_progress(this, 100 * done / file_len);
+    }
+  }
+
+  if (waits >= 10)
+    idx_progress(this, 100);
+  return retval;
+}
+
 /* This is called periodically to check if there's more file now than
  * there was before.  If there is, we constuct the index for (just) the
  * new part, and append it to the index we've got so far.  We stop
@@ -514,12 +799,18 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
   int           retval = -1;
   int           num_read = 0;
   uint8_t       data[AVI_HEADER_SIZE];
-  uint8_t       data2[4];
   off_t         savepos = this->input->seek(this->input, 0, SEEK_CUR);
   off_t         chunk_pos;
   uint32_t      chunk_len;
   int           sent_event = 0;
 
+  if (this->idx_scan) {
+    retval = idx_scan_wait(this, stopper, stopdata);
+    if ((retval >= 0) || this->idx_scan)
+      return retval < 0 ? -1 : retval;
+    /* scanner is done, see if the file has grown since. */
+  }
+
   this->input->seek(this->input, this->idx_grow.nexttagoffset, SEEK_SET);
   chunk_pos = this->idx_grow.nexttagoffset;
 
@@ -531,22 +822,9 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
 
     if (num_read % 1000 == 0) {
       /* send event to frontend about index generation progress */
+      off_t file_len = this->input->get_length (this->input);
 
-      xine_event_t             event;
-      xine_progress_data_t     prg;
-      off_t                    file_len;
-
-      file_len = this->input->get_length (this->input);
-
-      prg.description = _("Restoring index...");
-      prg.percent = 100 * this->idx_grow.nexttagoffset / file_len;
-
-      event.type = XINE_EVENT_PROGRESS;
-      event.data = &prg;
-      event.data_length = sizeof (xine_progress_data_t);
-
-      xine_event_send (this->stream, &event);
-
+      idx_progress(this, 100 * this->idx_grow.nexttagoffset / file_len);
       sent_event = 1;
     }
 
@@ -571,44 +849,17 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
     if ((data[0] == this->avi->video_tag[0]) &&
         (data[1] == this->avi->video_tag[1])) {
 
-      int flags = AVIIF_KEYFRAME;
       off_t pos = chunk_pos + AVI_HEADER_SIZE;
-      uint32_t tmp;
+      int flags;
 
       valid_chunk = 1;
-      /* FIXME:
-       *   UGLY hack to detect a keyframe parsing decoder data
-       *   AVI chuncks doesn't provide this info and we need it during
-       *   index building
-       *   this hack comes from mplayer (aviheader.c)
-       *   i've added XVID which looks like iso mpeg 4
-       */
-
-      if (this->input->read(this->input, data2, 4) != 4) {
-      read_failed:
+      flags = idx_video_flags(this, this->input);
+      if (flags < 0) {
         lprintf("read failed\n");
         break;
       }
-      tmp = data2[3] | (data2[2]<<8) | (data2[1]<<16) | (data2[0]<<24);
-      switch(this->avi->video_type) {
-        case BUF_VIDEO_MSMPEG4_V1:
-          if (this->input->read(this->input, data2, 4) != 4)
-            goto read_failed;
-          tmp = data2[3] | (data2[2]<<8) | (data2[1]<<16) | (data2[0]<<24);
-          tmp = tmp << 5;
-          /* fall through */
-        case BUF_VIDEO_MSMPEG4_V2:
-        case BUF_VIDEO_MSMPEG4_V3:
-          if (tmp & 0x40000000) flags = 0;
-          break;
-        case BUF_VIDEO_DIVX5:
-        case BUF_VIDEO_MPEG4:
-        case BUF_VIDEO_XVID:
-          if (tmp == 0x000001B6) flags = 0;
-          break;
-      }
 
-      if (video_index_append(this->avi, pos, chunk_len, flags) == -1) {
+      if (video_index_append(&this->avi->video_idx, pos, chunk_len, flags) == -1) {
         /* If we're out of memory, we just don't grow the index, but
          * nothing really bad happens. */
       }
@@ -632,7 +883,7 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
             audio->block_no += 1;
           }
 
-          if (audio_index_append(this->avi, i, pos, chunk_len, audio->audio_tot,
+          if (audio_index_append(&audio->audio_idx, pos, chunk_len, audio->audio_tot,
                                  audio->block_no) == -1) {
             /* As above. */
           }
@@ -652,17 +903,7 @@ static int idx_grow(demux_avi_t *this, int (*stopper)(demux_avi_t *, void *),
 
   if (sent_event == 1) {
     /* send event to frontend about index generation progress */
-    xine_event_t             event;
-    xine_progress_data_t     prg;
-
-    prg.description = _("Restoring index...");
-    prg.percent = 100;
-
-    event.type = XINE_EVENT_PROGRESS;
-    event.data = &prg;
-    event.data_length = sizeof (xine_progress_data_t);
-
-    xine_event_send (this->stream, &event);
+    idx_progress(this, 100);
   }
 
   this->input->seek (this->input, savepos, SEEK_SET);
@@ -1220,7 +1461,7 @@ static avi_t *XINE_MALLOC AVI_init(demux_avi_t *this) {
         uint32_t len = _X_LE_32(AVI->idx[i] + 12);
         uint32_t flags = _X_LE_32(AVI->idx[i] + 4);
 
-        if (video_index_append(AVI, pos, len, flags) == -1) {
+        if (video_index_append(&AVI->video_idx, pos, len, flags) == -1) {
           ERR_EXIT(AVI_ERR_NO_MEM) ;
         }
       } else {
@@ -1241,7 +1482,7 @@ static avi_t *XINE_MALLOC AVI_init(demux_avi_t *this) {
               audio->block_no += 1;
             }
 
-            if (audio_index_append(AVI, n, pos, len, audio->audio_tot,
+            if (audio_index_append(&audio->audio_idx, pos, len, audio->audio_tot,
                                    audio->block_no) == -1) {
               ERR_EXIT(AVI_ERR_NO_MEM) ;
             }
@@ -1311,7 +1552,7 @@ static avi_t *XINE_MALLOC AVI_init(demux_avi_t *this) {
             pos = offset + _X_LE_32(en); en += 4;
             len = odml_len(en);
             flags = odml_key(en); en += 4;
-            video_index_append(AVI, pos, len, flags);
+            video_index_append(&AVI->video_idx, pos, len, flags);
 
 #ifdef DEBUG_ODML
             /*
@@ -1393,7 +1634,7 @@ static avi_t *XINE_MALLOC AVI_init(demux_avi_t *this) {
               audio->block_no += 1;
             }
 
-            audio_index_append(AVI, audtr, pos, len, audio->audio_tot, audio->block_no);
+            audio_index_append(&audio->audio_idx, pos, len, audio->audio_tot, audio->block_no);
 
 #ifdef DEBUG_ODML
             /*
@@ -1883,6 +2124,8 @@ static int demux_avi_send_chunk (demux_plugin_t *this_gen) {
 static void demux_avi_dispose (demux_plugin_t *this_gen) {
   demux_avi_t *this = (demux_avi_t *) this_gen;
 
+  idx_scan_stop (this);
+
   if (this->avi)
     AVI_close (this->avi);
 
@@ -2366,6 +2609,8 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
            "demux_avi: %d frames\n", this->avi->video_idx.video_frames);
 
+  idx_scan_start (this);
+
   return &this->demux_plugin;
 }
 
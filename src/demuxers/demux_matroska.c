@@ -1979,6 +1979,65 @@ static int parse_cue_trackposition(demux_matroska_t *this, int *track_num,
 }
 
 
+static uint8_t *index_put_delta (uint8_t *p, int64_t d) {
+  /* zigzag, then 7 bits per byte. */
+  uint64_t v = ((uint64_t)d << 1) ^ (uint64_t)(d >> 63);
+  while (v >= 0x80) {
+    *p++ = (v & 0x7f) | 0x80;
+    v >>= 7;
+  }
+  *p++ = v;
+  return p;
+}
+
+static const uint8_t *index_get_delta (const uint8_t *p, int64_t *d) {
+  uint64_t v = 0;
+  int shift = 0;
+  while (*p & 0x80) {
+    v |= (uint64_t)(*p++ & 0x7f) << shift;
+    shift += 7;
+  }
+  v |= (uint64_t)(*p++) << shift;
+  *d = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+  return p;
+}
+
+static int index_append (matroska_index_t *index, uint64_t timecode, off_t pos) {
+  int n = index->num_entries;
+
+  if ((n % MATROSKA_INDEX_STEP) == 0) {
+    matroska_index_key_t *key;
+    if ((n % (MATROSKA_INDEX_STEP * 64)) == 0) {
+      key = realloc (index->keys, (n / MATROSKA_INDEX_STEP + 64) * sizeof (*key));
+      if (!key)
+        return 0;
+      index->keys = key;
+    }
+    key = &index->keys[n / MATROSKA_INDEX_STEP];
+    key->timecode = timecode;
+    key->pos      = pos;
+    key->offs     = index->data_used;
+  } else {
+    uint8_t *p;
+    /* 2 deltas, 10 bytes max each. */
+    if (index->data_used + 20 > index->data_size) {
+      uint32_t size = index->data_size ? 2 * index->data_size : 4096;
+      p = realloc (index->data, size);
+      if (!p)
+        return 0;
+      index->data = p;
+      index->data_size = size;
+    }
+    p = index_put_delta (index->data + index->data_used, timecode - index->last_timecode);
+    p = index_put_delta (p, pos - index->last_pos);
+    index->data_used = p - index->data;
+  }
+  index->last_timecode = timecode;
+  index->last_pos = pos;
+  index->num_entries++;
+  return 1;
+}
+
 static int parse_cue_point(demux_matroska_t *this) {
   ebml_parser_t *ebml = this->ebml;
   int next_level = 3;
@@ -2034,15 +2093,9 @@ static int parse_cue_point(demux_matroska_t *this) {
       index->track_num = track_num;
       this->num_indexes++;
     }
-    if ((index->num_entries % 1024) == 0) {
-      index->pos = realloc(index->pos, sizeof(off_t) *
-			   (index->num_entries + 1024));
-      index->timecode = realloc(index->timecode, sizeof(uint64_t) *
-				(index->num_entries + 1024));
-    }
-    index->pos[index->num_entries] = pos;
-    index->timecode[index->num_entries] = timecode;
-    index->num_entries++;
+    /* Scale the cues to ms precision. */
+    if (!index_append(index, (uint64_t)timecode * this->timecode_scale / 1000000, pos))
+      return 0;
   }
 
   return 1;
@@ -2590,19 +2643,6 @@ static int parse_cluster(demux_matroska_t *this) {
   uint64_t timecode = 0;
   uint64_t duration = 0;
 
-  if (!this->first_cluster_found) {
-    int idx, entry;
-
-    /* Scale the cues to ms precision. */
-    for (idx = 0; idx < this->num_indexes; idx++) {
-      matroska_index_t *index = &this->indexes[idx];
-      for (entry = 0; entry < index->num_entries; entry++)
-        index->timecode[entry] = index->timecode[entry] *
-          this->timecode_scale / 1000000;
-    }
-    this->first_cluster_found = 1;
-  }
-
   handle_events(this);
 
   while (next_level == this_level) {
@@ -2873,9 +2913,15 @@ static int parse_top_level_head(demux_matroska_t *this, int *next_level) {
         break;
       case MATROSKA_ID_CUES:
         lprintf("Cues\n");
-        if (!ebml_read_master (ebml, &elem))
-          return 0;
-        if ((elem.len > 0) && !parse_cues(this))
+        /* parse them later when we really need them. */
+        if ((this->num_cues & 3) == 0) {
+          off_t *list = realloc(this->cues_list, (this->num_cues + 4) * sizeof(off_t));
+          if (!list)
+            return 0;
+          this->cues_list = list;
+        }
+        this->cues_list[this->num_cues++] = current_pos;
+        if (!ebml_skip(ebml, &elem))
           return 0;
         break;
       case MATROSKA_ID_ATTACHMENTS:
@@ -2948,6 +2994,11 @@ static int parse_top_level(demux_matroska_t *this, int *next_level) {
       lprintf("Cluster\n");
       cluster_pos = this->input->get_current_pos(this->input);
       cluster_len = elem.len;
+      if (cluster_len < INT_MAX) {
+        /* we are going to read it all, in many small pieces. */
+        int ra = cluster_len;
+        this->input->get_optional_data(this->input, &ra, INPUT_OPTIONAL_DATA_READAHEAD);
+      }
       if (!ebml_read_master (ebml, &elem))
         return 0;
       if (!parse_cluster(this)) {
@@ -3103,61 +3154,103 @@ static void demux_matroska_send_headers (demux_plugin_t *this_gen) {
 }
 
 
-/* support function that performs a binary seek on a track; returns the
- * best index entry or -1 if the seek was beyond the end of the file */
-static int binary_seek(matroska_index_t *index, off_t start_pos,
-                       int start_time) {
-  int best_index;
-  int left, middle, right;
-  int found;
-  uint32_t stime = start_time < 0 ? 0 : start_time;
-
-  /* perform a binary search on the trak, testing the offset
-   * boundaries first; offset request has precedent over time request */
-  if (start_pos) {
-    if (start_pos <= index->pos[0])
-      best_index = 0;
-    else if (start_pos >= index->pos[index->num_entries - 1])
-      best_index = index->num_entries - 1;
-    else {
-      left = 0;
-      right = index->num_entries - 1;
-      found = 0;
-
-      while (!found) {
-        middle = (left + right + 1) / 2;
-        if ((start_pos >= index->pos[middle]) &&
-            (start_pos < index->pos[middle + 1]))
-          found = 1;
-        else if ((uint32_t)start_pos < index->pos[middle])
-          right = middle - 1;
-        else
-          left = middle;
-      }
+/* parse all Cues elements seen by send_headers () into our packed indexes. */
+static void load_cues(demux_matroska_t *this) {
+  ebml_parser_t ebml_bak;
+  off_t current_pos;
+  int i;
 
-      best_index = middle;
-    }
-  } else {
-    if (stime <= index->timecode[0])
-      best_index = 0;
-    else if (stime >= index->timecode[index->num_entries - 1])
-      best_index = index->num_entries - 1;
-    else {
-      left = 0;
-      right = index->num_entries - 1;
-      do {
-        middle = (left + right + 1) / 2;
-        if (stime < index->timecode[middle])
-          right = (middle - 1);
-        else
-          left = middle;
-      } while (left < right);
+  this->cues_loaded = 1;
+  if (!this->num_cues)
+    return;
+
+  /* backup current state */
+  current_pos = this->input->get_current_pos(this->input);
+  memcpy(&ebml_bak, this->ebml, sizeof(ebml_parser_t));   /* FIXME */
 
-      best_index = left;
+  for (i = 0; i < this->num_cues; i++) {
+    ebml_elem_t elem;
+
+    this->ebml->level = 1;
+    if (this->input->seek(this->input, this->cues_list[i], SEEK_SET) < 0) {
+      xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+              "demux_matroska: failed to seek to pos: %" PRIdMAX "\n",
+              (intmax_t)this->cues_list[i]);
+      continue;
     }
+    if (!ebml_read_elem_head(this->ebml, &elem) || (elem.id != MATROSKA_ID_CUES) ||
+        !ebml_read_master(this->ebml, &elem))
+      continue;
+    if ((elem.len > 0) && !parse_cues(this))
+      xprintf(this->stream->xine, XINE_VERBOSITY_LOG,
+              "demux_matroska: broken cues at pos: %" PRIdMAX "\n", (intmax_t)this->cues_list[i]);
+  }
+
+  for (i = 0; i < this->num_indexes; i++)
+    xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+            "demux_matroska: track %d: %d cues, %u bytes.\n", this->indexes[i].track_num,
+            this->indexes[i].num_entries, (unsigned int)(this->indexes[i].data_used +
+            (this->indexes[i].num_entries + MATROSKA_INDEX_STEP - 1) / MATROSKA_INDEX_STEP *
+            sizeof(matroska_index_key_t)));
+
+  /* restore old state */
+  memcpy(this->ebml, &ebml_bak, sizeof(ebml_parser_t));   /* FIXME */
+  if (this->input->seek(this->input, current_pos, SEEK_SET) < 0) {
+    xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
+            "demux_matroska: failed to seek to pos: %" PRIdMAX "\n",
+            (intmax_t)current_pos);
+  }
+}
+
+/* support function that performs a binary seek on a non empty track index;
+ * returns the best index entry, and its timecode and position. */
+static int binary_seek(const matroska_index_t *index, off_t start_pos,
+                       int start_time, uint64_t *timecode, off_t *pos) {
+  const matroska_index_key_t *keys = index->keys;
+  const uint8_t *p;
+  int left, right, entry, last;
+  uint64_t stime = start_time < 0 ? 0 : start_time;
+  uint64_t tc;
+  off_t ps;
+
+  /* perform a binary search on the keys for the last one not past the
+   * request; offset request has precedent over time request */
+  left = 0;
+  right = (index->num_entries - 1) / MATROSKA_INDEX_STEP;
+  while (left < right) {
+    int middle = (left + right + 1) / 2;
+    if (start_pos ? (keys[middle].pos <= start_pos) : (keys[middle].timecode <= stime))
+      left = middle;
+    else
+      right = middle - 1;
+  }
+
+  /* then walk the deltas following it */
+  entry = left * MATROSKA_INDEX_STEP;
+  last = entry + MATROSKA_INDEX_STEP - 1;
+  if (last > index->num_entries - 1)
+    last = index->num_entries - 1;
+  tc = keys[left].timecode;
+  ps = keys[left].pos;
+  p = index->data + keys[left].offs;
+  while (entry < last) {
+    int64_t d;
+    uint64_t ntc;
+    off_t nps;
+    p = index_get_delta(p, &d);
+    ntc = tc + d;
+    p = index_get_delta(p, &d);
+    nps = ps + d;
+    if (start_pos ? (nps > start_pos) : (ntc > stime))
+      break;
+    tc = ntc;
+    ps = nps;
+    entry++;
   }
 
-  return best_index;
+  *timecode = tc;
+  *pos = ps;
+  return entry;
 }
 
 
@@ -3167,6 +3260,8 @@ static int demux_matroska_seek (demux_plugin_t *this_gen,
   demux_matroska_t *this = (demux_matroska_t *) this_gen;
   matroska_index_t *index;
   matroska_track_t *track;
+  uint64_t timecode;
+  off_t pos;
   int i, entry;
 
   (void)playing;
@@ -3183,6 +3278,19 @@ static int demux_matroska_seek (demux_plugin_t *this_gen,
   this->send_newpts   = 1;
   this->buf_flag_seek = 1;
 
+  if (!this->cues_loaded) {
+    /* plain start of playback, dont parse the cues just for that. */
+    if (!start_pos && (start_time <= 0)) {
+      if (this->input->seek(this->input, this->segment.start, SEEK_SET) < 0)
+        this->status = DEMUX_FINISHED;
+      this->ebml->level = 1;
+      this->skip_to_timecode = 0;
+      _x_demux_flush_engine(this->stream);
+      return this->status;
+    }
+    load_cues(this);
+  }
+
   /* Seeking without an index is not supported yet. */
   if (!this->num_indexes)
     return this->status;
@@ -3214,29 +3322,22 @@ static int demux_matroska_seek (demux_plugin_t *this_gen,
   if (index == NULL)
     return this->status;
 
-  entry = binary_seek(index, start_pos, start_time);
-  if (entry == -1) {
-    lprintf("seeking for track %d to %s %" PRIdMAX " - no entry found/EOS.\n",
-            index->track_num, start_pos ? "pos" : "time",
-            start_pos ? (intmax_t)start_pos : (intmax_t)start_time);
-    this->status = DEMUX_FINISHED;
-
-  } else {
-    lprintf("seeking for track %d to %s %" PRIdMAX ". decision is #%d at %" PRIu64 "/%" PRIdMAX "\n",
-            index->track_num, start_pos ? "pos" : "time",
-            start_pos ? (intmax_t)start_pos : (intmax_t)start_time,
-            index->track_num, index->timecode[entry], (intmax_t)index->pos[entry]);
+  entry = binary_seek(index, start_pos, start_time, &timecode, &pos);
+  lprintf("seeking for track %d to %s %" PRIdMAX ". decision is #%d at %" PRIu64 "/%" PRIdMAX "\n",
+          index->track_num, start_pos ? "pos" : "time",
+          start_pos ? (intmax_t)start_pos : (intmax_t)start_time,
+          entry, timecode, (intmax_t)pos);
+  (void)entry;
 
-    if (this->input->seek(this->input, index->pos[entry], SEEK_SET) < 0)
-      this->status = DEMUX_FINISHED;
+  if (this->input->seek(this->input, pos, SEEK_SET) < 0)
+    this->status = DEMUX_FINISHED;
 
-    /* we always seek to the ebml level 1 */
-    this->ebml->level = 1;
+  /* we always seek to the ebml level 1 */
+  this->ebml->level = 1;
 
-    this->skip_to_timecode = index->timecode[entry];
-    this->skip_for_track = track->track_num;
-    _x_demux_flush_engine(this->stream);
-  }
+  this->skip_to_timecode = timecode;
+  this->skip_for_track = track->track_num;
+  _x_demux_flush_engine(this->stream);
 
   return this->status;
 }
@@ -3264,10 +3365,11 @@ static void demux_matroska_dispose (demux_plugin_t *this_gen) {
   }
   /* Free the cues. */
   for (i = 0; i < this->num_indexes; i++) {
-    _x_freep(&this->indexes[i].pos);
-    _x_freep(&this->indexes[i].timecode);
+    _x_freep(&this->indexes[i].keys);
+    _x_freep(&this->indexes[i].data);
   }
   _x_freep(&this->indexes);
+  _x_freep(&this->cues_list);
 
   /* Free the top_level elem list */
   _x_freep(&this->top_level_list);
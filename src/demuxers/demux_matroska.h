@@ -46,12 +46,28 @@
 
 #define WRAP_THRESHOLD        90000
 
+/* cue entries are kept packed: every MATROSKA_INDEX_STEP th entry is stored
+ * in full as a key, the others as zigzag varint deltas to their predecessor. */
+#define MATROSKA_INDEX_STEP     64
+
+typedef struct {
+  uint64_t             timecode;            /* in millis */
+  off_t                pos;
+  uint32_t             offs;                /* of the following deltas in data */
+} matroska_index_key_t;
+
 typedef struct {
   int                  track_num;
-  off_t               *pos;
-  uint64_t            *timecode;
   int                  num_entries;
 
+  matroska_index_key_t *keys;
+  uint8_t             *data;
+  uint32_t             data_used, data_size;
+
+  /* delta base for the next entry */
+  uint64_t             last_timecode;
+  off_t                last_pos;
+
 } matroska_index_t;
 
 typedef struct {
@@ -78,10 +94,12 @@ typedef struct {
   int                  has_seekhead;
   int                  seekhead_handled;
 
-  /* seek info */
+  /* seek info, cues are parsed on first real seek */
   matroska_index_t    *indexes;
   int                  num_indexes;
-  int                  first_cluster_found;
+  int                  cues_loaded;
+  int                  num_cues;
+  off_t               *cues_list;
   int                  skip_to_timecode;
   int                  skip_for_track;
 
@@ -42,6 +42,8 @@
 #include <xine/xine_internal.h>
 #include <xine/xineutils.h>
 #include <xine/demux.h>
+#include "bswap.h"
+#include "keyframe_index.h"
 
 #define NUM_PREVIEW_BUFFERS   250
 #define DISC_TRESHOLD       90000
@@ -85,6 +87,9 @@ typedef struct demux_mpeg_block_s {
   int64_t               last_cell_time;
   off_t                 last_cell_pos;
   int                   last_begin_time;
+
+  kfi_t                *kfi;
+  int                   kfi_blocksize;
 } demux_mpeg_block_t ;
 
 
@@ -1202,10 +1207,94 @@ static int demux_mpeg_block_estimate_rate (demux_mpeg_block_t *this) {
 }
 #endif /*ESTIMATE_RATE_FIXED*/
 
+/*
+ * On disk keyframe index, see keyframe_index.c.
+ * Only the first video stream (0xe0) is indexed, at pack granularity.
+ */
+
+static void demux_mpeg_block_kfi_pack (kfi_t *kfi, const uint8_t *p, uint32_t len, off_t offs) {
+  const uint8_t *e = p + len, *q;
+  int64_t pts;
+
+  if (_X_BE_32 (p) != 0x000001ba)
+    return;
+  if ((p[4] & 0xc0) == 0x40) /* mpeg 2 */
+    p += 14 + (p[13] & 0x07);
+  else
+    p += 12;
+
+  while (p + 6 <= e) {
+    uint32_t id = _X_BE_32 (p), l = 6 + _X_BE_16 (p + 4);
+    if ((id >> 8) != 1)
+      return;
+    /* program end code has no length. */
+    if (id < 0x1bb)
+      return;
+    if (id == 0x1e0)
+      break;
+    p += l;
+  }
+  if (p + 6 > e)
+    return;
+  if (p + 6 + _X_BE_16 (p + 4) < e)
+    e = p + 6 + _X_BE_16 (p + 4);
+
+  if ((p[6] & 0xc0) == 0x80) { /* mpeg 2 */
+    if ((e - p < 14) || !(p[7] & 0x80))
+      return;
+    q = p + 9;
+    p = q + p[8];
+  } else {
+    q = p + 6;
+    while ((q < e) && ((q[0] & 0x80) == 0x80))
+      q++;
+    if ((q < e) && ((q[0] & 0xc0) == 0x40))
+      q += 2;
+    if ((e - q < 5) || ((q[0] & 0xe0) != 0x20))
+      return;
+    p = q + ((q[0] & 0x10) ? 10 : 5);
+  }
+  if (p >= e)
+    return;
+  if (frametype_mpeg (p, e - p) != FRAMETYPE_I)
+    return;
+
+  pts  = (int64_t)(q[ 0] & 0x0E) << 29 ;
+  pts |=  q[ 1]         << 22 ;
+  pts |= (q[ 2] & 0xFE) << 14 ;
+  pts |=  q[ 3]         <<  7 ;
+  pts |= (q[ 4] & 0xFE) >>  1 ;
+  kfi_add (kfi, pts, offs);
+}
+
+static uint32_t demux_mpeg_block_kfi_parse (kfi_t *kfi, void *data, const uint8_t *buf, uint32_t len, off_t pos) {
+  demux_mpeg_block_t *this = data;
+  uint32_t bs = this->kfi_blocksize, i = 0;
+
+  while (i + bs <= len) {
+    demux_mpeg_block_kfi_pack (kfi, buf + i, bs, pos + i);
+    i += bs;
+  }
+  return i;
+}
+
+static void demux_mpeg_block_kfi_open (demux_mpeg_block_t *this) {
+  uint32_t key[3];
+
+  if (this->blocksize <= 0)
+    return;
+  this->kfi_blocksize = this->blocksize;
+  key[0] = 0xe0;
+  key[1] = this->kfi_blocksize;
+  key[2] = 1;
+  this->kfi = kfi_open (this->stream, this->input, key, demux_mpeg_block_kfi_parse, this);
+}
+
 static void demux_mpeg_block_dispose (demux_plugin_t *this_gen) {
 
   demux_mpeg_block_t *this = (demux_mpeg_block_t *) this_gen;
 
+  kfi_dispose (&this->kfi);
   free (this);
 }
 
@@ -1290,6 +1379,9 @@ static void demux_mpeg_block_send_headers (demux_plugin_t *this_gen) {
   _x_stream_info_set(this->stream, XINE_STREAM_INFO_HAS_VIDEO, 1);
   _x_stream_info_set(this->stream, XINE_STREAM_INFO_HAS_AUDIO, 1);
   _x_stream_info_set(this->stream, XINE_STREAM_INFO_BITRATE, this->rate * 50 * 8);
+
+  if (!this->kfi)
+    demux_mpeg_block_kfi_open (this);
 }
 
 
@@ -1297,12 +1389,21 @@ static int demux_mpeg_block_seek (demux_plugin_t *this_gen,
 				   off_t start_pos, int start_time, int playing) {
 
   demux_mpeg_block_t *this = (demux_mpeg_block_t *) this_gen;
+  off_t kf = -1;
   start_pos = (off_t) ( (double) start_pos / 65535 *
               this->input->get_length (this->input) );
 
+  if (this->kfi && (start_pos || start_time)) {
+    kfi_scan (this->kfi);
+    kf = kfi_find (this->kfi, start_pos, start_time);
+  }
+
   if((this->input->get_capabilities(this->input) & INPUT_CAP_SEEKABLE) != 0) {
 
-    if (start_pos) {
+    if (kf >= 0) {
+      lprintf ("seek: indexed keyframe at %" PRId64 "\n", (int64_t)kf);
+      this->input->seek (this->input, kf, SEEK_SET);
+    } else if (start_pos) {
       start_pos /= (off_t) this->blocksize;
       start_pos *= (off_t) this->blocksize;
 
@@ -1472,6 +1573,9 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen, xine_stream_t *str
   this->demux_plugin.demux_class       = class_gen;
 
   this->status     = DEMUX_FINISHED;
+#ifndef HAVE_ZERO_SAFE_MEM
+  this->kfi        = NULL;
+#endif
 
   return &this->demux_plugin;
 }
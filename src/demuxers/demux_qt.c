@@ -257,6 +257,36 @@ typedef struct {
 #  define QTF_MEDIA_ID(f) ((f)._ffs.bytes[6])
 #endif
 
+/* Very long traks do not get a full frame table. Instead, we keep a private copy
+ * of the sample table atoms, plus the expander state at every QT_LAZY_STEP th
+ * frame, and build a small window of frames on demand (see qt_trak_frame ()). */
+#define QT_LAZY_STEP       1024
+#define QT_LAZY_MIN_FRAMES (64 << 10)
+
+typedef struct {
+  /* read pointers: chunk offsets, sample sizes, durations, pts offsets, sync samples */
+  const uint8_t *o, *s, *p, *q, *k;
+  uint64_t offset;
+  int64_t  pts;
+  uint32_t sample;
+  /* sample to chunk index, chunks left there, samples left in this chunk */
+  uint32_t u, chunks_left, samples_left;
+  uint32_t size_left, size;
+  uint32_t duration_left, duration_countdown, duration;
+  uint32_t ptsoffs_left, ptsoffs_countdown;
+  int32_t  ptsoffs;
+  uint32_t sync_left;
+} qt_cursor_t;
+
+typedef struct {
+  uint8_t     *tables;
+  qt_cursor_t *marks;
+  /* edit list: xine pts = max (pts, pts_min) + pts_add, in trak timescale */
+  int64_t      pts_min, pts_add, pts_end;
+  /* the frames currently in trak->frames */
+  unsigned int base, valid;
+} qt_lazy_t;
+
 typedef struct {
   int64_t track_duration;
   int64_t media_time;
@@ -324,6 +354,8 @@ typedef struct {
   qt_frame    *frames;
   unsigned int frame_count;
   unsigned int current_frame;
+  /* if set, frames is just a window, use qt_trak_frame () */
+  qt_lazy_t   *lazy;
 
   /* this is the current properties atom in use */
   properties_t *properties;
@@ -416,6 +448,7 @@ typedef struct {
   /* fragment mode */
   xine_mfrag_list_t *fraglist;
   int          fragment_count;
+  int          fragment_stream; /* not or slow seekable, 1 fragment at a time */
   size_t       fragbuf_size;
   uint8_t     *fragment_buf;
   off_t        fragment_next;
@@ -590,6 +623,7 @@ static void reset_qt_info (demux_qt_t *this) {
   this->qt.fragbuf_size      = 0;
   this->qt.fragment_buf      = NULL;
   this->qt.fragment_next     = 0;
+  this->qt.fragment_stream   = 0;
 #else
   memset (&this->qt, 0, sizeof (this->qt));
 #endif
@@ -614,6 +648,12 @@ static void free_qt_info (demux_qt_t *this) {
     unsigned int i;
     for (i = 0; i < this->qt.trak_count; i++) {
       free (this->qt.traks[i].frames);
+      free (this->qt.traks[i].keyframes_list);
+      if (this->qt.traks[i].lazy) {
+        free (this->qt.traks[i].lazy->tables);
+        free (this->qt.traks[i].lazy->marks);
+        free (this->qt.traks[i].lazy);
+      }
       free (this->qt.traks[i].edit_list_table);
       free (this->qt.traks[i].sample_to_chunk_table);
       if (this->qt.traks[i].type == MEDIA_AUDIO) {
@@ -864,6 +904,7 @@ static qt_error parse_trak_atom (qt_trak *trak, uint8_t *trak_atom) {
   trak->frames = NULL;
   trak->frame_count = 0;
   trak->current_frame = 0;
+  trak->lazy = NULL;
   trak->flags = 0;
   trak->stsd_atoms_count = 0;
   trak->stsd_atoms = NULL;
@@ -1645,7 +1686,271 @@ static void qt_keyframes_simple_add (qt_trak *trak, qt_frame *f) {
   }
 }
 
-static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale) {
+static void qt_cursor_init (qt_trak *trak, qt_cursor_t *c) {
+  memset (c, 0, sizeof (*c));
+  c->o = trak->chunk_offset_table32 ? trak->chunk_offset_table32 : trak->chunk_offset_table64;
+  c->s = trak->sample_size_table;
+  c->p = trak->time_to_sample_table;
+  c->q = trak->timeoffs_to_sample_table;
+  c->k = trak->sync_sample_table;
+  c->chunks_left   = trak->sample_to_chunk_table[1].first_chunk - trak->sample_to_chunk_table[0].first_chunk;
+  c->size_left     = trak->sample_size_count;
+  c->size          = trak->sample_size;
+  c->duration_left = trak->time_to_sample_count;
+  c->duration      = 1;
+  c->ptsoffs_left  = trak->timeoffs_to_sample_count;
+  c->sync_left     = trak->sync_sample_count;
+}
+
+/* same as the frame builder loop below, but 1 frame at a time, and without scaling. */
+static void qt_cursor_next (qt_trak *trak, qt_cursor_t *c, qt_frame *frame) {
+  const sample_to_chunk_table_t *stsc = trak->sample_to_chunk_table;
+
+  while (!c->samples_left) {
+    while (!c->chunks_left) {
+      c->u++;
+      c->chunks_left = stsc[c->u + 1].first_chunk - stsc[c->u].first_chunk;
+    }
+    c->chunks_left--;
+    c->samples_left = stsc[c->u].samples_per_chunk;
+    if (trak->chunk_offset_table32)
+      c->offset = _X_BE_32 (c->o), c->o += 4;
+    else
+      c->offset = _X_BE_64 (c->o), c->o += 8;
+  }
+  c->samples_left--;
+
+  if (c->size_left) {
+    c->size = _X_BE_32 (c->s) >> trak->sample_size_shift;
+    c->s += trak->sample_size_bytes;
+    c->size_left--;
+  }
+  frame->_ffs.offset = c->offset;
+  frame->size = c->size;
+  c->offset += c->size;
+
+  QTF_MEDIA_ID(frame[0]) = stsc[c->u].media_id;
+
+  /* stss is sorted, see qt_lazy_build (). */
+  c->sample++;
+  if (c->k) {
+    QTF_KEYFRAME(frame[0]) = 0;
+    while (c->sync_left && (_X_BE_32 (c->k) <= c->sample)) {
+      if (_X_BE_32 (c->k) == c->sample)
+        QTF_KEYFRAME(frame[0]) = 1;
+      c->k += 4;
+      c->sync_left--;
+    }
+  } else {
+    QTF_KEYFRAME(frame[0]) = 1;
+  }
+
+  if (!c->duration_countdown && c->duration_left) {
+    c->duration_countdown = _X_BE_32 (c->p); c->p += 4;
+    c->duration           = _X_BE_32 (c->p); c->p += 4;
+    c->duration_left--;
+  }
+  frame->pts = c->pts;
+  c->pts += c->duration;
+  c->duration_countdown--;
+
+  if (!c->ptsoffs_countdown && c->ptsoffs_left) {
+    c->ptsoffs_countdown = _X_BE_32 (c->q); c->q += 4;
+    c->ptsoffs           = _X_BE_32 (c->q); c->q += 4;
+    c->ptsoffs_left--;
+  }
+  frame->ptsoffs = c->ptsoffs;
+  c->ptsoffs_countdown--;
+}
+
+static void qt_lazy_fix (qt_trak *trak, qt_frame *frame) {
+  qt_lazy_t *lazy = trak->lazy;
+  if (frame->pts < lazy->pts_min)
+    frame->pts = lazy->pts_min;
+  frame->pts += lazy->pts_add;
+  scale_int_do (&trak->si, &frame->pts);
+  frame->ptsoffs = (frame->ptsoffs * trak->ptsoffs_mul) >> 12;
+}
+
+/* the frame i of a trak, including the convenience frame at frame_count.
+ * NOTE: with a lazy trak, this invalidates previously returned pointers. */
+static qt_frame *qt_trak_frame (qt_trak *trak, unsigned int i) {
+  qt_lazy_t *lazy = trak->lazy;
+
+  if (!lazy)
+    return trak->frames + i;
+
+  if (i > trak->frame_count)
+    i = trak->frame_count;
+  if (i - lazy->base >= lazy->valid) {
+    qt_cursor_t c;
+    unsigned int base, n, j;
+
+    base = i / QT_LAZY_STEP * QT_LAZY_STEP;
+    if ((base == trak->frame_count) && base)
+      base -= QT_LAZY_STEP;
+    c = lazy->marks[base / QT_LAZY_STEP];
+    n = trak->frame_count - base;
+    if (n > QT_LAZY_STEP)
+      n = QT_LAZY_STEP;
+    for (j = 0; j < n; j++) {
+      qt_cursor_next (trak, &c, trak->frames + j);
+      qt_lazy_fix (trak, trak->frames + j);
+    }
+    if (base + n < trak->frame_count) {
+      qt_cursor_next (trak, &c, trak->frames + n);
+      qt_lazy_fix (trak, trak->frames + n);
+    } else {
+      memset (trak->frames + n, 0, sizeof (trak->frames[n]));
+      trak->frames[n].pts = lazy->pts_end;
+      scale_int_do (&trak->si, &trak->frames[n].pts);
+    }
+    lazy->base  = base;
+    lazy->valid = n + 1;
+  }
+  return trak->frames + (i - lazy->base);
+}
+
+/* try to set up a lazy frame table for a trak with video style sample tables,
+ * and at most 1 edit that is not a delay. returns 0 if not applicable. */
+static int qt_lazy_build (qt_trak *trak, unsigned int global_timescale, unsigned int frame_count) {
+  qt_lazy_t *lazy;
+  qt_cursor_t c;
+  qt_frame frame;
+  int *media_id_counts;
+  int64_t delay = 0, media_time = 0, lazy_pts_min = 0;
+  unsigned int u, first = 0, start = 0, use_keyframes;
+  size_t osize, ssize, tsize, psize, ksize;
+  uint8_t *t;
+
+  /* edit list */
+  for (u = 0; u < trak->edit_list_count; u++) {
+    if (trak->edit_list_table[u].media_time == -1ll) {
+      delay += trak->edit_list_table[u].track_duration * trak->timescale / global_timescale;
+      continue;
+    }
+    if (u != trak->edit_list_count - 1)
+      return 0;
+    media_time = trak->edit_list_table[u].media_time;
+  }
+  if (trak->edit_list_count && (trak->edit_list_table[trak->edit_list_count - 1].media_time == -1ll))
+    return 0;
+
+  /* the real number of samples */
+  {
+    uint32_t n = 0;
+    for (u = 0; u < trak->sample_to_chunk_count; u++)
+      n += (trak->sample_to_chunk_table[u + 1].first_chunk - trak->sample_to_chunk_table[u].first_chunk)
+         * trak->sample_to_chunk_table[u].samples_per_chunk;
+    if (frame_count > n)
+      frame_count = n;
+    if (trak->samples && (trak->samples < frame_count))
+      frame_count = trak->samples;
+  }
+
+  /* our cursor relies on this. */
+  for (u = 1; u < trak->sync_sample_count; u++) {
+    if (_X_BE_32 (trak->sync_sample_table + 4 * u) < _X_BE_32 (trak->sync_sample_table + 4 * u - 4))
+      return 0;
+  }
+
+  /* find edit start, and the nearest keyframe before. */
+  if (trak->edit_list_count) {
+    qt_cursor_init (trak, &c);
+    for (u = 0; u < frame_count; u++) {
+      qt_cursor_next (trak, &c, &frame);
+      if (!trak->sync_sample_count || QTF_KEYFRAME(frame))
+        first = u;
+      if (frame.pts + frame.ptsoffs - media_time >= 0)
+        break;
+    }
+    if (u >= frame_count)
+      return 0;
+    start = u;
+    lazy_pts_min = frame.pts;
+  }
+
+  lazy = calloc (1, sizeof (*lazy));
+  if (!lazy)
+    return 0;
+  lazy->marks = malloc ((frame_count - first + QT_LAZY_STEP - 1) / QT_LAZY_STEP * sizeof (*lazy->marks));
+  trak->frames = malloc ((QT_LAZY_STEP + 1) * sizeof (*trak->frames));
+  media_id_counts = calloc (trak->stsd_atoms_count + 1, sizeof (int));
+  /* the moov buffer goes away after parsing, keep the tables we need.
+   * sample sizes may be read as 32 bits, pad them like the moov buffer. */
+  osize = trak->chunk_offset_count * (trak->chunk_offset_table32 ? 4 : 8);
+  ssize = trak->sample_size_table ? trak->sample_size_count * trak->sample_size_bytes + 4 : 0;
+  tsize = trak->time_to_sample_count * 8;
+  psize = trak->timeoffs_to_sample_count * 8;
+  ksize = trak->sync_sample_count * 4;
+  lazy->tables = t = malloc (osize + ssize + tsize + psize + ksize);
+  if (!lazy->marks || !trak->frames || !media_id_counts || !t) {
+    free (lazy->marks);
+    free (lazy->tables);
+    free (lazy);
+    free (trak->frames);
+    trak->frames = NULL;
+    free (media_id_counts);
+    return 0;
+  }
+#define QT_LAZY_COPY(table,size) if (table) { memcpy (t, table, size); table = t; t += size; }
+  if (trak->chunk_offset_table32) {
+    QT_LAZY_COPY (trak->chunk_offset_table32, osize);
+  } else {
+    QT_LAZY_COPY (trak->chunk_offset_table64, osize);
+  }
+  QT_LAZY_COPY (trak->sample_size_table, ssize);
+  QT_LAZY_COPY (trak->time_to_sample_table, tsize);
+  QT_LAZY_COPY (trak->timeoffs_to_sample_table, psize);
+  QT_LAZY_COPY (trak->sync_sample_table, ksize);
+#undef QT_LAZY_COPY
+  trak->lazy = lazy;
+
+  if (trak->edit_list_count) {
+    /* decoder preroll frames get edit start pts. */
+    lazy->pts_min = lazy_pts_min;
+    lazy->pts_add = delay - media_time;
+  }
+
+  /* walk the whole trak once: cursor marks, keyframes, media ids. */
+  qt_cursor_init (trak, &c);
+  for (u = 0; u < first; u++)
+    qt_cursor_next (trak, &c, &frame);
+  trak->frame_count = frame_count - first;
+  qt_keyframes_size (trak, trak->sync_sample_count);
+  use_keyframes = trak->sync_sample_count && (trak->keyframes_size >= trak->sync_sample_count);
+  for (u = 0; u < trak->frame_count; u++) {
+    if (!(u % QT_LAZY_STEP))
+      lazy->marks[u / QT_LAZY_STEP] = c;
+    qt_cursor_next (trak, &c, &frame);
+    media_id_counts[QTF_MEDIA_ID(frame)] += 1;
+    if (QTF_KEYFRAME(frame) && use_keyframes && (u + first >= start)) {
+      qt_lazy_fix (trak, &frame);
+      qt_keyframes_simple_add (trak, &frame);
+    }
+  }
+  /* provide append time for fragments */
+  trak->fragment_dts = lazy->pts_end = trak->edit_list_count ? delay + c.pts - lazy_pts_min : c.pts;
+
+  /* nothing valid in trak->frames yet. */
+  lazy->base  = 0;
+  lazy->valid = 0;
+  trak->current_frame = 0;
+
+  /* decide which properties atom to use */
+  {
+    int atom_to_use = 0;
+    for (u = 1; u < trak->stsd_atoms_count; u++)
+      if (media_id_counts[u + 1] > media_id_counts[u])
+        atom_to_use = u;
+    trak->properties = &trak->stsd_atoms[atom_to_use];
+  }
+  free (media_id_counts);
+
+  return 1;
+}
+
+static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale, int lazy_ok) {
 
   if ((trak->type != MEDIA_VIDEO) &&
       (trak->type != MEDIA_AUDIO))
@@ -1719,6 +2024,10 @@ static qt_error build_frame_table (qt_trak *trak, unsigned int global_timescale)
     if (!trak->frame_count)
       return QT_OK;
 
+    if (lazy_ok && (samples_per_frame == 1) && (trak->frame_count >= QT_LAZY_MIN_FRAMES) &&
+      qt_lazy_build (trak, global_timescale, trak->frame_count))
+      return QT_OK;
+
     /* 1 more for convenient end marker. */
     trak->frames = malloc ((trak->frame_count + 1) * sizeof (qt_frame));
     if (!trak->frames)
@@ -2755,6 +3064,19 @@ static int parse_moof_atom (demux_qt_t *this, uint8_t *moof_atom, int moofsize,
   return done;
 }
 
+/* streaming mode: all traks have been played up to here, and we dont want to seek back.
+ * reuse the frame tables for the next fragment instead of growing them forever. */
+static void fragment_recycle (demux_qt_t *this) {
+  unsigned int i;
+
+  for (i = 0; i < this->qt.trak_count; i++) {
+    qt_trak *trak = &this->qt.traks[i];
+    trak->frame_count    = 0;
+    trak->current_frame  = 0;
+    trak->keyframes_used = 0;
+  }
+}
+
 static int fragment_scan (demux_qt_t *this) {
   uint8_t hbuf[16];
   off_t pos, fsize;
@@ -2767,7 +3089,7 @@ static int fragment_scan (demux_qt_t *this) {
   caps = this->input->get_capabilities (this->input);
   fsize = this->input->get_length (this->input);
 
-  if ((caps & INPUT_CAP_SEEKABLE) && (fsize > 0)) {
+  if (((caps & (INPUT_CAP_SEEKABLE | INPUT_CAP_SLOW_SEEKABLE)) == INPUT_CAP_SEEKABLE) && (fsize > 0)) {
     /* Plain file, possibly being written right now.
      * Get all fragments known so far. */
 
@@ -2814,7 +3136,10 @@ static int fragment_scan (demux_qt_t *this) {
     return frags;
 
   } else {
-    /* Stay patient, get 1 fragment only. */
+    /* Stay patient, get 1 fragment only.
+     * Slow seekable inputs (hls, mpegdash, http) come here as well,
+     * even if they say seekable. Scanning them all would mean reading them all. */
+    this->qt.fragment_stream = 1;
 
     /* find next moof */
     pos = this->qt.fragment_next;
@@ -2926,7 +3251,7 @@ static void qt_update_duration (demux_qt_t *this) {
   uint32_t n;
   for (n = this->qt.trak_count; n; n--) {
     if (trak->frame_count) {
-      int32_t msecs = qt_pts_2_msecs (trak->frames[trak->frame_count].pts);
+      int32_t msecs = qt_pts_2_msecs (qt_trak_frame (trak, trak->frame_count)->pts);
       if (msecs > this->qt.msecs)
         this->qt.msecs = msecs;
     }
@@ -3068,16 +3393,17 @@ static void parse_moov_atom (demux_qt_t *this, uint8_t *moov_atom) {
     }
     debug_frame_table("    qt: building frame table #%d (%s)\n", i,
       (this->qt.traks[i].type == MEDIA_VIDEO) ? "video" : "audio");
-    error = build_frame_table(&this->qt.traks[i], this->qt.timescale);
+    /* fragments will append to the frame table. */
+    error = build_frame_table(&this->qt.traks[i], this->qt.timescale, !mvex_atom);
     if (error != QT_OK) {
       this->qt.last_error = error;
       return;
     }
     if (trak->frame_count) {
+      qt_frame *f = qt_trak_frame (trak, 0);
       xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
-        "demux_qt:            start %" PRId64 "pts, %u frames.\n",
-        trak->frames[0].pts + trak->frames[0].ptsoffs,
-        trak->frame_count);
+        "demux_qt:            start %" PRId64 "pts, %u frames%s.\n",
+        f->pts + f->ptsoffs, trak->frame_count, trak->lazy ? " (lazy)" : "");
     }
   }
 
@@ -3095,14 +3421,16 @@ static void parse_moov_atom (demux_qt_t *this, uint8_t *moov_atom) {
 #if DEBUG_DUMP_MOOV
     unsigned int j;
     /* dump the frame table in debug mode */
-    for (j = 0; j < trak->frame_count; j++)
+    for (j = 0; j < trak->frame_count; j++) {
+      qt_frame *f = qt_trak_frame (trak, j);
       debug_frame_table("      %d: %8X bytes @ %"PRIX64", %"PRId64" pts, media id %d%s\n",
         j,
-        trak->frames[j].size,
-        QTF_OFFSET(trak[0].frames[j]),
-        trak->frames[j].pts,
-        (int)QTF_MEDIA_ID(trak[0].frames[j]),
-        (QTF_KEYFRAME(trak[0].frames[j])) ? " (keyframe)" : "");
+        f->size,
+        QTF_OFFSET(f[0]),
+        f->pts,
+        (int)QTF_MEDIA_ID(f[0]),
+        (QTF_KEYFRAME(f[0])) ? " (keyframe)" : "");
+    }
 #endif
     /* decide which audio trak and which video trak has the most frames */
     if ((trak->type == MEDIA_VIDEO) &&
@@ -3401,6 +3729,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
   int frame_duration;
   int first_buf;
   qt_trak *trak = NULL;
+  qt_frame frame;
   off_t current_pos = this->input->get_current_pos (this->input);
 
   /* if this is DRM-protected content, finish playback before it even
@@ -3447,6 +3776,8 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     /* Step 2: handle trivial cases. */
     if (trak_count == 0) {
+      if (this->qt.fragment_stream)
+        fragment_recycle (this);
       if (fragment_scan (this)) {
         qt_update_duration (this);
         this->status = DEMUX_OK;
@@ -3466,8 +3797,10 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     for (i = 0; i < trak_count; i++) {
       int64_t pts;
       off_t pos;
+      qt_frame *f;
       trak = &this->qt.traks[traks[i]];
-      pts  = trak->frames[trak->current_frame].pts;
+      f    = qt_trak_frame (trak, trak->current_frame);
+      pts  = f->pts;
       if (i == 0) {
         min_pts  = max_pts = pts;
         min_trak = traks[i];
@@ -3476,7 +3809,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
         min_trak = traks[i];
       } else if (pts > max_pts)
         max_pts  = pts;
-      pos = QTF_OFFSET(trak->frames[trak->current_frame]);
+      pos = QTF_OFFSET(f[0]);
       if ((pos >= current_pos) && (pos < next_pos)) {
         next_pos = pos;
         next_trak = traks[i];
@@ -3484,18 +3817,25 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     }
 
     /* Step 4: after seek, or if the pts scissors opened too much, send minimum pts trak next.
-       Otherwise, take next one by offset. */
-    i = this->qt.seek_flag || (next_trak < 0) || (max_pts - min_pts > MAX_PTS_DIFF) ?
-      min_trak : next_trak;
+       Otherwise, take next one by offset. When streaming fragments, a seek back would fail,
+       and the rest of a fragment usually is just a few seconds ahead. */
+    if (this->qt.fragment_stream && (next_trak >= 0))
+      i = next_trak;
+    else
+      i = this->qt.seek_flag || (next_trak < 0) || (max_pts - min_pts > MAX_PTS_DIFF) ?
+        min_trak : next_trak;
     trak = &this->qt.traks[i];
   } while (0);
 
+  /* a copy, the table may be a lazy window. */
+  frame = *qt_trak_frame (trak, trak->current_frame);
+
   if (this->stream->xine->verbosity == XINE_VERBOSITY_DEBUG + 1) {
     xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG + 1,
       "demux_qt: sending trak %d dts %"PRId64" pos %"PRId64"\n",
       (int)(trak - this->qt.traks),
-      trak->frames[trak->current_frame].pts,
-      QTF_OFFSET(trak->frames[trak->current_frame]));
+      frame.pts,
+      QTF_OFFSET(frame));
   }
 
   /* check if it is time to seek */
@@ -3504,20 +3844,20 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     /* send min pts of all used traks, usually audio (see demux_qt_seek ()). */
     _x_demux_control_newpts (this->stream,
-        trak->frames[trak->current_frame].pts + trak->frames[trak->current_frame].ptsoffs, BUF_FLAG_SEEK);
+        frame.pts + frame.ptsoffs, BUF_FLAG_SEEK);
   }
 
   if (trak->type == MEDIA_VIDEO) {
     i = trak->current_frame++;
 
-    if (QTF_MEDIA_ID(trak->frames[i]) != trak->properties->media_id) {
+    if (QTF_MEDIA_ID(frame) != trak->properties->media_id) {
       this->status = DEMUX_OK;
       return this->status;
     }
 
-    remaining_sample_bytes = trak->frames[i].size;
-    if ((off_t)QTF_OFFSET(trak->frames[i]) != current_pos) {
-      if (this->input->seek (this->input, QTF_OFFSET(trak->frames[i]), SEEK_SET) < 0) {
+    remaining_sample_bytes = frame.size;
+    if ((off_t)QTF_OFFSET(frame) != current_pos) {
+      if (this->input->seek (this->input, QTF_OFFSET(frame), SEEK_SET) < 0) {
         /* Do not stop demuxing. Maybe corrupt file or broken track. */
         return this->status;
       }
@@ -3525,8 +3865,8 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     /* frame duration is the pts diff between this video frame and the next video frame
      * or the convenience frame at the end of list */
-    frame_duration  = trak->frames[i + 1].pts;
-    frame_duration -= trak->frames[i].pts;
+    frame_duration  = qt_trak_frame (trak, i + 1)->pts;
+    frame_duration -= frame.pts;
 
     /* Due to the edit lists, some successive frames have the same pts
      * which would ordinarily cause frame_duration to be 0 which can
@@ -3545,17 +3885,17 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     debug_video_demux("  qt: sending off video frame %d from offset 0x%"PRIX64", %d bytes, media id %d, %"PRId64" pts\n",
       i,
-      QTF_OFFSET(trak->frames[i]),
-      trak->frames[i].size,
-      (int)QTF_MEDIA_ID(trak->frames[i]),
-      trak->frames[i].pts);
+      QTF_OFFSET(frame),
+      frame.size,
+      (int)QTF_MEDIA_ID(frame),
+      frame.pts);
 
     while (remaining_sample_bytes) {
       buf = this->video_fifo->buffer_pool_size_alloc (this->video_fifo, remaining_sample_bytes);
       buf->type = trak->properties->codec_buftype;
-      buf->extra_info->input_time = qt_pts_2_msecs (trak->frames[i].pts);
+      buf->extra_info->input_time = qt_pts_2_msecs (frame.pts);
       buf->extra_info->input_normpos = qt_msec_2_normpos (this, buf->extra_info->input_time);
-      buf->pts = trak->frames[i].pts + (int64_t)trak->frames[i].ptsoffs + this->ptsoffs;
+      buf->pts = frame.pts + (int64_t)frame.ptsoffs + this->ptsoffs;
 
       buf->decoder_flags |= BUF_FLAG_FRAMERATE;
       buf->decoder_info[0] = frame_duration;
@@ -3573,7 +3913,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
         break;
       }
 
-      if (QTF_KEYFRAME(trak->frames[i]))
+      if (QTF_KEYFRAME(frame))
         buf->decoder_flags |= BUF_FLAG_KEYFRAME;
       if (!remaining_sample_bytes)
         buf->decoder_flags |= BUF_FLAG_FRAME_END;
@@ -3585,7 +3925,7 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     /* load an audio sample and packetize it */
     i = trak->current_frame++;
 
-    if (QTF_MEDIA_ID(trak->frames[i]) != trak->properties->media_id) {
+    if (QTF_MEDIA_ID(frame) != trak->properties->media_id) {
       this->status = DEMUX_OK;
       return this->status;
     }
@@ -3594,10 +3934,10 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
     if (!this->audio_fifo)
       return this->status;
 
-    remaining_sample_bytes = trak->frames[i].size;
+    remaining_sample_bytes = frame.size;
 
-    if ((off_t)QTF_OFFSET(trak->frames[i]) != current_pos) {
-      if (this->input->seek (this->input, QTF_OFFSET(trak->frames[i]), SEEK_SET) < 0) {
+    if ((off_t)QTF_OFFSET(frame) != current_pos) {
+      if (this->input->seek (this->input, QTF_OFFSET(frame), SEEK_SET) < 0) {
         /* Do not stop demuxing. Maybe corrupt file or broken track. */
         return this->status;
       }
@@ -3605,16 +3945,16 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
 
     debug_audio_demux("  qt: sending off audio frame %d from offset 0x%"PRIX64", %d bytes, media id %d, %"PRId64" pts\n",
       i,
-      QTF_OFFSET(trak->frames[i]),
-      trak->frames[i].size,
-      (int)QTF_MEDIA_ID(trak->frames[i]),
-      trak->frames[i].pts);
+      QTF_OFFSET(frame),
+      frame.size,
+      (int)QTF_MEDIA_ID(frame),
+      frame.pts);
 
     first_buf = 1;
     while (remaining_sample_bytes) {
       buf = this->audio_fifo->buffer_pool_size_alloc (this->audio_fifo, remaining_sample_bytes);
       buf->type = trak->properties->codec_buftype;
-      buf->extra_info->input_time = qt_pts_2_msecs (trak->frames[i].pts);
+      buf->extra_info->input_time = qt_pts_2_msecs (frame.pts);
       buf->extra_info->input_normpos = qt_msec_2_normpos (this, buf->extra_info->input_time);
       /* The audio chunk is often broken up into multiple 8K buffers when
        * it is sent to the audio decoder. Only attach the proper timestamp
@@ -3625,14 +3965,14 @@ static int demux_qt_send_chunk(demux_plugin_t *this_gen) {
       if ((buf->type == BUF_AUDIO_LPCM_BE) ||
           (buf->type == BUF_AUDIO_LPCM_LE)) {
         if (first_buf) {
-          buf->pts = trak->frames[i].pts + this->ptsoffs;
+          buf->pts = frame.pts + this->ptsoffs;
           first_buf = 0;
         } else {
           buf->extra_info->input_time = 0;
           buf->pts = 0;
         }
       } else {
-        buf->pts = trak->frames[i].pts + this->ptsoffs;
+        buf->pts = frame.pts + this->ptsoffs;
       }
 
       /* 24-bit audio doesn't fit evenly into the default 8192-byte buffers */
@@ -3703,17 +4043,17 @@ static void demux_qt_send_headers(demux_plugin_t *this_gen) {
   if (this->qt.video_trak != -1) {
     video_trak = &this->qt.traks[this->qt.video_trak];
 #ifdef QT_OFFSET_SEEK
-    first_video_offset = QTF_OFFSET(video_trak->frames[0]);
-    last_video_offset = video_trak->frames[video_trak->frame_count - 1].size +
-      QTF_OFFSET(video_trak->frames[video_trak->frame_count - 1]);
+    first_video_offset = QTF_OFFSET(qt_trak_frame (video_trak, 0)[0]);
+    last_video_offset = qt_trak_frame (video_trak, video_trak->frame_count - 1)->size +
+      QTF_OFFSET(qt_trak_frame (video_trak, video_trak->frame_count - 1)[0]);
 #endif
   }
   if (this->qt.audio_trak != -1) {
     audio_trak = &this->qt.traks[this->qt.audio_trak];
 #ifdef QT_OFFSET_SEEK
-    first_audio_offset = QTF_OFFSET(audio_trak->frames[0]);
-    last_audio_offset = audio_trak->frames[audio_trak->frame_count - 1].size +
-      QTF_OFFSET(audio_trak->frames[audio_trak->frame_count - 1]);
+    first_audio_offset = QTF_OFFSET(qt_trak_frame (audio_trak, 0)[0]);
+    last_audio_offset = qt_trak_frame (audio_trak, audio_trak->frame_count - 1)->size +
+      QTF_OFFSET(qt_trak_frame (audio_trak, audio_trak->frame_count - 1)[0]);
 #endif
   }
 
@@ -3954,6 +4294,54 @@ static void demux_qt_send_headers(demux_plugin_t *this_gen) {
   }
 }
 
+/* streaming mode: the frame tables only have the current fragment.
+ * if the seek target is elsewhere, load the fragment with it instead. */
+static void fragment_seek (demux_qt_t *this, off_t start_pos, int start_time) {
+  off_t offs;
+  xine_mfrag_index_t idx;
+
+  if (!this->qt.fraglist) {
+    xine_mfrag_list_t *fraglist = NULL;
+    if (this->input->get_optional_data (this->input, &fraglist, INPUT_OPTIONAL_DATA_FRAGLIST) != INPUT_OPTIONAL_SUCCESS)
+      return;
+    this->qt.fraglist = fraglist;
+  }
+  if (!this->qt.fraglist)
+    return;
+
+#ifdef QT_OFFSET_SEEK
+  if (start_pos) {
+    idx = xine_mfrag_find_pos (this->qt.fraglist, start_pos);
+  } else
+#else
+  if (start_pos)
+    start_time = (uint64_t)(start_pos & 0xffff) * (uint32_t)this->qt.msecs / 0xffff;
+#endif
+  {
+    int64_t pts = (int64_t)90 * start_time, timebase;
+    qt_trak *trak = this->qt.video_trak >= 0 ? &this->qt.traks[this->qt.video_trak]
+         : this->qt.audio_trak_count > 0 ? &this->qt.traks[this->qt.audio_traks[0]] : NULL;
+    /* already there? */
+    if (trak && trak->frame_count
+      && (pts >= qt_trak_frame (trak, 0)->pts) && (pts < qt_trak_frame (trak, trak->frame_count)->pts))
+      return;
+    if (!xine_mfrag_get_index_frag (this->qt.fraglist, 0, &timebase, NULL) || (timebase <= 0))
+      return;
+    idx = xine_mfrag_find_time (this->qt.fraglist, (int64_t)start_time * timebase / 1000);
+  }
+  if ((idx < 1) || (idx > xine_mfrag_get_frag_count (this->qt.fraglist)))
+    return;
+  if (!xine_mfrag_get_index_start (this->qt.fraglist, idx, NULL, &offs) || (offs <= 0))
+    return;
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    "demux_qt: seek: loading fragment #%d at %" PRId64 ".\n", (int)idx, (int64_t)offs);
+  fragment_recycle (this);
+  this->qt.fragment_next = offs;
+  if (fragment_scan (this))
+    qt_update_duration (this);
+}
+
 /* support function that performs a binary seek on a trak; returns the
  * demux status */
 static int binary_seek (demux_qt_t *this, qt_trak *trak, off_t start_pos, int start_time) {
@@ -3972,9 +4360,9 @@ static int binary_seek (demux_qt_t *this, qt_trak *trak, off_t start_pos, int st
   /* perform a binary search on the trak, testing the offset
    * boundaries first; offset request has precedent over time request */
   if (start_pos) {
-    if (start_pos <= (off_t)QTF_OFFSET(trak->frames[0]))
+    if (start_pos <= (off_t)QTF_OFFSET(qt_trak_frame (trak, 0)[0]))
       best_index = 0;
-    else if (start_pos >= (off_t)QTF_OFFSET(trak->frames[trak->frame_count - 1]))
+    else if (start_pos >= (off_t)QTF_OFFSET(qt_trak_frame (trak, trak->frame_count - 1)[0]))
       best_index = trak->frame_count - 1;
     else {
       left = 0;
@@ -3983,10 +4371,10 @@ static int binary_seek (demux_qt_t *this, qt_trak *trak, off_t start_pos, int st
 
       while (!found) {
 	middle = (left + right + 1) / 2;
-        if ((start_pos >= (off_t)QTF_OFFSET(trak->frames[middle])) &&
-            (start_pos < (off_t)QTF_OFFSET(trak->frames[middle + 1]))) {
+        if ((start_pos >= (off_t)QTF_OFFSET(qt_trak_frame (trak, middle)[0])) &&
+            (start_pos < (off_t)QTF_OFFSET(qt_trak_frame (trak, middle + 1)[0]))) {
           found = 1;
-        } else if (start_pos < (off_t)QTF_OFFSET(trak->frames[middle])) {
+        } else if (start_pos < (off_t)QTF_OFFSET(qt_trak_frame (trak, middle)[0])) {
           right = middle - 1;
         } else {
           left = middle;
@@ -4004,16 +4392,16 @@ static int binary_seek (demux_qt_t *this, qt_trak *trak, off_t start_pos, int st
   {
     int64_t pts = (int64_t)90 * start_time;
 
-    if (pts <= trak->frames[0].pts)
+    if (pts <= qt_trak_frame (trak, 0)->pts)
       best_index = 0;
-    else if (pts >= trak->frames[trak->frame_count - 1].pts)
+    else if (pts >= qt_trak_frame (trak, trak->frame_count - 1)->pts)
       best_index = trak->frame_count - 1;
     else {
       left = 0;
       right = trak->frame_count - 1;
       do {
 	middle = (left + right + 1) / 2;
-	if (pts < trak->frames[middle].pts) {
+	if (pts < qt_trak_frame (trak, middle)->pts) {
 	  right = (middle - 1);
 	} else {
 	  left = middle;
@@ -4050,6 +4438,9 @@ static int demux_qt_seek (demux_plugin_t *this_gen,
     return this->status;
   }
 
+  if (this->qt.fragment_stream)
+    fragment_seek (this, start_pos, start_time);
+
   /* if there is a video trak, position it as close as possible to the
    * requested position */
   if (this->qt.video_trak != -1) {
@@ -4059,12 +4450,12 @@ static int demux_qt_seek (demux_plugin_t *this_gen,
       return this->status;
     /* search back in the video trak for the nearest keyframe */
     while (video_trak->current_frame) {
-      if (QTF_KEYFRAME(video_trak->frames[video_trak->current_frame])) {
+      if (QTF_KEYFRAME(qt_trak_frame (video_trak, video_trak->current_frame)[0])) {
         break;
       }
       video_trak->current_frame--;
     }
-    keyframe_pts = video_trak->frames[video_trak->current_frame].pts;
+    keyframe_pts = qt_trak_frame (video_trak, video_trak->current_frame)->pts;
   }
 
   /* seek all supported audio traks */
@@ -4081,11 +4472,11 @@ static int demux_qt_seek (demux_plugin_t *this_gen,
    * no video trak */
   if (keyframe_pts >= 0) for (i = 0; i < this->qt.audio_trak_count; i++) {
     audio_trak = &this->qt.traks[this->qt.audio_traks[i]];
-    if (keyframe_pts > audio_trak->frames[audio_trak->frame_count - 1].pts) {
+    if (keyframe_pts > qt_trak_frame (audio_trak, audio_trak->frame_count - 1)->pts) {
       /* whoops, this trak is too short, mark it finished */
       audio_trak->current_frame = audio_trak->frame_count;
     } else while (audio_trak->current_frame) {
-      if (audio_trak->frames[audio_trak->current_frame].pts <= keyframe_pts) {
+      if (qt_trak_frame (audio_trak, audio_trak->current_frame)->pts <= keyframe_pts) {
         break;
       }
       audio_trak->current_frame--;
@@ -4159,7 +4550,8 @@ static int demux_qt_get_optional_data(demux_plugin_t *this_gen,
     case DEMUX_OPTIONAL_DATA_VIDEO_TIME:
       if (data && (this->qt.video_trak >= 0)) {
         qt_trak *trak = &this->qt.traks[this->qt.video_trak];
-        int32_t vtime = (trak->frames[trak->current_frame].pts + trak->frames[trak->current_frame].ptsoffs) / 90;
+        qt_frame *f = qt_trak_frame (trak, trak->current_frame);
+        int32_t vtime = (f->pts + f->ptsoffs) / 90;
         memcpy (data, &vtime, sizeof (vtime));
         return DEMUX_OPTIONAL_SUCCESS;
       }
@@ -174,6 +174,7 @@
 #include <xine/demux.h>
 
 #include "bswap.h"
+#include "keyframe_index.h"
 
 /*
   #define TS_LOG
@@ -337,13 +338,6 @@
  * if this seems to work during normal business, use it to find next
  * keyframe after seek as well. */
 
-typedef enum {
-  FRAMETYPE_UNKNOWN = 0,
-  FRAMETYPE_I,
-  FRAMETYPE_P,
-  FRAMETYPE_B
-} frametype_t;
-
 static frametype_t frametype_h264 (const uint8_t *f, uint32_t len) {
   static const uint8_t t[16] = {
     FRAMETYPE_UNKNOWN, FRAMETYPE_I,
@@ -411,28 +405,6 @@ static frametype_t frametype_h265 (const uint8_t *f, uint32_t len) {
   return FRAMETYPE_UNKNOWN;
 }
 
-static frametype_t frametype_mpeg (const uint8_t *f, uint32_t len) {
-  static const uint8_t t[8] = {
-    FRAMETYPE_UNKNOWN, FRAMETYPE_I, FRAMETYPE_P, FRAMETYPE_B,
-    FRAMETYPE_UNKNOWN, FRAMETYPE_UNKNOWN, FRAMETYPE_UNKNOWN, FRAMETYPE_UNKNOWN
-  };
-  const uint8_t *e = f + len - 4 - 2;
-  while (f <= e) {
-    uint32_t v = _X_BE_32 (f);
-    f += 1;
-    if ((v >> 8) != 1)
-      continue;
-    v &= 0xff; /* nal unit type */
-    if (v == 0xb3) /* sequence head */
-      return FRAMETYPE_I;
-    f += 4 - 1;
-    if (v != 0) /* picture start */
-      continue;
-    return t[(f[1] & 0x38) >> 3];
-  }
-  return FRAMETYPE_UNKNOWN;
-}
-
 static frametype_t frametype_vc1 (const uint8_t *f, uint32_t len) {
   const uint8_t *e = f + len - 4 - 1;
   while (f <= e) {
@@ -510,6 +482,14 @@ typedef struct {
   uint8_t  buf[4098];
 } demux_ts_pmt;
 
+/* keyframe index scan state */
+typedef struct {
+  frametype_t    (*get_frametype)(const uint8_t *f, uint32_t len);
+  uint32_t         pid;
+  uint32_t         hdmv;
+  int              synced;
+} demux_ts_kfi_t;
+
 typedef struct {
   /*
    * The first field must be the "base class" for the plugin!
@@ -543,6 +523,8 @@ typedef struct {
   uint32_t         pat_interval;
   uint32_t         keyframe_interval;
   frametype_t     (*get_frametype)(const uint8_t *f, uint32_t len);
+  kfi_t           *kfi;
+  demux_ts_kfi_t   kfi_state;
   /* programs */
   demux_ts_pmt    *pmts[MAX_PMTS];
   uint32_t         programs[MAX_PMTS + 1];
@@ -2706,27 +2688,39 @@ static const uint8_t *sync_next (demux_ts_t *this) {
 }
 #endif
 
+#if TS_PACKET_READER == 2
+/* number of complete, synchronised packets that follow in the buffer. */
+static int sync_count (demux_ts_t *this) {
+  const uint8_t *p = this->buf + this->buf_pos;
+  int step = this->hdmv > 0 ? 192 : 188;
+  int left = this->buf_size - this->buf_pos;
+  int n = 0;
+  while ((left >= step) && (p[0] == SYNC_BYTE)) {
+    p += step;
+    left -= step;
+    n++;
+  }
+  return n;
+}
+#endif
+
 /* transport stream packet layer */
-static void demux_ts_parse_packet (demux_ts_t*this) {
+static void demux_ts_parse_packet (demux_ts_t*this, const uint8_t *originalPkt) {
 
-  const uint8_t *originalPkt;
   uint32_t       tsp_head;
   uint32_t       pid;
   unsigned int   data_offset;
   unsigned int   data_len;
   uint32_t       index;
 
-  /* get next synchronised packet, or NULL */
-#if TS_PACKET_READER == 2
-  originalPkt = sync_next (this);
-#elif TS_PACKET_READER == 1
-  originalPkt = demux_synchronise(this);
-#endif
-  if (originalPkt == NULL)
-    return;
-
   tsp_head = _X_BE_32 (originalPkt);
   pid      = (tsp_head & TSP_pid) >> 8;
+  index    = this->pid_index[pid];
+
+  /* Most packets of a full transponder recording belong to programs we
+   * dont play. Drop them before looking any further. */
+  if ((index == 0xff) && pid && (pid != this->pcr_pid) && (pid != this->tbre_pid))
+    return;
 
 #ifdef TS_HEADER_LOG
   printf ("demux_ts:ts_header:sync_byte=0x%.2x\n",
@@ -2803,7 +2797,6 @@ static void demux_ts_parse_packet (demux_ts_t*this) {
   }
 
   data_len = PKT_SIZE - data_offset;
-  index = this->pid_index[pid];
 
   /* Do the demuxing in descending order of packet frequency! */
   if (!(index & 0x80)) {
@@ -2862,6 +2855,39 @@ static void demux_ts_parse_packet (demux_ts_t*this) {
   }
 }
 
+/* parse the next packet, and all further ones already in the read block. */
+static void demux_ts_parse_packets (demux_ts_t *this) {
+
+  const uint8_t *originalPkt;
+
+  /* get next synchronised packet, or NULL */
+#if TS_PACKET_READER == 2
+  originalPkt = sync_next (this);
+#elif TS_PACKET_READER == 1
+  originalPkt = demux_synchronise(this);
+#endif
+  if (originalPkt == NULL)
+    return;
+
+  demux_ts_parse_packet (this, originalPkt);
+
+#if TS_PACKET_READER == 2
+  {
+    int step = this->hdmv > 0 ? 192 : 188;
+    int n = sync_count (this);
+
+    /* sync_next () is not needed for these. Stop early when the engine
+     * wants to seek or stop. */
+    while ((n-- > 0) && (this->status == DEMUX_OK) && !_x_action_pending (this->stream)) {
+      originalPkt = this->buf + this->buf_pos;
+      this->buf_pos += step;
+      this->frame_pos += step;
+      demux_ts_parse_packet (this, originalPkt);
+    }
+  }
+#endif
+}
+
 /* 0 (go on), 1 (recheck), 2 (stop) */
 static int demux_ts_parse_pat_pmt_packet (demux_ts_t*this) {
 
@@ -2979,6 +3005,82 @@ static void demux_ts_scan_pat_pmt (demux_ts_t *this) {
 }
 
 
+/*
+ * On disk keyframe index, see keyframe_index.c.
+ */
+
+static void demux_ts_kfi_packet (kfi_t *kfi, demux_ts_kfi_t *d, const uint8_t *p, off_t offs) {
+  uint32_t head = _X_BE_32 (p), len = 184, v;
+  int64_t pts;
+
+  if ((head & (TSP_transport_error | TSP_payload_unit_start | TSP_pid | TSP_scrambling_control | TSP_adaptation_field_0))
+    != (TSP_payload_unit_start | (d->pid << 8) | TSP_adaptation_field_0))
+    return;
+  p += 4;
+  if (head & TSP_adaptation_field_1) {
+    uint32_t al = 1 + p[0];
+    if (len < al)
+      return;
+    p += al;
+    len -= al;
+  }
+  /* pes head with pts */
+  if ((len < 14) || ((_X_BE_32 (p) >> 8) != 1) || !(p[7] & 0x80))
+    return;
+  v = 9 + p[8];
+  if ((v < 14) || (len < v))
+    return;
+  if (d->get_frametype (p + v, len - v) != FRAMETYPE_I)
+    return;
+  pts = (int64_t)(p[9] & 0x0e) << 29;
+  v = _X_BE_32 (p + 10);
+  v = ((v >> 1) & 0x7fff) | ((v >> 2) & 0x3fff8000);
+  pts |= v;
+  kfi_add (kfi, pts, offs);
+}
+
+static uint32_t demux_ts_kfi_parse (kfi_t *kfi, void *data, const uint8_t *buf, uint32_t len, off_t pos) {
+  demux_ts_kfi_t *d = data;
+  uint32_t step = d->hdmv ? 192 : 188, sofs = d->hdmv ? 4 : 0;
+  uint32_t i = 0;
+
+  while (i + step <= len) {
+    if (buf[i + sofs] != SYNC_BYTE) {
+      i++;
+      d->synced = 0;
+      continue;
+    }
+    if (!d->synced) {
+      /* need another one to trust it. */
+      if (i + 2 * step > len)
+        break;
+      if (buf[i + sofs + step] != SYNC_BYTE) {
+        i++;
+        continue;
+      }
+      d->synced = 1;
+    }
+    demux_ts_kfi_packet (kfi, d, buf + i + sofs, pos + i);
+    i += step;
+  }
+  return i;
+}
+
+static void demux_ts_kfi_open (demux_ts_t *this) {
+  uint32_t key[3];
+
+  if ((this->videoPid == INVALID_PID) || !this->get_frametype || (this->hdmv < 0))
+    return;
+  this->kfi_state.get_frametype = this->get_frametype;
+  this->kfi_state.pid           = this->videoPid;
+  this->kfi_state.hdmv          = this->hdmv;
+  this->kfi_state.synced        = 0;
+  key[0] = this->videoPid;
+  key[1] = this->hdmv;
+  key[2] = 0;
+  this->kfi = kfi_open (this->stream, this->input, key, demux_ts_kfi_parse, &this->kfi_state);
+}
+
 /*
  * check for pids change events
  */
@@ -3016,7 +3118,7 @@ static int demux_ts_send_chunk (demux_plugin_t *this_gen) {
 
   demux_ts_event_handler (this);
 
-  demux_ts_parse_packet(this);
+  demux_ts_parse_packets (this);
 
   /* DVBSUB: check if channel has changed.  Dunno if I should, or
    * even could, lock the xine object. */
@@ -3031,6 +3133,8 @@ static void demux_ts_dispose (demux_plugin_t *this_gen) {
   int i;
   demux_ts_t*this = (demux_ts_t*)this_gen;
 
+  kfi_dispose (&this->kfi);
+
   for (i = 0; this->programs[i] != INVALID_PROGRAM; i++) {
     if (this->pmts[i] != NULL) {
       free (this->pmts[i]);
@@ -3103,6 +3207,9 @@ static void demux_ts_send_headers (demux_plugin_t *this_gen) {
   _x_stream_info_set (this->stream, XINE_STREAM_INFO_HAS_AUDIO, 1);
 
   demux_ts_scan_pat_pmt (this);
+
+  if (!this->kfi)
+    demux_ts_kfi_open (this);
 }
 
 static int demux_ts_seek (demux_plugin_t *this_gen,
@@ -3110,6 +3217,7 @@ static int demux_ts_seek (demux_plugin_t *this_gen,
 
   demux_ts_t *this = (demux_ts_t *) this_gen;
   uint32_t caps;
+  off_t kf = -1;
   int i;
 
   if (playing) {
@@ -3147,7 +3255,13 @@ static int demux_ts_seek (demux_plugin_t *this_gen,
       this->input->seek_time (this->input, start_time, SEEK_SET);
     } else {
       start_pos = (off_t)((double)start_pos / 65535 * this->input->get_length (this->input));
-      if ((!start_pos) && (start_time)) {
+      if (this->kfi && (start_pos || start_time)) {
+        kfi_scan (this->kfi);
+        kf = kfi_find (this->kfi, start_pos, start_time);
+      }
+      if (kf >= 0) {
+        this->input->seek (this->input, kf, SEEK_SET);
+      } else if ((!start_pos) && (start_time)) {
         if (this->input->seek_time) {
           this->input->seek_time (this->input, start_time, SEEK_SET);
         } else {
@@ -3166,7 +3280,13 @@ static int demux_ts_seek (demux_plugin_t *this_gen,
      * Unfortunately, they are marked in a codec specific way,
      * and may even hide behind escape codes.
      * Limit scan to ~10 seconds / 8Mbyte. */
-    if ((this->videoPid != INVALID_PID) && this->get_frametype && (this->keyframe_interval < 1000000)) {
+    if (kf >= 0) {
+      /* already there. */
+      this->last_keyframe_time = 0;
+      xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+        "demux_ts: seek: indexed keyframe at %" PRId64 ".\n", (int64_t)kf);
+    }
+    else if ((this->videoPid != INVALID_PID) && this->get_frametype && (this->keyframe_interval < 1000000)) {
       uint32_t n;
       uint32_t want_phead = (SYNC_BYTE << 24) | TSP_payload_unit_start | (this->videoPid << 8) | TSP_adaptation_field_0;
       xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
@@ -3472,6 +3592,7 @@ static demux_plugin_t *open_plugin (demux_class_t *class_gen,
   this->last_pat_time      = 0;
   this->last_keyframe_time = 0;
   this->get_frametype      = NULL;
+  this->kfi                = NULL;
   this->bounce_left        = 0;
   this->first_pts          = 0;
   this->apts               = 0;
@@ -0,0 +1,461 @@
+/*
+ * Copyright (C) 2000-2022 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * On disk keyframe index.
+ * A cloned input scans the file once for video keyframes in a separate thread,
+ * and the result is kept in $XDG_CACHE_HOME/xine-lib/keyframes/. Later opens
+ * just load it, and only scan what the file has grown since.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include <basedir.h>
+
+#define LOG_MODULE "keyframe_index"
+
+#include <xine/xine_internal.h>
+#include <xine/xineutils.h>
+#include "bswap.h"
+
+#include "keyframe_index.h"
+
+#define KFI_MAGIC      "XINEKFI1"
+#define KFI_HEAD_SIZE  32
+#define KFI_CHECK_SIZE 4096
+#define KFI_BUF_SIZE   (192 * 1024)
+#define KFI_PTS_WRAP   ((int64_t)1 << 33)
+
+typedef struct {
+  int64_t  pts;  /* 90kHz, unwrapped */
+  int64_t  offs; /* file position to seek to */
+} kfi_entry_t;
+
+struct kfi_s {
+  xine_stream_t   *stream;
+  input_plugin_t  *input;      /* own clone, used by the scan thread */
+  kfi_parse_t      parse;
+  void            *data;
+  char            *path;
+  uint32_t         key[3];
+  uint32_t         check;
+  off_t            length;     /* scan thread only */
+
+  pthread_t        thread;
+  int              started;    /* thread needs join */
+  int              quit;
+
+  /* protected by mutex. list is appended and reallocated by the scan thread only. */
+  pthread_mutex_t  mutex;
+  int              running;
+  off_t            done;       /* scanned bytes */
+  uint32_t         used, size, saved;
+  kfi_entry_t     *list;
+};
+
+frametype_t frametype_mpeg (const uint8_t *f, uint32_t len) {
+  static const uint8_t t[8] = {
+    FRAMETYPE_UNKNOWN, FRAMETYPE_I, FRAMETYPE_P, FRAMETYPE_B,
+    FRAMETYPE_UNKNOWN, FRAMETYPE_UNKNOWN, FRAMETYPE_UNKNOWN, FRAMETYPE_UNKNOWN
+  };
+  const uint8_t *e = f + len - 4 - 2;
+  while (f <= e) {
+    uint32_t v = _X_BE_32 (f);
+    f += 1;
+    if ((v >> 8) != 1)
+      continue;
+    v &= 0xff; /* nal unit type */
+    if (v == 0xb3) /* sequence head */
+      return FRAMETYPE_I;
+    f += 4 - 1;
+    if (v != 0) /* picture start */
+      continue;
+    return t[(f[1] & 0x38) >> 3];
+  }
+  return FRAMETYPE_UNKNOWN;
+}
+
+static uint32_t kfi_hash (const uint8_t *p, uint32_t len, uint32_t h) {
+  /* FNV-1a */
+  while (len--)
+    h = (h ^ *p++) * 0x01000193;
+  return h;
+}
+
+static int kfi_mkdir (xine_t *xine, const char *path) {
+  if ((mkdir (path, 0700) < 0) && (errno != EEXIST)) {
+    int e = errno;
+    xprintf (xine, XINE_VERBOSITY_DEBUG,
+      LOG_MODULE ": mkdir (%s) failed: %s.\n", path, strerror (e));
+    return 0;
+  }
+  return 1;
+}
+
+static char *kfi_path (xine_t *xine, const char *mrl) {
+  const char *cache = xdgCacheHome (&xine->basedir_handle);
+  char *path;
+  size_t l;
+
+  if (!cache)
+    return NULL;
+  l = strlen (cache);
+  path = malloc (l + sizeof ("/" PACKAGE "/keyframes/") + 20);
+  if (!path)
+    return NULL;
+  memcpy (path, cache, l + 1);
+  if (!kfi_mkdir (xine, path))
+    goto fail;
+  strcpy (path + l, "/" PACKAGE);
+  if (!kfi_mkdir (xine, path))
+    goto fail;
+  strcat (path + l, "/keyframes");
+  if (!kfi_mkdir (xine, path))
+    goto fail;
+  sprintf (path + strlen (path), "/%08x.idx",
+    (unsigned int)kfi_hash ((const uint8_t *)mrl, strlen (mrl), 0x811c9dc5));
+  return path;
+ fail:
+  free (path);
+  return NULL;
+}
+
+static void kfi_head (kfi_t *kfi, uint8_t *head, int64_t done) {
+  uint32_t w[4];
+
+  w[0] = kfi->key[0];
+  w[1] = kfi->key[1];
+  w[2] = kfi->check;
+  w[3] = kfi->key[2];
+  memcpy (head, KFI_MAGIC, 8);
+  memcpy (head + 8, w, 16);
+  memcpy (head + 24, &done, 8);
+}
+
+static void kfi_load (kfi_t *kfi) {
+  struct stat st;
+  uint8_t head[KFI_HEAD_SIZE], want[KFI_HEAD_SIZE];
+  int64_t done;
+  uint32_t n;
+  size_t l;
+  int fd;
+
+  fd = xine_open_cloexec (kfi->path, O_RDONLY);
+  if (fd < 0)
+    return;
+  if ((fstat (fd, &st) < 0) || (st.st_size < KFI_HEAD_SIZE) || (st.st_size > (1 << 30))
+    || (read (fd, head, KFI_HEAD_SIZE) != KFI_HEAD_SIZE)) {
+    close (fd);
+    return;
+  }
+  kfi_head (kfi, want, 0);
+  memcpy (&done, head + 24, 8);
+  if (memcmp (head, want, 24) || (done <= 0) || (done > kfi->input->get_length (kfi->input))) {
+    close (fd);
+    return;
+  }
+
+  n = (st.st_size - KFI_HEAD_SIZE) / sizeof (*kfi->list);
+  l = (size_t)n * sizeof (*kfi->list);
+  kfi->list = malloc (l + 1024 * sizeof (*kfi->list));
+  if (kfi->list && (read (fd, kfi->list, l) == (ssize_t)l)) {
+    kfi->used = kfi->saved = n;
+    kfi->size = n + 1024;
+    kfi->done = done;
+  } else {
+    _x_freep (&kfi->list);
+  }
+  close (fd);
+}
+
+static void kfi_save (kfi_t *kfi) {
+  uint8_t head[KFI_HEAD_SIZE];
+  kfi_entry_t *add = NULL;
+  uint32_t saved, n;
+  int fd;
+
+  /* dont hold the lock during file io. */
+  pthread_mutex_lock (&kfi->mutex);
+  saved = kfi->saved;
+  n = kfi->used - saved;
+  if (n) {
+    add = malloc (n * sizeof (*add));
+    if (add)
+      memcpy (add, kfi->list + saved, n * sizeof (*add));
+  }
+  kfi_head (kfi, head, kfi->done);
+  pthread_mutex_unlock (&kfi->mutex);
+  if (n && !add)
+    return;
+
+  /* drop a stale index of another file. */
+  fd = xine_create_cloexec (kfi->path, saved ? O_WRONLY : (O_WRONLY | O_TRUNC), 0600);
+  if (fd < 0) {
+    free (add);
+    return;
+  }
+  /* new entries first, then make them valid. */
+  if (n) {
+    size_t l = n * sizeof (*add);
+    if ((lseek (fd, KFI_HEAD_SIZE + (off_t)saved * sizeof (*add), SEEK_SET) < 0)
+      || (write (fd, add, l) != (ssize_t)l)) {
+      close (fd);
+      free (add);
+      return;
+    }
+  }
+  free (add);
+  if ((lseek (fd, 0, SEEK_SET) == 0) && (write (fd, head, KFI_HEAD_SIZE) == KFI_HEAD_SIZE)) {
+    pthread_mutex_lock (&kfi->mutex);
+    kfi->saved = saved + n;
+    pthread_mutex_unlock (&kfi->mutex);
+  }
+  close (fd);
+}
+
+void kfi_add (kfi_t *kfi, int64_t pts, off_t offs) {
+  xine_keyframes_entry_t e;
+
+  pthread_mutex_lock (&kfi->mutex);
+  if (kfi->used) {
+    /* keep it sorted. */
+    int64_t last = kfi->list[kfi->used - 1].pts;
+    pts += last - (last & (KFI_PTS_WRAP - 1));
+    if (pts < last - (KFI_PTS_WRAP >> 1))
+      pts += KFI_PTS_WRAP;
+    if (pts <= last) {
+      pthread_mutex_unlock (&kfi->mutex);
+      return;
+    }
+  }
+  if (kfi->used >= kfi->size) {
+    kfi_entry_t *n = realloc (kfi->list, (kfi->size + 1024) * sizeof (*n));
+    if (!n) {
+      pthread_mutex_unlock (&kfi->mutex);
+      return;
+    }
+    kfi->list = n;
+    kfi->size += 1024;
+  }
+  kfi->list[kfi->used].pts = pts;
+  kfi->list[kfi->used].offs = offs;
+  kfi->used++;
+  e.msecs = (pts - kfi->list[0].pts) / 90;
+  pthread_mutex_unlock (&kfi->mutex);
+
+  e.normpos = kfi->length > 0 ? (int)((double)offs * 65535 / kfi->length) : 0;
+  _x_keyframes_add (kfi->stream, &e);
+}
+
+static void *kfi_loop (void *data) {
+  kfi_t *kfi = data;
+  uint32_t fill = 0, used;
+  uint8_t *buf;
+  off_t pos;
+
+  pthread_mutex_lock (&kfi->mutex);
+  pos = kfi->done;
+  pthread_mutex_unlock (&kfi->mutex);
+  kfi->length = kfi->input->get_length (kfi->input);
+
+  buf = malloc (KFI_BUF_SIZE);
+  if (buf && (kfi->input->seek (kfi->input, pos, SEEK_SET) == pos)) {
+    xprintf (kfi->stream->xine, XINE_VERBOSITY_DEBUG,
+      LOG_MODULE ": scanning from %" PRId64 ".\n", (int64_t)pos);
+    while (!kfi->quit) {
+      uint32_t i;
+      off_t n = kfi->input->read (kfi->input, buf + fill, KFI_BUF_SIZE - fill);
+      if (n <= 0)
+        break;
+      fill += n;
+      i = kfi->parse (kfi, kfi->data, buf, fill, pos);
+      fill -= i;
+      if (fill)
+        memmove (buf, buf + i, fill);
+      pos += i;
+      pthread_mutex_lock (&kfi->mutex);
+      kfi->done = pos;
+      pthread_mutex_unlock (&kfi->mutex);
+    }
+  }
+  free (buf);
+
+  kfi_save (kfi);
+  pthread_mutex_lock (&kfi->mutex);
+  kfi->running = 0;
+  used = kfi->used;
+  pos = kfi->done;
+  pthread_mutex_unlock (&kfi->mutex);
+  xprintf (kfi->stream->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": %u entries for %" PRId64 " bytes.\n", (unsigned int)used, (int64_t)pos);
+  return NULL;
+}
+
+void kfi_scan (kfi_t *kfi) {
+  int run;
+
+  pthread_mutex_lock (&kfi->mutex);
+  run = kfi->running || (kfi->input->get_length (kfi->input) <= kfi->done);
+  if (!run)
+    kfi->running = 1;
+  pthread_mutex_unlock (&kfi->mutex);
+  if (run)
+    return;
+  if (kfi->started) {
+    pthread_join (kfi->thread, NULL);
+    kfi->started = 0;
+  }
+  if (pthread_create (&kfi->thread, NULL, kfi_loop, kfi)) {
+    pthread_mutex_lock (&kfi->mutex);
+    kfi->running = 0;
+    pthread_mutex_unlock (&kfi->mutex);
+    return;
+  }
+  kfi->started = 1;
+}
+
+void kfi_dispose (kfi_t **kfi_p) {
+  kfi_t *kfi = *kfi_p;
+
+  if (!kfi)
+    return;
+  *kfi_p = NULL;
+  kfi->quit = 1;
+  if (kfi->started)
+    pthread_join (kfi->thread, NULL);
+  kfi->input->dispose (kfi->input);
+  pthread_mutex_destroy (&kfi->mutex);
+  free (kfi->list);
+  free (kfi->path);
+  free (kfi);
+}
+
+kfi_t *kfi_open (xine_stream_t *stream, input_plugin_t *input, const uint32_t key[3],
+  kfi_parse_t parse, void *data) {
+  xine_t *xine = stream->xine;
+  kfi_t *kfi;
+  input_plugin_t *clone = NULL;
+  uint8_t check[KFI_CHECK_SIZE];
+
+  if (!xine->config->register_bool (xine->config,
+    "media.files.keyframe_index", 0,
+    _("Keep a keyframe index of MPEG-TS and MPEG-PS files"),
+    _("Scan local transport and program stream files for video keyframes once, in the background, "
+      "and store the result in the cache directory. This makes time seeks exact, "
+      "and lets a frontend know all keyframes right after opening."),
+    20, NULL, NULL))
+    return NULL;
+
+  if ((input->get_capabilities (input) & (INPUT_CAP_SEEKABLE | INPUT_CAP_CLONE | INPUT_CAP_LIVE))
+    != (INPUT_CAP_SEEKABLE | INPUT_CAP_CLONE))
+    return NULL;
+  if ((input->get_optional_data (input, &clone, INPUT_OPTIONAL_DATA_CLONE) != INPUT_OPTIONAL_SUCCESS)
+    || !clone)
+    return NULL;
+  /* files with a different start are different files. */
+  if ((clone->read (clone, check, KFI_CHECK_SIZE) != KFI_CHECK_SIZE)
+    || !(kfi = calloc (1, sizeof (*kfi)))) {
+    clone->dispose (clone);
+    return NULL;
+  }
+#ifndef HAVE_ZERO_SAFE_MEM
+  kfi->list    = NULL;
+  kfi->used    = 0;
+  kfi->saved   = 0;
+  kfi->done    = 0;
+  kfi->running = 0;
+  kfi->started = 0;
+  kfi->quit    = 0;
+#endif
+  kfi->path = kfi_path (xine, input->get_mrl (input));
+  if (!kfi->path) {
+    clone->dispose (clone);
+    free (kfi);
+    return NULL;
+  }
+  kfi->stream = stream;
+  kfi->input  = clone;
+  kfi->parse  = parse;
+  kfi->data   = data;
+  kfi->key[0] = key[0];
+  kfi->key[1] = key[1];
+  kfi->key[2] = key[2];
+  kfi->check  = kfi_hash (check, KFI_CHECK_SIZE, 0x811c9dc5);
+  pthread_mutex_init (&kfi->mutex, NULL);
+
+  kfi_load (kfi);
+  if (kfi->used) {
+    off_t length = clone->get_length (clone);
+    xine_keyframes_entry_t *list = malloc (kfi->used * sizeof (*list));
+    if (list) {
+      uint32_t u;
+      for (u = 0; u < kfi->used; u++) {
+        list[u].msecs = (kfi->list[u].pts - kfi->list[0].pts) / 90;
+        list[u].normpos = length > 0 ? (int)((double)kfi->list[u].offs * 65535 / length) : 0;
+      }
+      _x_keyframes_set (stream, list, kfi->used);
+      free (list);
+    }
+  }
+  kfi_scan (kfi);
+  return kfi;
+}
+
+off_t kfi_find (kfi_t *kfi, off_t start_pos, int start_time) {
+  off_t ret = -1;
+  int64_t pts = 0;
+  uint32_t a, e, m;
+
+  pthread_mutex_lock (&kfi->mutex);
+  if (!kfi->used)
+    goto done;
+  if (start_pos > 0) {
+    if (start_pos > kfi->done)
+      goto done;
+  } else {
+    pts = kfi->list[0].pts + (int64_t)start_time * 90;
+    if ((pts > kfi->list[kfi->used - 1].pts) && kfi->running)
+      goto done;
+  }
+  /* last entry not behind target */
+  a = 0;
+  e = kfi->used;
+  while (e - a > 1) {
+    m = (a + e) >> 1;
+    if (start_pos > 0 ? (kfi->list[m].offs <= start_pos) : (kfi->list[m].pts <= pts))
+      a = m;
+    else
+      e = m;
+  }
+  ret = kfi->list[a].offs;
+ done:
+  pthread_mutex_unlock (&kfi->mutex);
+  return ret;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2000-2022 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * On disk keyframe index, shared by demux_ts and demux_mpeg_block.
+ */
+#ifndef KEYFRAME_INDEX_H
+#define KEYFRAME_INDEX_H
+
+#include <xine/xine_internal.h>
+
+typedef enum {
+  FRAMETYPE_UNKNOWN = 0,
+  FRAMETYPE_I,
+  FRAMETYPE_P,
+  FRAMETYPE_B
+} frametype_t;
+
+/* guess the type of a mpeg-1/2 video frame from the start of its pes payload. */
+frametype_t frametype_mpeg (const uint8_t *f, uint32_t len);
+
+typedef struct kfi_s kfi_t;
+
+/* called by the scan thread with the next len bytes at file position pos.
+ * report keyframes with kfi_add (), and return the number of bytes done with.
+ * the rest will be passed again, together with more data. */
+typedef uint32_t (*kfi_parse_t) (kfi_t *kfi, void *data, const uint8_t *buf, uint32_t len, off_t pos);
+
+/* returns NULL if disabled by user, or input is not suitable.
+ * key tells index files of different stream layouts apart.
+ * data must stay valid until kfi_dispose (). */
+kfi_t *kfi_open (xine_stream_t *stream, input_plugin_t *input, const uint32_t key[3],
+  kfi_parse_t parse, void *data);
+void   kfi_dispose (kfi_t **kfi);
+
+/* pts is 90kHz, offs is the file position to seek to. */
+void   kfi_add (kfi_t *kfi, int64_t pts, off_t offs);
+
+/* (re)start the scan thread if the file has grown. */
+void   kfi_scan (kfi_t *kfi);
+
+/* find the file position of the keyframe at or before start_pos (bytes) or start_time (ms),
+ * or -1 if that part of the file is not indexed yet. */
+off_t  kfi_find (kfi_t *kfi, off_t start_pos, int start_time);
+
+#endif
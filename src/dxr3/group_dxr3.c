@@ -70,8 +70,8 @@ const plugin_info_t xine_plugin_info[] EXPORTED = {
   { PLUGIN_VIDEO_DECODER, 19, "dxr3-mpeg2",  XINE_VERSION_CODE, &dxr3_video_decoder_info, &dxr3_video_init_plugin },
   { PLUGIN_SPU_DECODER,   17, "dxr3-spudec", XINE_VERSION_CODE, &dxr3_spudec_info,        &dxr3_spudec_init_plugin },
 #ifdef HAVE_X11
-  { PLUGIN_VIDEO_OUT,     22, "dxr3",        XINE_VERSION_CODE, &vo_info_dxr3_x11,        &dxr3_x11_init_plugin },
+  { PLUGIN_VIDEO_OUT,     23, "dxr3",        XINE_VERSION_CODE, &vo_info_dxr3_x11,        &dxr3_x11_init_plugin },
 #endif
-  { PLUGIN_VIDEO_OUT,     22, "aadxr3",      XINE_VERSION_CODE, &vo_info_dxr3_aa,         &dxr3_aa_init_plugin },
+  { PLUGIN_VIDEO_OUT,     23, "aadxr3",      XINE_VERSION_CODE, &vo_info_dxr3_aa,         &dxr3_aa_init_plugin },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
@@ -0,0 +1,462 @@
+/*
+ * Copyright (C) 2020 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * Fragment prefetch for segmented streams (hls, mpegdash).
+ * Upcoming fragments are loaded into memory by a few side threads
+ * with their own input instances. The owner then gets a finished fragment
+ * as a small memory backed input plugin that can just replace its in1.
+ * Needs <pthread.h>, <xine/xine_internal.h> and "input_helper.h".
+ */
+
+/** max parallel fetches, and max fragments held in memory. */
+#define FRAG_PREFETCH_SLOTS 8
+/** dont grab more than this per owner. */
+#define FRAG_PREFETCH_MAX_BYTES (64 << 20)
+/** a single fragment larger than this is left to the direct path. */
+#define FRAG_PREFETCH_MAX_FRAG (32 << 20)
+
+typedef enum {
+  FRAG_SLOT_FREE = 0,
+  FRAG_SLOT_QUEUED,
+  FRAG_SLOT_LOADING,
+  FRAG_SLOT_DONE,
+  FRAG_SLOT_FAILED
+} frag_slot_state_t;
+
+typedef struct {
+  char              *mrl;
+  uint8_t           *buf;
+  size_t             size;
+  uint32_t           seq;
+  uint32_t           dur_ms;  /** << playback time, 0 if unknown */
+  frag_slot_state_t  state;
+  int                cancel;
+} frag_slot_t;
+
+typedef struct {
+  xine_stream_t   *stream;
+  const char      *name;
+  pthread_mutex_t  mutex;
+  pthread_cond_t   work, done;
+  pthread_t        threads[FRAG_PREFETCH_SLOTS];
+  uint32_t         num_threads;
+  uint32_t         max_depth;  /** << user setting, 0 = off */
+  uint32_t         depth;      /** << current adaptive depth 1..max_depth */
+  uint32_t         seq;
+  uint32_t         rate;       /** << measured bytes/second, 0 if unknown */
+  size_t           bytes;      /** << currently held in memory */
+  int              quit;
+  int              init;
+  frag_slot_t      slots[FRAG_PREFETCH_SLOTS];
+} frag_prefetch_t;
+
+/* the memory input handed to the owner. */
+
+typedef struct {
+  input_plugin_t  input_plugin;
+  uint8_t        *buf;
+  size_t          size;
+  off_t           pos;
+  char            mrl[1];
+} frag_mem_input_t;
+
+static off_t frag_mem_read (input_plugin_t *this_gen, void *buf, off_t len) {
+  frag_mem_input_t *this = (frag_mem_input_t *)this_gen;
+  off_t l = this->size - this->pos;
+  if (len < 0)
+    return -1;
+  if (l > len)
+    l = len;
+  if (l > 0) {
+    memcpy (buf, this->buf + this->pos, l);
+    this->pos += l;
+  }
+  return l;
+}
+
+static off_t frag_mem_seek (input_plugin_t *this_gen, off_t offset, int origin) {
+  frag_mem_input_t *this = (frag_mem_input_t *)this_gen;
+  offset = _x_input_translate_seek (offset, origin, this->pos, this->size);
+  if (offset < 0)
+    return -1;
+  this->pos = offset;
+  return offset;
+}
+
+static off_t frag_mem_get_current_pos (input_plugin_t *this_gen) {
+  frag_mem_input_t *this = (frag_mem_input_t *)this_gen;
+  return this->pos;
+}
+
+static off_t frag_mem_get_length (input_plugin_t *this_gen) {
+  frag_mem_input_t *this = (frag_mem_input_t *)this_gen;
+  return this->size;
+}
+
+static const char *frag_mem_get_mrl (input_plugin_t *this_gen) {
+  frag_mem_input_t *this = (frag_mem_input_t *)this_gen;
+  return this->mrl;
+}
+
+static int frag_mem_open (input_plugin_t *this_gen) {
+  (void)this_gen;
+  return 1;
+}
+
+static void frag_mem_dispose (input_plugin_t *this_gen) {
+  frag_mem_input_t *this = (frag_mem_input_t *)this_gen;
+  free (this->buf);
+  free (this);
+}
+
+static input_plugin_t *frag_mem_input_new (const char *mrl, uint8_t *buf, size_t size) {
+  size_t l = strlen (mrl);
+  frag_mem_input_t *this = calloc (1, sizeof (*this) + l);
+  if (!this)
+    return NULL;
+  memcpy (this->mrl, mrl, l + 1);
+  this->buf  = buf;
+  this->size = size;
+  this->input_plugin.open              = frag_mem_open;
+  this->input_plugin.get_capabilities  = _x_input_get_capabilities_seekable;
+  this->input_plugin.read              = frag_mem_read;
+  this->input_plugin.read_block        = _x_input_default_read_block;
+  this->input_plugin.seek              = frag_mem_seek;
+  this->input_plugin.get_current_pos   = frag_mem_get_current_pos;
+  this->input_plugin.get_length        = frag_mem_get_length;
+  this->input_plugin.get_blocksize     = _x_input_default_get_blocksize;
+  this->input_plugin.get_mrl           = frag_mem_get_mrl;
+  this->input_plugin.get_optional_data = _x_input_default_get_optional_data;
+  this->input_plugin.dispose           = frag_mem_dispose;
+  /* input_class and node stay NULL, _x_free_input_plugin () handles that. */
+  return &this->input_plugin;
+}
+
+/* the side threads. */
+
+static void frag_slot_clear (frag_prefetch_t *pf, frag_slot_t *slot) {
+  if (slot->buf) {
+    pf->bytes -= slot->size;
+    _x_freep (&slot->buf);
+  }
+  _x_freep (&slot->mrl);
+  slot->size = 0;
+  slot->cancel = 0;
+  slot->state = FRAG_SLOT_FREE;
+}
+
+static int frag_prefetch_load (frag_prefetch_t *pf, frag_slot_t *slot, const char *mrl, uint8_t **pbuf, size_t *psize) {
+  input_plugin_t *in;
+  uint8_t *buf = NULL;
+  size_t size = 0, bsize = 0;
+  off_t len;
+  int ok = 0;
+
+  in = _x_find_input_plugin (pf->stream, mrl);
+  if (!in)
+    return 0;
+  if (in->open (in) <= 0) {
+    _x_free_input_plugin (pf->stream, in);
+    return 0;
+  }
+  len = in->get_length (in);
+  if (len > FRAG_PREFETCH_MAX_FRAG)
+    goto done;
+  bsize = len > 0 ? (size_t)len : (256 << 10);
+  while (!slot->cancel) {
+    off_t r;
+    if (size >= bsize) {
+      uint8_t *nbuf;
+      if (bsize >= FRAG_PREFETCH_MAX_FRAG)
+        break;
+      bsize *= 2;
+      if (bsize > FRAG_PREFETCH_MAX_FRAG)
+        bsize = FRAG_PREFETCH_MAX_FRAG;
+      nbuf = realloc (buf, bsize);
+      if (!nbuf)
+        break;
+      buf = nbuf;
+    } else if (!buf) {
+      buf = malloc (bsize);
+      if (!buf)
+        break;
+    }
+    r = bsize - size;
+    if (r > (64 << 10))
+      r = 64 << 10;
+    r = in->read (in, buf + size, r);
+    if (r < 0)
+      break;
+    if (r == 0) {
+      ok = !slot->cancel;
+      break;
+    }
+    size += r;
+  }
+ done:
+  _x_free_input_plugin (pf->stream, in);
+  if (!ok) {
+    free (buf);
+    return 0;
+  }
+  *pbuf = buf;
+  *psize = size;
+  return 1;
+}
+
+static void *frag_prefetch_thread (void *data) {
+  frag_prefetch_t *pf = (frag_prefetch_t *)data;
+
+  pthread_mutex_lock (&pf->mutex);
+  while (1) {
+    frag_slot_t *slot = NULL;
+    uint32_t i;
+    while (!pf->quit) {
+      /* oldest first. */
+      for (i = 0; i < FRAG_PREFETCH_SLOTS; i++) {
+        frag_slot_t *s = pf->slots + i;
+        if ((s->state == FRAG_SLOT_QUEUED) && (!slot || ((int32_t)(s->seq - slot->seq) < 0)))
+          slot = s;
+      }
+      if (slot)
+        break;
+      pthread_cond_wait (&pf->work, &pf->mutex);
+    }
+    if (pf->quit)
+      break;
+    {
+      struct timeval tv1, tv2;
+      char *mrl = slot->mrl;
+      uint8_t *buf = NULL;
+      size_t size = 0;
+      int ok, ms;
+
+      slot->state = FRAG_SLOT_LOADING;
+      pthread_mutex_unlock (&pf->mutex);
+      xine_monotonic_clock (&tv1, NULL);
+      ok = frag_prefetch_load (pf, slot, mrl, &buf, &size);
+      xine_monotonic_clock (&tv2, NULL);
+      ms = (tv2.tv_sec - tv1.tv_sec) * 1000 + (tv2.tv_usec - tv1.tv_usec) / 1000;
+      pthread_mutex_lock (&pf->mutex);
+
+      if (slot->cancel) {
+        free (buf);
+        frag_slot_clear (pf, slot);
+      } else if (!ok) {
+        slot->state = FRAG_SLOT_FAILED;
+      } else {
+        slot->buf = buf;
+        slot->size = size;
+        slot->state = FRAG_SLOT_DONE;
+        pf->bytes += size;
+        if (ms < 1)
+          ms = 1;
+        pf->rate = (uint64_t)size * 1000u / (uint32_t)ms;
+        /* adapt depth: a fetch eating up much of its own play time
+         * needs more parallel ones to keep up, a fast one needs fewer. */
+        if (slot->dur_ms) {
+          uint32_t load = (uint32_t)ms * 100u / slot->dur_ms;
+          if ((load > 50) && (pf->depth < pf->max_depth))
+            pf->depth++;
+          else if ((load < 15) && (pf->depth > 1))
+            pf->depth--;
+        }
+        xprintf (pf->stream->xine, XINE_VERBOSITY_DEBUG,
+          "%s: prefetched %s (%zu bytes, %d ms, depth %u).\n", pf->name, mrl, size, ms, pf->depth);
+      }
+      pthread_cond_broadcast (&pf->done);
+    }
+  }
+  pthread_mutex_unlock (&pf->mutex);
+  return NULL;
+}
+
+/* owner side. */
+
+static uint32_t frag_prefetch_get_depth (config_values_t *config) {
+  int v = config->register_range (config,
+    "media.network.fragment_prefetch", 2, 0, FRAG_PREFETCH_SLOTS,
+    _("Fragments to fetch ahead"),
+    _("With segmented streams (HLS, MPEG-DASH), load up to this many upcoming\n"
+      "fragments in parallel into memory while the current one is playing.\n"
+      "The actual number follows the measured download speed.\n"
+      "0 turns this off."),
+    20, NULL, NULL);
+  return v < 0 ? 0 : v > FRAG_PREFETCH_SLOTS ? FRAG_PREFETCH_SLOTS : (uint32_t)v;
+}
+
+static void frag_prefetch_init (frag_prefetch_t *pf, xine_stream_t *stream, const char *name) {
+  memset (pf, 0, sizeof (*pf));
+  pf->stream = stream;
+  pf->name = name;
+  pf->max_depth = frag_prefetch_get_depth (stream->xine->config);
+  pf->depth = 1;
+  if (pthread_mutex_init (&pf->mutex, NULL))
+    return;
+  if (pthread_cond_init (&pf->work, NULL)) {
+    pthread_mutex_destroy (&pf->mutex);
+    return;
+  }
+  if (pthread_cond_init (&pf->done, NULL)) {
+    pthread_cond_destroy (&pf->work);
+    pthread_mutex_destroy (&pf->mutex);
+    return;
+  }
+  pf->init = 1;
+}
+
+/** drop everything queued or loaded, eg after a seek. */
+static void frag_prefetch_flush_int (frag_prefetch_t *pf, uint32_t before) {
+  uint32_t i;
+  for (i = 0; i < FRAG_PREFETCH_SLOTS; i++) {
+    frag_slot_t *s = pf->slots + i;
+    if (s->state == FRAG_SLOT_FREE)
+      continue;
+    if (before && ((int32_t)(s->seq - before) >= 0))
+      continue;
+    if (s->state == FRAG_SLOT_LOADING)
+      s->cancel = 1;
+    else
+      frag_slot_clear (pf, s);
+  }
+}
+
+static void frag_prefetch_flush (frag_prefetch_t *pf) {
+  if (!pf->init)
+    return;
+  pthread_mutex_lock (&pf->mutex);
+  frag_prefetch_flush_int (pf, 0);
+  pthread_mutex_unlock (&pf->mutex);
+}
+
+static void frag_prefetch_deinit (frag_prefetch_t *pf) {
+  uint32_t i;
+  if (!pf->init)
+    return;
+  pthread_mutex_lock (&pf->mutex);
+  pf->quit = 1;
+  frag_prefetch_flush_int (pf, 0);
+  pthread_cond_broadcast (&pf->work);
+  pthread_mutex_unlock (&pf->mutex);
+  for (i = 0; i < pf->num_threads; i++)
+    pthread_join (pf->threads[i], NULL);
+  pf->num_threads = 0;
+  for (i = 0; i < FRAG_PREFETCH_SLOTS; i++)
+    frag_slot_clear (pf, pf->slots + i);
+  pthread_cond_destroy (&pf->done);
+  pthread_cond_destroy (&pf->work);
+  pthread_mutex_destroy (&pf->mutex);
+  pf->init = 0;
+}
+
+/** queue an upcoming fragment.
+ *  return: 1 (queued), 0 (already there), -1 (enough for now, or off). */
+static int frag_prefetch_add (frag_prefetch_t *pf, const char *mrl, uint32_t dur_ms) {
+  frag_slot_t *free_slot = NULL;
+  uint32_t i, pending = 0;
+  int ret = -1;
+
+  if (!pf->init || !pf->max_depth)
+    return -1;
+  pthread_mutex_lock (&pf->mutex);
+  for (i = 0; i < FRAG_PREFETCH_SLOTS; i++) {
+    frag_slot_t *s = pf->slots + i;
+    if (s->state == FRAG_SLOT_FREE) {
+      if (!free_slot)
+        free_slot = s;
+      continue;
+    }
+    if (s->cancel)
+      continue;
+    if (!strcmp (s->mrl, mrl)) {
+      ret = 0;
+      goto done;
+    }
+    pending++;
+  }
+  if ((pending >= pf->depth) || !free_slot || (pf->bytes >= FRAG_PREFETCH_MAX_BYTES))
+    goto done;
+  free_slot->mrl = strdup (mrl);
+  if (!free_slot->mrl)
+    goto done;
+  free_slot->seq = ++pf->seq;
+  free_slot->dur_ms = dur_ms;
+  free_slot->cancel = 0;
+  free_slot->state = FRAG_SLOT_QUEUED;
+  /* one thread per parallel fetch, started on demand. */
+  if ((pf->num_threads < pf->depth) && (pf->num_threads < pending + 1)) {
+    if (!pthread_create (pf->threads + pf->num_threads, NULL, frag_prefetch_thread, pf))
+      pf->num_threads++;
+  }
+  if (!pf->num_threads) {
+    frag_slot_clear (pf, free_slot);
+    goto done;
+  }
+  pthread_cond_signal (&pf->work);
+  ret = 1;
+ done:
+  pthread_mutex_unlock (&pf->mutex);
+  return ret;
+}
+
+/** get a prefetched fragment as input plugin, waiting for a running fetch.
+ *  return NULL if not there, caller then opens mrl the usual way. */
+static input_plugin_t *frag_prefetch_get (frag_prefetch_t *pf, const char *mrl) {
+  input_plugin_t *in = NULL;
+  frag_slot_t *slot = NULL;
+  uint32_t i;
+
+  if (!pf->init)
+    return NULL;
+  pthread_mutex_lock (&pf->mutex);
+  for (i = 0; i < FRAG_PREFETCH_SLOTS; i++) {
+    frag_slot_t *s = pf->slots + i;
+    if ((s->state != FRAG_SLOT_FREE) && !s->cancel && !strcmp (s->mrl, mrl)) {
+      slot = s;
+      break;
+    }
+  }
+  if (!slot) {
+    /* out of order, prefetched stuff is likely useless now. */
+    frag_prefetch_flush_int (pf, 0);
+    pthread_mutex_unlock (&pf->mutex);
+    return NULL;
+  }
+  /* we will not need the ones before. */
+  frag_prefetch_flush_int (pf, slot->seq);
+  if (slot->state == FRAG_SLOT_QUEUED) {
+    /* not started yet, do it directly. */
+    frag_slot_clear (pf, slot);
+  } else {
+    while (slot->state == FRAG_SLOT_LOADING)
+      pthread_cond_wait (&pf->done, &pf->mutex);
+    if (slot->state == FRAG_SLOT_DONE) {
+      in = frag_mem_input_new (mrl, slot->buf, slot->size);
+      if (in) {
+        pf->bytes -= slot->size;
+        slot->buf = NULL;
+        slot->size = 0;
+      }
+    }
+    if (slot->state != FRAG_SLOT_FREE)
+      frag_slot_clear (pf, slot);
+  }
+  pthread_mutex_unlock (&pf->mutex);
+  return in;
+}
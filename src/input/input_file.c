@@ -37,6 +37,7 @@
 
 #ifdef HAVE_MMAP
 #include <sys/mman.h>
+#include <pthread.h>
 #endif
 
 #define LOG_MODULE "input_file"
@@ -73,7 +74,28 @@ typedef struct {
 
 } file_input_class_t;
 
-typedef struct {
+typedef struct file_input_plugin_s file_input_plugin_t;
+
+#ifdef HAVE_MMAP
+/* read_block () hands out pool bufs pointing right into the mapping.
+ * we save the original buf owner here, and keep the mapping alive
+ * until all of them came back. */
+typedef union file_input_saved_buf_u {
+  union file_input_saved_buf_u *free_next;
+  struct {
+    file_input_plugin_t *this;
+    void                *source;
+    void               (*free_buffer) (buf_element_t *);
+  } used;
+} file_input_saved_buf_t;
+
+#define FILE_SAVED_SIZE 1024
+/* madvise () read ahead window limits. */
+#define FILE_RA_MIN (256 << 10)
+#define FILE_RA_MAX (4 << 20)
+#endif
+
+struct file_input_plugin_s {
   input_plugin_t    input_plugin;
 
   xine_stream_t    *stream;
@@ -89,11 +111,19 @@ typedef struct {
   int               mmap_on;
   uint8_t          *mmap_base;
   uint8_t          *mmap_curr;
+  uint8_t          *mmap_ra;
   off_t             mmap_len;
+  uintptr_t         page_mask;
+
+  pthread_mutex_t   buf_mutex;
+  file_input_saved_buf_t *saved_free;
+  unsigned int      saved_used;
+  int               freeing;
+  file_input_saved_buf_t saved_bufs[FILE_SAVED_SIZE];
 #endif
   char             *mrl;
 
-} file_input_plugin_t;
+};
 
 static void file_input_size (file_input_plugin_t *this, const struct stat *sbuf) {
   if ((sbuf->st_size != this->size) &&
@@ -168,6 +198,100 @@ static int file_input_check_mmap (file_input_plugin_t *this) {
 }
 #endif
 
+#ifdef HAVE_MMAP
+static void file_input_saved_init (file_input_plugin_t *this) {
+  file_input_saved_buf_t *s = this->saved_bufs;
+  unsigned int n;
+  this->saved_free = s;
+  for (n = FILE_SAVED_SIZE - 1; n; n--) {
+    s++;
+    s[-1].free_next = s;
+  }
+  s[0].free_next   = NULL;
+  this->saved_used = 0;
+}
+
+/* Get this->buf_mutex for the next 2. */
+static file_input_saved_buf_t *file_input_saved_acquire (file_input_plugin_t *this) {
+  file_input_saved_buf_t *s = this->saved_free;
+  if (s) {
+    this->saved_free = s->free_next;
+    this->saved_used++;
+    s->used.this = this;
+  }
+  return s;
+}
+
+static unsigned int file_input_saved_release (file_input_plugin_t *this, file_input_saved_buf_t *s) {
+  s->free_next = this->saved_free;
+  this->saved_free = s;
+  this->saved_used--;
+  return this->saved_used;
+}
+
+static void file_input_free (file_input_plugin_t *this) {
+  /* Check for mmap_base rather than mmap_on because the file might have
+   * started as a mmap() and now might be changed to descriptor-based
+   * access
+   */
+  if (this->mmap_base)
+    munmap (this->mmap_base, this->mmap_len);
+  pthread_mutex_destroy (&this->buf_mutex);
+  _x_freep (&this->mrl);
+  free (this);
+}
+
+static void file_input_free_buffer (buf_element_t *buf) {
+  file_input_saved_buf_t *s = buf->source;
+  file_input_plugin_t *this = s->used.this;
+  unsigned int n;
+  int freeing;
+
+  pthread_mutex_lock (&this->buf_mutex);
+  /* reconstruct the original xine buffer */
+  buf->free_buffer = s->used.free_buffer;
+  buf->source = s->used.source;
+  buf->content = buf->mem;
+  n = file_input_saved_release (this, s);
+  freeing = this->freeing;
+  pthread_mutex_unlock (&this->buf_mutex);
+  /* give this buffer back to xine's pool */
+  buf->free_buffer (buf);
+  if (freeing && !n) {
+    /* all buffers returned, we can unmap now */
+    file_input_free (this);
+  }
+}
+
+/* tell the kernel what the fifo is about to take from us. */
+static void file_input_readahead (file_input_plugin_t *this, fifo_buffer_t *fifo, off_t len) {
+#ifdef MADV_WILLNEED
+  uint8_t *end = this->mmap_base + this->mmap_len, *start, *stop;
+  off_t win = (off_t)(fifo->buffer_pool_num_free > 0 ? fifo->buffer_pool_num_free : 1) * len;
+
+  if (win < FILE_RA_MIN)
+    win = FILE_RA_MIN;
+  else if (win > FILE_RA_MAX)
+    win = FILE_RA_MAX;
+  /* seek */
+  if ((this->mmap_ra < this->mmap_curr) || (this->mmap_ra > this->mmap_curr + FILE_RA_MAX))
+    this->mmap_ra = this->mmap_curr;
+  /* still enough pending */
+  if (this->mmap_ra - this->mmap_curr >= (win >> 1))
+    return;
+  start = (uint8_t *)((uintptr_t)this->mmap_ra & ~this->page_mask);
+  stop = (end - this->mmap_curr > win) ? this->mmap_curr + win : end;
+  if (stop > start)
+    madvise (start, stop - start, MADV_WILLNEED);
+  this->mmap_ra = stop;
+#else
+  (void)this;
+  (void)fifo;
+  (void)len;
+#endif
+}
+#endif
+
 static off_t file_input_read (input_plugin_t *this_gen, void *buf, off_t len) {
   file_input_plugin_t *this = (file_input_plugin_t *) this_gen;
   uint8_t *b;
@@ -242,30 +366,41 @@ static buf_element_t *file_input_read_block (input_plugin_t *this_gen, fifo_buff
 #ifdef HAVE_MMAP
   file_input_plugin_t  *this = (file_input_plugin_t *) this_gen;
   if ( file_input_check_mmap(this) ) {
-    buf_element_t        *buf = fifo->buffer_pool_alloc (fifo);
+    buf_element_t *buf;
+    file_input_saved_buf_t *s;
     off_t len = todo;
 
-    if (todo > buf->max_size)
-      todo = buf->max_size;
-    if (todo < 0) {
-      buf->free_buffer (buf);
+    if (todo < 0)
       return NULL;
-    }
-
-    buf->type = BUF_DEMUX_BLOCK;
 
+    buf = fifo->buffer_pool_alloc (fifo);
+    if (len > buf->max_size)
+      len = buf->max_size;
     if ( (this->mmap_curr + len) > (this->mmap_base + this->mmap_len) )
       len = (this->mmap_base + this->mmap_len) - this->mmap_curr;
 
-    /* We use the still-mmapped file rather than copying it */
+    buf->type = BUF_DEMUX_BLOCK;
     buf->size = len;
-    buf->content = this->mmap_curr;
 
-    /* FIXME: it's completely illegal to free buffer->mem here
-     * - buffer->mem has not been allocated by malloc
-     * - demuxers expect buffer->mem != NULL
-     */
-    /* free(buf->mem); buf->mem = NULL; */
+    file_input_readahead (this, fifo, len);
+
+    pthread_mutex_lock (&this->buf_mutex);
+    s = file_input_saved_acquire (this);
+    if (s) {
+      /* We use the still-mmapped file rather than copying it.
+       * buf->mem stays untouched, and comes back to the pool
+       * via file_input_free_buffer (). */
+      s->used.free_buffer = buf->free_buffer;
+      s->used.source = buf->source;
+      buf->free_buffer = file_input_free_buffer;
+      buf->source = s;
+      buf->content = this->mmap_curr;
+    }
+    pthread_mutex_unlock (&this->buf_mutex);
+    if (!s) {
+      /* too many blocks in flight, copy this one. */
+      memcpy (buf->mem, this->mmap_curr, len);
+    }
 
     this->mmap_curr += len;
 
@@ -359,21 +494,27 @@ static const char* file_input_get_mrl (input_plugin_t *this_gen) {
 static void file_input_dispose (input_plugin_t *this_gen ) {
   file_input_plugin_t *this = (file_input_plugin_t *) this_gen;
 
-#ifdef HAVE_MMAP
-  /* Check for mmap_base rather than mmap_on because the file might have
-   * started as a mmap() and now might be changed to descriptor-based
-   * access
-   */
-  if ( this->mmap_base )
-    munmap(this->mmap_base, this->mmap_len);
-#endif
-
-  if (this->fh != -1)
+  if (this->fh != -1) {
     close(this->fh);
+    this->fh = -1;
+  }
 
+#ifdef HAVE_MMAP
+  pthread_mutex_lock (&this->buf_mutex);
+  if (this->saved_used) {
+    /* raise the freeing flag, so that the mapping will be released as soon
+     * as all buffers pointing into it have returned to their pool. */
+    this->freeing = 1;
+    pthread_mutex_unlock (&this->buf_mutex);
+    return;
+  }
+  pthread_mutex_unlock (&this->buf_mutex);
+  file_input_free (this);
+#else
   _x_freep (&this->mrl);
 
   free (this);
+#endif
 }
 
 static char *file_input_decode_uri (char *uri) {
@@ -439,6 +580,7 @@ static int file_input_open (input_plugin_t *this_gen ) {
   this->mmap_on = 0;
   this->mmap_base = NULL;
   this->mmap_curr = NULL;
+  this->mmap_ra = NULL;
   this->mmap_len = 0;
 #endif
 
@@ -449,13 +591,15 @@ static int file_input_open (input_plugin_t *this_gen ) {
 #ifdef HAVE_MMAP
   this->mmap_base = NULL;
   do {
-    uint8_t mmap_base;
+    uint8_t *mmap_base;
     size_t tmp_size;
     /* may cause truncation - if it does, DON'T mmap! */
     tmp_size = (size_t)sbuf.st_size;
     if ((off_t)tmp_size != sbuf.st_size)
       break;
-    mmap_base = mmap (NULL, tmp_size, PROT_READ, MAP_SHARED, this->fh, 0);
+    /* private and writable: some demuxers edit their block in place,
+     * which now just copies that page. */
+    mmap_base = mmap (NULL, tmp_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, this->fh, 0);
     if (mmap_base == (void*)-1)
       break;
     /* paranoia */
@@ -466,8 +610,12 @@ static int file_input_open (input_plugin_t *this_gen ) {
     }
     this->mmap_on = 1;
     this->mmap_base =
-    this->mmap_curr = mmap_base;
+    this->mmap_curr =
+    this->mmap_ra = mmap_base;
     this->mmap_len = sbuf.st_size;
+#ifdef MADV_SEQUENTIAL
+    madvise (mmap_base, tmp_size, MADV_SEQUENTIAL);
+#endif
   } while (0);
 #endif
 
@@ -506,6 +654,12 @@ static input_plugin_t *file_input_get_instance (input_class_t *cls_gen, xine_str
   this->fh     = -1;
   this->state  = FILE_STATIC;
   this->size   = 0;
+#ifdef HAVE_MMAP
+  this->page_mask = (uintptr_t)sysconf (_SC_PAGESIZE) - 1;
+  this->freeing = 0;
+  file_input_saved_init (this);
+  pthread_mutex_init (&this->buf_mutex, NULL);
+#endif
 
   this->input_plugin.open               = file_input_open;
   this->input_plugin.get_capabilities   = file_input_get_capabilities;
@@ -521,6 +675,9 @@ static input_plugin_t *file_input_get_instance (input_class_t *cls_gen, xine_str
   this->input_plugin.input_class        = cls_gen;
 
   if (!this->mrl) {
+#ifdef HAVE_MMAP
+    pthread_mutex_destroy (&this->buf_mutex);
+#endif
     free(this);
     return NULL;
   }
@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 
 #define LOG_MODULE "input_hls"
 #define LOG_VERBOSE
@@ -45,6 +46,7 @@
 #include "input_helper.h"
 #include "group_network.h"
 #include "multirate_pref.c"
+#include "frag_prefetch.c"
 
 typedef enum {
   HLS_A_none = 0,
@@ -70,6 +72,7 @@ typedef struct {
   input_class_t     input_class;
   xine_t           *xine;
   multirate_pref_t  pref;
+  int               adaptive;
 } hls_input_class_t;
 
 typedef struct {
@@ -85,6 +88,8 @@ typedef struct {
   uint32_t          caps1;
   int               last_err;
 
+  frag_prefetch_t   prefetch;
+
   unsigned int      side_index; /** << 0 .. 3 */
   unsigned int      num_sides;
 
@@ -138,6 +143,20 @@ typedef struct {
   char              bump1[HLS_MAX_MRL];
   char              pad2[4];
   char              bump2[HLS_MAX_MRL];
+  /** bandwidth adaptive variant switching. */
+  struct {
+    char             *mrls;      /** << merged variant list mrls */
+    uint32_t          offs[HLS_MAX_ITEMS];
+    multirate_pref_t  info[HLS_MAX_ITEMS]; /** << bitrate 0 = not a candidate */
+    uint32_t          num;
+    int               cur;       /** << playing variant */
+    int               top;       /** << the preferred one, we never go above */
+    uint32_t          bw;        /** << smoothed throughput, bits/s */
+    uint32_t          hold;      /** << fragments to wait before next switch */
+    uint32_t          keep_from; /** << reload list, keep frag.list and entries before this */
+    int               prefetched;
+    uint64_t          read_us;   /** << this fragment */
+  }                 abr;
   char              preview[32 << 10];
 } hls_input_plugin_t;
 
@@ -175,6 +194,7 @@ static off_t hls_get_size (hls_input_plugin_t *this) {
 static uint32_t hls_frag_start (hls_input_plugin_t *this) {
   int64_t s1, s2;
   this->frag.pos = this->pos;
+  this->abr.read_us = 0;
   /* known size */
   xine_mfrag_get_index_frag (this->frag.list, this->frag.current, NULL, &s1);
   /* seen size */
@@ -204,6 +224,17 @@ static void hls_frag_end (hls_input_plugin_t *this) {
   int64_t s;
   s = this->pos - this->frag.pos;
   xine_mfrag_set_index_frag (this->frag.list, this->frag.current, -1, s);
+  /* throughput sample. prefetched fragments come from memory,
+   * use the rate seen by the side thread instead. */
+  if (this->abr.num > 1) {
+    uint32_t sample = 0;
+    if (this->abr.prefetched)
+      sample = this->prefetch.rate * 8u;
+    else if ((s >= (16 << 10)) && this->abr.read_us)
+      sample = (uint64_t)s * 8000000u / this->abr.read_us;
+    if (sample)
+      this->abr.bw = this->abr.bw ? (this->abr.bw * 3u + sample) / 4u : sample;
+  }
 }
 
 static int hls_bump_find (hls_input_plugin_t *this, const char *item1, const char *seq) {
@@ -322,9 +353,19 @@ static void hls_bump_inc (hls_input_plugin_t *this) {
   this->bump_seq += 1;
 }
 
-static int hls_input_switch_mrl (hls_input_plugin_t *this) {
+/** frag: item_mrl is a media fragment that may have been prefetched.
+ *  playlist reloads pass 0, and leave the queue alone. */
+static int hls_input_switch_mrl (hls_input_plugin_t *this, int frag) {
+  input_plugin_t *in;
   xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
     LOG_MODULE ".%u: %s.\n", this->side_index, this->item_mrl);
+  in = frag ? frag_prefetch_get (&this->prefetch, this->item_mrl) : NULL;
+  this->abr.prefetched = in != NULL;
+  if (in) {
+    _x_free_input_plugin (this->stream, this->in1);
+    this->in1 = in;
+    return 1;
+  }
   if (this->in1) {
     if (this->in1->get_capabilities (this->in1) & INPUT_CAP_NEW_MRL) {
       if (this->in1->get_optional_data (this->in1, this->item_mrl,
@@ -343,10 +384,44 @@ static int hls_input_switch_mrl (hls_input_plugin_t *this) {
   return 1;
 }
 
+static void hls_prefetch_next (hls_input_plugin_t *this, uint32_t n) {
+  char mrl[HLS_MAX_MRL];
+  uint32_t last;
+
+  /* live lists only hold what is already there, so frag.num is the live edge.
+   * bump mode does not know the next name before it exists. */
+  if (this->list_type == LIST_LIVE_BUMP)
+    return;
+  if (!this->prefetch.max_depth) {
+    /* no parallel loads, but the server may queue the next request for us. */
+    if ((n < this->frag.num) && !this->frag.input_offs[n + 1] && this->in1) {
+      _x_merge_mrl (mrl, HLS_MAX_MRL, this->list_mrl, this->list_buf + this->frag.mrl_offs[n + 1]);
+      if (strcmp (mrl, this->item_mrl))
+        this->in1->get_optional_data (this->in1, mrl, INPUT_OPTIONAL_DATA_NEXT_MRL);
+    }
+    return;
+  }
+  last = n + FRAG_PREFETCH_SLOTS;
+  if (last > this->frag.num)
+    last = this->frag.num;
+  while (++n <= last) {
+    int64_t dur = 0;
+    /* byte ranges share their mrl, leave them to the direct path. */
+    if (this->frag.input_offs[n])
+      break;
+    _x_merge_mrl (mrl, HLS_MAX_MRL, this->list_mrl, this->list_buf + this->frag.mrl_offs[n]);
+    if (!strcmp (mrl, this->item_mrl))
+      break;
+    xine_mfrag_get_index_frag (this->frag.list, n, &dur, NULL);
+    if (frag_prefetch_add (&this->prefetch, mrl, dur > 0 ? dur / 1000 : 0) < 0)
+      break;
+  }
+}
+
 static int hls_input_open_bump (hls_input_plugin_t *this) {
   /* bump mode */
   _x_merge_mrl (this->item_mrl, HLS_MAX_MRL, this->list_mrl, this->bump1);
-  if (!hls_input_switch_mrl (this))
+  if (!hls_input_switch_mrl (this, 1))
     return 0;
   this->caps1 = this->in1->get_capabilities (this->in1);
   hls_frag_start (this);
@@ -365,7 +440,7 @@ static int hls_input_open_item (hls_input_plugin_t *this, uint32_t n) {
   /* get input */
   if (strcmp (this->prev_item_mrl, this->item_mrl)) {
     this->caps1 = 0;
-    if (!hls_input_switch_mrl (this))
+    if (!hls_input_switch_mrl (this, 1))
       return 0;
   } else {
     xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
@@ -397,6 +472,7 @@ static int hls_input_open_item (hls_input_plugin_t *this, uint32_t n) {
   /* update size info */
   hls_frag_start (this);
   this->bump_seq = this->list_seq + n - 1;
+  hls_prefetch_next (this, n);
   return 1;
 }
 
@@ -641,7 +717,8 @@ static int hls_input_load_list (hls_input_plugin_t *this) {
 
   this->frag.mrl_offs = NULL;
   _x_freep (&this->frag.input_offs);
-  xine_mfrag_list_close (&this->frag.list);
+  if (!this->abr.keep_from)
+    xine_mfrag_list_close (&this->frag.list);
   this->frag.num = 0;
   this->items_num = 0;
 
@@ -732,8 +809,10 @@ static int hls_input_load_list (hls_input_plugin_t *this) {
     this->frag.mrl_offs[1] = 0;
     this->frag.input_offs[0] = 0;
     this->frag.input_offs[1] = 0;
-    xine_mfrag_list_open (&this->frag.list);
-    xine_mfrag_set_index_frag (this->frag.list, 0, 1000000, 0);
+    if (!this->abr.keep_from) {
+      xine_mfrag_list_open (&this->frag.list);
+      xine_mfrag_set_index_frag (this->frag.list, 0, 1000000, 0);
+    }
     lend = this->list_buf + 4;
     while (1) {
       size_t llen;
@@ -798,7 +877,10 @@ static int hls_input_load_list (hls_input_plugin_t *this) {
         this->frag.num += 1;
         this->frag.mrl_offs[this->frag.num + 1] = 0;
         this->frag.input_offs[this->frag.num + 1] = 0;
-        xine_mfrag_set_index_frag (this->frag.list, this->frag.num, frag_duration, fragsize != ~0u ? (int64_t)fragsize : -1);
+        /* variant switch: fragments already played keep their sizes,
+         * the new variant ones are unknown yet. */
+        if (this->frag.num >= this->abr.keep_from)
+          xine_mfrag_set_index_frag (this->frag.list, this->frag.num, frag_duration, fragsize != ~0u ? (int64_t)fragsize : 0);
       }
     }
     if ((fixed_duration != 0) && (fixed_duration != ~0u)) {
@@ -903,6 +985,187 @@ static int hls_input_load_list (hls_input_plugin_t *this) {
   return 0;
 }
 
+#define HLS_ABR_LOW_MS   6000
+#define HLS_ABR_HIGH_MS 20000
+#define HLS_ABR_HOLD        3
+
+/** remember the variants of a master list for later switching. */
+static void hls_abr_save (hls_input_plugin_t *this, int sel) {
+  const char *group;
+  uint32_t n, used, size;
+
+  _x_freep (&this->abr.mrls);
+  this->abr.num = 0;
+  this->abr.cur = this->abr.top = -1;
+  if ((sel < 0) || (this->items_num < 2))
+    return;
+  group = this->items_group[sel] ? this->list_buf + this->items_group[sel] : "";
+  for (size = 0, n = 0; n < this->items_num; n++) {
+    size_t l = _x_merge_mrl (NULL, 0, this->list_mrl, this->list_buf + this->items_mrl[n]);
+    if (l >= HLS_MAX_MRL)
+      return;
+    size += l + 1;
+  }
+  this->abr.mrls = malloc (size);
+  if (!this->abr.mrls)
+    return;
+  for (used = 0, n = 0; n < this->items_num; n++) {
+    const char *g = this->items_group[n] ? this->list_buf + this->items_group[n] : "";
+    this->abr.offs[n] = used;
+    used += _x_merge_mrl (this->abr.mrls + used, size - used, this->list_mrl, this->list_buf + this->items_mrl[n]) + 1;
+    this->abr.info[n] = this->items[n];
+    /* same kind and audio group only. */
+    if (!this->items[n].bitrate || strcmp (g, group)
+      || ((this->items[n].video_width == 0) != (this->items[sel].video_width == 0)))
+      this->abr.info[n].bitrate = 0;
+  }
+  this->abr.num = this->items_num;
+  this->abr.cur = this->abr.top = sel;
+  this->abr.bw = 0;
+  this->abr.hold = HLS_ABR_HOLD;
+}
+
+static void hls_abr_report (hls_input_plugin_t *this, int fill) {
+  const multirate_pref_t *info;
+  if (this->abr.cur < 0)
+    return;
+  info = this->abr.info + this->abr.cur;
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_VARIANT_NUMBER, this->abr.cur);
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_VARIANT_COUNT, this->abr.num);
+  _x_stream_info_set (this->stream, XINE_STREAM_INFO_VARIANT_BITRATE, info->bitrate);
+  if (fill != -2) {
+    xine_event_t event;
+    xine_variant_data_t data;
+    data.index      = this->abr.cur;
+    data.count      = this->abr.num;
+    data.bitrate    = info->bitrate;
+    data.width      = info->video_width;
+    data.height     = info->video_height;
+    data.throughput = this->abr.bw;
+    data.buffered   = fill;
+    event.type        = XINE_EVENT_VARIANT_CHANGE;
+    event.data        = &data;
+    event.data_length = sizeof (data);
+    xine_event_send (this->stream, &event);
+  }
+}
+
+/** buffer level driven choice: more safety margin while the fifos run low,
+ *  step up only with a comfortable buffer, never above the preferred one. */
+static int hls_abr_pick (hls_input_plugin_t *this, int *fill) {
+  const multirate_pref_t *info = this->abr.info;
+  uint32_t safe, top = info[this->abr.top].bitrate, cur = info[this->abr.cur].bitrate;
+  int n, best = -1, lowest = -1, up = -1;
+
+  *fill = xine_nbc_get_fill_ms (this->nbc);
+  if (!this->abr.bw)
+    return this->abr.cur;
+  if (this->abr.hold) {
+    this->abr.hold--;
+    return this->abr.cur;
+  }
+  safe = *fill < 0 ? (uint64_t)this->abr.bw * 3u / 4u
+       : *fill < HLS_ABR_LOW_MS ? this->abr.bw / 2u
+       : *fill > HLS_ABR_HIGH_MS ? (uint64_t)this->abr.bw * 9u / 10u
+       : (uint64_t)this->abr.bw * 3u / 4u;
+  for (n = 0; n < (int)this->abr.num; n++) {
+    uint32_t b = info[n].bitrate;
+    if (!b || (b > top))
+      continue;
+    if ((lowest < 0) || (b < info[lowest].bitrate))
+      lowest = n;
+    if ((b <= safe) && ((best < 0) || (b > info[best].bitrate)))
+      best = n;
+    if ((b > cur) && ((up < 0) || (b < info[up].bitrate)))
+      up = n;
+  }
+  if (best < 0)
+    best = lowest;
+  if ((best < 0) || (best == this->abr.cur))
+    return this->abr.cur;
+  if (info[best].bitrate > cur) {
+    if ((*fill >= 0) && (*fill < 2 * HLS_ABR_LOW_MS))
+      return this->abr.cur;
+    return up;
+  }
+  if (*fill > HLS_ABR_HIGH_MS)
+    return this->abr.cur;
+  return best;
+}
+
+/** called at a fragment boundary, before opening fragment #n.
+ *  returns the fragment index to open next, 0 on error. */
+static uint32_t hls_abr_check (hls_input_plugin_t *this, uint32_t n) {
+  char old_mrl[HLS_MAX_MRL];
+  uint32_t seq, old_num;
+  int next, fill;
+
+  if ((this->abr.num < 2) || (this->abr.cur < 0))
+    return n;
+  if ((this->list_type == LIST_LIVE_BUMP) || this->list_rangeinit.len || this->frag.mrl_offs[0])
+    return n;
+  next = hls_abr_pick (this, &fill);
+  if (next == this->abr.cur)
+    return n;
+
+  xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ".%u: throughput %u bits/s, buffer %d ms, switching from item #%d (%u) to #%d (%u).\n",
+    this->side_index, (unsigned int)this->abr.bw, fill,
+    this->abr.cur, (unsigned int)this->abr.info[this->abr.cur].bitrate,
+    next, (unsigned int)this->abr.info[next].bitrate);
+  this->abr.hold = HLS_ABR_HOLD;
+  /* fragments of the old variant are no use now. */
+  frag_prefetch_flush (&this->prefetch);
+
+  if (this->list_type == LIST_LIVE_REGET) {
+    /* the reget will fetch the new list, and align on media sequence there. */
+    strcpy (this->list_mrl, this->abr.mrls + this->abr.offs[next]);
+    this->abr.cur = next;
+    hls_abr_report (this, fill);
+    return n;
+  }
+
+  /* VOD: reload in place, the demuxer holds our frag.list. */
+  seq = this->list_seq + n - 1;
+  old_num = this->frag.num;
+  strcpy (old_mrl, this->list_mrl);
+  strcpy (this->item_mrl, this->abr.mrls + this->abr.offs[next]);
+  this->abr.keep_from = n;
+  if (hls_input_switch_mrl (this, 0) && (hls_input_load_list (this) == 1) && (this->frag.num == old_num)) {
+    this->abr.keep_from = 0;
+    strcpy (this->list_mrl, this->item_mrl);
+    this->abr.cur = next;
+    hls_abr_report (this, fill);
+    /* same media sequence number in the new list. */
+    seq = seq - this->list_seq + 1;
+    if ((seq >= 1) && (seq <= this->frag.num))
+      n = seq;
+    return n;
+  }
+  xprintf (this->stream->xine, XINE_VERBOSITY_LOG,
+    LOG_MODULE ".%u: variant switch failed, staying with %s.\n", this->side_index, old_mrl);
+  this->abr.info[next].bitrate = 0;
+  strcpy (this->item_mrl, old_mrl);
+  if (!hls_input_switch_mrl (this, 0) || (hls_input_load_list (this) != 1)) {
+    this->abr.keep_from = 0;
+    return 0;
+  }
+  this->abr.keep_from = 0;
+  return n;
+}
+
+static off_t hls_in1_read (hls_input_plugin_t *this, uint8_t *buf, off_t len) {
+  struct timeval t1, t2;
+  off_t r;
+  if ((this->abr.num < 2) || this->abr.prefetched)
+    return this->in1->read (this->in1, buf, len);
+  xine_monotonic_clock (&t1, NULL);
+  r = this->in1->read (this->in1, buf, len);
+  xine_monotonic_clock (&t2, NULL);
+  this->abr.read_us += (int64_t)(t2.tv_sec - t1.tv_sec) * 1000000 + (t2.tv_usec - t1.tv_usec);
+  return r;
+}
+
 static uint32_t hls_input_get_capabilities (input_plugin_t *this_gen) {
   hls_input_plugin_t *this = (hls_input_plugin_t *)this_gen;
   uint32_t flags;
@@ -1014,7 +1277,7 @@ static off_t hls_input_read (input_plugin_t *this_gen, void *buf, off_t len) {
       }
       left -= fragleft;
       while (fragleft > 0) {
-        r = this->in1->read (this->in1, (void *)b, fragleft);
+        r = hls_in1_read (this, b, fragleft);
         if (r <= 0)
           break;
         this->pos += r;
@@ -1043,7 +1306,8 @@ static off_t hls_input_read (input_plugin_t *this_gen, void *buf, off_t len) {
           break;
         reget = 1;
       } else {
-        if (!hls_input_open_item (this, n))
+        n = hls_abr_check (this, n);
+        if (!n || !hls_input_open_item (this, n))
           break;
       }
     } else {
@@ -1060,8 +1324,9 @@ static off_t hls_input_read (input_plugin_t *this_gen, void *buf, off_t len) {
     }
     if (reget) {
       int32_t n;
+      hls_abr_check (this, this->frag.current + 1);
       strcpy (this->item_mrl, this->list_mrl);
-      if (!hls_input_switch_mrl (this))
+      if (!hls_input_switch_mrl (this, 0))
         break;
       if (hls_input_load_list (this) != 1)
         break;
@@ -1151,6 +1416,9 @@ static off_t hls_input_time_seek (input_plugin_t *this_gen, int time_offs, int o
     if ((idx == 1) && (this->frag.current == 1) && (this->pos <= (off_t)this->prev_size2) && (p <= (int64_t)this->prev_size2)) {
       this->pos = p;
     } else {
+      /* a real jump, drop what was loaded for the old position. */
+      if (((uint32_t)idx != this->frag.current) && ((uint32_t)idx != this->frag.current + 1))
+        frag_prefetch_flush (&this->prefetch);
       this->frag.current = idx;
       this->pos = p;
       this->prev_size2 = 0;
@@ -1219,6 +1487,8 @@ static off_t hls_input_seek (input_plugin_t *this_gen, off_t offset, int origin)
      * and the fragment itself may turn out to be smaller than expected.
      * however, demux expects a seek to land at the exact byte offs.
      * lets try to meet that, even if it is still wrong. */
+    if (((uint32_t)idx != this->frag.current) && ((uint32_t)idx != this->frag.current + 1))
+      frag_prefetch_flush (&this->prefetch);
     xine_mfrag_get_index_start (this->frag.list, idx, NULL, &p1);
     this->pos = p1;
     if (!hls_input_open_item (this, idx))
@@ -1275,6 +1545,7 @@ static void hls_input_dispose (input_plugin_t *this_gen) {
   hls_input_plugin_t *this = (hls_input_plugin_t *)this_gen;
   if (!this)
     return;
+  frag_prefetch_deinit (&this->prefetch);
   if (this->in1) {
     _x_free_input_plugin (this->stream, this->in1);
     this->in1 = NULL;
@@ -1287,6 +1558,7 @@ static void hls_input_dispose (input_plugin_t *this_gen) {
   _x_freep (&this->list_buf);
   this->frag.mrl_offs = NULL;
   _x_freep (&this->frag.input_offs);
+  _x_freep (&this->abr.mrls);
   free (this);
 }
 
@@ -1317,10 +1589,11 @@ static int hls_input_open (input_plugin_t *this_gen) {
     }
     xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
       LOG_MODULE ".%u: auto selected item #%d.\n", this->side_index, n);
+    hls_abr_save (this, cls->adaptive ? n : -1);
     _x_merge_mrl (this->item_mrl, HLS_MAX_MRL, this->list_mrl, this->list_buf + this->items_mrl[n]);
     xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
       LOG_MODULE ".%u: trying %s.\n", this->side_index, this->item_mrl);
-    if (!hls_input_switch_mrl (this))
+    if (!hls_input_switch_mrl (this, 0))
       return 0;
     strcpy (this->list_mrl, this->item_mrl);
   }
@@ -1354,6 +1627,7 @@ static int hls_input_open (input_plugin_t *this_gen) {
   xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
     LOG_MODULE ".%u: %s mode @ seq %s.\n",
     this->side_index, type_names[this->list_type], this->list_strseq);
+  hls_abr_report (this, -2);
 
   do {
     if (this->list_rangeinit.len) {
@@ -1509,16 +1783,23 @@ static input_plugin_t *hls_input_get_instance (input_class_t *cls_gen, xine_stre
   this->next_stop.tv_nsec = 0;
   this->rewind       = 0;
   this->prev_item_mrl[0] = 0;
+  this->abr.mrls     = NULL;
+  this->abr.num      = 0;
+  this->abr.bw       = 0;
+  this->abr.keep_from = 0;
+  this->abr.prefetched = 0;
 #endif
 
   this->stream = stream;
   this->in1    = in1;
   this->num_sides = 1;
   this->frag.current = HLS_NO_FRAGMENT;
+  this->abr.cur = this->abr.top = -1;
 
   /* TJ. yes input_http already does this, but i want to test offline
    * with a file based service. */
   this->nbc    = xine_nbc_init (this->stream);
+  frag_prefetch_init (&this->prefetch, this->stream, LOG_MODULE);
 
   xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ".%u: %s.\n", this->side_index, mrl + n);
 
@@ -1546,6 +1827,11 @@ static input_plugin_t *hls_input_get_instance (input_class_t *cls_gen, xine_stre
  * plugin class functions
  */
 
+static void hls_cb_adaptive (void *data, xine_cfg_entry_t *entry) {
+  hls_input_class_t *this = (hls_input_class_t *)data;
+  this->adaptive = entry->num_value;
+}
+
 static void hls_input_class_dispose (input_class_t *this_gen) {
   hls_input_class_t *this = (hls_input_class_t *)this_gen;
   config_values_t   *config = this->xine->config;
@@ -1566,6 +1852,13 @@ void *input_hls_init_class (xine_t *xine, const void *data) {
 
   this->xine = xine;
   multirate_pref_get (xine->config, &this->pref);
+  this->adaptive = xine->config->register_bool (xine->config,
+    "media.multirate.adaptive", 1,
+    _("Adapt to network speed"),
+    _("With HLS streams that offer multiple versions, switch to a lower bitrate\n"
+      "one while the network cannot keep up, and back when it recovers.\n"
+      "The preferred version above is the upper limit."),
+    10, hls_cb_adaptive, this);
 
   this->input_class.get_instance       = hls_input_get_instance;
   this->input_class.identifier         = "hls";
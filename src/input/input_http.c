@@ -35,6 +35,8 @@
 #endif
 #include <ctype.h>
 #include <errno.h>
+#include <time.h>
+#include <pthread.h>
 #include <zlib.h>
 
 #ifdef WIN32
@@ -61,6 +63,10 @@
 #define DEFAULT_HTTP_PORT         80
 #define DEFAULT_HTTPS_PORT       443
 
+#define HTTP_POOL_SIZE             8 /* idle persistent connections */
+#define HTTP_POOL_IDLE            15 /* max seconds to keep them */
+#define HTTP_KEY_SIZE            576
+
 static inline void uint64_2str (char **s, uint64_t v) {
   uint8_t b[44], *t = b + 21, *q = (uint8_t *)*s;
   uint32_t u;
@@ -177,13 +183,16 @@ typedef struct {
 #define MODE_AGAIN      0x0010 /* follow a redirection */
 #define MODE_INFLATING  0x0020 /* zlib inflater is up */
 #define MODE_DONE       0x0040 /* end of content reached */
+#define MODE_KEEP_ALIVE 0x0080 /* server will keep the connection open */
 #define MODE_HAVE_CHUNK 0x0100 /* there are content portions left */
 #define MODE_HAVE_SBUF  0x0200 /* there are content bytes in sbuf */
 #define MODE_HAVE_READ  0x0400 /* socket still has data to read */
+#define MODE_REUSED     0x0800 /* connection served a request before */
 #define MODE_SEEKABLE   0x1000 /* server supports byte ranges */
 #define MODE_NSV        0x2000 /* we have a nullsoft stream */
 #define MODE_LASTFM     0x4000 /* we have a last.fm stream */
 #define MODE_SHOUTCAST  0x8000 /* content has info inserts */
+#define MODE_PIPED     0x10000 /* request was sent with the previous one */
   uint32_t         mode;
   uint32_t         status;
 
@@ -199,6 +208,11 @@ typedef struct {
 
   char             mime_type[128];
 
+  /* persistent connections */
+  char            *pipe_mrl;
+  uint32_t         keep_secs;
+  char             conn_key[HTTP_KEY_SIZE];
+
   uint8_t          zbuf[32 << 10];
   uint8_t          zbuf_pad[4];
   uint8_t          sbuf[32 << 10];
@@ -213,6 +227,13 @@ typedef struct {
   char             mrl[4096];
 } http_input_plugin_t;
 
+typedef struct {
+  xine_tls_t       *tls;
+  int               fh;
+  time_t            expires;
+  char              key[HTTP_KEY_SIZE];
+} http_conn_t;
+
 typedef struct {
 
   input_class_t     input_class;
@@ -229,6 +250,13 @@ typedef struct {
   const char       *noproxylist;
 
   const char       *head_dump_name;
+
+  int               keep_alive;
+  int               pipelining;
+
+  /* idle persistent connections, shared by all instances. */
+  pthread_mutex_t   pool_lock;
+  http_conn_t       pool[HTTP_POOL_SIZE];
 } http_input_class_t;
 
 static void sbuf_init (http_input_plugin_t *this) {
@@ -710,6 +738,117 @@ static void head_dump_name_change_cb (void *this_gen, xine_cfg_entry_t *cfg) {
   this->head_dump_name = cfg->str_value;
 }
 
+static void keep_alive_change_cb (void *this_gen, xine_cfg_entry_t *cfg) {
+  http_input_class_t *this = (http_input_class_t *)this_gen;
+
+  this->keep_alive = cfg->num_value;
+}
+
+static void pipelining_change_cb (void *this_gen, xine_cfg_entry_t *cfg) {
+  http_input_class_t *this = (http_input_class_t *)this_gen;
+
+  this->pipelining = cfg->num_value;
+}
+
+/*
+ * persistent connection pool
+ */
+
+static void http_conn_drop (http_conn_t *conn) {
+  _x_tls_deinit (&conn->tls);
+  if (conn->fh >= 0) {
+    _x_io_tcp_close (NULL, conn->fh);
+    conn->fh = -1;
+  }
+  conn->key[0] = 0;
+}
+
+static int http_pool_get (http_input_class_t *cls, http_input_plugin_t *this) {
+  http_conn_t old[HTTP_POOL_SIZE];
+  time_t now = time (NULL);
+  int i, n = 0, found = 0;
+
+  pthread_mutex_lock (&cls->pool_lock);
+  for (i = 0; i < HTTP_POOL_SIZE; i++) {
+    http_conn_t *conn = cls->pool + i;
+    if (conn->fh < 0)
+      continue;
+    if (conn->expires <= now) {
+      old[n++] = *conn;
+      conn->tls = NULL;
+      conn->fh = -1;
+      conn->key[0] = 0;
+    } else if (!found && !strcmp (conn->key, this->conn_key)) {
+      this->fh = conn->fh;
+      this->tls = conn->tls;
+      conn->tls = NULL;
+      conn->fh = -1;
+      conn->key[0] = 0;
+      found = 1;
+    }
+  }
+  pthread_mutex_unlock (&cls->pool_lock);
+
+  /* TLS shutdown may take a while, dont do it under lock. */
+  while (n > 0)
+    http_conn_drop (old + --n);
+  if (!found)
+    return 0;
+  _x_tls_set_stream (this->tls, this->stream);
+  this->mode |= MODE_REUSED;
+  xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": reusing connection to %s.\n", this->conn_key);
+  return 1;
+}
+
+static void http_pool_put (http_input_class_t *cls, http_input_plugin_t *this) {
+  http_conn_t old;
+  time_t now = time (NULL);
+  int i, best = 0;
+
+  old.tls = NULL;
+  old.fh = -1;
+  _x_tls_set_stream (this->tls, NULL);
+
+  pthread_mutex_lock (&cls->pool_lock);
+  /* prefer a free slot, or else the one that expires first. */
+  for (i = 0; i < HTTP_POOL_SIZE; i++) {
+    http_conn_t *conn = cls->pool + i;
+    if ((conn->fh < 0) || (conn->expires <= now)) {
+      best = i;
+      break;
+    }
+    if (conn->expires < cls->pool[best].expires)
+      best = i;
+  }
+  old = cls->pool[best];
+  cls->pool[best].tls = this->tls;
+  cls->pool[best].fh = this->fh;
+  cls->pool[best].expires = now + this->keep_secs;
+  strcpy (cls->pool[best].key, this->conn_key);
+  pthread_mutex_unlock (&cls->pool_lock);
+
+  this->tls = NULL;
+  this->fh = -1;
+  http_conn_drop (&old);
+}
+
+static void http_pool_flush (http_input_class_t *cls) {
+  int i;
+
+  for (i = 0; i < HTTP_POOL_SIZE; i++)
+    http_conn_drop (cls->pool + i);
+}
+
+/* the connection is ready to take another request. */
+static int http_can_keep (http_input_plugin_t *this) {
+  if ((this->fh < 0) || !(this->mode & MODE_KEEP_ALIVE) || ((this->status / 100) != 2) || !this->keep_secs)
+    return 0;
+  if ((this->mode & (MODE_HAS_LENGTH | MODE_CHUNKED | MODE_DEFLATED | MODE_NSV | MODE_SHOUTCAST)) != MODE_HAS_LENGTH)
+    return 0;
+  return (this->bytes_left == 0) && (this->sgot == this->sdelivered);
+}
+
 /*
  * handle no-proxy list config option and returns, if use the proxy or not
  * if error occurred, is expected using the proxy
@@ -1001,11 +1140,17 @@ static off_t http_plugin_get_current_pos (input_plugin_t *this_gen){
 
 static void http_close(http_input_plugin_t * this)
 {
+  http_input_class_t *cls = (http_input_class_t *)this->input_plugin.input_class;
+
+  if (cls->keep_alive && !this->pipe_mrl && !(this->mode & MODE_PIPED) && http_can_keep (this))
+    http_pool_put (cls, this);
   _x_tls_deinit (&this->tls);
   if (this->fh >= 0) {
     _x_io_tcp_close (this->stream, this->fh);
     this->fh = -1;
   }
+  _x_freep (&this->pipe_mrl);
+  this->mode &= ~(MODE_KEEP_ALIVE | MODE_REUSED | MODE_PIPED);
   _x_url_cleanup (&this->proxyurl);
   _x_url_cleanup (&this->url);
 }
@@ -1046,10 +1191,11 @@ static int http_restart(http_input_plugin_t * this, off_t abs_offset)
     return 0;
   } while (0);
 
-  /* restore old stream */
+  /* restore old stream. it may carry a pipelined answer we no longer know of. */
   _x_tls_deinit (&this->tls);
   if (this->fh >= 0)
     _x_io_tcp_close (this->stream, this->fh);
+  this->mode &= ~MODE_KEEP_ALIVE;
   this->tls = old_tls;
   this->curpos = old_pos;
   this->fh = old_fh;
@@ -1138,6 +1284,8 @@ typedef enum {
   _K_icy_genre,
   _K_icy_notice2,
   _K_icy_metaint,
+  _K_connection,
+  _K_keep_alive,
   _K_LAST
 } _k_t;
 
@@ -1157,6 +1305,12 @@ static _k_t http_key_num (const char *key, uint32_t klen) {
       if (!memcmp (key, "icy-genre", 9))
         return _K_icy_genre;
       break;
+    case 10:
+      if (!memcmp (key, "connection", 10))
+        return _K_connection;
+      if (!memcmp (key, "keep-alive", 10))
+        return _K_keep_alive;
+      break;
     case 11:
       if (!memcmp (key, "icy-metaint", 11))
         return _K_icy_metaint;
@@ -1192,7 +1346,78 @@ static _k_t http_key_num (const char *key, uint32_t klen) {
   return _K_NONE;
 }
 
-static xio_handshake_status_t http_plugin_handshake (void *userdata, int fh) {
+static size_t http_build_request (http_input_plugin_t *this, const xine_url_t *url, off_t pos,
+  const char *user_agent, uint8_t *buf, size_t size) {
+/* total size of string literals: tfi input_http.c -x 0 "ADDLIT%q(%22%r%22)" "%r" -k -L (or just count yourself ;-) */
+#define SIZEOF_LITERALS 229
+/* max size needed for numbers */
+#define SIZEOF_NUMS (1 * 24)
+#define ADDLIT(s) { static const char ls[] = s; memcpy (q, s, sizeof (ls)); q += sizeof (ls) - 1; }
+#define ADDSTR(s) q += strlcpy (q, s, e - q); if (q > e) q = e
+  http_input_class_t *this_class = (http_input_class_t *) this->input_plugin.input_class;
+  char *q = (char *)buf, *e = q + size - SIZEOF_LITERALS - SIZEOF_NUMS - 1;
+  char strport[16];
+  int vers = this_class->prot_version;
+
+  if (url->port != DEFAULT_HTTP_PORT) {
+    char *t = strport;
+    *t++ = ':';
+    uint32_2str (&t, url->port);
+  } else {
+    strport[0] = 0;
+  }
+
+  ADDLIT ("GET ");
+  if (this->use_proxy) {
+    ADDSTR (url->proto);
+    ADDLIT ("://");
+    ADDSTR (url->host);
+    ADDSTR (strport);
+  }
+  ADDSTR (url->uri);
+  if (vers == 1) {
+    ADDLIT (" HTTP/1.1\r\nHost: ");
+  } else {
+    ADDLIT (" HTTP/1.0\r\nHost: ");
+  }
+  ADDSTR (url->host);
+  ADDSTR (strport);
+  if (pos > 0) {
+    /* restart from offset */
+    ADDLIT ("\r\nRange: bytes=");
+    uint64_2str (&q, pos);
+    ADDLIT ("-");
+/*  uint64_2str (&q, this->contentlength - 1); */
+    xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+      "input_http: requesting restart from offset %" PRId64 "\n", (int64_t)pos);
+  } else if (vers == 1) {
+    ADDLIT ("\r\nAccept-Encoding: gzip,deflate");
+  }
+  if ((vers != 1) && this_class->keep_alive) {
+    ADDLIT ("\r\nConnection: keep-alive");
+  }
+  if (this->use_proxy && this_class->proxyuser && this_class->proxyuser[0]) {
+    ADDLIT ("\r\nProxy-Authorization: Basic ");
+    q += http_plugin_basicauth (this_class->proxyuser, this_class->proxypassword, q, e - q);
+  }
+  if (url->user && url->user[0]) {
+    ADDLIT ("\r\nAuthorization: Basic ");
+    q += http_plugin_basicauth (url->user, url->password, q, e - q);
+  }
+  ADDLIT ("\r\nUser-Agent: ");
+  if (user_agent) {
+    ADDSTR (user_agent);
+    ADDLIT (" ");
+  }
+  ADDLIT ("xine/" VERSION "\r\nAccept: */*\r\nIcy-MetaData: 1\r\n\r\n");
+  return (uint8_t *)q - buf;
+#undef ADDSTR
+#undef ADDLIT
+#undef SIZEOF_LITERALS
+#undef SIZEOF_NUMS
+}
+
+static xio_handshake_status_t http_plugin_request (http_input_plugin_t *this) {
   static const uint8_t tab_tolower[256] = {
       0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
      16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31,
@@ -1212,10 +1437,9 @@ static xio_handshake_status_t http_plugin_handshake (void *userdata, int fh) {
     240,241,242,243,244,245,246,247,248,249,250,251,252,253,254,255
   };
 
-  http_input_plugin_t *this = (http_input_plugin_t *)userdata;
   http_input_class_t  *this_class = (http_input_class_t *) this->input_plugin.input_class;
-  int                  res;
   int                  mpegurl_redirect = 0;
+  int                  piped = this->mode & MODE_PIPED;
   char                 mime_type[128];
 
   {
@@ -1224,121 +1448,26 @@ static xio_handshake_status_t http_plugin_handshake (void *userdata, int fh) {
     mime_type[0] = 0;
     sbuf_reset (this);
 
-    {
-      uint32_t timeout, progress;
-      timeout = _x_query_network_timeout (this->xine) * 1000;
-      if (timeout == 0)
-        timeout = 30000;
-      progress = 0;
-      do {
-        if (this->num_msgs) {
-          if (this->num_msgs > 0)
-            this->num_msgs--;
-          report_progress (this->stream, progress);
-        }
-        res = _x_io_select (this->stream, fh, XIO_WRITE_READY, 500);
-        progress += (500 * 100000) / timeout;
-      } while ((res == XIO_TIMEOUT) && (progress <= 100000) && !_x_action_pending (this->stream));
-      if (res != XIO_READY) {
-        _x_message (this->stream, XINE_MSG_NETWORK_UNREACHABLE, this->mrl, NULL);
-        this->ret = -3;
-        return XIO_HANDSHAKE_TRY_NEXT;
-      }
-    }
-
-    /* TLS */
-    _x_assert (this->tls == NULL);
-    this->tls = _x_tls_init (this->xine, this->stream, fh);
-    if (!this->tls) {
-      this->ret = -2;
-      return XIO_HANDSHAKE_INTR;
-    }
-    if (this->use_tls) {
-      int r = _x_tls_handshake (this->tls, this->url.host, -1);
-      if (r < 0) {
-        _x_message (this->stream, XINE_MSG_CONNECTION_REFUSED, "TLS handshake failed", NULL);
-        xprintf (this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake failed\n");
-        this->ret = -4;
-        _x_tls_deinit (&this->tls);
-        return XIO_HANDSHAKE_TRY_NEXT;
-      }
-      xprintf (this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake succeed, connection is encrypted\n");
-    }
-
     /* Request */
-    {
-/* total size of string literals: tfi input_http.c -x 0 "ADDLIT%q(%22%r%22)" "%r" -k -L (or just count yourself ;-) */
-#define SIZEOF_LITERALS 205
-/* max size needed for numbers */
-#define SIZEOF_NUMS (1 * 24)
-#define ADDLIT(s) { static const char ls[] = s; memcpy (q, s, sizeof (ls)); q += sizeof (ls) - 1; }
-#define ADDSTR(s) q += strlcpy (q, s, e - q); if (q > e) q = e
-      char *q = (char *)this->sbuf, *e = q + sizeof (this->sbuf) - SIZEOF_LITERALS - SIZEOF_NUMS - 1;
-      char strport[16];
-      int vers = this_class->prot_version;
-
-      if (this->url.port != DEFAULT_HTTP_PORT) {
-        char *t = strport;
-        *t++ = ':';
-        uint32_2str (&t, this->url.port);
-      } else {
-        strport[0] = 0;
-      }
-
-      ADDLIT ("GET ");
-      if (this->use_proxy) {
-        ADDSTR (this->url.proto);
-        ADDLIT ("://");
-        ADDSTR (this->url.host);
-        ADDSTR (strport);
-      }
-      ADDSTR (this->url.uri);
-      if (vers == 1) {
-        ADDLIT (" HTTP/1.1\r\nHost: ");
-      } else {
-        ADDLIT (" HTTP/1.0\r\nHost: ");
-      }
-      ADDSTR (this->url.host);
-      ADDSTR (strport);
-      if (this->curpos > 0) {
-        /* restart from offset */
-        ADDLIT ("\r\nRange: bytes=");
-        uint64_2str (&q, this->curpos);
-        ADDLIT ("-");
-/*      uint64_2str (&q, this->contentlength - 1); */
-        xprintf (this->xine, XINE_VERBOSITY_DEBUG,
-          "input_http: requesting restart from offset %" PRId64 "\n", (int64_t)this->curpos);
-      } else if (vers == 1) {
-        ADDLIT ("\r\nAccept-Encoding: gzip,deflate");
-      }
-      if (this->use_proxy && this_class->proxyuser && this_class->proxyuser[0]) {
-        ADDLIT ("\r\nProxy-Authorization: Basic ");
-        q += http_plugin_basicauth (this_class->proxyuser, this_class->proxypassword, q, e - q);
-      }
-      if (this->url.user && this->url.user[0]) {
-        ADDLIT ("\r\nAuthorization: Basic ");
-        q += http_plugin_basicauth (this->url.user, this->url.password, q, e - q);
-      }
-      ADDLIT ("\r\nUser-Agent: ");
-      if (this->user_agent) {
-        ADDSTR (this->user_agent);
-        ADDLIT (" ");
-      }
-      ADDLIT ("xine/" VERSION "\r\nAccept: */*\r\nIcy-MetaData: 1\r\n\r\n");
+    this->mode &= ~MODE_PIPED;
+    if (piped) {
+      /* already sent along with the previous one. */
+      this->mode |= MODE_REUSED;
+    } else {
+      size_t len = http_build_request (this, &this->url, this->curpos, this->user_agent,
+        this->sbuf, sizeof (this->sbuf));
       if (this->head_dump_file)
-        fwrite (this->sbuf, 1, (uint8_t *)q - this->sbuf, this->head_dump_file);
-      if (_x_tls_write (this->tls, this->sbuf, (uint8_t *)q - this->sbuf) != (uint8_t *)q - this->sbuf) {
-        _x_message (this->stream, XINE_MSG_CONNECTION_REFUSED, "couldn't send request", NULL);
+        fwrite (this->sbuf, 1, len, this->head_dump_file);
+      if (_x_tls_write (this->tls, this->sbuf, len) != (ssize_t)len) {
+        /* a reused connection may just have timed out, and we will retry silently. */
+        if (!(this->mode & MODE_REUSED))
+          _x_message (this->stream, XINE_MSG_CONNECTION_REFUSED, "couldn't send request", NULL);
         xprintf (this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": couldn't send request\n");
         this->ret = -4;
         _x_tls_deinit (&this->tls);
         return XIO_HANDSHAKE_TRY_NEXT;
       }
       lprintf ("request sent: >%s<\n", this->sbuf);
-#undef ADDSTR
-#undef ADDLIT
-#undef SIZEOF_LITERALS
-#undef SIZEOF_NUMS
     }
 
     this->mode &= ~(MODE_DONE | MODE_NSV | MODE_LASTFM | MODE_SHOUTCAST | MODE_AGAIN);
@@ -1373,11 +1502,19 @@ static xio_handshake_status_t http_plugin_handshake (void *userdata, int fh) {
             break;
           while (*p2 == ' ') p2++;
           strlcpy (httpstatus, (char *)p2, sizeof (httpstatus));
+          /* HTTP/1.1 keeps the connection by default, if we asked that way. */
+          this->keep_secs = HTTP_POOL_IDLE;
+          if ((this_class->prot_version == 1) && !memcmp (line, "HTTP/1.1", 8))
+            this->mode |= MODE_KEEP_ALIVE;
+          else
+            this->mode &= ~MODE_KEEP_ALIVE;
           ok = 1;
         } while (0);
         if (!ok) {
-          _x_message (this->stream, XINE_MSG_CONNECTION_REFUSED, "invalid http answer", NULL);
-          xine_log (this->xine, XINE_LOG_MSG, _("input_http: invalid http answer\n"));
+          if (!(this->mode & MODE_REUSED)) {
+            _x_message (this->stream, XINE_MSG_CONNECTION_REFUSED, "invalid http answer", NULL);
+            xine_log (this->xine, XINE_LOG_MSG, _("input_http: invalid http answer\n"));
+          }
           this->ret = -6;
           _x_tls_deinit (&this->tls);
           return XIO_HANDSHAKE_TRY_NEXT;
@@ -1511,6 +1648,26 @@ static xio_handshake_status_t http_plugin_handshake (void *userdata, int fh) {
             if (this->shoutcast_interval)
               this->mode |= MODE_SHOUTCAST;
             break;
+          case _K_connection:
+            if (!strncasecmp ((char *)p2, "close", 5))
+              this->mode &= ~MODE_KEEP_ALIVE;
+            else if (!strncasecmp ((char *)p2, "keep-alive", 10))
+              this->mode |= MODE_KEEP_ALIVE;
+            break;
+          case _K_keep_alive:
+            /* "timeout=5, max=100" */
+            {
+              char *t = strstr ((char *)p2, "timeout=");
+              if (t) {
+                uint8_t *v = (uint8_t *)t + 8;
+                uint32_t secs = str2uint32 (&v);
+                /* leave some margin for the way back. */
+                secs = secs > 1 ? secs - 1 : 0;
+                if (secs < this->keep_secs)
+                  this->keep_secs = secs;
+              }
+            }
+            break;
           default: ;
         }
       }
@@ -1623,6 +1780,54 @@ static xio_handshake_status_t http_plugin_handshake (void *userdata, int fh) {
   return XIO_HANDSHAKE_OK;
 }
 
+static xio_handshake_status_t http_plugin_handshake (void *userdata, int fh) {
+  http_input_plugin_t *this = (http_input_plugin_t *)userdata;
+  int                  res;
+
+  {
+    uint32_t timeout, progress;
+    timeout = _x_query_network_timeout (this->xine) * 1000;
+    if (timeout == 0)
+      timeout = 30000;
+    progress = 0;
+    do {
+      if (this->num_msgs) {
+        if (this->num_msgs > 0)
+          this->num_msgs--;
+        report_progress (this->stream, progress);
+      }
+      res = _x_io_select (this->stream, fh, XIO_WRITE_READY, 500);
+      progress += (500 * 100000) / timeout;
+    } while ((res == XIO_TIMEOUT) && (progress <= 100000) && !_x_action_pending (this->stream));
+    if (res != XIO_READY) {
+      _x_message (this->stream, XINE_MSG_NETWORK_UNREACHABLE, this->mrl, NULL);
+      this->ret = -3;
+      return XIO_HANDSHAKE_TRY_NEXT;
+    }
+  }
+
+  /* TLS */
+  _x_assert (this->tls == NULL);
+  this->tls = _x_tls_init (this->xine, this->stream, fh);
+  if (!this->tls) {
+    this->ret = -2;
+    return XIO_HANDSHAKE_INTR;
+  }
+  if (this->use_tls) {
+    int r = _x_tls_handshake (this->tls, this->url.host, -1);
+    if (r < 0) {
+      _x_message (this->stream, XINE_MSG_CONNECTION_REFUSED, "TLS handshake failed", NULL);
+      xprintf (this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake failed\n");
+      this->ret = -4;
+      _x_tls_deinit (&this->tls);
+      return XIO_HANDSHAKE_TRY_NEXT;
+    }
+    xprintf (this->xine, XINE_VERBOSITY_DEBUG, LOG_MODULE ": TLS handshake succeed, connection is encrypted\n");
+  }
+
+  return http_plugin_request (this);
+}
+
 static int http_plugin_open (input_plugin_t *this_gen) {
   http_input_plugin_t *this = (http_input_plugin_t *)this_gen;
   http_input_class_t  *this_class = (http_input_class_t *) this->input_plugin.input_class;
@@ -1631,7 +1836,13 @@ static int http_plugin_open (input_plugin_t *this_gen) {
   do {
     int proxyport, mrl_tls, proxy_tls;
 
-    http_close (this);
+    if (this->mode & MODE_PIPED) {
+      /* keep the connection, our answer is already on its way. */
+      _x_url_cleanup (&this->proxyurl);
+      _x_url_cleanup (&this->url);
+    } else {
+      http_close (this);
+    }
 
     if (--redirections <= 0) {
       xprintf (this->xine, XINE_VERBOSITY_LOG,
@@ -1676,8 +1887,32 @@ static int http_plugin_open (input_plugin_t *this_gen) {
     printf ("\n");
 #endif
 
+    snprintf (this->conn_key, sizeof (this->conn_key), "%s://%s:%d/%s",
+      this->use_tls ? "https" : "http",
+      this->use_proxy ? this_class->proxyhost : this->url.host,
+      this->use_proxy ? proxyport : this->url.port,
+      /* TLS through a proxy is verified against the final host. */
+      (this->use_proxy && this->use_tls) ? this->url.host : "");
+
     this->bytes_left = ~(uint64_t)0;
     this->ret = -2;
+    if ((this->fh >= 0) || (this_class->keep_alive && http_pool_get (this_class, this))) {
+      if (http_plugin_request (this) == XIO_HANDSHAKE_OK)
+        continue;
+      _x_tls_deinit (&this->tls);
+      _x_io_tcp_close (this->stream, this->fh);
+      this->fh = -1;
+      this->mode &= ~(MODE_KEEP_ALIVE | MODE_REUSED);
+      /* a real answer, or user abort. */
+      if ((this->ret != -1) && (this->ret != -4) && (this->ret != -6))
+        return this->ret;
+      if (_x_action_pending (this->stream))
+        return this->ret;
+      xprintf (this->xine, XINE_VERBOSITY_DEBUG,
+        LOG_MODULE ": persistent connection to %s was closed, reconnecting.\n", this->conn_key);
+      this->bytes_left = ~(uint64_t)0;
+      this->ret = -2;
+    }
     if (this->use_proxy)
       this->fh = _x_io_tcp_handshake_connect (this->stream, this_class->proxyhost, proxyport, http_plugin_handshake, this);
     else
@@ -1776,6 +2011,45 @@ static int http_can_handle (xine_stream_t *stream, const char *mrl) {
   return 1;
 }
 
+/* send the request for the next fragment now, and let the server
+ * queue it behind the current answer. */
+static int http_pipeline (http_input_plugin_t *this, const char *mrl) {
+  http_input_class_t *cls = (http_input_class_t *)this->input_plugin.input_class;
+  xine_url_t url;
+  int ok = 0;
+
+  if (!cls->pipelining || !cls->keep_alive || this->pipe_mrl || this->use_proxy)
+    return 0;
+  if ((this->fh < 0) || !(this->mode & MODE_KEEP_ALIVE) || ((this->status / 100) != 2))
+    return 0;
+  if ((this->mode & (MODE_HAS_LENGTH | MODE_CHUNKED | MODE_DEFLATED | MODE_NSV | MODE_SHOUTCAST)) != MODE_HAS_LENGTH)
+    return 0;
+  if (!_x_url_parse2 (mrl, &url))
+    return 0;
+  if (url.port == 0)
+    url.port = !strcasecmp (url.proto, "https") ? DEFAULT_HTTPS_PORT : DEFAULT_HTTP_PORT;
+  if (!strcasecmp (url.proto, this->url.proto) && !strcasecmp (url.host, this->url.host)
+    && (url.port == this->url.port)) {
+    /* zbuf is unused with plain content. */
+    size_t len = http_build_request (this, &url, 0, _x_url_user_agent (mrl), this->zbuf, sizeof (this->zbuf));
+    ssize_t r = _x_tls_write (this->tls, this->zbuf, len);
+    if (r == (ssize_t)len) {
+      if (this->head_dump_file)
+        fwrite (this->zbuf, 1, len, this->head_dump_file);
+      this->pipe_mrl = strdup (mrl);
+      ok = this->pipe_mrl != NULL;
+    }
+    if (!ok) {
+      /* connection is in an unknown state now. */
+      this->mode &= ~MODE_KEEP_ALIVE;
+    } else {
+      lprintf ("pipelined request for %s\n", mrl);
+    }
+  }
+  _x_url_cleanup (&url);
+  return ok;
+}
+
 static int http_plugin_get_optional_data (input_plugin_t *this_gen,
 					  void *const data, int data_type) {
 
@@ -1840,7 +2114,12 @@ static int http_plugin_get_optional_data (input_plugin_t *this_gen,
           break;
         if (!new_mrl[0])
           xprintf (this->xine, XINE_VERBOSITY_DEBUG, "input_http: going standby.\n");
-        http_close (this);
+        if (this->pipe_mrl && !strcmp (this->pipe_mrl, new_mrl) && http_can_keep (this)) {
+          _x_freep (&this->pipe_mrl);
+          this->mode |= MODE_PIPED;
+        } else {
+          http_close (this);
+        }
         sbuf_reset (this);
         this->mrl[0] = 0;
         this->mime_type[0] = 0;
@@ -1865,6 +2144,11 @@ static int http_plugin_get_optional_data (input_plugin_t *this_gen,
         }
         return INPUT_OPTIONAL_SUCCESS;
       }
+
+    case INPUT_OPTIONAL_DATA_NEXT_MRL:
+      if (!data)
+        break;
+      return http_pipeline (this, (const char *)data) ? INPUT_OPTIONAL_SUCCESS : INPUT_OPTIONAL_UNSUPPORTED;
   }
 
   return INPUT_OPTIONAL_UNSUPPORTED;
@@ -1908,6 +2192,7 @@ static input_plugin_t *http_class_get_instance (input_class_t *cls_gen, xine_str
   this->proxyurl.password   = NULL;
   this->proxyurl.uri        = NULL;
   this->head_dump_file      = NULL;
+  this->pipe_mrl            = NULL;
 #endif
 
   if (!strncasecmp (mrl, "peercast://pls/", 15)) {
@@ -1954,6 +2239,9 @@ static void http_class_dispose (input_class_t *this_gen) {
 
   config->unregister_callbacks (config, NULL, NULL, this, sizeof (*this));
 
+  http_pool_flush (this);
+  pthread_mutex_destroy (&this->pool_lock);
+
   free (this);
 }
 
@@ -2056,5 +2344,27 @@ void *input_http_init_class (xine_t *xine, const void *data) {
     _("Set this for debugging."),
     20, head_dump_name_change_cb, this);
 
+  /* persistent connections */
+  this->keep_alive = config->register_bool (config, "media.network.http_keep_alive",
+    1,
+    _("Reuse HTTP connections"),
+    _("Keep connections to a server open for a few seconds, and send the next request "
+      "over them. This saves a lot of connection and TLS setup time with fragment streams."),
+    20, keep_alive_change_cb, this);
+
+  this->pipelining = config->register_bool (config, "media.network.http_pipelining",
+    0,
+    _("Pipeline HTTP requests"),
+    _("Request the next fragment of a stream while the current one is still coming in. "
+      "Some servers and proxies dislike this."),
+    20, pipelining_change_cb, this);
+
+  {
+    int i;
+    for (i = 0; i < HTTP_POOL_SIZE; i++)
+      this->pool[i].fh = -1;
+  }
+  pthread_mutex_init (&this->pool_lock, NULL);
+
   return this;
 }
@@ -50,6 +50,7 @@
 #include "input_helper.h"
 #include "group_network.h"
 #include "multirate_pref.c"
+#include "frag_prefetch.c"
 #include "net_buf_ctrl.h"
 
 typedef struct {
@@ -105,6 +106,8 @@ typedef struct mpd_input_plugin_s {
   input_plugin_t   *in1;
   uint32_t          caps1;
 
+  frag_prefetch_t   prefetch;
+
   uint32_t          side_index; /** << 0..3 */
   uint32_t          num_sides;
 
@@ -342,8 +345,15 @@ static void mpd_apply_fragnum (mpd_input_plugin_t *this) {
 }
 
 static int mpd_input_switch_mrl (mpd_input_plugin_t *this) {
+  input_plugin_t *in;
   xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
     "input_mpegdash.%d: %s.\n", (int)this->side_index, this->item_mrl);
+  in = frag_prefetch_get (&this->prefetch, this->item_mrl);
+  if (in) {
+    _x_free_input_plugin (this->stream, this->in1);
+    this->in1 = in;
+    return 1;
+  }
   if (this->in1) {
     if (this->in1->get_capabilities (this->in1) & INPUT_CAP_NEW_MRL) {
       if (this->in1->get_optional_data (this->in1, this->item_mrl,
@@ -458,6 +468,50 @@ static int mpd_set_start_time (mpd_input_plugin_t *this) {
   return 1;
 }
 
+static void mpd_prefetch_next (mpd_input_plugin_t *this) {
+  char mrl[MPD_MAX_MRL], buf[32];
+  uint32_t dur_ms, index, last, l_2;
+
+  if ((this->mode == MPD_SINGLE_LIVE) || (this->mode == MPD_SINGLE_VOD) || !this->frag_mrl_2)
+    return;
+  if (this->frag_mrl_1 + 32 + this->frag_mrl_3 >= MPD_MAX_MRL)
+    return;
+  dur_ms = this->info.timebase ? (uint64_t)this->info.frag_duration * 1000u / this->info.timebase : 0;
+  /* no parallel loads, but the server may queue the next request for us. */
+  last = this->prefetch.max_depth ? this->frag_index + FRAG_PREFETCH_SLOTS : this->frag_index + 1;
+  if (this->info.frag_count && (last > this->info.frag_count))
+    last = this->info.frag_count;
+  if (MPD_IS_LIVE (this)) {
+    /* live edge: same schedule as the wait in mpd_set_frag_index (). */
+    struct timespec ts = {0, 0};
+    int64_t ms;
+    uint32_t edge;
+    if (!dur_ms)
+      return;
+    xine_gettime (&ts);
+    ms = (int64_t)(ts.tv_sec - this->sync.play_systime.tv_sec) * 1000;
+    ms += (ts.tv_nsec - this->sync.play_systime.tv_nsec) / 1000000;
+    if (ms < 0)
+      return;
+    edge = ms * this->info.timebase / ((int64_t)1000 * this->info.frag_duration) + 1;
+    if (last > edge)
+      last = edge;
+  }
+  memcpy (mrl, this->item_mrl, this->frag_mrl_1);
+  for (index = this->frag_index + 1; index <= last; index++) {
+    l_2 = sprintf (buf, "%" PRId64, this->frag_num + index - this->frag_index);
+    memcpy (mrl + this->frag_mrl_1, buf, l_2);
+    memcpy (mrl + this->frag_mrl_1 + l_2, this->item_mrl + this->frag_mrl_1 + this->frag_mrl_2, this->frag_mrl_3 + 1);
+    if (!this->prefetch.max_depth) {
+      if (this->in1)
+        this->in1->get_optional_data (this->in1, mrl, INPUT_OPTIONAL_DATA_NEXT_MRL);
+      break;
+    }
+    if (frag_prefetch_add (&this->prefetch, mrl, dur_ms) < 0)
+      break;
+  }
+}
+
 static int mpd_set_frag_index (mpd_input_plugin_t *this, uint32_t index, int wait) {
   if (!MPD_IS_LIVE (this)) {
     this->frag_num = this->info.frag_start + index - 1;
@@ -490,7 +544,10 @@ static int mpd_set_frag_index (mpd_input_plugin_t *this, uint32_t index, int wai
       }
     }
   }
-  return mpd_input_switch_mrl (this);
+  if (!mpd_input_switch_mrl (this))
+    return 0;
+  mpd_prefetch_next (this);
+  return 1;
 }
 
 static void mpd_frag_seen (mpd_input_plugin_t *this) {
@@ -567,6 +624,7 @@ static ssize_t mpd_read_int (mpd_input_plugin_t *this, void *buf, size_t len, in
     if (!mpd_input_switch_mrl (this))
       return q - (char *)buf;
     mpd_frag_seen (this);
+    mpd_prefetch_next (this);
   }
 
   while (len > 0) {
@@ -929,6 +987,9 @@ static off_t mpd_input_time_seek (input_plugin_t *this_gen, int time_offs, int o
     if (!xine_mfrag_get_index_start (this->fraglist, idx, NULL, &frag_time1))
       break;
     if ((uint32_t)idx != this->frag_index) {
+      /* a real jump, drop what was loaded for the old position. */
+      if ((uint32_t)idx != this->frag_index + 1)
+        frag_prefetch_flush (&this->prefetch);
       if (!mpd_set_frag_index (this, idx, 1))
         break;
     }
@@ -1003,6 +1064,8 @@ static off_t mpd_input_seek (input_plugin_t *this_gen, off_t offset, int origin)
      * and the fragment itself may turn out to be smaller than expected.
      * however, demux expects a seek to land at the exact byte offs.
      * lets try to meet that, even if it is still wrong. */
+    if (((uint32_t)idx != this->frag_index) && ((uint32_t)idx != this->frag_index + 1))
+      frag_prefetch_flush (&this->prefetch);
     idx -= 1;
     do {
       idx += 1;
@@ -1088,6 +1151,7 @@ static void mpd_input_dispose (input_plugin_t *this_gen) {
   if (!this)
     return;
 
+  frag_prefetch_deinit (&this->prefetch);
   if (this->nbc) {
     nbc_close (this->nbc);
     this->nbc = NULL;
@@ -1264,6 +1328,7 @@ static input_plugin_t *mpd_get_side (mpd_input_plugin_t *this, int side_index) {
     return NULL;
   }
   side_input->nbc = nbc_init (side_input->stream);
+  frag_prefetch_init (&side_input->prefetch, side_input->stream, "input_mpegdash");
 
   return &side_input->input_plugin;
 }
@@ -1410,6 +1475,7 @@ static input_plugin_t *mpd_input_get_instance (input_class_t *cls_gen, xine_stre
   this->sync.avail_start =
   this->sync.play_start  = (time_t)-1;
   this->sync.refs = 1;
+  frag_prefetch_init (&this->prefetch, this->stream, "input_mpegdash");
 
   xprintf (this->stream->xine, XINE_VERBOSITY_DEBUG,
     "input_mpegdash.%d: %s.\n", (int)this->side_index, mrl + n);
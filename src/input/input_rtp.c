@@ -119,6 +119,18 @@
 
 #define BUFFER_SIZE (1024*1024)
 
+#define RTP_PACKET_SIZE 9216  /* fits a jumbo frame */
+#define UDP_PACKET_SIZE 65536 /* plain udp may use the full datagram size */
+#define RTP_BATCH       16    /* datagrams per receive call */
+#define RTP_REORDER     32    /* rtp sequence reorder window, a power of 2 */
+#define RTP_PACKETS     (RTP_BATCH + RTP_REORDER)
+
+typedef struct {
+  unsigned char    *buf;          /* packet memory, NULL if unused */
+  unsigned char    *data;         /* payload */
+  int               len;
+} rtp_packet_t;
+
 typedef struct {
   input_plugin_t    input_plugin;
 
@@ -139,7 +151,25 @@ typedef struct {
   unsigned char	   *buffer_put_ptr;  /* put pointer used by writer */
   long              buffer_count; /* number of bytes in the buffer */
 
-  unsigned char     packet_buffer[65536];
+  /* reader thread only */
+  unsigned char    *packet_mem;
+  int               packet_size;  /* RTP_PACKET_SIZE or UDP_PACKET_SIZE */
+  unsigned char    *free_packets[RTP_PACKETS];
+  int               num_free;
+  rtp_packet_t      reorder[RTP_REORDER];
+  rtp_packet_t      out[RTP_PACKETS]; /* ready for the buffer ring */
+  int               num_out;
+  int               seq_valid;
+  uint16_t          next_seq;     /* next sequence number to deliver */
+  uint16_t          max_seq;      /* highest sequence number seen */
+  int               warned_trunc;
+#ifdef HAVE_RECVMMSG
+  int               use_mmsg;
+#endif
+  int64_t           rx_stats[INPUT_NET_STATS_SIZE];
+
+  /* protected by buffer_ring_mut */
+  int64_t           stats[INPUT_NET_STATS_SIZE];
 
   int               last_input_error;
   int               input_eof;
@@ -291,14 +321,257 @@ static int host_connect(const char *host, int port,
   return -1;
 }
 
+/*
+ * packet handling, reader thread only.
+ */
+static void rtp_packet_free (rtp_input_plugin_t *this, unsigned char *buf) {
+  this->free_packets[this->num_free++] = buf;
+}
+
+static void rtp_packet_drop (rtp_input_plugin_t *this, unsigned char *buf) {
+  this->rx_stats[INPUT_NET_STATS_DROPPED]++;
+  rtp_packet_free (this, buf);
+}
+
+static void rtp_packet_out (rtp_input_plugin_t *this, rtp_packet_t *p) {
+  this->out[this->num_out++] = *p;
+  p->buf = NULL;
+}
+
+/* advance the reorder window to seq, delivering what is there. */
+static void rtp_reorder_skip (rtp_input_plugin_t *this, uint16_t seq) {
+  uint16_t n = seq - this->next_seq;
+  int i;
+
+  for (i = 0; (i < n) && (i < RTP_REORDER); i++) {
+    rtp_packet_t *p = &this->reorder[(uint16_t)(this->next_seq + i) & (RTP_REORDER - 1)];
+
+    if (p->buf)
+      rtp_packet_out (this, p);
+    else
+      this->rx_stats[INPUT_NET_STATS_LOST]++;
+  }
+  if (n > RTP_REORDER)
+    this->rx_stats[INPUT_NET_STATS_LOST] += n - RTP_REORDER;
+  this->next_seq = seq;
+}
+
+/* stop waiting for missing packets. */
+static void rtp_reorder_flush (rtp_input_plugin_t *this) {
+  int i;
+
+  for (i = RTP_REORDER - 1; i >= 0; i--) {
+    if (this->reorder[(uint16_t)(this->next_seq + i) & (RTP_REORDER - 1)].buf) {
+      rtp_reorder_skip (this, this->next_seq + i + 1);
+      break;
+    }
+  }
+}
+
+static void rtp_packet_in (rtp_input_plugin_t *this, unsigned char *buf, int length) {
+  rtp_packet_t *p;
+  unsigned char *data = buf;
+  uint16_t seq;
+  int16_t d;
+  int pad, ext, csrc;
+
+  if (!this->is_rtp) {
+    rtp_packet_t q = { buf, data, length };
+    rtp_packet_out (this, &q);
+    return;
+  }
+
+  /* Do minimal RTP parsing to extract payload.  See
+   * http://www.faqs.org/rfcs/rfc3550.html for header format.
+   */
+
+  if ((length < 12) || ((data[0] & 0xc0) != 0x80)) {
+    rtp_packet_drop (this, buf);
+    return;
+  }
+
+  pad = data[0] & 0x20;
+  ext = data[0] & 0x10;
+  csrc = data[0] & 0x0f;
+  seq = (data[2] << 8) | data[3];
+
+  data += 12 + csrc * 4;
+  length -= 12 + csrc * 4;
+
+  if (ext && (length >= 4)) {
+    /* 32 bit words following the 4 byte extension header */
+    int hlen = 4 + ((data[2] << 8) | data[3]) * 4;
+
+    data += hlen;
+    length -= hlen;
+  }
+
+  /* the last padding byte counts the padding, including itself. */
+  if (pad && (length > 0))
+    length -= data[length - 1];
+
+  if (length < 0) {
+    rtp_packet_drop (this, buf);
+    return;
+  }
+
+  if (!this->seq_valid) {
+    this->seq_valid = 1;
+    this->next_seq = this->max_seq = seq;
+  }
+
+  d = seq - this->next_seq;
+  if (d <= -RTP_REORDER) {
+    /* sender restart */
+    rtp_reorder_flush (this);
+    this->next_seq = this->max_seq = seq;
+    d = 0;
+  } else if (d < 0) {
+    /* late or duplicate */
+    rtp_packet_drop (this, buf);
+    return;
+  } else if (d >= RTP_REORDER) {
+    /* too far ahead, give up on the missing ones. */
+    rtp_reorder_skip (this, seq - RTP_REORDER + 1);
+  }
+
+  p = &this->reorder[seq & (RTP_REORDER - 1)];
+  if (p->buf) {
+    rtp_packet_drop (this, buf);
+    return;
+  }
+  if ((int16_t)(seq - this->max_seq) < 0)
+    this->rx_stats[INPUT_NET_STATS_REORDERED]++;
+  else
+    this->max_seq = seq;
+  p->buf = buf;
+  p->data = data;
+  p->len = length;
+
+  while (this->reorder[this->next_seq & (RTP_REORDER - 1)].buf) {
+    rtp_packet_out (this, &this->reorder[this->next_seq & (RTP_REORDER - 1)]);
+    this->next_seq++;
+  }
+}
+
+/* move the ready packets into the buffer ring. */
+static void rtp_deliver (rtp_input_plugin_t *this) {
+  int i;
+
+  pthread_mutex_lock(&this->buffer_ring_mut);
+
+  for (i = 0; i < this->num_out; i++) {
+    unsigned char *data = this->out[i].data;
+    long length = this->out[i].len;
+
+    /* insert data into cyclic buffer */
+    if (length > 0) {
+      long buffer_space_remaining;
+
+      /* wait for enough space to write the whole of the recv'ed data */
+      while( (BUFFER_SIZE - this->buffer_count) < length )
+      {
+        struct timeval tv;
+        struct timespec timeout;
+
+        gettimeofday(&tv, NULL);
+
+        timeout.tv_nsec = tv.tv_usec * 1000;
+        timeout.tv_sec = tv.tv_sec + 2;
+
+        if( pthread_cond_timedwait(&this->writer_cond, &this->buffer_ring_mut, &timeout) != 0 )
+        {
+          fprintf( stdout, "input_rtp: buffer ring not read within 2 seconds!\n" );
+        }
+      }
+
+      /* Now there's enough space to write some bytes into the buffer
+       * determine how many bytes can be written. If the buffer wraps
+       * around, write in two pieces: from the head pointer to the
+       * end of the buffer and from the base to the remaining number
+       * of bytes.
+       */
+      buffer_space_remaining = BUFFER_SIZE - (this->buffer_put_ptr - this->buffer);
+
+      if( buffer_space_remaining >= length )
+      {
+        /* data fits inside the buffer */
+        memcpy(this->buffer_put_ptr, data, length);
+        this->buffer_put_ptr += length;
+      }
+      else
+      {
+        /* data wrapped around the end of the buffer */
+        memcpy(this->buffer_put_ptr, data, buffer_space_remaining);
+        memcpy(this->buffer, &data[buffer_space_remaining], length - buffer_space_remaining);
+        this->buffer_put_ptr = &this->buffer[ length - buffer_space_remaining ];
+      }
+
+      this->buffer_count += length;
+    }
+    rtp_packet_free (this, this->out[i].buf);
+  }
+
+  memcpy (this->stats, this->rx_stats, sizeof (this->stats));
+
+  /* signal the reader that there is new data */
+  if (this->num_out)
+    pthread_cond_signal(&this->reader_cond);
+  pthread_mutex_unlock(&this->buffer_ring_mut);
+
+  this->num_out = 0;
+}
+
+/* receive up to RTP_BATCH datagrams into bufs, and store their sizes.
+ * sizes > packet_size mean truncated. */
+static int rtp_receive (rtp_input_plugin_t *this, unsigned char **bufs, int *lens) {
+  int n;
+
+#ifdef HAVE_RECVMMSG
+  if (this->use_mmsg) {
+    struct mmsghdr msgs[RTP_BATCH];
+    struct iovec iov[RTP_BATCH];
+    int i;
+
+    /* get all waiting datagrams at once. */
+    memset (msgs, 0, sizeof (msgs));
+    for (i = 0; i < RTP_BATCH; i++) {
+      iov[i].iov_base = bufs[i];
+      iov[i].iov_len = this->packet_size;
+      msgs[i].msg_hdr.msg_iov = &iov[i];
+      msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    n = recvmmsg (this->fh, msgs, RTP_BATCH, MSG_DONTWAIT, NULL);
+    this->rx_stats[INPUT_NET_STATS_SYSCALLS]++;
+    if (n >= 0) {
+      for (i = 0; i < n; i++)
+        lens[i] = (msgs[i].msg_hdr.msg_flags & MSG_TRUNC) ? this->packet_size + 1 : (int)msgs[i].msg_len;
+      return n;
+    }
+    if (errno != ENOSYS)
+      return -1;
+    this->use_mmsg = 0;
+  }
+#endif
+
+  /* packets have 1 spare byte. if that gets used, the datagram was too large. */
+  n = recv (this->fh, bufs[0], this->packet_size + 1, 0);
+  this->rx_stats[INPUT_NET_STATS_SYSCALLS]++;
+  if (n < 0)
+    return -1;
+  lens[0] = n;
+  return 1;
+}
+
 /*
  *
  */
 static void * input_plugin_read_loop(void *arg) {
 
   rtp_input_plugin_t *this  = (rtp_input_plugin_t *) arg;
-  unsigned char *data;
-  long length;
+  unsigned char *bufs[RTP_BATCH];
+  int lens[RTP_BATCH];
+  int i, n;
   fd_set read_fds;
 
   while (1) {
@@ -322,125 +595,55 @@ static void * input_plugin_read_loop(void *arg) {
 
     /* wait for a packet to arrive - but do not hang! */
     rc = select( this->fh+1, &read_fds, NULL, NULL, &recv_timeout );
-    if( rc > 0 )
-    {
-        length = recv(this->fh, this->packet_buffer,
-                    sizeof(this->packet_buffer), 0);
+    if (rc == 0) {
+      /* nothing more coming for now, dont hold back what we have. */
+      rtp_reorder_flush (this);
+      rtp_deliver (this);
+      continue;
+    }
+    if (rc > 0) {
+      /* there are always enough free packets here, see RTP_PACKETS. */
+      for (i = 0; i < RTP_BATCH; i++)
+        bufs[i] = this->free_packets[--this->num_free];
+      n = rtp_receive (this, bufs, lens);
+      if (n < 0) {
+        int e = errno;
+        for (i = 0; i < RTP_BATCH; i++)
+          rtp_packet_free (this, bufs[i]);
+        errno = e;
+      }
     }
-    else if( rc == 0 )
-        length = 0;
     else
-        length = -1;
+      n = -1;
     }
     pthread_testcancel();
 
-    if (length < 0) {
-      if (errno != EINTR) {
+    if (n < 0) {
+      if ((errno != EINTR) && (errno != EAGAIN) && (errno != EWOULDBLOCK)) {
 	LOG_MSG(this->stream->xine, _("recv(): %s.\n"), strerror(errno));
 	return NULL;
       }
+      continue;
     }
-    else {
-      data = this->packet_buffer;
-
-      if (this->is_rtp) {
-	int pad, ext;
-	int csrc;
 
-	/* Do minimal RTP parsing to extract payload.  See
-	 * http://www.faqs.org/rfcs/rfc1889.html for header format.
-	 *
-	 * WARNING: wholly untested code.  I don't have any RTP sender.
-	 */
-
-	if (length < 12) continue;
-
-	pad = data[0] & 0x20;
-	ext = data[0] & 0x10;
-	csrc = data[0] & 0x0f;
-
-	data += 12 + csrc * 4;
-	length -= 12 + csrc * 4;
-
-	if (ext) {
-	  long hlen;
-
-	  if (length < 4) continue;
-
-	  hlen = (data[2] << 8) | data[3];
-	  data += hlen;
-	  length -= hlen;
-	}
-
-	if (pad) {
-	  if (length < 1)
-	    continue;
-
-	  /* FIXME: is the pad length byte included in the
-	   * length value or not?  We assume it is not.
-	   */
-	  length -= data[length - 1] + 1;
-	}
-      }
-
-      /* insert data into cyclic buffer */
-      if (length > 0) {
-
-	/*
-	 * if the buffer is full, wait for the reader
-	 * to signal
-	 */
-
-        pthread_mutex_lock(&this->buffer_ring_mut);
-        /* wait for enough space to write the whole of the recv'ed data */
-	while( (BUFFER_SIZE - this->buffer_count) < length )
-        {
-          struct timeval tv;
-          struct timespec timeout;
-
-          gettimeofday(&tv, NULL);
-
-          timeout.tv_nsec = tv.tv_usec * 1000;
-          timeout.tv_sec = tv.tv_sec + 2;
-
-          if( pthread_cond_timedwait(&this->writer_cond, &this->buffer_ring_mut, &timeout) != 0 )
-          {
-            fprintf( stdout, "input_rtp: buffer ring not read within 2 seconds!\n" );
-          }
-        }
-
-	/* Now there's enough space to write some bytes into the buffer
-	 * determine how many bytes can be written. If the buffer wraps
-	 * around, write in two pieces: from the head pointer to the
-	 * end of the buffer and from the base to the remaining number
-	 * of bytes.
-	 */
-
-        {
-        long buffer_space_remaining = BUFFER_SIZE - (this->buffer_put_ptr - this->buffer);
-
-	if( buffer_space_remaining >= length )
-        {
-            /* data fits inside the buffer */
-            memcpy(this->buffer_put_ptr, data, length);
-            this->buffer_put_ptr += length;
-    }
-	else
-        {
-            /* data wrapped around the end of the buffer */
-            memcpy(this->buffer_put_ptr, data, buffer_space_remaining);
-            memcpy(this->buffer, &data[buffer_space_remaining], length - buffer_space_remaining);
-            this->buffer_put_ptr = &this->buffer[ length - buffer_space_remaining ];
+    for (i = 0; i < n; i++) {
+      this->rx_stats[INPUT_NET_STATS_PACKETS]++;
+      if (lens[i] > this->packet_size) {
+        if (!this->warned_trunc) {
+          this->warned_trunc = 1;
+          xprintf (this->stream->xine, XINE_VERBOSITY_LOG,
+            LOG_MODULE ": dropping datagrams larger than %d bytes.\n", this->packet_size);
         }
-        }
-
-	this->buffer_count += length;
-
-	/* signal the reader that there is new data	*/
-	pthread_cond_signal(&this->reader_cond);
-	pthread_mutex_unlock(&this->buffer_ring_mut);
+        rtp_packet_drop (this, bufs[i]);
+        continue;
       }
+      rtp_packet_in (this, bufs[i], lens[i]);
     }
+    /* return the unused ones. */
+    for (; i < RTP_BATCH; i++)
+      rtp_packet_free (this, bufs[i]);
+
+    rtp_deliver (this);
   }
 }
 
@@ -594,6 +797,14 @@ static int rtp_plugin_get_optional_data (input_plugin_t *this_gen,
       memcpy(data, this->preview, this->preview_size);
     return this->preview_size;
   }
+  else if (data_type == INPUT_OPTIONAL_DATA_NET_STATS) {
+    if (!data)
+      return INPUT_OPTIONAL_UNSUPPORTED;
+    pthread_mutex_lock(&this->buffer_ring_mut);
+    memcpy(data, this->stats, sizeof(this->stats));
+    pthread_mutex_unlock(&this->buffer_ring_mut);
+    return INPUT_OPTIONAL_SUCCESS;
+  }
   else {
     return INPUT_OPTIONAL_UNSUPPORTED;
   }
@@ -618,6 +829,7 @@ static void rtp_plugin_dispose (input_plugin_t *this_gen ) {
   pthread_cond_destroy(&this->writer_cond);
 
   _x_freep(&this->buffer);
+  _x_freep(&this->packet_mem);
   _x_freep(&this->mrl);
   free(this);
 }
@@ -735,6 +947,19 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
   this->buffer_count = 0;
   this->curpos = 0;
 
+  /* only the received bytes of this ever get touched. */
+  this->packet_size = is_rtp ? RTP_PACKET_SIZE : UDP_PACKET_SIZE;
+  this->packet_mem = malloc(RTP_PACKETS * (this->packet_size + 1));
+  if (this->packet_mem) {
+    int i;
+    for (i = 0; i < RTP_PACKETS; i++)
+      this->free_packets[i] = this->packet_mem + i * (this->packet_size + 1);
+    this->num_free = RTP_PACKETS;
+  }
+#ifdef HAVE_RECVMMSG
+  this->use_mmsg = 1;
+#endif
+
   this->input_plugin.open              = rtp_plugin_open;
   this->input_plugin.get_capabilities  = _x_input_get_capabilities_preview;
   this->input_plugin.read              = rtp_plugin_read;
@@ -751,8 +976,9 @@ static input_plugin_t *rtp_class_get_instance (input_class_t *cls_gen,
   this->nbc = NULL;
   this->nbc = nbc_init(this->stream);
 
-  if (!this->buffer) {
+  if (!this->buffer || !this->packet_mem) {
     rtp_plugin_dispose(&this->input_plugin);
+    return NULL;
   }
 
   return &this->input_plugin;
@@ -334,6 +334,13 @@ static int _gnutls_load_certs (tls_gnutls_t *this, const char *dirname) {
 }
 #endif
 
+static void _gnutls_set_stream(tls_plugin_t *this_gen, xine_stream_t *stream)
+{
+  tls_gnutls_t *this = (tls_gnutls_t *)this_gen;
+
+  this->stream = stream;
+}
+
 static void _gnutls_shutdown(tls_plugin_t *this_gen)
 {
   tls_gnutls_t *this = (tls_gnutls_t *)this_gen;
@@ -499,6 +506,7 @@ static xine_module_t *gnutls_get_instance(xine_module_class_t *cls_gen, const vo
   this->tls_plugin.read      = _gnutls_read;
   this->tls_plugin.part_read = _gnutls_part_read;
   this->tls_plugin.write     = _gnutls_write;
+  this->tls_plugin.set_stream = _gnutls_set_stream;
 
   this->xine   = p->xine;
   this->fd     = p->fd;
@@ -220,6 +220,13 @@ static ssize_t _openssl_part_read(tls_plugin_t *this_gen, void *buf, size_t min,
   return ret;
 }
 
+static void _openssl_set_stream(tls_plugin_t *this_gen, xine_stream_t *stream)
+{
+  tls_openssl_t *this = (tls_openssl_t *)this_gen;
+
+  this->stream = stream;
+}
+
 static void _openssl_shutdown(tls_plugin_t *this_gen)
 {
   tls_openssl_t *this = (tls_openssl_t *)this_gen;
@@ -327,6 +334,7 @@ static xine_module_t *_openssl_get_instance(xine_module_class_t *cls_gen, const
   this->tls_plugin.part_read = _openssl_part_read;
   this->tls_plugin.read      = _openssl_read;
   this->tls_plugin.write     = _openssl_write;
+  this->tls_plugin.set_stream = _openssl_set_stream;
 
   this->xine   = p->xine;
   this->fd     = p->fd;
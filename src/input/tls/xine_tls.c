@@ -177,6 +177,14 @@ xine_tls_t *_x_tls_init (xine_t *xine, xine_stream_t *stream, int fd) {
   return tls;
 }
 
+void _x_tls_set_stream (xine_tls_t *tls, xine_stream_t *stream) {
+  if (!tls)
+    return;
+  tls->stream = stream;
+  if (tls->tls && tls->tls->set_stream)
+    tls->tls->set_stream (tls->tls, stream);
+}
+
 xine_tls_t *_x_tls_connect (xine_t *xine, xine_stream_t *stream, const char *host, int port) {
   xine_tls_t *tls;
   int fh;
@@ -53,6 +53,9 @@ xine_tls_t *_x_tls_init (xine_t *xine, xine_stream_t *stream, int fd);
 /* do NOT close fd. */
 void        _x_tls_deinit (xine_tls_t **tlsp);
 
+/* move an open connection to another stream, or park it with stream == NULL. */
+void        _x_tls_set_stream (xine_tls_t *, xine_stream_t *stream);
+
 ssize_t _x_tls_part_read(xine_tls_t *, void *data, size_t min, size_t max);
 ssize_t _x_tls_read(xine_tls_t *, void *data, size_t len);
 ssize_t _x_tls_write(xine_tls_t *, const void *data, size_t len);
@@ -47,6 +47,9 @@ struct tls_plugin_s {
   ssize_t (*read)(tls_plugin_t *, void *buf, size_t len);
   ssize_t (*write)(tls_plugin_t *, const void *buf, size_t len);
   ssize_t (*part_read)(tls_plugin_t *, void *buf, size_t min, size_t max);
+
+  /* rebind an established session to another (or no) stream. */
+  void    (*set_stream)(tls_plugin_t *, xine_stream_t *stream);
 };
 
 /*
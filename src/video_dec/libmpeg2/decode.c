@@ -236,6 +236,37 @@ static void remember_metainfo (mpeg2dec_t *mpeg2dec) {
   _x_meta_info_set_utf8(mpeg2dec->stream, XINE_META_INFO_VIDEOCODEC, "MPEG (libmpeg2)");
 }
 
+/* finish all slices decoded by the thread pool. */
+static void mpeg2_slice_mt_sync (mpeg2dec_t * mpeg2dec)
+{
+    vo_frame_t *frame = mpeg2_slice_mt_wait (mpeg2dec->slice_mt);
+
+    if (frame)
+	frame->bad_frame = 0;
+}
+
+/* can the thread pool handle this slice? */
+static int mpeg2_slice_mt_usable (picture_t * picture)
+{
+    vo_frame_t *frame = picture->current_frame;
+
+    /* mpeg1 slices may span multiple rows, and proc_slice wants them in order. */
+    if (picture->mpeg1 || frame->proc_slice || (frame->format != XINE_IMGFMT_YV12))
+	return 0;
+    if ((frame->picture_coding_type == XINE_PICT_P_TYPE) ||
+	(frame->picture_coding_type == XINE_PICT_B_TYPE)) {
+	if (!picture->forward_reference_frame ||
+	    (picture->forward_reference_frame->format != frame->format))
+	    return 0;
+    }
+    if (frame->picture_coding_type == XINE_PICT_B_TYPE) {
+	if (!picture->backward_reference_frame ||
+	    (picture->backward_reference_frame->format != frame->format))
+	    return 0;
+    }
+    return 1;
+}
+
 static inline int parse_chunk (mpeg2dec_t * mpeg2dec, int code,
 			       uint8_t * buffer, int next_code)
 {
@@ -261,6 +292,9 @@ static inline int parse_chunk (mpeg2dec_t * mpeg2dec, int code,
     mpeg2_stats (code, buffer);
 
     picture = mpeg2dec->picture;
+
+    if (mpeg2dec->slice_mt && ((!code) || (code >= 0xb0)))
+	mpeg2_slice_mt_sync (mpeg2dec);
     is_frame_done = mpeg2dec->in_slice && ((!code) || (code >= 0xb0));
 
     if (is_frame_done)
@@ -576,12 +610,16 @@ static inline int parse_chunk (mpeg2dec_t * mpeg2dec, int code,
 	  printf("slice target %08x past %08x future %08x\n",picture->current_frame,picture->forward_reference_frame,picture->backward_reference_frame);
 	  fflush(stdout);
 #endif
-	  libmpeg2_accel_slice(&mpeg2dec->accel, picture, code, buffer, mpeg2dec->chunk_size, 
-			       mpeg2dec->chunk_buffer);
-
-	  if( picture->v_offset > picture->limit_y || 
-	      picture->v_offset + 16 > picture->display_height ) { 
-	    picture->current_frame->bad_frame = 0;
+	  if (!mpeg2dec->slice_mt || (mpeg2dec->frame_format != XINE_IMGFMT_YV12) ||
+	      !mpeg2_slice_mt_usable (picture) ||
+	      !mpeg2_slice_mt_put (mpeg2dec->slice_mt, picture, code, buffer, mpeg2dec->chunk_size)) {
+	    libmpeg2_accel_slice(&mpeg2dec->accel, picture, code, buffer, mpeg2dec->chunk_size, 
+			         mpeg2dec->chunk_buffer);
+
+	    if( picture->v_offset > picture->limit_y || 
+	        picture->v_offset + 16 > picture->display_height ) { 
+	      picture->current_frame->bad_frame = 0;
+	    }
 	  }
 	}
     }
@@ -725,6 +763,9 @@ void mpeg2_discontinuity (mpeg2dec_t * mpeg2dec) {
 
   if( !picture )
     return;
+
+  if (mpeg2dec->slice_mt)
+    mpeg2_slice_mt_sync (mpeg2dec);
   
   mpeg2dec->in_slice = 0;
   mpeg2dec->pts = 0;  
@@ -792,6 +833,9 @@ void mpeg2_flush (mpeg2dec_t * mpeg2dec) {
 
   if (!picture)
     return;
+
+  if (mpeg2dec->slice_mt)
+    mpeg2_slice_mt_sync (mpeg2dec);
   
   if (picture->current_frame && !picture->current_frame->drawn &&
       !picture->current_frame->bad_frame) {
@@ -819,6 +863,12 @@ void mpeg2_close (mpeg2dec_t * mpeg2dec)
     }
     */
 
+    if (mpeg2dec->slice_mt) {
+      mpeg2_slice_mt_sync (mpeg2dec);
+      mpeg2_slice_mt_delete (mpeg2dec->slice_mt);
+      mpeg2dec->slice_mt = NULL;
+    }
+
     /* 
       dont remove any picture->*->free() below. doing so will cause buffer 
       leak, and we only have about 15 of them.
@@ -874,6 +924,9 @@ void mpeg2_find_sequence_header (mpeg2dec_t * mpeg2dec,
   uint8_t code, next_code;
   picture_t *picture = mpeg2dec->picture;
 
+  if (mpeg2dec->slice_mt)
+    mpeg2_slice_mt_sync (mpeg2dec);
+
   mpeg2dec->seek_mode = 1;
 
   while (current < end) {
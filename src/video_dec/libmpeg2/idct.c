@@ -283,6 +283,16 @@ void mpeg2_idct_init (uint32_t mm_accel)
     mpeg2_zero_block = mpeg2_zero_block_c;
 
 #if defined(ARCH_X86) || defined(ARCH_X86_64)
+#ifdef LIBMPEG2_AVX2
+    if (mm_accel & MM_ACCEL_X86_AVX2) {
+#ifdef LOG
+	fprintf (stderr, "Using AVX2 for IDCT transform\n");
+#endif
+	mpeg2_idct_copy = mpeg2_idct_copy_avx2;
+	mpeg2_idct_add  = mpeg2_idct_add_avx2;
+	mpeg2_idct      = mpeg2_idct_avx2;
+    } else
+#endif
     if (mm_accel & MM_ACCEL_X86_MMXEXT) {
 #ifdef LOG
 	fprintf (stderr, "Using MMXEXT for IDCT transform\n");
@@ -303,6 +313,16 @@ void mpeg2_idct_init (uint32_t mm_accel)
 	mpeg2_idct_mmx_init ();
     } else
 #endif
+#ifdef LIBMPEG2_NEON
+    if (mm_accel & MM_ACCEL_ARM_NEON) {
+#ifdef LOG
+	fprintf (stderr, "Using NEON for IDCT transform\n");
+#endif
+	mpeg2_idct_copy = mpeg2_idct_copy_neon;
+	mpeg2_idct_add  = mpeg2_idct_add_neon;
+	mpeg2_idct      = mpeg2_idct_neon;
+    } else
+#endif
 #if defined (ARCH_PPC) && defined (ENABLE_ALTIVEC)
     if (mm_accel & MM_ACCEL_PPC_ALTIVEC) {
 #ifdef LOG
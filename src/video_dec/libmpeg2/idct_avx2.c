@@ -0,0 +1,205 @@
+/*
+ * idct_avx2.c
+ * Copyright (C) 2000-2021 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * AVX2 version of the Chen-Wang IDCT in idct.c.
+ * All 8 rows (then all 8 columns) are transformed at once, 1 per 32 bit
+ * lane, using the very same integer arithmetic. The result is bit exact
+ * to the C version.
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+
+#include "mpeg2_internal.h"
+
+#ifdef LIBMPEG2_AVX2
+
+#include <immintrin.h>
+
+#define AVX2_FUNC __attribute__ ((target ("avx2")))
+
+#define W1 2841 /* 2048*sqrt (2)*cos (1*pi/16) */
+#define W2 2676 /* 2048*sqrt (2)*cos (2*pi/16) */
+#define W3 2408 /* 2048*sqrt (2)*cos (3*pi/16) */
+#define W5 1609 /* 2048*sqrt (2)*cos (5*pi/16) */
+#define W6 1108 /* 2048*sqrt (2)*cos (6*pi/16) */
+#define W7 565  /* 2048*sqrt (2)*cos (7*pi/16) */
+
+#define MUL(w,x) _mm256_mullo_epi32 (_mm256_set1_epi32 (w), x)
+#define ADD(a,b) _mm256_add_epi32 (a, b)
+#define SUB(a,b) _mm256_sub_epi32 (a, b)
+#define SHR(x,n) _mm256_sra_epi32 (x, n)
+
+static inline AVX2_FUNC void transpose (__m128i *r)
+{
+    __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+    __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+    a0 = _mm_unpacklo_epi16 (r[0], r[1]);
+    a1 = _mm_unpackhi_epi16 (r[0], r[1]);
+    a2 = _mm_unpacklo_epi16 (r[2], r[3]);
+    a3 = _mm_unpackhi_epi16 (r[2], r[3]);
+    a4 = _mm_unpacklo_epi16 (r[4], r[5]);
+    a5 = _mm_unpackhi_epi16 (r[4], r[5]);
+    a6 = _mm_unpacklo_epi16 (r[6], r[7]);
+    a7 = _mm_unpackhi_epi16 (r[6], r[7]);
+
+    b0 = _mm_unpacklo_epi32 (a0, a2);
+    b1 = _mm_unpackhi_epi32 (a0, a2);
+    b2 = _mm_unpacklo_epi32 (a1, a3);
+    b3 = _mm_unpackhi_epi32 (a1, a3);
+    b4 = _mm_unpacklo_epi32 (a4, a6);
+    b5 = _mm_unpackhi_epi32 (a4, a6);
+    b6 = _mm_unpacklo_epi32 (a5, a7);
+    b7 = _mm_unpackhi_epi32 (a5, a7);
+
+    r[0] = _mm_unpacklo_epi64 (b0, b4);
+    r[1] = _mm_unpackhi_epi64 (b0, b4);
+    r[2] = _mm_unpacklo_epi64 (b1, b5);
+    r[3] = _mm_unpackhi_epi64 (b1, b5);
+    r[4] = _mm_unpacklo_epi64 (b2, b6);
+    r[5] = _mm_unpackhi_epi64 (b2, b6);
+    r[6] = _mm_unpacklo_epi64 (b3, b7);
+    r[7] = _mm_unpackhi_epi64 (b3, b7);
+}
+
+/* one pass of idct_row () or idct_col (), see idct.c.
+ * row: in_shift 11, bias 128,  rnd 0, stage_shift 0, out_shift 8.
+ * col: in_shift 8,  bias 8192, rnd 4, stage_shift 3, out_shift 14. */
+static inline AVX2_FUNC void idct_pass (__m128i *r, int in_shift, int bias,
+					int rnd, int stage_shift, int out_shift)
+{
+    __m256i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+    __m128i in_sh = _mm_cvtsi32_si128 (in_shift);
+    __m128i st_sh = _mm_cvtsi32_si128 (stage_shift);
+    __m128i out_sh = _mm_cvtsi32_si128 (out_shift);
+    __m128i round_sh = _mm_cvtsi32_si128 (8);
+    __m256i vrnd = _mm256_set1_epi32 (rnd);
+    __m256i v128 = _mm256_set1_epi32 (128);
+
+    x1 = _mm256_sll_epi32 (_mm256_cvtepi16_epi32 (r[4]), in_sh);
+    x2 = _mm256_cvtepi16_epi32 (r[6]);
+    x3 = _mm256_cvtepi16_epi32 (r[2]);
+    x4 = _mm256_cvtepi16_epi32 (r[1]);
+    x5 = _mm256_cvtepi16_epi32 (r[7]);
+    x6 = _mm256_cvtepi16_epi32 (r[5]);
+    x7 = _mm256_cvtepi16_epi32 (r[3]);
+    x0 = ADD (_mm256_sll_epi32 (_mm256_cvtepi16_epi32 (r[0]), in_sh),
+	      _mm256_set1_epi32 (bias));
+
+    /* first stage */
+    x8 = ADD (MUL (W7, ADD (x4, x5)), vrnd);
+    x4 = SHR (ADD (x8, MUL (W1 - W7, x4)), st_sh);
+    x5 = SHR (SUB (x8, MUL (W1 + W7, x5)), st_sh);
+    x8 = ADD (MUL (W3, ADD (x6, x7)), vrnd);
+    x6 = SHR (SUB (x8, MUL (W3 - W5, x6)), st_sh);
+    x7 = SHR (SUB (x8, MUL (W3 + W5, x7)), st_sh);
+
+    /* second stage */
+    x8 = ADD (x0, x1);
+    x0 = SUB (x0, x1);
+    x1 = ADD (MUL (W6, ADD (x3, x2)), vrnd);
+    x2 = SHR (SUB (x1, MUL (W2 + W6, x2)), st_sh);
+    x3 = SHR (ADD (x1, MUL (W2 - W6, x3)), st_sh);
+    x1 = ADD (x4, x6);
+    x4 = SUB (x4, x6);
+    x6 = ADD (x5, x7);
+    x5 = SUB (x5, x7);
+
+    /* third stage */
+    x7 = ADD (x8, x3);
+    x8 = SUB (x8, x3);
+    x3 = ADD (x0, x2);
+    x0 = SUB (x0, x2);
+    x2 = SHR (ADD (MUL (181, ADD (x4, x5)), v128), round_sh);
+    x4 = SHR (ADD (MUL (181, SUB (x4, x5)), v128), round_sh);
+
+    /* fourth stage, truncate to int16_t like the C version does. */
+#define STORE(i,v) do {							\
+	__m256i t = SHR (v, out_sh);					\
+	t = _mm256_srai_epi32 (_mm256_slli_epi32 (t, 16), 16);		\
+	r[i] = _mm_packs_epi32 (_mm256_castsi256_si128 (t),		\
+				_mm256_extracti128_si256 (t, 1));	\
+    } while (0)
+    STORE (0, ADD (x7, x1));
+    STORE (1, ADD (x3, x2));
+    STORE (2, ADD (x0, x4));
+    STORE (3, ADD (x8, x6));
+    STORE (4, SUB (x8, x6));
+    STORE (5, SUB (x0, x4));
+    STORE (6, SUB (x3, x2));
+    STORE (7, SUB (x7, x1));
+#undef STORE
+}
+
+static inline AVX2_FUNC void idct (int16_t * block, __m128i *r)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+	r[i] = _mm_loadu_si128 ((const __m128i *)(block + 8 * i));
+    /* rows */
+    transpose (r);
+    idct_pass (r, 11, 128, 0, 0, 8);
+    /* columns */
+    transpose (r);
+    idct_pass (r, 8, 8192, 4, 3, 14);
+}
+
+AVX2_FUNC void mpeg2_idct_copy_avx2 (int16_t * block, uint8_t * dest, int stride)
+{
+    __m128i r[8], zero = _mm_setzero_si128 ();
+    int i;
+
+    idct (block, r);
+    for (i = 0; i < 8; i++) {
+	_mm_storel_epi64 ((__m128i *)dest, _mm_packus_epi16 (r[i], r[i]));
+	_mm_storeu_si128 ((__m128i *)(block + 8 * i), zero);
+	dest += stride;
+    }
+}
+
+AVX2_FUNC void mpeg2_idct_add_avx2 (int16_t * block, uint8_t * dest, int stride)
+{
+    __m128i r[8], zero = _mm_setzero_si128 ();
+    int i;
+
+    idct (block, r);
+    for (i = 0; i < 8; i++) {
+	__m128i d = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)dest), zero);
+	d = _mm_adds_epi16 (d, r[i]);
+	_mm_storel_epi64 ((__m128i *)dest, _mm_packus_epi16 (d, d));
+	_mm_storeu_si128 ((__m128i *)(block + 8 * i), zero);
+	dest += stride;
+    }
+}
+
+AVX2_FUNC void mpeg2_idct_avx2 (int16_t * block)
+{
+    __m128i r[8];
+    int i;
+
+    idct (block, r);
+    for (i = 0; i < 8; i++)
+	_mm_storeu_si128 ((__m128i *)(block + 8 * i), r[i]);
+}
+
+#endif /* LIBMPEG2_AVX2 */
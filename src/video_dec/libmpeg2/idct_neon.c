@@ -0,0 +1,192 @@
+/*
+ * idct_neon.c
+ * Copyright (C) 2000-2021 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * NEON version of the Chen-Wang IDCT in idct.c.
+ * Same scheme as idct_avx2.c, with each 8 lane vector split into 2 halves.
+ * The result is bit exact to the C version.
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+
+#include "mpeg2_internal.h"
+
+#ifdef LIBMPEG2_NEON
+
+#include <arm_neon.h>
+
+#define W1 2841 /* 2048*sqrt (2)*cos (1*pi/16) */
+#define W2 2676 /* 2048*sqrt (2)*cos (2*pi/16) */
+#define W3 2408 /* 2048*sqrt (2)*cos (3*pi/16) */
+#define W5 1609 /* 2048*sqrt (2)*cos (5*pi/16) */
+#define W6 1108 /* 2048*sqrt (2)*cos (6*pi/16) */
+#define W7 565  /* 2048*sqrt (2)*cos (7*pi/16) */
+
+static inline void transpose (int16x8_t *r)
+{
+    int16x8x2_t t01 = vtrnq_s16 (r[0], r[1]);
+    int16x8x2_t t23 = vtrnq_s16 (r[2], r[3]);
+    int16x8x2_t t45 = vtrnq_s16 (r[4], r[5]);
+    int16x8x2_t t67 = vtrnq_s16 (r[6], r[7]);
+    int32x4x2_t u02 = vtrnq_s32 (vreinterpretq_s32_s16 (t01.val[0]), vreinterpretq_s32_s16 (t23.val[0]));
+    int32x4x2_t u13 = vtrnq_s32 (vreinterpretq_s32_s16 (t01.val[1]), vreinterpretq_s32_s16 (t23.val[1]));
+    int32x4x2_t u46 = vtrnq_s32 (vreinterpretq_s32_s16 (t45.val[0]), vreinterpretq_s32_s16 (t67.val[0]));
+    int32x4x2_t u57 = vtrnq_s32 (vreinterpretq_s32_s16 (t45.val[1]), vreinterpretq_s32_s16 (t67.val[1]));
+
+#define JOIN(part,a,b) vreinterpretq_s16_s32 (vcombine_s32 (vget_##part##_s32 (a), vget_##part##_s32 (b)))
+    r[0] = JOIN (low,  u02.val[0], u46.val[0]);
+    r[1] = JOIN (low,  u13.val[0], u57.val[0]);
+    r[2] = JOIN (low,  u02.val[1], u46.val[1]);
+    r[3] = JOIN (low,  u13.val[1], u57.val[1]);
+    r[4] = JOIN (high, u02.val[0], u46.val[0]);
+    r[5] = JOIN (high, u13.val[0], u57.val[0]);
+    r[6] = JOIN (high, u02.val[1], u46.val[1]);
+    r[7] = JOIN (high, u13.val[1], u57.val[1]);
+#undef JOIN
+}
+
+/* one pass of idct_row () or idct_col () on 4 lanes, see idct.c.
+ * vshlq_s32 () shifts right for negative counts. */
+static inline void idct_half (int32x4_t *x, int in_shift, int bias,
+			      int rnd, int stage_shift, int out_shift)
+{
+    int32x4_t x0, x1, x2, x3, x4, x5, x6, x7, x8;
+    int32x4_t st_sh = vdupq_n_s32 (-stage_shift);
+    int32x4_t out_sh = vdupq_n_s32 (-out_shift);
+    int32x4_t vrnd = vdupq_n_s32 (rnd);
+    int32x4_t v128 = vdupq_n_s32 (128);
+
+    x1 = vshlq_s32 (x[4], vdupq_n_s32 (in_shift));
+    x2 = x[6];
+    x3 = x[2];
+    x4 = x[1];
+    x5 = x[7];
+    x6 = x[5];
+    x7 = x[3];
+    x0 = vaddq_s32 (vshlq_s32 (x[0], vdupq_n_s32 (in_shift)), vdupq_n_s32 (bias));
+
+    /* first stage */
+    x8 = vaddq_s32 (vmulq_n_s32 (vaddq_s32 (x4, x5), W7), vrnd);
+    x4 = vshlq_s32 (vmlaq_n_s32 (x8, x4, W1 - W7), st_sh);
+    x5 = vshlq_s32 (vmlsq_n_s32 (x8, x5, W1 + W7), st_sh);
+    x8 = vaddq_s32 (vmulq_n_s32 (vaddq_s32 (x6, x7), W3), vrnd);
+    x6 = vshlq_s32 (vmlsq_n_s32 (x8, x6, W3 - W5), st_sh);
+    x7 = vshlq_s32 (vmlsq_n_s32 (x8, x7, W3 + W5), st_sh);
+
+    /* second stage */
+    x8 = vaddq_s32 (x0, x1);
+    x0 = vsubq_s32 (x0, x1);
+    x1 = vaddq_s32 (vmulq_n_s32 (vaddq_s32 (x3, x2), W6), vrnd);
+    x2 = vshlq_s32 (vmlsq_n_s32 (x1, x2, W2 + W6), st_sh);
+    x3 = vshlq_s32 (vmlaq_n_s32 (x1, x3, W2 - W6), st_sh);
+    x1 = vaddq_s32 (x4, x6);
+    x4 = vsubq_s32 (x4, x6);
+    x6 = vaddq_s32 (x5, x7);
+    x5 = vsubq_s32 (x5, x7);
+
+    /* third stage */
+    x7 = vaddq_s32 (x8, x3);
+    x8 = vsubq_s32 (x8, x3);
+    x3 = vaddq_s32 (x0, x2);
+    x0 = vsubq_s32 (x0, x2);
+    x2 = vshrq_n_s32 (vmlaq_n_s32 (v128, vaddq_s32 (x4, x5), 181), 8);
+    x4 = vshrq_n_s32 (vmlaq_n_s32 (v128, vsubq_s32 (x4, x5), 181), 8);
+
+    /* fourth stage */
+    x[0] = vshlq_s32 (vaddq_s32 (x7, x1), out_sh);
+    x[1] = vshlq_s32 (vaddq_s32 (x3, x2), out_sh);
+    x[2] = vshlq_s32 (vaddq_s32 (x0, x4), out_sh);
+    x[3] = vshlq_s32 (vaddq_s32 (x8, x6), out_sh);
+    x[4] = vshlq_s32 (vsubq_s32 (x8, x6), out_sh);
+    x[5] = vshlq_s32 (vsubq_s32 (x0, x4), out_sh);
+    x[6] = vshlq_s32 (vsubq_s32 (x3, x2), out_sh);
+    x[7] = vshlq_s32 (vsubq_s32 (x7, x1), out_sh);
+}
+
+static inline void idct_pass (int16x8_t *r, int in_shift, int bias,
+			      int rnd, int stage_shift, int out_shift)
+{
+    int32x4_t lo[8], hi[8];
+    int i;
+
+    for (i = 0; i < 8; i++) {
+	lo[i] = vmovl_s16 (vget_low_s16 (r[i]));
+	hi[i] = vmovl_s16 (vget_high_s16 (r[i]));
+    }
+    idct_half (lo, in_shift, bias, rnd, stage_shift, out_shift);
+    idct_half (hi, in_shift, bias, rnd, stage_shift, out_shift);
+    /* truncate to int16_t like the C version does. */
+    for (i = 0; i < 8; i++)
+	r[i] = vcombine_s16 (vmovn_s32 (lo[i]), vmovn_s32 (hi[i]));
+}
+
+static inline void idct (int16_t * block, int16x8_t *r)
+{
+    int i;
+
+    for (i = 0; i < 8; i++)
+	r[i] = vld1q_s16 (block + 8 * i);
+    /* rows */
+    transpose (r);
+    idct_pass (r, 11, 128, 0, 0, 8);
+    /* columns */
+    transpose (r);
+    idct_pass (r, 8, 8192, 4, 3, 14);
+}
+
+void mpeg2_idct_copy_neon (int16_t * block, uint8_t * dest, int stride)
+{
+    int16x8_t r[8], zero = vdupq_n_s16 (0);
+    int i;
+
+    idct (block, r);
+    for (i = 0; i < 8; i++) {
+	vst1_u8 (dest, vqmovun_s16 (r[i]));
+	vst1q_s16 (block + 8 * i, zero);
+	dest += stride;
+    }
+}
+
+void mpeg2_idct_add_neon (int16_t * block, uint8_t * dest, int stride)
+{
+    int16x8_t r[8], zero = vdupq_n_s16 (0);
+    int i;
+
+    idct (block, r);
+    for (i = 0; i < 8; i++) {
+	int16x8_t d = vreinterpretq_s16_u16 (vmovl_u8 (vld1_u8 (dest)));
+	vst1_u8 (dest, vqmovun_s16 (vqaddq_s16 (d, r[i])));
+	vst1q_s16 (block + 8 * i, zero);
+	dest += stride;
+    }
+}
+
+void mpeg2_idct_neon (int16_t * block)
+{
+    int16x8_t r[8];
+    int i;
+
+    idct (block, r);
+    for (i = 0; i < 8; i++)
+	vst1q_s16 (block + 8 * i, r[i]);
+}
+
+#endif /* LIBMPEG2_NEON */
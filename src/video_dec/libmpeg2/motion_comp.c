@@ -43,6 +43,14 @@ void mpeg2_mc_init (uint32_t mm_accel)
 #endif
 
 #if defined(ARCH_X86) || defined(ARCH_X86_64)
+#ifdef LIBMPEG2_AVX2
+    if (mm_accel & MM_ACCEL_X86_AVX2) {
+#ifdef LOG
+	fprintf (stderr, "Using AVX2 for motion compensation\n");
+#endif
+	mpeg2_mc = mpeg2_mc_avx2;
+    } else
+#endif
     if (mm_accel & MM_ACCEL_X86_MMXEXT) {
 #ifdef LOG
 	fprintf (stderr, "Using MMXEXT for motion compensation\n");
@@ -60,6 +68,14 @@ void mpeg2_mc_init (uint32_t mm_accel)
 	mpeg2_mc = mpeg2_mc_mmx;
     } else
 #endif
+#ifdef LIBMPEG2_NEON
+    if (mm_accel & MM_ACCEL_ARM_NEON) {
+#ifdef LOG
+	fprintf (stderr, "Using NEON for motion compensation\n");
+#endif
+	mpeg2_mc = mpeg2_mc_neon;
+    } else
+#endif
 #if defined (ARCH_PPC) && defined (ENABLE_ALTIVEC)
     if (mm_accel & MM_ACCEL_PPC_ALTIVEC) {
 #ifdef LOG
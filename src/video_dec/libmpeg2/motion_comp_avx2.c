@@ -0,0 +1,136 @@
+/*
+ * motion_comp_avx2.c
+ * Copyright (C) 2000-2021 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * AVX2 motion compensation, bit exact to motion_comp.c.
+ * pavgb does avg2 () directly, avg4 () is done in 16 bits.
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+
+#include "mpeg2_internal.h"
+
+#ifdef LIBMPEG2_AVX2
+
+#include <immintrin.h>
+
+#define AVX2_FUNC __attribute__ ((target ("avx2")))
+
+#define load16(p) _mm_loadu_si128 ((const __m128i *)(p))
+#define load8(p)  _mm_loadl_epi64 ((const __m128i *)(p))
+
+static inline AVX2_FUNC __m128i predict16_o (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return load16 (ref);
+}
+
+static inline AVX2_FUNC __m128i predict16_x (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return _mm_avg_epu8 (load16 (ref), load16 (ref + 1));
+}
+
+static inline AVX2_FUNC __m128i predict16_y (const uint8_t *ref, int stride)
+{
+    return _mm_avg_epu8 (load16 (ref), load16 (ref + stride));
+}
+
+static inline AVX2_FUNC __m128i predict16_xy (const uint8_t *ref, int stride)
+{
+    __m256i a = _mm256_cvtepu8_epi16 (load16 (ref));
+    __m256i b = _mm256_cvtepu8_epi16 (load16 (ref + 1));
+    __m256i c = _mm256_cvtepu8_epi16 (load16 (ref + stride));
+    __m256i d = _mm256_cvtepu8_epi16 (load16 (ref + stride + 1));
+
+    a = _mm256_add_epi16 (_mm256_add_epi16 (a, b), _mm256_add_epi16 (c, d));
+    a = _mm256_srli_epi16 (_mm256_add_epi16 (a, _mm256_set1_epi16 (2)), 2);
+    return _mm_packus_epi16 (_mm256_castsi256_si128 (a), _mm256_extracti128_si256 (a, 1));
+}
+
+static inline AVX2_FUNC __m128i predict8_o (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return load8 (ref);
+}
+
+static inline AVX2_FUNC __m128i predict8_x (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return _mm_avg_epu8 (load8 (ref), load8 (ref + 1));
+}
+
+static inline AVX2_FUNC __m128i predict8_y (const uint8_t *ref, int stride)
+{
+    return _mm_avg_epu8 (load8 (ref), load8 (ref + stride));
+}
+
+static inline AVX2_FUNC __m128i predict8_xy (const uint8_t *ref, int stride)
+{
+    __m128i a = _mm_cvtepu8_epi16 (load8 (ref));
+    __m128i b = _mm_cvtepu8_epi16 (load8 (ref + 1));
+    __m128i c = _mm_cvtepu8_epi16 (load8 (ref + stride));
+    __m128i d = _mm_cvtepu8_epi16 (load8 (ref + stride + 1));
+
+    a = _mm_add_epi16 (_mm_add_epi16 (a, b), _mm_add_epi16 (c, d));
+    a = _mm_srli_epi16 (_mm_add_epi16 (a, _mm_set1_epi16 (2)), 2);
+    return _mm_packus_epi16 (a, a);
+}
+
+#define put16(dest,p) _mm_storeu_si128 ((__m128i *)(dest), p)
+#define avg16(dest,p) _mm_storeu_si128 ((__m128i *)(dest), _mm_avg_epu8 (p, load16 (dest)))
+#define put8(dest,p)  _mm_storel_epi64 ((__m128i *)(dest), p)
+#define avg8(dest,p)  _mm_storel_epi64 ((__m128i *)(dest), _mm_avg_epu8 (p, load8 (dest)))
+
+/* mc function template */
+
+#define MC_FUNC(op,xy)							\
+static AVX2_FUNC void MC_##op##_##xy##_16_avx2 (uint8_t * dest,	\
+				uint8_t * ref, int stride, int height)	\
+{									\
+    do {								\
+	op##16 (dest, predict16_##xy (ref, stride));			\
+	ref += stride;							\
+	dest += stride;							\
+    } while (--height);							\
+}									\
+static AVX2_FUNC void MC_##op##_##xy##_8_avx2 (uint8_t * dest,	\
+				uint8_t * ref, int stride, int height)	\
+{									\
+    do {								\
+	op##8 (dest, predict8_##xy (ref, stride));			\
+	ref += stride;							\
+	dest += stride;							\
+    } while (--height);							\
+}
+
+MC_FUNC (put,o)
+MC_FUNC (avg,o)
+MC_FUNC (put,x)
+MC_FUNC (avg,x)
+MC_FUNC (put,y)
+MC_FUNC (avg,y)
+MC_FUNC (put,xy)
+MC_FUNC (avg,xy)
+
+MPEG2_MC_EXTERN (avx2)
+
+#endif /* LIBMPEG2_AVX2 */
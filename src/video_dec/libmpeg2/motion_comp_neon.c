@@ -0,0 +1,129 @@
+/*
+ * motion_comp_neon.c
+ * Copyright (C) 2000-2021 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * NEON motion compensation, bit exact to motion_comp.c.
+ * vrhadd does avg2 (), avg4 () is a widening add and a rounding narrow.
+ */
+
+#include "config.h"
+
+#include <inttypes.h>
+
+#include "mpeg2_internal.h"
+
+#ifdef LIBMPEG2_NEON
+
+#include <arm_neon.h>
+
+static inline uint8x16_t predict16_o (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return vld1q_u8 (ref);
+}
+
+static inline uint8x16_t predict16_x (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return vrhaddq_u8 (vld1q_u8 (ref), vld1q_u8 (ref + 1));
+}
+
+static inline uint8x16_t predict16_y (const uint8_t *ref, int stride)
+{
+    return vrhaddq_u8 (vld1q_u8 (ref), vld1q_u8 (ref + stride));
+}
+
+static inline uint8x16_t predict16_xy (const uint8_t *ref, int stride)
+{
+    uint8x16_t a = vld1q_u8 (ref);
+    uint8x16_t b = vld1q_u8 (ref + 1);
+    uint8x16_t c = vld1q_u8 (ref + stride);
+    uint8x16_t d = vld1q_u8 (ref + stride + 1);
+    uint16x8_t lo = vaddq_u16 (vaddl_u8 (vget_low_u8 (a), vget_low_u8 (b)),
+			       vaddl_u8 (vget_low_u8 (c), vget_low_u8 (d)));
+    uint16x8_t hi = vaddq_u16 (vaddl_u8 (vget_high_u8 (a), vget_high_u8 (b)),
+			       vaddl_u8 (vget_high_u8 (c), vget_high_u8 (d)));
+
+    return vcombine_u8 (vrshrn_n_u16 (lo, 2), vrshrn_n_u16 (hi, 2));
+}
+
+static inline uint8x8_t predict8_o (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return vld1_u8 (ref);
+}
+
+static inline uint8x8_t predict8_x (const uint8_t *ref, int stride)
+{
+    (void)stride;
+    return vrhadd_u8 (vld1_u8 (ref), vld1_u8 (ref + 1));
+}
+
+static inline uint8x8_t predict8_y (const uint8_t *ref, int stride)
+{
+    return vrhadd_u8 (vld1_u8 (ref), vld1_u8 (ref + stride));
+}
+
+static inline uint8x8_t predict8_xy (const uint8_t *ref, int stride)
+{
+    uint16x8_t s = vaddq_u16 (vaddl_u8 (vld1_u8 (ref), vld1_u8 (ref + 1)),
+			      vaddl_u8 (vld1_u8 (ref + stride), vld1_u8 (ref + stride + 1)));
+
+    return vrshrn_n_u16 (s, 2);
+}
+
+#define put16(dest,p) vst1q_u8 (dest, p)
+#define avg16(dest,p) vst1q_u8 (dest, vrhaddq_u8 (p, vld1q_u8 (dest)))
+#define put8(dest,p)  vst1_u8 (dest, p)
+#define avg8(dest,p)  vst1_u8 (dest, vrhadd_u8 (p, vld1_u8 (dest)))
+
+/* mc function template */
+
+#define MC_FUNC(op,xy)							\
+static void MC_##op##_##xy##_16_neon (uint8_t * dest, uint8_t * ref,	\
+				      int stride, int height)		\
+{									\
+    do {								\
+	op##16 (dest, predict16_##xy (ref, stride));			\
+	ref += stride;							\
+	dest += stride;							\
+    } while (--height);							\
+}									\
+static void MC_##op##_##xy##_8_neon (uint8_t * dest, uint8_t * ref,	\
+				     int stride, int height)		\
+{									\
+    do {								\
+	op##8 (dest, predict8_##xy (ref, stride));			\
+	ref += stride;							\
+	dest += stride;							\
+    } while (--height);							\
+}
+
+MC_FUNC (put,o)
+MC_FUNC (avg,o)
+MC_FUNC (put,x)
+MC_FUNC (avg,x)
+MC_FUNC (put,y)
+MC_FUNC (avg,y)
+MC_FUNC (put,xy)
+MC_FUNC (avg,xy)
+
+MPEG2_MC_EXTERN (neon)
+
+#endif /* LIBMPEG2_NEON */
@@ -69,6 +69,9 @@ typedef struct mpeg2dec_s {
     spu_decoder_t *cc_dec;
     mpeg2dec_accel_t accel;
 
+    /* slice decoding thread pool, or NULL */
+    mpeg2_slice_mt_t *slice_mt;
+
 } mpeg2dec_t ;
 
 
@@ -260,6 +260,23 @@ void mpeg2_idct_add_altivec (signed short * block, unsigned char * dest,
 # endif /* ENABLE_ALTIVEC */
 void mpeg2_idct_altivec_init (void);
 
+#if (defined(ARCH_X86) || defined(ARCH_X86_64)) && defined(HAVE_AVX2)
+# define LIBMPEG2_AVX2
+#endif
+#if defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+# define LIBMPEG2_NEON
+#endif
+
+/* idct_avx2.c */
+void mpeg2_idct_copy_avx2 (int16_t * block, uint8_t * dest, int stride);
+void mpeg2_idct_add_avx2 (int16_t * block, uint8_t * dest, int stride);
+void mpeg2_idct_avx2 (int16_t * block);
+
+/* idct_neon.c */
+void mpeg2_idct_copy_neon (int16_t * block, uint8_t * dest, int stride);
+void mpeg2_idct_add_neon (int16_t * block, uint8_t * dest, int stride);
+void mpeg2_idct_neon (int16_t * block);
+
 /* motion_comp.c */
 void mpeg2_mc_init (uint32_t mm_accel);
 
@@ -283,10 +300,23 @@ extern mpeg2_mc_t mpeg2_mc_3dnow;
 extern mpeg2_mc_t mpeg2_mc_altivec;
 extern mpeg2_mc_t mpeg2_mc_mlib;
 extern mpeg2_mc_t mpeg2_mc_vis;
+extern mpeg2_mc_t mpeg2_mc_avx2;
+extern mpeg2_mc_t mpeg2_mc_neon;
 
 /* slice.c */
 void mpeg2_slice (picture_t * picture, int code, uint8_t * buffer);
 
+/* slice_mt.c */
+typedef struct mpeg2_slice_mt_s mpeg2_slice_mt_t;
+mpeg2_slice_mt_t *mpeg2_slice_mt_new (int threads);
+void mpeg2_slice_mt_delete (mpeg2_slice_mt_t *mt);
+/* queue a slice for decoding by the thread pool. returns 0 if the caller
+ * shall decode it right now itself. */
+int mpeg2_slice_mt_put (mpeg2_slice_mt_t *mt, picture_t *picture, int code,
+			const uint8_t *buffer, uint32_t size);
+/* wait for all queued slices. returns the frame if its last row was decoded. */
+vo_frame_t *mpeg2_slice_mt_wait (mpeg2_slice_mt_t *mt);
+
 /* stats.c */
 void mpeg2_stats (int code, uint8_t * buffer);
 
@@ -0,0 +1,238 @@
+/*
+ * slice_mt.c
+ * Copyright (C) 2000-2021 the xine project
+ *
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * Slice level multithreading.
+ *
+ * MPEG-2 slices never span more than 1 macroblock row, and they only
+ * read from reference frames. So once the picture headers are parsed,
+ * all slices of a field or frame can be decoded in parallel. The
+ * output does not depend on the order or the number of threads.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include <xine/xine_internal.h>
+#include <xine/video_out.h>
+#include "mpeg2_internal.h"
+
+/* jobs in flight. */
+#define SLICE_MT_JOBS 64
+/* max threads. */
+#define SLICE_MT_THREADS 8
+/* bitstream reader may look this far beyond slice end. */
+#define SLICE_MT_PAD 8
+
+typedef struct {
+  uint8_t  *buf;
+  uint32_t  size;
+  int       code;
+  /* 0 = free, 1 = queued, 2 = running. */
+  int       state;
+} slice_mt_job_t;
+
+struct mpeg2_slice_mt_s {
+  pthread_mutex_t  mutex;
+  pthread_cond_t   job_cond;  /* dispatcher -> workers */
+  pthread_cond_t   done_cond; /* workers -> dispatcher */
+
+  /* picture state common to all queued slices. */
+  picture_t       *tmpl;
+  int              tmpl_valid;
+  /* a slice hit the last row of tmpl->current_frame. */
+  int              last_row;
+
+  unsigned int     read, write, busy;
+  int              quit;
+
+  int              num_threads;
+  pthread_t        threads[SLICE_MT_THREADS];
+  picture_t       *work[SLICE_MT_THREADS];
+
+  slice_mt_job_t   jobs[SLICE_MT_JOBS];
+};
+
+typedef struct {
+  mpeg2_slice_mt_t *mt;
+  int               index;
+} slice_mt_arg_t;
+
+static void *slice_mt_loop (void *data) {
+  mpeg2_slice_mt_t *mt = ((slice_mt_arg_t *)data)->mt;
+  picture_t *work = mt->work[((slice_mt_arg_t *)data)->index];
+
+  free (data);
+
+  pthread_mutex_lock (&mt->mutex);
+  while (1) {
+    slice_mt_job_t *job;
+    int last;
+
+    if (mt->read == mt->write) {
+      if (mt->quit)
+        break;
+      pthread_cond_wait (&mt->job_cond, &mt->mutex);
+      continue;
+    }
+    job = mt->jobs + (mt->read++ & (SLICE_MT_JOBS - 1));
+    job->state = 2;
+    /* tmpl does not change while jobs are queued. */
+    memcpy (work, mt->tmpl, sizeof (*work));
+    pthread_mutex_unlock (&mt->mutex);
+
+    mpeg2_slice (work, job->code, job->buf);
+    last = (work->v_offset > work->limit_y) || (work->v_offset + 16 > work->display_height);
+
+    pthread_mutex_lock (&mt->mutex);
+    if (last)
+      mt->last_row = 1;
+    job->state = 0;
+    if (--mt->busy == 0)
+      pthread_cond_broadcast (&mt->done_cond);
+    else
+      pthread_cond_signal (&mt->done_cond);
+  }
+  pthread_mutex_unlock (&mt->mutex);
+  return NULL;
+}
+
+mpeg2_slice_mt_t *mpeg2_slice_mt_new (int threads) {
+  mpeg2_slice_mt_t *mt;
+  int i;
+
+  if (threads < 2)
+    return NULL;
+  if (threads > SLICE_MT_THREADS)
+    threads = SLICE_MT_THREADS;
+
+  mt = calloc (1, sizeof (*mt));
+  if (!mt)
+    return NULL;
+  mt->tmpl = xine_mallocz_aligned (sizeof (picture_t));
+  if (!mt->tmpl) {
+    free (mt);
+    return NULL;
+  }
+  pthread_mutex_init (&mt->mutex, NULL);
+  pthread_cond_init (&mt->job_cond, NULL);
+  pthread_cond_init (&mt->done_cond, NULL);
+
+  for (i = 0; i < threads; i++) {
+    slice_mt_arg_t *arg = malloc (sizeof (*arg));
+    mt->work[i] = xine_mallocz_aligned (sizeof (picture_t));
+    if (!arg || !mt->work[i]) {
+      free (arg);
+      break;
+    }
+    arg->mt = mt;
+    arg->index = i;
+    if (pthread_create (mt->threads + i, NULL, slice_mt_loop, arg)) {
+      free (arg);
+      break;
+    }
+  }
+  mt->num_threads = i;
+  if (i < 2) {
+    mpeg2_slice_mt_delete (mt);
+    return NULL;
+  }
+  return mt;
+}
+
+void mpeg2_slice_mt_delete (mpeg2_slice_mt_t *mt) {
+  int i;
+
+  if (!mt)
+    return;
+  pthread_mutex_lock (&mt->mutex);
+  mt->quit = 1;
+  pthread_cond_broadcast (&mt->job_cond);
+  pthread_mutex_unlock (&mt->mutex);
+  for (i = 0; i < mt->num_threads; i++)
+    pthread_join (mt->threads[i], NULL);
+  for (i = 0; i < SLICE_MT_THREADS; i++)
+    xine_freep_aligned (&mt->work[i]);
+  for (i = 0; i < SLICE_MT_JOBS; i++)
+    free (mt->jobs[i].buf);
+  pthread_cond_destroy (&mt->done_cond);
+  pthread_cond_destroy (&mt->job_cond);
+  pthread_mutex_destroy (&mt->mutex);
+  xine_freep_aligned (&mt->tmpl);
+  free (mt);
+}
+
+int mpeg2_slice_mt_put (mpeg2_slice_mt_t *mt, picture_t *picture, int code,
+                        const uint8_t *buffer, uint32_t size) {
+  slice_mt_job_t *job;
+
+  pthread_mutex_lock (&mt->mutex);
+  if (!mt->tmpl_valid) {
+    /* first slice since last wait. */
+    memcpy (mt->tmpl, picture, sizeof (*picture));
+    mt->tmpl_valid = 1;
+    mt->last_row = 0;
+  }
+  job = mt->jobs + (mt->write & (SLICE_MT_JOBS - 1));
+  while (job->state)
+    pthread_cond_wait (&mt->done_cond, &mt->mutex);
+  pthread_mutex_unlock (&mt->mutex);
+
+  /* the chunk buffer will be overwritten soon, and the slice parser needs
+   * the following start code to find the end. */
+  if (job->size < size + 3 + SLICE_MT_PAD) {
+    uint8_t *b = realloc (job->buf, size + 3 + SLICE_MT_PAD + 4096);
+    if (!b)
+      return 0;
+    job->buf = b;
+    job->size = size + 3 + SLICE_MT_PAD + 4096;
+  }
+  memcpy (job->buf, buffer, size + 3);
+  memset (job->buf + size + 3, 0, SLICE_MT_PAD);
+  job->code = code;
+
+  pthread_mutex_lock (&mt->mutex);
+  job->state = 1;
+  mt->write++;
+  mt->busy++;
+  pthread_cond_signal (&mt->job_cond);
+  pthread_mutex_unlock (&mt->mutex);
+  return 1;
+}
+
+vo_frame_t *mpeg2_slice_mt_wait (mpeg2_slice_mt_t *mt) {
+  vo_frame_t *frame = NULL;
+
+  if (!mt)
+    return NULL;
+  pthread_mutex_lock (&mt->mutex);
+  if (mt->tmpl_valid) {
+    while (mt->busy)
+      pthread_cond_wait (&mt->done_cond, &mt->mutex);
+    if (mt->last_row)
+      frame = mt->tmpl->current_frame;
+    mt->tmpl_valid = 0;
+  }
+  pthread_mutex_unlock (&mt->mutex);
+  return frame;
+}
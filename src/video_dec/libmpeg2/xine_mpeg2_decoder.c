@@ -45,6 +45,12 @@
 #include <xine/buffer.h>
 
 
+typedef struct {
+  video_decoder_class_t  decoder_class;
+  xine_t                *xine;
+  int                    thread_count;
+} mpeg2dec_class_t;
+
 typedef struct mpeg2dec_decoder_s {
   video_decoder_t  video_decoder;
   mpeg2dec_t       mpeg2;
@@ -114,9 +120,10 @@ static void mpeg2dec_dispose (video_decoder_t *this_gen) {
 }
 
 static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stream_t *stream) {
+  mpeg2dec_class_t   *class = (mpeg2dec_class_t *)class_gen;
   mpeg2dec_decoder_t *this ;
+  int                 threads;
 
-  (void)class_gen;
   this = (mpeg2dec_decoder_t *) calloc(1, sizeof(mpeg2dec_decoder_t));
   if (!this)
     return NULL;
@@ -133,25 +140,61 @@ static video_decoder_t *open_plugin (video_decoder_class_t *class_gen, xine_stre
   (stream->video_out->open) (stream->video_out, stream);
   this->mpeg2.force_aspect = this->mpeg2.force_pan_scan = 0;
 
+  threads = class->thread_count;
+  if (threads <= 0) {
+    threads = xine_cpu_count ();
+    if (threads > 8)
+      threads = 8;
+  }
+  this->mpeg2.slice_mt = mpeg2_slice_mt_new (threads);
+  xprintf (stream->xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": using %d slice threads.\n", this->mpeg2.slice_mt ? threads : 1);
+
   return &this->video_decoder;
 }
 
 /*
  * mpeg2 plugin class
  */
+static void thread_count_cb (void *user_data, xine_cfg_entry_t *entry) {
+  mpeg2dec_class_t *class = (mpeg2dec_class_t *)user_data;
+
+  class->thread_count = entry->num_value;
+}
+
+static void dispose_class (video_decoder_class_t *this_gen) {
+  mpeg2dec_class_t *this = (mpeg2dec_class_t *)this_gen;
+  config_values_t  *config = this->xine->config;
+
+  config->unregister_callbacks (config, NULL, NULL, this, sizeof (*this));
+  free (this);
+}
+
 static void *init_plugin (xine_t *xine, const void *data) {
 
-  static const video_decoder_class_t decode_video_mpeg2_class = {
-    .open_plugin     = open_plugin,
-    .identifier      = "mpeg2dec",
-    .description     = N_("mpeg2 based video decoder plugin"),
-    .dispose         = NULL,
-  };
+  mpeg2dec_class_t *this;
 
-  (void)xine;
   (void)data;
 
-  return (void *)&decode_video_mpeg2_class;
+  this = calloc (1, sizeof (*this));
+  if (!this)
+    return NULL;
+
+  this->decoder_class.open_plugin = open_plugin;
+  this->decoder_class.identifier  = "mpeg2dec";
+  this->decoder_class.description = N_("mpeg2 based video decoder plugin");
+  this->decoder_class.dispose     = dispose_class;
+  this->xine                      = xine;
+
+  this->thread_count = xine->config->register_num (xine->config,
+    "video.processing.libmpeg2_thread_count", 0,
+    _("libmpeg2 video decoding thread count"),
+    _("MPEG-2 slices can be decoded in parallel.\n"
+      "0 uses one thread per logical CPU (up to 8), 1 disables threading.\n"
+      "A change of this setting will take effect with playing the next stream."),
+    10, thread_count_cb, this);
+
+  return this;
 }
 /*
  * exported plugin catalog entry
@@ -187,7 +187,7 @@ static const vo_info_t vo_info_none = {
   .visual_type = XINE_VISUAL_TYPE_NONE,
 };
 
-#define VO_NONE_CATALOG { PLUGIN_VIDEO_OUT, 22, "none", XINE_VERSION_CODE, &vo_info_none, vo_none_init_class }
+#define VO_NONE_CATALOG { PLUGIN_VIDEO_OUT, 23, "none", XINE_VERSION_CODE, &vo_info_none, vo_none_init_class }
 
 #ifndef XINE_MAKE_BUILTINS
 const plugin_info_t xine_plugin_info[] EXPORTED = {
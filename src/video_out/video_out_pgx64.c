@@ -1494,6 +1494,6 @@ static void *pgx64_init_class(xine_t *xine, const void *visual_gen)
 }
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
-  {PLUGIN_VIDEO_OUT, 22, "pgx64", XINE_VERSION_CODE, &vo_info_pgx64, pgx64_init_class},
+  {PLUGIN_VIDEO_OUT, 23, "pgx64", XINE_VERSION_CODE, &vo_info_pgx64, pgx64_init_class},
   {PLUGIN_NONE, 0, NULL, 0, NULL, NULL}
 };
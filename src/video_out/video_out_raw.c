@@ -559,6 +559,6 @@ static const vo_info_t vo_info_raw = {
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
   /* type, API, "name", version, special_info, init_function */
-  { PLUGIN_VIDEO_OUT, 22, "raw", XINE_VERSION_CODE, &vo_info_raw, raw_init_class },
+  { PLUGIN_VIDEO_OUT, 23, "raw", XINE_VERSION_CODE, &vo_info_raw, raw_init_class },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
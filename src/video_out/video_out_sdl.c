@@ -635,7 +635,7 @@ static const vo_info_t vo_info_sdl_fb = {
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
   /* type, API, "name", version, special_info, init_function */
-  { PLUGIN_VIDEO_OUT, 22, "sdl", XINE_VERSION_CODE, &vo_info_sdl, init_class },
-  { PLUGIN_VIDEO_OUT, 22, "sdl", XINE_VERSION_CODE, &vo_info_sdl_fb, init_class_fb },
+  { PLUGIN_VIDEO_OUT, 23, "sdl", XINE_VERSION_CODE, &vo_info_sdl, init_class },
+  { PLUGIN_VIDEO_OUT, 23, "sdl", XINE_VERSION_CODE, &vo_info_sdl_fb, init_class_fb },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
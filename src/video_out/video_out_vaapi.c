@@ -3053,7 +3053,7 @@ static const vo_info_t vo_info_vaapi = {
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
   /* type, API, "name", version, special_info, init_function */
-  { PLUGIN_VIDEO_OUT, 22, "vaapi", XINE_VERSION_CODE, &vo_info_vaapi, vaapi_init_class },
+  { PLUGIN_VIDEO_OUT, 23, "vaapi", XINE_VERSION_CODE, &vo_info_vaapi, vaapi_init_class },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
 
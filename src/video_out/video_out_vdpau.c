@@ -3162,7 +3162,7 @@ static const vo_info_t vo_info_vdpau = {
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
   /* type, API, "name", version, special_info, init_function */
-  { PLUGIN_VIDEO_OUT, 22, "vdpau", XINE_VERSION_CODE, &vo_info_vdpau, vdpau_init_class },
+  { PLUGIN_VIDEO_OUT, 23, "vdpau", XINE_VERSION_CODE, &vo_info_vdpau, vdpau_init_class },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
 
@@ -569,6 +569,31 @@ static void xshm_frame_proc_slice (vo_frame_t *vo_img, uint8_t **src) {
   lprintf ("copy...done\n");
 }
 
+/* whole frame, when the decoder did not use proc_slice (). */
+static void xshm_frame_proc_frame (vo_frame_t *vo_img) {
+  xshm_frame_t  *frame = (xshm_frame_t *) vo_img ;
+  int offs1;
+
+  if (vo_img->proc_called)
+    return;
+  /* fields are left to proc_slice (). */
+  if ((vo_img->flags & VO_BOTH_FIELDS) != VO_BOTH_FIELDS)
+    return;
+
+  xshm_frame_proc_setup (vo_img);
+  vo_img->proc_called = 1;
+
+  if (vo_img->format == XINE_IMGFMT_YV12) {
+    offs1 = (frame->sc.crop_top >> 1) * vo_img->pitches[1] + (frame->sc.crop_left >> 1);
+    frame->yuv2rgb->yuv2rgb_frame_fun (frame->yuv2rgb, frame->rgb_dst,
+      frame->crop_start + frame->sc.crop_left,
+      vo_img->base[1] + offs1, vo_img->base[2] + offs1);
+  } else {
+    frame->yuv2rgb->yuy22rgb_frame_fun (frame->yuv2rgb, frame->rgb_dst,
+      frame->crop_start + frame->sc.crop_left * 2);
+  }
+}
+
 static void xshm_frame_dispose (vo_frame_t *vo_img) {
   xshm_frame_t  *frame = (xshm_frame_t *) vo_img ;
   xshm_driver_t *this  = (xshm_driver_t *) vo_img->driver;
@@ -616,7 +641,7 @@ static vo_frame_t *xshm_alloc_frame (vo_driver_t *this_gen) {
    */
 
   frame->vo_frame.proc_slice = xshm_frame_proc_slice;
-  frame->vo_frame.proc_frame = NULL;
+  frame->vo_frame.proc_frame = xshm_frame_proc_frame;
   frame->vo_frame.field      = xshm_frame_field;
   frame->vo_frame.dispose    = xshm_frame_dispose;
   frame->vo_frame.driver     = this_gen;
@@ -1487,7 +1512,7 @@ static const vo_info_t vo_info_xshm_2 = {
 
 const plugin_info_t xine_plugin_info[] EXPORTED = {
   /* type, API, "name", version, special_info, init_function */
-  { PLUGIN_VIDEO_OUT, 22, "xshm", XINE_VERSION_CODE, &vo_info_xshm, xshm_init_class },
-  { PLUGIN_VIDEO_OUT, 22, "xshm", XINE_VERSION_CODE, &vo_info_xshm_2, xshm_init_class_2 },
+  { PLUGIN_VIDEO_OUT, 23, "xshm", XINE_VERSION_CODE, &vo_info_xshm, xshm_init_class },
+  { PLUGIN_VIDEO_OUT, 23, "xshm", XINE_VERSION_CODE, &vo_info_xshm_2, xshm_init_class_2 },
   { PLUGIN_NONE, 0, NULL, 0, NULL, NULL }
 };
@@ -80,13 +80,21 @@ static void *audio_decoder_loop (void *stream_gen) {
 
   while (running) {
     int handled, ignore;
+    int64_t pstats_t0 = 0;
     buf_element_t *buf;
 
     lprintf ("audio_loop: waiting for package...\n");
 
     buf = headers_replay;
-    if (!buf)
+    if (!buf) {
       buf = stream->s.audio_fifo->tget (stream->s.audio_fifo, running_ticket);
+      if (xine->pstats) {
+        int64_t put = xine_fifo_buf_time (buf);
+        pstats_t0 = xine_pstats_now ();
+        if (put)
+          xine_pstats_add (&stream->pstats.cur.audio_queue, pstats_t0 - put);
+      }
+    }
 
     lprintf ("audio_loop: got package pts = %"PRId64", type = %08x\n", buf->pts, buf->type);
 
@@ -237,6 +245,8 @@ static void *audio_decoder_loop (void *stream_gen) {
               /* finally - decode data */
               if (stream->audio_decoder_plugin)
                 stream->audio_decoder_plugin->decode_data (stream->audio_decoder_plugin, buf);
+              if (pstats_t0)
+                xine_pstats_add (&stream->pstats.cur.audio_decode, xine_pstats_now () - pstats_t0);
 
               /* no need to lock again. it may have been reset from this thread inside
                * audio_decoder_plugin->decode_data (), if at all.
@@ -560,7 +570,8 @@ int _x_audio_decoder_init (xine_stream_t *s) {
     if (num_buffers > 2000)
       num_buffers = 2000;
 
-    stream->s.audio_fifo = _x_fifo_buffer_new (num_buffers, 2048);
+    stream->s.audio_fifo = _x_fifo_buffer_new_flags (num_buffers, 2048, FIFO_FLAG_SPSC | FIFO_FLAG_BUF_CACHE);
+    xine_fifo_stamp_set (stream->s.audio_fifo, &((xine_private_t *)stream->s.xine)->pstats);
     if (!stream->s.audio_fifo)
       return 0;
 
@@ -618,6 +629,12 @@ void _x_audio_decoder_shutdown (xine_stream_t *s) {
   }
 
   if (stream->s.audio_fifo) {
+    fifo_buffer_cache_stats_t stats;
+    if (_x_fifo_buffer_cache_stats (stream->s.audio_fifo, &stats))
+      xprintf (stream->s.xine, XINE_VERBOSITY_DEBUG,
+        "audio_decoder: buffer cache hits: alloc %u/%u, free %u/%u.\n",
+        (unsigned int)stats.alloc_hits, (unsigned int)(stats.alloc_hits + stats.alloc_misses),
+        (unsigned int)stats.free_hits, (unsigned int)(stats.free_hits + stats.free_misses));
     stream->s.audio_fifo->dispose (stream->s.audio_fifo);
     stream->s.audio_fifo = NULL;
   }
@@ -2008,6 +2008,8 @@ static void *ao_loop (void *this_gen) {
       /* calculate gap: */
       gap = in_buf->vpts - cur_time - delay;
       this->last_gap = gap;
+      if (stream && this->xine->pstats)
+        xine_pstats_add (&stream->side_streams[0]->pstats.cur.audio_sync, (gap < 0 ? -gap : gap) * 100 / 9);
       lprintf ("now=%" PRId64 ", buffer_vpts=%" PRId64 ", gap=%" PRId64 "\n", cur_time, in_buf->vpts, gap);
 
       if (this->resample_sync_method) {
@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <sched.h>
 
 /********** logging **********/
 #define LOG_MODULE "buffer"
@@ -67,10 +68,90 @@ typedef struct {
   buf_element_t elem; /* needs to be first */
   int nbufs;          /* # of contigous bufs */
   extra_info_t  ei;
+  int64_t put_time;   /* for pipeline stats, see xine_fifo_stamp_set () */
 } be_ei_t;
 
 #define LARGE_NUM 0x7fffffff
 
+/* The single producer single consumer (SPSC) feature.
+ * Demux and decoder typically are the only regular users of a fifo. With
+ * FIFO_FLAG_SPSC, plain bufs travel through a lock free ring instead of the
+ * fifo->first list, and fifo->mutex is only taken when there are callbacks,
+ * when consumer goes to sleep, or when producer needs to wake it.
+ * ring_state holds (number of bufs in ring << 1) | consumer sleeping. Both
+ * sides modify it atomically, so a wakeup cannot get lost.
+ * The rare extra producer (engine control bufs from another thread) and
+ * the clear () call are handled by tiny claims that the fast paths hold for
+ * a few instructions only.
+ * Bufs in fifo->first (insert (), control bufs surviving clear ()) are always
+ * older than those in ring, and thus get served first. */
+
+/* The buffer cache feature.
+ * With FIFO_FLAG_BUF_CACHE, single bufs are freed to a lock free stack
+ * (cache_top) instead of the sorted pool. The allocating thread (demux,
+ * mostly) grabs that whole stack at once into its magazine (cache_mag), and
+ * serves from there. Being taken as a whole, the stack has no ABA issue.
+ * The pool mutex is only needed when the magazine runs dry, for large bufs,
+ * when there are alloc callbacks, or when the emergency reserve is reached.
+ * Large bufs, realloc and waits first return all cached bufs to the sorted
+ * pool (harvest). Per thread caches would hide free bufs from a waiting
+ * allocator, thus we have 1 cache per fifo.
+ * buffer_pool_num_free always includes cached bufs, and is updated
+ * atomically then. cache_num holds the number of cached bufs, and
+ * cache_sleepers the number of allocators waiting for them, see
+ * buffer_pool_wait (). There may be more than 1 allocator per fifo, e. g.
+ * side stream demuxers, or control bufs sent from frontend. */
+#if defined(__GNUC__) && (HAVE_ATOMIC_VARS > 0) && (HAVE_ATOMIC_VARS < 3)
+#  define FIFO_SPSC
+#  define BUF_CACHE
+#  define FIFO_ATFA(_v,_n) __atomic_fetch_add (&(_v), (_n), __ATOMIC_ACQ_REL)
+#  define FIFO_ATGET(_v) __atomic_load_n (&(_v), __ATOMIC_ACQUIRE)
+/* for sleep/wake handshakes that need store -> load ordering. */
+#  define FIFO_ATFA_SC(_v,_n) __atomic_fetch_add (&(_v), (_n), __ATOMIC_SEQ_CST)
+#  define FIFO_ATGET_SC(_v) __atomic_load_n (&(_v), __ATOMIC_SEQ_CST)
+#endif
+
+typedef struct {
+  fifo_buffer_t    fifo; /* needs to be first */
+  int              spsc;
+  int              cache;
+  const int       *stamp;
+#ifdef FIFO_SPSC
+  int              ring_state;
+  int              ring_putter, ring_getter;
+  uint32_t         ring_put;  /* producer private */
+  uint32_t         ring_get;  /* consumer private */
+  uint32_t         ring_mask;
+  buf_element_t  **ring;
+#endif
+#ifdef BUF_CACHE
+  be_ei_t         *cache_top;
+  be_ei_t         *cache_mag; /* with cache_getter claimed */
+  int              cache_num;
+  int              cache_sleepers;
+  int              cache_getter;
+  /* statistics */
+  uint32_t         cache_alloc_hits, cache_alloc_misses;
+  uint32_t         cache_free_hits, cache_free_misses;
+#endif
+} fifo_buffer_private_t;
+
+#ifdef FIFO_SPSC
+static int fifo_try_claim (int *claim) {
+  int v = 0;
+  return __atomic_compare_exchange_n (claim, &v, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void fifo_claim (int *claim) {
+  while (!fifo_try_claim (claim))
+    sched_yield ();
+}
+
+static void fifo_unclaim (int *claim) {
+  __atomic_store_n (claim, 0, __ATOMIC_RELEASE);
+}
+#endif
+
 /* The file buf ctrl feature.
  * After stream start/seek (fifo flush), there is a phase when a few decoded frames
  * are better than a lot of merely demuxed ones. Net_buf_ctrl wants large fifos to
@@ -140,24 +221,22 @@ static void fbc_sub (fifo_buffer_t *this, int n) {
   }
 }
 
-/*
- * put a previously allocated buffer element back into the buffer pool
- */
-static void buffer_pool_free (buf_element_t *element) {
-  fifo_buffer_t *this = (fifo_buffer_t *) element->source;
-  be_ei_t *newhead, *newtail, *nexthead;
-  int n;
-
-  pthread_mutex_lock (&this->buffer_pool_mutex);
-
-  newhead = (be_ei_t *)element;
-  n = newhead->nbufs;
-  fbc_sub (this, n);
-  this->buffer_pool_num_free += n;
-  if (this->buffer_pool_num_free > this->buffer_pool_capacity) {
-    fprintf(stderr, _("xine-lib: buffer.c: There has been a fatal error: TOO MANY FREE's\n"));
-    _x_abort();
+/* buffer_pool_num_free may be touched lock free with the buffer cache. */
+static void buffer_pool_num_free_add (fifo_buffer_t *this, int n) {
+#ifdef BUF_CACHE
+  if (((fifo_buffer_private_t *)this)->cache) {
+    FIFO_ATFA (this->buffer_pool_num_free, n);
+    return;
   }
+#endif
+  this->buffer_pool_num_free += n;
+}
+
+/* with buffer_pool_mutex held.
+ * sort a chunk of bufs into the pool, does not touch buffer_pool_num_free. */
+static void buffer_pool_put_int (fifo_buffer_t *this, be_ei_t *newhead) {
+  be_ei_t *newtail, *nexthead;
+  int n = newhead->nbufs;
 
   /* we might be a new chunk */
   newtail = newhead + 1;
@@ -193,6 +272,183 @@ static void buffer_pool_free (buf_element_t *element) {
     if (prevtail == newhead)
       prevhead->nbufs += newhead->nbufs;
   }
+}
+
+#ifdef BUF_CACHE
+static void buffer_pool_too_many_frees (void) {
+  fprintf(stderr, _("xine-lib: buffer.c: There has been a fatal error: TOO MANY FREE's\n"));
+  _x_abort();
+}
+
+/* lock free. returns 0 if caller shall use the pool instead. */
+static int buffer_pool_cache_put (fifo_buffer_private_t *fifo, be_ei_t *buf) {
+  be_ei_t *top;
+
+  /* fbc and other alloc callbacks need to see every free. */
+  if (!fifo->cache || (buf->nbufs != 1) || fifo->fifo.alloc_cb[0])
+    return 0;
+
+  top = __atomic_load_n (&fifo->cache_top, __ATOMIC_RELAXED);
+  do {
+    buf->elem.next = &top->elem;
+  } while (!__atomic_compare_exchange_n (&fifo->cache_top, &top, buf, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+  FIFO_ATFA (fifo->cache_free_hits, 1);
+  if (FIFO_ATFA (fifo->fifo.buffer_pool_num_free, 1) >= fifo->fifo.buffer_pool_capacity)
+    buffer_pool_too_many_frees ();
+  FIFO_ATFA_SC (fifo->cache_num, 1);
+  if (FIFO_ATGET_SC (fifo->cache_sleepers)) {
+    /* allocator is waiting. */
+    pthread_mutex_lock (&fifo->fifo.buffer_pool_mutex);
+    pthread_cond_signal (&fifo->fifo.buffer_pool_cond_not_empty);
+    pthread_mutex_unlock (&fifo->fifo.buffer_pool_mutex);
+  }
+  return 1;
+}
+
+/* lock free. returns NULL if caller shall use the pool instead. */
+static be_ei_t *buffer_pool_cache_get (fifo_buffer_private_t *fifo) {
+  be_ei_t *buf;
+
+  if (!fifo->cache || fifo->fifo.alloc_cb[0] || !fifo_try_claim (&fifo->cache_getter))
+    return NULL;
+
+  buf = fifo->cache_mag;
+  if (!buf)
+    buf = __atomic_exchange_n (&fifo->cache_top, NULL, __ATOMIC_ACQUIRE);
+  if (buf) {
+    /* we always keep one free buffer for emergency situations like
+     * decoder flushes that would need a buffer in buffer_pool_try_alloc() */
+    if (FIFO_ATFA (fifo->fifo.buffer_pool_num_free, -1) < 3) {
+      FIFO_ATFA (fifo->fifo.buffer_pool_num_free, 1);
+      fifo->cache_mag = buf;
+      buf = NULL;
+    } else {
+      fifo->cache_mag = (be_ei_t *)buf->elem.next;
+      FIFO_ATFA (fifo->cache_num, -1);
+      fifo->cache_alloc_hits++;
+    }
+  }
+
+  fifo_unclaim (&fifo->cache_getter);
+  return buf;
+}
+
+/* with buffer_pool_mutex held. return all cached bufs to pool. */
+static void buffer_pool_harvest (fifo_buffer_t *this) {
+  fifo_buffer_private_t *fifo = (fifo_buffer_private_t *)this;
+  be_ei_t *buf, *list[2];
+  int i, n = 0;
+
+  if (!fifo->cache)
+    return;
+  fifo_claim (&fifo->cache_getter);
+  list[0] = fifo->cache_mag;
+  fifo->cache_mag = NULL;
+  fifo_unclaim (&fifo->cache_getter);
+  list[1] = __atomic_exchange_n (&fifo->cache_top, NULL, __ATOMIC_ACQUIRE);
+  for (i = 0; i < 2; i++) {
+    buf = list[i];
+    while (buf) {
+      be_ei_t *next = (be_ei_t *)buf->elem.next;
+      buf->nbufs = 1;
+      buffer_pool_put_int (this, buf);
+      buf = next;
+      n++;
+    }
+  }
+  if (n)
+    FIFO_ATFA (fifo->cache_num, -n);
+}
+
+/* with buffer_pool_mutex held. */
+static be_ei_t *buffer_pool_cache_take (fifo_buffer_private_t *fifo) {
+  be_ei_t *buf;
+
+  fifo_claim (&fifo->cache_getter);
+  buf = fifo->cache_mag;
+  if (!buf)
+    buf = __atomic_exchange_n (&fifo->cache_top, NULL, __ATOMIC_ACQUIRE);
+  if (buf) {
+    fifo->cache_mag = (be_ei_t *)buf->elem.next;
+    FIFO_ATFA (fifo->cache_num, -1);
+  }
+  fifo_unclaim (&fifo->cache_getter);
+  return buf;
+}
+#endif
+
+/* with buffer_pool_mutex held, and at least 1 free buf. */
+static be_ei_t *buffer_pool_get_one (fifo_buffer_t *this) {
+  be_ei_t *buf;
+  int i;
+
+#ifdef BUF_CACHE
+  if (((fifo_buffer_private_t *)this)->cache) {
+    ((fifo_buffer_private_t *)this)->cache_alloc_misses++;
+    if (!this->buffer_pool_top) {
+      /* serve from cache, and leave the rest to the fast path.
+       * buffer_pool_num_free is counted after the push, so there is one. */
+      buf = buffer_pool_cache_take ((fifo_buffer_private_t *)this);
+      buffer_pool_num_free_add (this, -1);
+      return buf;
+    }
+  }
+#endif
+  buf = (be_ei_t *)this->buffer_pool_top;
+  this->buffer_pool_top = buf->elem.next;
+  i = buf->nbufs - 1;
+  if (i > 0)
+    buf[1].nbufs = i;
+  buffer_pool_num_free_add (this, -1);
+  return buf;
+}
+
+/* with buffer_pool_mutex held. */
+static void buffer_pool_wait (fifo_buffer_t *this) {
+#ifdef BUF_CACHE
+  fifo_buffer_private_t *fifo = (fifo_buffer_private_t *)this;
+  if (fifo->cache) {
+    /* tell freers that we are going to sleep, and recheck. a freer seeing
+     * cache_sleepers needs buffer_pool_mutex to signal, which we hold until
+     * we actually wait. */
+    FIFO_ATFA_SC (fifo->cache_sleepers, 1);
+    if (!FIFO_ATGET_SC (fifo->cache_num))
+      pthread_cond_wait (&this->buffer_pool_cond_not_empty, &this->buffer_pool_mutex);
+    FIFO_ATFA_SC (fifo->cache_sleepers, -1);
+    buffer_pool_harvest (this);
+    return;
+  }
+#endif
+  pthread_cond_wait (&this->buffer_pool_cond_not_empty, &this->buffer_pool_mutex);
+}
+
+/*
+ * put a previously allocated buffer element back into the buffer pool
+ */
+static void buffer_pool_free (buf_element_t *element) {
+  fifo_buffer_t *this = (fifo_buffer_t *) element->source;
+  be_ei_t *newhead = (be_ei_t *)element;
+  int n;
+
+#ifdef BUF_CACHE
+  if (buffer_pool_cache_put ((fifo_buffer_private_t *)this, newhead))
+    return;
+#endif
+
+  pthread_mutex_lock (&this->buffer_pool_mutex);
+
+  n = newhead->nbufs;
+  fbc_sub (this, n);
+  buffer_pool_num_free_add (this, n);
+#ifdef BUF_CACHE
+  ((fifo_buffer_private_t *)this)->cache_free_misses++;
+#endif
+  if (this->buffer_pool_num_free > this->buffer_pool_capacity) {
+    fprintf(stderr, _("xine-lib: buffer.c: There has been a fatal error: TOO MANY FREE's\n"));
+    _x_abort();
+  }
+
+  buffer_pool_put_int (this, newhead);
 
   /* dont provoke useless wakeups */
   if (this->buffer_pool_num_waiters ||
@@ -224,32 +480,33 @@ static buf_element_t *buffer_pool_size_alloc_int (fifo_buffer_t *this, int n) {
     if (this->buffer_pool_large_wait != LARGE_NUM) {
       this->buffer_pool_num_waiters++;
       do {
-        pthread_cond_wait (&this->buffer_pool_cond_not_empty, &this->buffer_pool_mutex);
+        buffer_pool_wait (this);
       } while (fbc_avail (this) < n);
       this->buffer_pool_num_waiters--;
     } else {
       this->buffer_pool_large_wait = n;
       do {
-        pthread_cond_wait (&this->buffer_pool_cond_not_empty, &this->buffer_pool_mutex);
+        buffer_pool_wait (this);
       } while (fbc_avail (this) < n);
       this->buffer_pool_large_wait = LARGE_NUM;
     }
   }
   n -= 2;
 
-  buf = (be_ei_t *)this->buffer_pool_top;
   if (n == 1) {
 
-    this->buffer_pool_top = buf->elem.next;
-    i = buf->nbufs - 1;
-    if (i > 0)
-      buf[1].nbufs = i;
-    this->buffer_pool_num_free--;
+    buf = buffer_pool_get_one (this);
 
   } else {
 
     buf_element_t **link = &this->buffer_pool_top, **bestlink = link;
     int bestsize = 0;
+#ifdef BUF_CACHE
+    /* large bufs need the pool sorted. */
+    buffer_pool_harvest (this);
+    ((fifo_buffer_private_t *)this)->cache_alloc_misses++;
+#endif
+    buf = (be_ei_t *)this->buffer_pool_top;
     while (1) {
       int l = buf->nbufs;
       if (l > n) {
@@ -275,7 +532,7 @@ static buf_element_t *buffer_pool_size_alloc_int (fifo_buffer_t *this, int n) {
         break;
       }
     }
-    this->buffer_pool_num_free -= n;
+    buffer_pool_num_free_add (this, -n);
 
   }
 
@@ -295,10 +552,32 @@ static buf_element_t *buffer_pool_size_alloc_int (fifo_buffer_t *this, int n) {
   return &buf->elem;
 }
 
+static buf_element_t *buffer_pool_init_buf (fifo_buffer_t *this, be_ei_t *buf) {
+  /* set sane values to the newly allocated buffer */
+  buf->elem.content = buf->elem.mem; /* 99% of demuxers will want this */
+  buf->elem.pts = 0;
+  buf->elem.size = 0;
+  buf->elem.max_size = this->buffer_pool_buf_size;
+  buf->elem.decoder_flags = 0;
+  buf->nbufs = 1;
+  memset (buf->elem.decoder_info, 0, sizeof (buf->elem.decoder_info));
+  memset (buf->elem.decoder_info_ptr, 0, sizeof (buf->elem.decoder_info_ptr));
+  _x_extra_info_reset (buf->elem.extra_info);
+
+  return &buf->elem;
+}
+
 static buf_element_t *buffer_pool_size_alloc (fifo_buffer_t *this, size_t size) {
   int n = size ? ((int)size + this->buffer_pool_buf_size - 1) / this->buffer_pool_buf_size : 1;
   if (n > (this->buffer_pool_capacity >> 2))
     n = this->buffer_pool_capacity >> 2;
+#ifdef BUF_CACHE
+  if (n <= 1) {
+    be_ei_t *buf = buffer_pool_cache_get ((fifo_buffer_private_t *)this);
+    if (buf)
+      return buffer_pool_init_buf (this, buf);
+  }
+#endif
   pthread_mutex_lock (&this->buffer_pool_mutex);
   return buffer_pool_size_alloc_int (this, n);
 }
@@ -308,6 +587,12 @@ static buf_element_t *buffer_pool_alloc (fifo_buffer_t *this) {
   be_ei_t *buf;
   int i;
 
+#ifdef BUF_CACHE
+  buf = buffer_pool_cache_get ((fifo_buffer_private_t *)this);
+  if (buf)
+    return buffer_pool_init_buf (this, buf);
+#endif
+
   pthread_mutex_lock (&this->buffer_pool_mutex);
 
   for(i = 0; this->alloc_cb[i]; i++)
@@ -318,32 +603,16 @@ static buf_element_t *buffer_pool_alloc (fifo_buffer_t *this) {
   if (fbc_avail (this) < 2) {
     this->buffer_pool_num_waiters++;
     do {
-      pthread_cond_wait (&this->buffer_pool_cond_not_empty, &this->buffer_pool_mutex);
+      buffer_pool_wait (this);
     } while (fbc_avail (this) < 2);
     this->buffer_pool_num_waiters--;
   }
 
-  buf = (be_ei_t *)this->buffer_pool_top;
-  this->buffer_pool_top = buf->elem.next;
-  i = buf->nbufs - 1;
-  if (i > 0)
-    buf[1].nbufs = i;
-  this->buffer_pool_num_free--;
+  buf = buffer_pool_get_one (this);
 
   pthread_mutex_unlock (&this->buffer_pool_mutex);
 
-  /* set sane values to the newly allocated buffer */
-  buf->elem.content = buf->elem.mem; /* 99% of demuxers will want this */
-  buf->elem.pts = 0;
-  buf->elem.size = 0;
-  buf->elem.max_size = this->buffer_pool_buf_size;
-  buf->elem.decoder_flags = 0;
-  buf->nbufs = 1;
-  memset (buf->elem.decoder_info, 0, sizeof (buf->elem.decoder_info));
-  memset (buf->elem.decoder_info_ptr, 0, sizeof (buf->elem.decoder_info_ptr));
-  _x_extra_info_reset (buf->elem.extra_info);
-
-  return &buf->elem;
+  return buffer_pool_init_buf (this, buf);
 }
 
 static buf_element_t *buffer_pool_realloc (buf_element_t *buf, size_t new_size) {
@@ -371,6 +640,9 @@ static buf_element_t *buffer_pool_realloc (buf_element_t *buf, size_t new_size)
   want_buf = old_buf + old_buf->nbufs;
   last_buf = &this->buffer_pool_top;
   pthread_mutex_lock (&this->buffer_pool_mutex);
+#ifdef BUF_CACHE
+  buffer_pool_harvest (this);
+#endif
   while (1) {
     new_buf = (be_ei_t *)(*last_buf);
     if (!new_buf)
@@ -402,7 +674,7 @@ static buf_element_t *buffer_pool_realloc (buf_element_t *buf, size_t new_size)
       new_buf += n;
       *last_buf = new_buf[-1].elem.next;
     }
-    this->buffer_pool_num_free -= n;
+    buffer_pool_num_free_add (this, -n);
     pthread_mutex_unlock (&this->buffer_pool_mutex);
     old_buf->nbufs += n;
     old_buf->elem.max_size = old_buf->nbufs * this->buffer_pool_buf_size;
@@ -418,60 +690,82 @@ static buf_element_t *buffer_pool_realloc (buf_element_t *buf, size_t new_size)
 
 static buf_element_t *buffer_pool_try_alloc (fifo_buffer_t *this) {
   be_ei_t *buf;
-  int i;
 
   pthread_mutex_lock (&this->buffer_pool_mutex);
-  buf = (be_ei_t *)this->buffer_pool_top;
-  if (!buf) {
+  if (this->buffer_pool_num_free <= 0) {
     pthread_mutex_unlock (&this->buffer_pool_mutex);
     return NULL;
   }
-
-  this->buffer_pool_top = buf->elem.next;
-  i = buf->nbufs - 1;
-  if (i > 0)
-    buf[1].nbufs = i;
-  this->buffer_pool_num_free--;
+  buf = buffer_pool_get_one (this);
   pthread_mutex_unlock (&this->buffer_pool_mutex);
 
-  /* set sane values to the newly allocated buffer */
-  buf->elem.content = buf->elem.mem; /* 99% of demuxers will want this */
-  buf->elem.pts = 0;
-  buf->elem.size = 0;
-  buf->elem.max_size = this->buffer_pool_buf_size;
-  buf->elem.decoder_flags = 0;
-  buf->nbufs = 1;
-  memset (buf->elem.decoder_info, 0, sizeof (buf->elem.decoder_info));
-  memset (buf->elem.decoder_info_ptr, 0, sizeof (buf->elem.decoder_info_ptr));
-  _x_extra_info_reset (buf->elem.extra_info);
+  return buffer_pool_init_buf (this, buf);
+}
 
-  return &buf->elem;
+
+static int fifo_buf_nbufs (buf_element_t *buf) {
+  return buf->free_buffer == buffer_pool_free ? ((be_ei_t *)buf)->nbufs : 1;
 }
 
+/* fifo_size and fifo_data_size may be touched lock free in SPSC mode. */
+static void fifo_stats_add (fifo_buffer_t *fifo, int n, int size) {
+#ifdef FIFO_SPSC
+  if (((fifo_buffer_private_t *)fifo)->spsc) {
+    FIFO_ATFA (fifo->fifo_size, n);
+    FIFO_ATFA (fifo->fifo_data_size, size);
+    return;
+  }
+#endif
+  fifo->fifo_size += n;
+  fifo->fifo_data_size += size;
+}
 
 /*
  * append buffer element to fifo buffer
  */
+static int fifo_buffer_merge (fifo_buffer_t *fifo, buf_element_t *element) {
+  be_ei_t *new = (be_ei_t *)element, *prev = (be_ei_t *)fifo->last;
+  new->elem.decoder_flags &= ~BUF_FLAG_MERGE;
+  if (prev && (prev + prev->nbufs == new)
+    && (prev->elem.type == new->elem.type)
+    && (prev->nbufs < (fifo->buffer_pool_capacity >> 3))) {
+    fifo_stats_add (fifo, new->nbufs, new->elem.size);
+    prev->nbufs += new->nbufs;
+    prev->elem.max_size += new->elem.max_size;
+    prev->elem.size += new->elem.size;
+    prev->elem.decoder_flags |= new->elem.decoder_flags;
+    return 1;
+  }
+  return 0;
+}
+
+static void fifo_stamp (fifo_buffer_t *fifo, buf_element_t *element) {
+  fifo_buffer_private_t *this = (fifo_buffer_private_t *)fifo;
+
+  if (this->stamp && (element->free_buffer == buffer_pool_free))
+    ((be_ei_t *)element)->put_time = *this->stamp ? xine_pstats_now () : 0;
+}
+
+void xine_fifo_stamp_set (fifo_buffer_t *fifo, const int *flag) {
+  if (fifo)
+    ((fifo_buffer_private_t *)fifo)->stamp = flag;
+}
+
+int64_t xine_fifo_buf_time (buf_element_t *buf) {
+  if (buf->free_buffer != buffer_pool_free)
+    return 0;
+  return ((be_ei_t *)buf)->put_time;
+}
+
 static void fifo_buffer_put (fifo_buffer_t *fifo, buf_element_t *element) {
   int i;
 
+  fifo_stamp (fifo, element);
   pthread_mutex_lock (&fifo->mutex);
 
-  if (element->decoder_flags & BUF_FLAG_MERGE) {
-    be_ei_t *new = (be_ei_t *)element, *prev = (be_ei_t *)fifo->last;
-    new->elem.decoder_flags &= ~BUF_FLAG_MERGE;
-    if (prev && (prev + prev->nbufs == new)
-      && (prev->elem.type == new->elem.type)
-      && (prev->nbufs < (fifo->buffer_pool_capacity >> 3))) {
-      fifo->fifo_size += new->nbufs;
-      fifo->fifo_data_size += new->elem.size;
-      prev->nbufs += new->nbufs;
-      prev->elem.max_size += new->elem.max_size;
-      prev->elem.size += new->elem.size;
-      prev->elem.decoder_flags |= new->elem.decoder_flags;
-      pthread_mutex_unlock (&fifo->mutex);
-      return;
-    }
+  if ((element->decoder_flags & BUF_FLAG_MERGE) && fifo_buffer_merge (fifo, element)) {
+    pthread_mutex_unlock (&fifo->mutex);
+    return;
   }
 
   for(i = 0; fifo->put_cb[i]; i++)
@@ -527,13 +821,7 @@ static void fifo_buffer_insert (fifo_buffer_t *fifo, buf_element_t *element) {
   if( !fifo->last )
     fifo->last = element;
 
-  if (element->free_buffer == buffer_pool_free) {
-    be_ei_t *beei = (be_ei_t *)element;
-    fifo->fifo_size += beei->nbufs;
-  } else {
-    fifo->fifo_size += 1;
-  }
-  fifo->fifo_data_size += element->size;
+  fifo_stats_add (fifo, fifo_buf_nbufs (element), element->size);
 
   if (fifo->fifo_num_waiters)
     pthread_cond_signal (&fifo->not_empty);
@@ -655,11 +943,9 @@ static buf_element_t *fifo_buffer_tget (fifo_buffer_t *fifo, xine_ticket_t *tick
 /*
  * clear buffer (put all contained buffer elements back into buffer pool)
  */
-static void fifo_buffer_clear (fifo_buffer_t *fifo) {
+static void fifo_buffer_clear_int (fifo_buffer_t *fifo) {
   be_ei_t *start;
 
-  pthread_mutex_lock (&fifo->mutex);
-
   /* take out all at once */
   start = (be_ei_t *)fifo->first;
   fifo->first = fifo->last = NULL;
@@ -714,6 +1000,11 @@ static void fifo_buffer_clear (fifo_buffer_t *fifo) {
 
   fbc_reset (fifo);
   /* printf("Free buffers after clear: %d\n", fifo->buffer_pool_num_free); */
+}
+
+static void fifo_buffer_clear (fifo_buffer_t *fifo) {
+  pthread_mutex_lock (&fifo->mutex);
+  fifo_buffer_clear_int (fifo);
   pthread_mutex_unlock (&fifo->mutex);
 }
 
@@ -763,6 +1054,204 @@ static void fifo_buffer_all_clear (fifo_buffer_t *fifo) {
   pthread_mutex_unlock (&fifo->mutex);
 }
 
+#ifdef FIFO_SPSC
+/* ring covers the whole pool, plus a fair amount of custom bufs. */
+static int fifo_spsc_has_space (fifo_buffer_private_t *fifo) {
+  return (FIFO_ATGET (fifo->ring_state) >> 1) <= (int)fifo->ring_mask;
+}
+
+/* with ring_putter claimed. returns whether consumer needs a wakeup. */
+static int fifo_spsc_push (fifo_buffer_private_t *fifo, buf_element_t *buf) {
+  buf->next = NULL;
+  fifo->ring[fifo->ring_put & fifo->ring_mask] = buf;
+  fifo->ring_put++;
+  fifo_stats_add (&fifo->fifo, fifo_buf_nbufs (buf), buf->size);
+  return FIFO_ATFA (fifo->ring_state, 2) & 1;
+}
+
+/* with ring_getter claimed. */
+static buf_element_t *fifo_spsc_pop (fifo_buffer_private_t *fifo) {
+  buf_element_t *buf;
+
+  if (!(FIFO_ATGET (fifo->ring_state) >> 1))
+    return NULL;
+  buf = fifo->ring[fifo->ring_get & fifo->ring_mask];
+  fifo->ring_get++;
+  FIFO_ATFA (fifo->ring_state, -2);
+  fifo_stats_add (&fifo->fifo, -fifo_buf_nbufs (buf), -buf->size);
+  return buf;
+}
+
+/* with mutex and both claims held. move ring contents to list tail. */
+static void fifo_spsc_drain (fifo_buffer_private_t *fifo) {
+  int n = FIFO_ATGET (fifo->ring_state) >> 1;
+
+  if (n <= 0)
+    return;
+  FIFO_ATFA (fifo->ring_state, -2 * n);
+  while (n-- > 0) {
+    buf_element_t *buf = fifo->ring[fifo->ring_get & fifo->ring_mask];
+    fifo->ring_get++;
+    if (fifo->fifo.last)
+      fifo->fifo.last->next = buf;
+    else
+      fifo->fifo.first = buf;
+    fifo->fifo.last = buf;
+  }
+}
+
+static void fifo_spsc_put (fifo_buffer_t *this, buf_element_t *element) {
+  fifo_buffer_private_t *fifo = (fifo_buffer_private_t *)this;
+  int i;
+
+  fifo_stamp (this, element);
+  if (!this->put_cb[0] && !(element->decoder_flags & BUF_FLAG_MERGE)) {
+    /* fast path */
+    while (1) {
+      fifo_claim (&fifo->ring_putter);
+      if (fifo_spsc_has_space (fifo))
+        break;
+      fifo_unclaim (&fifo->ring_putter);
+      xine_usec_sleep (1000);
+    }
+    i = fifo_spsc_push (fifo, element);
+    fifo_unclaim (&fifo->ring_putter);
+    if (i) {
+      pthread_mutex_lock (&this->mutex);
+      pthread_cond_signal (&this->not_empty);
+      pthread_mutex_unlock (&this->mutex);
+    }
+    return;
+  }
+
+  while (1) {
+    pthread_mutex_lock (&this->mutex);
+    fifo_claim (&fifo->ring_putter);
+    if (fifo_spsc_has_space (fifo))
+      break;
+    fifo_unclaim (&fifo->ring_putter);
+    pthread_mutex_unlock (&this->mutex);
+    xine_usec_sleep (1000);
+  }
+
+  /* the ring is consumer domain, we can only merge with the list tail. */
+  if ((element->decoder_flags & BUF_FLAG_MERGE)
+    && !(FIFO_ATGET (fifo->ring_state) >> 1) && fifo_buffer_merge (this, element)) {
+    fifo_unclaim (&fifo->ring_putter);
+    pthread_mutex_unlock (&this->mutex);
+    return;
+  }
+  element->decoder_flags &= ~BUF_FLAG_MERGE;
+
+  for (i = 0; this->put_cb[i]; i++)
+    this->put_cb[i] (this, element, this->put_cb_data[i]);
+
+  if (fifo_spsc_push (fifo, element))
+    pthread_cond_signal (&this->not_empty);
+
+  fifo_unclaim (&fifo->ring_putter);
+  pthread_mutex_unlock (&this->mutex);
+}
+
+/* with mutex held. */
+static buf_element_t *fifo_spsc_get_locked (fifo_buffer_private_t *fifo, xine_ticket_t *ticket, int *mode) {
+  buf_element_t *buf;
+
+  while (1) {
+    int state;
+
+    buf = fifo->fifo.first;
+    if (buf) {
+      fifo->fifo.first = buf->next;
+      if (!fifo->fifo.first)
+        fifo->fifo.last = NULL;
+      fifo_stats_add (&fifo->fifo, -fifo_buf_nbufs (buf), -buf->size);
+      return buf;
+    }
+
+    fifo_claim (&fifo->ring_getter);
+    buf = fifo_spsc_pop (fifo);
+    fifo_unclaim (&fifo->ring_getter);
+    if (buf)
+      return buf;
+
+    if (*mode & 2) {
+      ticket->release (ticket, 0);
+      *mode = 1;
+    }
+    /* tell producer that we are going to sleep, and recheck atomically. */
+    fifo->fifo.fifo_num_waiters++;
+    state = FIFO_ATFA (fifo->ring_state, 1);
+    if (!(state >> 1))
+      pthread_cond_wait (&fifo->fifo.not_empty, &fifo->fifo.mutex);
+    FIFO_ATFA (fifo->ring_state, -1);
+    fifo->fifo.fifo_num_waiters--;
+  }
+}
+
+static buf_element_t *fifo_spsc_tget (fifo_buffer_t *this, xine_ticket_t *ticket) {
+  fifo_buffer_private_t *fifo = (fifo_buffer_private_t *)this;
+  buf_element_t *buf;
+  int mode = ticket ? 2 : 0, i;
+
+  /* fast path. fifo->first is rare, and a stale view of it is harmless. */
+  if (!this->first && !this->get_cb[0] && fifo_try_claim (&fifo->ring_getter)) {
+    buf = fifo_spsc_pop (fifo);
+    fifo_unclaim (&fifo->ring_getter);
+    if (buf) {
+      if ((mode & 2) && ticket->ticket_revoked) {
+        ticket->release (ticket, 0);
+        ticket->acquire (ticket, 0);
+      }
+      return buf;
+    }
+  }
+
+  /* see fifo_buffer_tget () */
+  if (pthread_mutex_trylock (&this->mutex)) {
+    if (mode & 2) {
+      ticket->release (ticket, 0);
+      mode = 1;
+    }
+    pthread_mutex_lock (&this->mutex);
+  }
+
+  buf = fifo_spsc_get_locked (fifo, ticket, &mode);
+
+  if ((mode & 2) && ticket->ticket_revoked) {
+    ticket->release (ticket, 0);
+    mode = 1;
+  }
+
+  for (i = 0; this->get_cb[i]; i++)
+    this->get_cb[i] (this, buf, this->get_cb_data[i]);
+
+  pthread_mutex_unlock (&this->mutex);
+
+  if (mode & 1)
+    ticket->acquire (ticket, 0);
+
+  return buf;
+}
+
+static buf_element_t *fifo_spsc_get (fifo_buffer_t *this) {
+  return fifo_spsc_tget (this, NULL);
+}
+
+static void fifo_spsc_clear (fifo_buffer_t *this) {
+  fifo_buffer_private_t *fifo = (fifo_buffer_private_t *)this;
+
+  pthread_mutex_lock (&this->mutex);
+  fifo_claim (&fifo->ring_putter);
+  fifo_claim (&fifo->ring_getter);
+  fifo_spsc_drain (fifo);
+  fifo_buffer_clear_int (this);
+  fifo_unclaim (&fifo->ring_getter);
+  fifo_unclaim (&fifo->ring_putter);
+  pthread_mutex_unlock (&this->mutex);
+}
+#endif
+
 /*
  * Return the number of elements in the fifo buffer
  */
@@ -806,6 +1295,12 @@ static int fifo_buffer_num_free (fifo_buffer_t *this) {
  * Destroy the buffer
  */
 static void fifo_buffer_dispose (fifo_buffer_t *this) {
+#ifdef FIFO_SPSC
+  if (((fifo_buffer_private_t *)this)->spsc) {
+    /* threads are gone now. */
+    fifo_spsc_drain ((fifo_buffer_private_t *)this);
+  }
+#endif
   fifo_buffer_all_clear (this);
   xine_free_aligned (this->buffer_pool_base);
   pthread_mutex_destroy(&this->mutex);
@@ -947,16 +1442,29 @@ static void fifo_unregister_get_cb (fifo_buffer_t *this,
 /*
  * allocate and initialize new (empty) fifo buffer
  */
-fifo_buffer_t *_x_fifo_buffer_new (int num_buffers, uint32_t buf_size) {
+fifo_buffer_t *_x_fifo_buffer_new_flags (int num_buffers, uint32_t buf_size, uint32_t flags) {
 
+  fifo_buffer_private_t *fifo;
   fifo_buffer_t *this;
   int            i;
   unsigned char *multi_buffer;
   be_ei_t       *beei;
+#ifdef FIFO_SPSC
+  uint32_t       ring_size = 0;
 
-  this = calloc(1, sizeof(fifo_buffer_t));
-  if (!this)
+  if (flags & FIFO_FLAG_SPSC) {
+    ring_size = 64;
+    while (ring_size < 2 * (uint32_t)num_buffers)
+      ring_size <<= 1;
+  }
+  fifo = calloc (1, sizeof (*fifo) + ring_size * sizeof (buf_element_t *));
+#else
+  (void)flags;
+  fifo = calloc (1, sizeof (*fifo));
+#endif
+  if (!fifo)
     return NULL;
+  this = &fifo->fifo;
 #ifndef HAVE_ZERO_SAFE_MEM
   /* Do these first, when compiler still knows "this" is all zeroed.
    * Let it optimize away this on most systems where clear mem
@@ -973,6 +1481,13 @@ fifo_buffer_t *_x_fifo_buffer_new (int num_buffers, uint32_t buf_size) {
   this->alloc_cb_data[0]        = NULL;
   this->get_cb_data[0]          = NULL;
   this->put_cb_data[0]          = NULL;
+#  ifdef BUF_CACHE
+  fifo->cache_top               = NULL;
+  fifo->cache_mag               = NULL;
+  fifo->cache_num               = 0;
+  fifo->cache_sleepers          = 0;
+  fifo->cache_getter            = 0;
+#  endif
 #endif
 
   /* printf ("Allocating %d buffers of %ld bytes in one chunk\n", num_buffers, (long int) buf_size); */
@@ -997,6 +1512,20 @@ fifo_buffer_t *_x_fifo_buffer_new (int num_buffers, uint32_t buf_size) {
   this->unregister_alloc_cb = fifo_unregister_alloc_cb;
   this->unregister_get_cb   = fifo_unregister_get_cb;
   this->unregister_put_cb   = fifo_unregister_put_cb;
+#ifdef BUF_CACHE
+  fifo->cache = !!(flags & FIFO_FLAG_BUF_CACHE);
+#endif
+#ifdef FIFO_SPSC
+  if (ring_size) {
+    fifo->spsc      = 1;
+    fifo->ring      = (buf_element_t **)(fifo + 1);
+    fifo->ring_mask = ring_size - 1;
+    this->put       = fifo_spsc_put;
+    this->get       = fifo_spsc_get;
+    this->tget      = fifo_spsc_tget;
+    this->clear     = fifo_spsc_clear;
+  }
+#endif
   pthread_mutex_init (&this->mutex, NULL);
   pthread_cond_init (&this->not_empty, NULL);
 
@@ -1036,6 +1565,30 @@ fifo_buffer_t *_x_fifo_buffer_new (int num_buffers, uint32_t buf_size) {
   return this;
 }
 
+fifo_buffer_t *_x_fifo_buffer_new (int num_buffers, uint32_t buf_size) {
+  return _x_fifo_buffer_new_flags (num_buffers, buf_size, 0);
+}
+
+int _x_fifo_buffer_cache_stats (fifo_buffer_t *fifo, fifo_buffer_cache_stats_t *stats) {
+#ifdef BUF_CACHE
+  fifo_buffer_private_t *this = (fifo_buffer_private_t *)fifo;
+
+  if (!this || !this->cache || !stats)
+    return 0;
+  pthread_mutex_lock (&fifo->buffer_pool_mutex);
+  stats->alloc_hits   = this->cache_alloc_hits;
+  stats->alloc_misses = this->cache_alloc_misses;
+  stats->free_hits    = FIFO_ATGET (this->cache_free_hits);
+  stats->free_misses  = this->cache_free_misses;
+  pthread_mutex_unlock (&fifo->buffer_pool_mutex);
+  return 1;
+#else
+  (void)fifo;
+  (void)stats;
+  return 0;
+#endif
+}
+
 /*
  * allocate and initialize new (empty) fifo buffer
  */
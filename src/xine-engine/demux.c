@@ -389,6 +389,8 @@ static void *demux_loop (void *stream_gen) {
           stream->demux.input_caps = input_caps;
           pthread_mutex_unlock (&stream->demux.action_lock);
         }
+        if ((stream == m) && (((xine_private_t *)stream->s.xine)->pstats_log > 0))
+          xine_pstats_log (m, xine_pstats_now ());
       }
 
       /* someone may want to interrupt us */
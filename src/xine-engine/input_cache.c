@@ -21,6 +21,10 @@
  *
  * The goal of this input plugin is to reduce
  * the number of calls to the real input plugin.
+ *
+ * Optionally (engine.buffers.input_readahead_size), a background thread
+ * keeps a larger ring filled ahead of the current position, so that
+ * slow media (NFS, SMB, USB) do not stall the demuxer in steady playback.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -33,10 +37,16 @@
 #define LOG
 */
 
+#include <pthread.h>
+
 #include <xine/xine_internal.h>
 #include "xine_private.h"
 
 #define DEFAULT_BUFFER_SIZE 8192
+/* max size of the plain buffer after INPUT_OPTIONAL_DATA_READAHEAD. */
+#define MAX_BUFFER_SIZE (1 << 20)
+/* max size of a single read by the read ahead thread. */
+#define RA_CHUNK_SIZE (64 << 10)
 
 typedef struct {
   input_plugin_t    input_plugin;      /* inherited structure */
@@ -51,6 +61,26 @@ typedef struct {
 
   int               is_clone;
 
+  /* read ahead thread, if any. */
+  struct {
+    /* main_input_plugin is used by 1 thread at a time. order: io_mutex, then mutex. */
+    pthread_mutex_t io_mutex;
+    pthread_mutex_t mutex;
+    pthread_cond_t  data_cond;  /* reader -> demux */
+    pthread_cond_t  space_cond; /* demux -> reader */
+    pthread_t       thread;
+    uint8_t        *ring;
+    size_t          size;
+    /* ring read index, ready bytes from there, still valid bytes before that. */
+    size_t          rpos, fill, back;
+    /* stream offset at ring read index. */
+    off_t           pos;
+    /* reader stopped after a short read (0) or an error (< 0). */
+    off_t           last;
+    int             stop, flush, quit, waiting;
+    int             running;
+  }                 ra;
+
   /* Statistics */
   int               read_call;
   int               main_read_call;
@@ -171,6 +201,324 @@ static off_t cache_plugin_read(input_plugin_t *this_gen, void *buf_gen, off_t le
   }
 }
 
+/*
+ * read ahead thread version.
+ */
+
+static void *cache_ra_loop (void *data) {
+  cache_input_plugin_t *this = (cache_input_plugin_t *)data;
+
+  while (1) {
+    size_t w, n;
+    off_t r;
+
+    pthread_mutex_lock (&this->ra.io_mutex);
+    pthread_mutex_lock (&this->ra.mutex);
+    if (this->ra.quit) {
+      pthread_mutex_unlock (&this->ra.mutex);
+      pthread_mutex_unlock (&this->ra.io_mutex);
+      break;
+    }
+    if (this->ra.stop || this->ra.flush || (this->ra.fill >= this->ra.size)) {
+      pthread_mutex_unlock (&this->ra.io_mutex);
+      pthread_cond_wait (&this->ra.space_cond, &this->ra.mutex);
+      pthread_mutex_unlock (&this->ra.mutex);
+      continue;
+    }
+    w = this->ra.rpos + this->ra.fill;
+    if (w >= this->ra.size)
+      w -= this->ra.size;
+    n = this->ra.size - this->ra.fill;
+    if (n > this->ra.size - w)
+      n = this->ra.size - w;
+    if (n > RA_CHUNK_SIZE)
+      n = RA_CHUNK_SIZE;
+    /* we are going to overwrite some history. */
+    if (this->ra.back > this->ra.size - this->ra.fill - n)
+      this->ra.back = this->ra.size - this->ra.fill - n;
+    pthread_mutex_unlock (&this->ra.mutex);
+
+    r = this->main_input_plugin->read (this->main_input_plugin, this->ra.ring + w, n);
+
+    pthread_mutex_lock (&this->ra.mutex);
+    this->main_read_call++;
+    if (r > 0)
+      this->ra.fill += r;
+    if (r < (off_t)n) {
+      this->ra.stop = 1;
+      this->ra.last = r < 0 ? r : 0;
+    }
+    if (this->ra.waiting)
+      pthread_cond_signal (&this->ra.data_cond);
+    pthread_mutex_unlock (&this->ra.mutex);
+    pthread_mutex_unlock (&this->ra.io_mutex);
+  }
+  return NULL;
+}
+
+/* get exclusive access to main_input_plugin, and drop all read ahead data.
+ * main input position is this->ra.pos then. */
+static void cache_ra_flush_lock (cache_input_plugin_t *this) {
+  pthread_mutex_lock (&this->ra.mutex);
+  this->ra.flush = 1;
+  pthread_mutex_unlock (&this->ra.mutex);
+  pthread_mutex_lock (&this->ra.io_mutex);
+  pthread_mutex_lock (&this->ra.mutex);
+  this->ra.rpos = this->ra.fill = this->ra.back = 0;
+  pthread_mutex_unlock (&this->ra.mutex);
+}
+
+static void cache_ra_flush_unlock (cache_input_plugin_t *this) {
+  pthread_mutex_lock (&this->ra.mutex);
+  this->ra.flush = 0;
+  this->ra.stop = 0;
+  this->ra.last = 0;
+  pthread_cond_signal (&this->ra.space_cond);
+  pthread_mutex_unlock (&this->ra.mutex);
+  pthread_mutex_unlock (&this->ra.io_mutex);
+}
+
+/* same, but keep the data as long as main input did not move. */
+static void cache_ra_pause (cache_input_plugin_t *this) {
+  pthread_mutex_lock (&this->ra.mutex);
+  this->ra.flush = 1;
+  pthread_mutex_unlock (&this->ra.mutex);
+  pthread_mutex_lock (&this->ra.io_mutex);
+}
+
+static void cache_ra_resume (cache_input_plugin_t *this) {
+  off_t pos = this->main_input_plugin->get_current_pos (this->main_input_plugin);
+
+  pthread_mutex_lock (&this->ra.mutex);
+  if (pos != this->ra.pos + (off_t)this->ra.fill) {
+    this->ra.rpos = this->ra.fill = this->ra.back = 0;
+    this->ra.pos = pos;
+  }
+  pthread_mutex_unlock (&this->ra.mutex);
+  cache_ra_flush_unlock (this);
+}
+
+static off_t cache_ra_read (input_plugin_t *this_gen, void *buf_gen, off_t len) {
+  cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
+  uint8_t *buf = (uint8_t *)buf_gen;
+  off_t done = 0;
+
+  this->read_call++;
+
+  if (len <= 0) {
+    _x_assert(len >= 0);
+    return len;
+  }
+
+  pthread_mutex_lock (&this->ra.mutex);
+  while (len > 0) {
+    size_t n = this->ra.fill, rpos = this->ra.rpos;
+
+    if (n == 0) {
+      off_t r;
+
+      if (!this->ra.stop) {
+        this->ra.waiting = 1;
+        pthread_cond_wait (&this->ra.data_cond, &this->ra.mutex);
+        this->ra.waiting = 0;
+        continue;
+      }
+      if (this->ra.last < 0) {
+        /* report read error after the data before it. */
+        r = this->ra.last;
+        this->ra.last = 0;
+        this->ra.stop = 0;
+        pthread_cond_signal (&this->ra.space_cond);
+        pthread_mutex_unlock (&this->ra.mutex);
+        return done ? done : r;
+      }
+      /* (maybe only preliminary) end of stream. read the rest ourselves,
+       * some inputs wait for more data when called from the demux thread. */
+      pthread_mutex_unlock (&this->ra.mutex);
+      cache_ra_flush_lock (this);
+      this->main_read_call++;
+      r = this->main_input_plugin->read (this->main_input_plugin, buf, len);
+      if (r > 0) {
+        this->ra.pos += r;
+        done += r;
+      }
+      cache_ra_flush_unlock (this);
+      return (r < 0 && !done) ? r : done;
+    }
+
+    pthread_mutex_unlock (&this->ra.mutex);
+    if ((off_t)n > len)
+      n = len;
+    if (n > this->ra.size - rpos)
+      n = this->ra.size - rpos;
+    xine_fast_memcpy (buf, this->ra.ring + rpos, n);
+    buf += n;
+    len -= n;
+    done += n;
+    this->ra.pos += n;
+    pthread_mutex_lock (&this->ra.mutex);
+    rpos += n;
+    this->ra.rpos = rpos >= this->ra.size ? rpos - this->ra.size : rpos;
+    this->ra.fill -= n;
+    this->ra.back += n;
+    if (this->ra.back > this->ra.size - this->ra.fill)
+      this->ra.back = this->ra.size - this->ra.fill;
+    pthread_cond_signal (&this->ra.space_cond);
+  }
+  pthread_mutex_unlock (&this->ra.mutex);
+  return done;
+}
+
+static buf_element_t *cache_ra_read_block (input_plugin_t *this_gen, fifo_buffer_t *fifo, off_t todo) {
+  buf_element_t *buf;
+  off_t read_len;
+
+  if (todo < 0)
+    return NULL;
+  buf = fifo->buffer_pool_size_alloc (fifo, todo);
+  if (todo > buf->max_size)
+    todo = buf->max_size;
+  buf->content = buf->mem;
+  buf->type = BUF_DEMUX_BLOCK;
+  read_len = cache_ra_read (this_gen, buf->content, todo);
+  if (read_len != todo) {
+    buf->free_buffer (buf);
+    return NULL;
+  }
+  buf->size = read_len;
+  return buf;
+}
+
+static off_t cache_ra_seek (input_plugin_t *this_gen, off_t offset, int origin) {
+  cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
+  off_t pos;
+
+  this->seek_call++;
+
+  switch (origin) {
+    case SEEK_CUR:
+      offset += this->ra.pos;
+      /* fall through */
+    case SEEK_SET:
+      pthread_mutex_lock (&this->ra.mutex);
+      /* inside the ring? */
+      if ((offset >= this->ra.pos - (off_t)this->ra.back) && (offset <= this->ra.pos + (off_t)this->ra.fill)) {
+        off_t d = offset - this->ra.pos;
+        off_t rpos = (off_t)this->ra.rpos + d;
+        if (rpos < 0)
+          rpos += this->ra.size;
+        else if (rpos >= (off_t)this->ra.size)
+          rpos -= this->ra.size;
+        this->ra.rpos = rpos;
+        this->ra.fill -= d;
+        this->ra.back += d;
+        this->ra.pos = offset;
+        pthread_cond_signal (&this->ra.space_cond);
+        pthread_mutex_unlock (&this->ra.mutex);
+        return offset;
+      }
+      pthread_mutex_unlock (&this->ra.mutex);
+      break;
+    default: ;
+  }
+
+  cache_ra_flush_lock (this);
+  this->main_seek_call++;
+  pos = this->main_input_plugin->seek (this->main_input_plugin, offset, origin == SEEK_CUR ? SEEK_SET : origin);
+  this->ra.pos = this->main_input_plugin->get_current_pos (this->main_input_plugin);
+  cache_ra_flush_unlock (this);
+  return pos;
+}
+
+static off_t cache_ra_seek_time (input_plugin_t *this_gen, int time_offset, int origin) {
+  cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
+  off_t pos;
+
+  this->seek_call++;
+  cache_ra_flush_lock (this);
+  this->main_seek_call++;
+  pos = this->main_input_plugin->seek_time (this->main_input_plugin, time_offset, origin);
+  this->ra.pos = this->main_input_plugin->get_current_pos (this->main_input_plugin);
+  cache_ra_flush_unlock (this);
+  return pos;
+}
+
+static off_t cache_ra_get_current_pos (input_plugin_t *this_gen) {
+  cache_input_plugin_t *this = (cache_input_plugin_t *)this_gen;
+
+  return this->ra.pos;
+}
+
+static int cache_ra_start (cache_input_plugin_t *this) {
+  xine_t *xine = this->stream->xine;
+  int size;
+  uint32_t caps;
+
+  size = xine->config->register_num (xine->config,
+    "engine.buffers.input_readahead_size", 0,
+    _("Input read ahead size (MiB)"),
+    _("Read this much of a seekable stream ahead of the demuxer, using an extra thread.\n"
+      "This helps with slow or high latency media like network shares and USB drives.\n"
+      "0 disables the read ahead thread."),
+    20, NULL, NULL);
+  if (size <= 0)
+    return 0;
+  if (size > 64)
+    size = 64;
+
+  caps = this->main_input_plugin->get_capabilities (this->main_input_plugin);
+  /* block based inputs do their own thing. */
+  if ((caps & (INPUT_CAP_SEEKABLE | INPUT_CAP_BLOCK | INPUT_CAP_LIVE)) != INPUT_CAP_SEEKABLE)
+    return 0;
+
+  this->ra.size = (size_t)size << 20;
+  this->ra.ring = malloc (this->ra.size);
+  if (!this->ra.ring)
+    return 0;
+  this->ra.pos = this->main_input_plugin->get_current_pos (this->main_input_plugin);
+
+  pthread_mutex_init (&this->ra.io_mutex, NULL);
+  pthread_mutex_init (&this->ra.mutex, NULL);
+  pthread_cond_init (&this->ra.data_cond, NULL);
+  pthread_cond_init (&this->ra.space_cond, NULL);
+  if (pthread_create (&this->ra.thread, NULL, cache_ra_loop, this)) {
+    pthread_cond_destroy (&this->ra.space_cond);
+    pthread_cond_destroy (&this->ra.data_cond);
+    pthread_mutex_destroy (&this->ra.mutex);
+    pthread_mutex_destroy (&this->ra.io_mutex);
+    _x_freep (&this->ra.ring);
+    return 0;
+  }
+  this->ra.running = 1;
+
+  this->input_plugin.read                = cache_ra_read;
+  this->input_plugin.read_block          = cache_ra_read_block;
+  this->input_plugin.seek                = cache_ra_seek;
+  if (this->main_input_plugin->seek_time)
+    this->input_plugin.seek_time         = cache_ra_seek_time;
+  this->input_plugin.get_current_pos     = cache_ra_get_current_pos;
+
+  xprintf (xine, XINE_VERBOSITY_DEBUG,
+    LOG_MODULE ": reading up to %d MiB ahead.\n", size);
+  return 1;
+}
+
+static void cache_ra_stop (cache_input_plugin_t *this) {
+  if (!this->ra.running)
+    return;
+  pthread_mutex_lock (&this->ra.mutex);
+  this->ra.quit = 1;
+  pthread_cond_signal (&this->ra.space_cond);
+  pthread_mutex_unlock (&this->ra.mutex);
+  pthread_join (this->ra.thread, NULL);
+  this->ra.running = 0;
+  pthread_cond_destroy (&this->ra.space_cond);
+  pthread_cond_destroy (&this->ra.data_cond);
+  pthread_mutex_destroy (&this->ra.mutex);
+  pthread_mutex_destroy (&this->ra.io_mutex);
+  _x_freep (&this->ra.ring);
+}
+
 /*
  * open should never be called
  */
@@ -338,6 +686,8 @@ static void cache_plugin_dispose(input_plugin_t *this_gen) {
   xprintf(this->stream->xine, XINE_VERBOSITY_DEBUG,
 	  LOG_MODULE": seek_calls: %d, main input seek calls: %d\n", this->seek_call, this->main_seek_call);
 
+  cache_ra_stop (this);
+
   if (this->is_clone)
     this->main_input_plugin->dispose (this->main_input_plugin);
   else
@@ -400,6 +750,8 @@ static input_plugin_t *cache_plugin_new (xine_stream_t *stream, input_plugin_t *
     return NULL;
   }
 
+  cache_ra_start (this);
+
   return &this->input_plugin;
 }
 
@@ -439,6 +791,59 @@ static int cache_plugin_get_optional_data (input_plugin_t *this_gen,
     return INPUT_OPTIONAL_SUCCESS;
   }
 
+  if (data_type == INPUT_OPTIONAL_DATA_CACHE_FILL) {
+    int *fill = (int *)data;
+    if (!fill)
+      return INPUT_OPTIONAL_UNSUPPORTED;
+    if (this->ra.running) {
+      pthread_mutex_lock (&this->ra.mutex);
+      fill[0] = this->ra.fill;
+      fill[1] = this->ra.size;
+      pthread_mutex_unlock (&this->ra.mutex);
+    } else {
+      fill[0] = this->buf_len - this->buf_pos;
+      fill[1] = this->buf_size;
+    }
+    return INPUT_OPTIONAL_SUCCESS;
+  }
+
+  if (data_type == INPUT_OPTIONAL_DATA_READAHEAD) {
+    const int *want = (const int *)data;
+    size_t size;
+    char *nbuf;
+    if (!want)
+      return INPUT_OPTIONAL_UNSUPPORTED;
+    /* the read ahead thread already does this. */
+    if (this->ra.running)
+      return INPUT_OPTIONAL_SUCCESS;
+    if ((*want <= 0) || ((size_t)*want <= this->buf_size) || (this->buf_size >= MAX_BUFFER_SIZE))
+      return INPUT_OPTIONAL_SUCCESS;
+    /* a large refill would stall playback on slow or live sources. */
+    if ((this->main_input_plugin->get_capabilities (this->main_input_plugin)
+      & (INPUT_CAP_SEEKABLE | INPUT_CAP_SLOW_SEEKABLE | INPUT_CAP_LIVE)) != INPUT_CAP_SEEKABLE)
+      return INPUT_OPTIONAL_UNSUPPORTED;
+    /* grow only. this keeps the bytes still in the buffer, and the
+     * next refill will fetch the whole announced range at once. */
+    size = ((size_t)*want + DEFAULT_BUFFER_SIZE - 1) & ~(size_t)(DEFAULT_BUFFER_SIZE - 1);
+    if (size > MAX_BUFFER_SIZE)
+      size = MAX_BUFFER_SIZE;
+    nbuf = realloc (this->buf, size);
+    if (!nbuf)
+      return INPUT_OPTIONAL_SUCCESS;
+    this->buf = nbuf;
+    this->buf_size = size;
+    return INPUT_OPTIONAL_SUCCESS;
+  }
+
+  if (this->ra.running) {
+    /* this may read or seek the main input as well. */
+    int r;
+    cache_ra_pause (this);
+    r = this->main_input_plugin->get_optional_data (this->main_input_plugin, data, data_type);
+    cache_ra_resume (this);
+    return r;
+  }
+
   return this->main_input_plugin->get_optional_data(
     this->main_input_plugin, data, data_type);
 }
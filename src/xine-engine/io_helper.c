@@ -46,6 +46,12 @@
 
 #include <string.h>
 
+#ifdef HAVE_IO_URING
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
 #include <xine/io_helper.h>
 #include "xine_private.h"
 
@@ -545,6 +551,268 @@ static off_t xio_err (xine_stream_t *stream, int ret) {
   return ret;
 }
 
+#ifdef HAVE_IO_URING
+/* a tiny io_uring per stream. instead of select () + recv () per chunk,
+ * submit the receive linked with a polling interval timeout, and wait
+ * for both in the same syscall. we use the raw kernel interface here
+ * to avoid yet another lib dependency. */
+
+struct xio_uring_s {
+  int                  fd;
+  /* 0 = untested, 1 = ok, -1 = kernel does not support our ops. */
+  int                  state;
+  unsigned int         sq_mask, cq_mask;
+  unsigned int        *sq_head, *sq_tail, *sq_array;
+  unsigned int        *cq_head, *cq_tail;
+  struct io_uring_sqe *sqes;
+  struct io_uring_cqe *cqes;
+  void                *sq_map, *cq_map;
+  size_t               sq_map_size, cq_map_size, sqes_size;
+  struct __kernel_timespec ts;
+};
+
+#define XIO_URING_FAIL (-2)
+
+static void xio_uring_delete (xio_uring_t *u) {
+  if (u->sqes)
+    munmap (u->sqes, u->sqes_size);
+  if (u->cq_map && (u->cq_map != u->sq_map))
+    munmap (u->cq_map, u->cq_map_size);
+  if (u->sq_map)
+    munmap (u->sq_map, u->sq_map_size);
+  if (u->fd >= 0)
+    close (u->fd);
+  free (u);
+}
+
+static xio_uring_t *xio_uring_new (void) {
+  struct io_uring_params p;
+  xio_uring_t *u = calloc (1, sizeof (*u));
+  uint8_t *sq, *cq;
+
+  if (!u)
+    return NULL;
+  memset (&p, 0, sizeof (p));
+  u->fd = syscall (__NR_io_uring_setup, 4, &p);
+  if (u->fd < 0) {
+    free (u);
+    return NULL;
+  }
+  /* our sockets are non blocking. without fast poll (kernel < 5.7),
+   * recv would just return -EAGAIN immediately. */
+#ifdef IORING_FEAT_FAST_POLL
+  if (!(p.features & IORING_FEAT_FAST_POLL))
+#endif
+  {
+    close (u->fd);
+    free (u);
+    return NULL;
+  }
+  u->sq_map_size = p.sq_off.array + p.sq_entries * sizeof (unsigned int);
+  u->cq_map_size = p.cq_off.cqes + p.cq_entries * sizeof (struct io_uring_cqe);
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    if (u->cq_map_size > u->sq_map_size)
+      u->sq_map_size = u->cq_map_size;
+    u->cq_map_size = u->sq_map_size;
+  }
+  u->sq_map = mmap (NULL, u->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQ_RING);
+  if (u->sq_map == MAP_FAILED) {
+    u->sq_map = NULL;
+    xio_uring_delete (u);
+    return NULL;
+  }
+  if (p.features & IORING_FEAT_SINGLE_MMAP) {
+    u->cq_map = u->sq_map;
+  } else {
+    u->cq_map = mmap (NULL, u->cq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_CQ_RING);
+    if (u->cq_map == MAP_FAILED) {
+      u->cq_map = NULL;
+      xio_uring_delete (u);
+      return NULL;
+    }
+  }
+  u->sqes_size = p.sq_entries * sizeof (struct io_uring_sqe);
+  u->sqes = mmap (NULL, u->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, u->fd, IORING_OFF_SQES);
+  if (u->sqes == MAP_FAILED) {
+    u->sqes = NULL;
+    xio_uring_delete (u);
+    return NULL;
+  }
+  sq = u->sq_map;
+  cq = u->cq_map;
+  u->sq_head  = (unsigned int *)(sq + p.sq_off.head);
+  u->sq_tail  = (unsigned int *)(sq + p.sq_off.tail);
+  u->sq_mask  = *(unsigned int *)(sq + p.sq_off.ring_mask);
+  u->sq_array = (unsigned int *)(sq + p.sq_off.array);
+  u->cq_head  = (unsigned int *)(cq + p.cq_off.head);
+  u->cq_tail  = (unsigned int *)(cq + p.cq_off.tail);
+  u->cq_mask  = *(unsigned int *)(cq + p.cq_off.ring_mask);
+  u->cqes     = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+  return u;
+}
+
+/* do 1 read type op with a timeout. return bytes, -errno, or -ETIME on timeout. */
+static int xio_uring_op (xio_uring_t *u, int op, int fd, void *buf, size_t len, unsigned int usec) {
+  struct io_uring_sqe *sqe;
+  unsigned int tail, head, ctail, n;
+  int res = -ETIME, got = 0, ret;
+
+  u->ts.tv_sec = usec / 1000000;
+  u->ts.tv_nsec = (usec % 1000000) * 1000;
+
+  tail = *u->sq_tail;
+  sqe = u->sqes + (tail & u->sq_mask);
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = op;
+  sqe->fd = fd;
+  sqe->addr = (uintptr_t)buf;
+  sqe->len = len > 0x7ffff000 ? 0x7ffff000 : len;
+  /* read from current file position. */
+  if (op == IORING_OP_READ)
+    sqe->off = (uint64_t)-1;
+  sqe->flags = IOSQE_IO_LINK;
+  sqe->user_data = 1;
+  u->sq_array[tail & u->sq_mask] = tail & u->sq_mask;
+  tail++;
+  sqe = u->sqes + (tail & u->sq_mask);
+  memset (sqe, 0, sizeof (*sqe));
+  sqe->opcode = IORING_OP_LINK_TIMEOUT;
+  sqe->fd = -1;
+  sqe->addr = (uintptr_t)&u->ts;
+  sqe->len = 1;
+  sqe->user_data = 2;
+  u->sq_array[tail & u->sq_mask] = tail & u->sq_mask;
+  tail++;
+  __atomic_store_n (u->sq_tail, tail, __ATOMIC_RELEASE);
+
+  do {
+    ret = syscall (__NR_io_uring_enter, u->fd, 2, 2, IORING_ENTER_GETEVENTS, NULL, 0);
+  } while ((ret < 0) && (errno == EINTR));
+  if (ret < 0) {
+    u->state = -1;
+    return XIO_URING_FAIL;
+  }
+
+  /* the timeout always completes as well, wait for both. */
+  while (got < 2) {
+    head = *u->cq_head;
+    ctail = __atomic_load_n (u->cq_tail, __ATOMIC_ACQUIRE);
+    for (n = head; n != ctail; n++) {
+      struct io_uring_cqe *cqe = u->cqes + (n & u->cq_mask);
+      if (cqe->user_data == 1)
+        res = cqe->res == -ECANCELED ? -ETIME : cqe->res;
+      got++;
+    }
+    __atomic_store_n (u->cq_head, ctail, __ATOMIC_RELEASE);
+    if (got < 2) {
+      do {
+        ret = syscall (__NR_io_uring_enter, u->fd, 0, 2 - got, IORING_ENTER_GETEVENTS, NULL, 0);
+      } while ((ret < 0) && (errno == EINTR));
+      if (ret < 0) {
+        u->state = -1;
+        return XIO_URING_FAIL;
+      }
+    }
+  }
+  return res;
+}
+
+/* get exclusive use of the stream ring, or NULL. */
+static xio_uring_t *xio_uring_get (xine_stream_t *s) {
+  xine_stream_private_t *stream = (xine_stream_private_t *)s;
+  xine_private_t *xine;
+  xio_uring_t *u;
+
+  if (!stream)
+    return NULL;
+  xine = (xine_private_t *)stream->s.xine;
+  if (!xine->io_uring)
+    return NULL;
+  if (pthread_mutex_trylock (&stream->uring.lock))
+    return NULL;
+  u = stream->uring.ring;
+  if (!u) {
+    if (stream->uring.failed) {
+      pthread_mutex_unlock (&stream->uring.lock);
+      return NULL;
+    }
+    u = stream->uring.ring = xio_uring_new ();
+    if (!u) {
+      stream->uring.failed = 1;
+      xprintf (&xine->x, XINE_VERBOSITY_DEBUG, "io_helper: io_uring not available, using select ().\n");
+      pthread_mutex_unlock (&stream->uring.lock);
+      return NULL;
+    }
+  }
+  if (u->state < 0) {
+    pthread_mutex_unlock (&stream->uring.lock);
+    return NULL;
+  }
+  return u;
+}
+
+static void xio_uring_put (xine_stream_t *s) {
+  xine_stream_private_t *stream = (xine_stream_private_t *)s;
+  pthread_mutex_unlock (&stream->uring.lock);
+}
+
+void _x_io_uring_free (xine_stream_t *s) {
+  xine_stream_private_t *stream = (xine_stream_private_t *)s;
+  if (stream->uring.ring) {
+    xio_uring_delete (stream->uring.ring);
+    stream->uring.ring = NULL;
+  }
+}
+
+/* the io_uring version of the read loops below. return 0 (done), -1 (error),
+ * or XIO_URING_FAIL if caller shall continue the traditional way from *have. */
+static int xio_uring_read (xine_stream_t *stream, xio_uring_t *u, int op, int s,
+  uint8_t *buf, size_t min, size_t max, unsigned int timeout, size_t *have) {
+  unsigned int total_time_usec = 0;
+
+  while (*have < min) {
+    int ret = xio_uring_op (u, op, s, buf + *have, max - *have, XIO_POLLING_INTERVAL);
+    if (ret > 0) {
+      u->state = 1;
+      *have += ret;
+      total_time_usec = 0;
+      continue;
+    }
+    /* EOF */
+    if (ret == 0)
+      break;
+    if (ret == -ETIME) {
+      if (_x_action_pending (stream)) {
+        errno = EINTR;
+        return -1;
+      }
+      total_time_usec += XIO_POLLING_INTERVAL;
+      if (total_time_usec >= timeout * 1000) {
+        errno = ETIMEDOUT;
+        return -1;
+      }
+      continue;
+    }
+    if (ret == XIO_URING_FAIL)
+      return XIO_URING_FAIL;
+    if ((ret == -EINVAL) && !u->state) {
+      /* old kernel without this op. */
+      u->state = -1;
+      return XIO_URING_FAIL;
+    }
+    if (ret == -EAGAIN) {
+      /* not polled by kernel. dont spin, wait in select () instead. */
+      return XIO_URING_FAIL;
+    }
+    if (ret == -EINTR)
+      continue;
+    errno = -ret;
+    return xio_err (stream, -1);
+  }
+  return 0;
+}
+#endif
+
 off_t _x_io_tcp_read (xine_stream_t *stream, int s, void *buf_gen, off_t todo) {
   uint8_t *buf = buf_gen;
   unsigned int timeout;
@@ -559,6 +827,18 @@ off_t _x_io_tcp_read (xine_stream_t *stream, int s, void *buf_gen, off_t todo) {
     timeout = 30000; /* 30K msecs = 30 secs */
   }
 
+#ifdef HAVE_IO_URING
+  {
+    xio_uring_t *u = xio_uring_get (stream);
+    if (u) {
+      int r = xio_uring_read (stream, u, IORING_OP_RECV, s, buf, want, want, timeout, &have);
+      xio_uring_put (stream);
+      if (r != XIO_URING_FAIL)
+        return r < 0 ? r : (off_t)have;
+    }
+  }
+#endif
+
   while (have < want) {
     ssize_t ret;
     ret = _x_io_select (stream, s, XIO_READ_READY, timeout);
@@ -608,6 +888,18 @@ ssize_t _x_io_tcp_part_read (xine_stream_t *stream, int s, void *buf_gen, size_t
     return ret;
   }
 
+#ifdef HAVE_IO_URING
+  {
+    xio_uring_t *u = xio_uring_get (stream);
+    if (u) {
+      int r = xio_uring_read (stream, u, IORING_OP_RECV, s, buf, min, max, timeout, &have);
+      xio_uring_put (stream);
+      if (r != XIO_URING_FAIL)
+        return r < 0 ? r : (off_t)have;
+    }
+  }
+#endif
+
   while (have < min) {
     ssize_t ret;
     ret = _x_io_select (stream, s, XIO_READ_READY, timeout);
@@ -676,6 +968,18 @@ off_t _x_io_file_read (xine_stream_t *stream, int s, void *buf_gen, off_t todo)
     timeout = 30000; /* 30K msecs = 30 secs */
   }
 
+#ifdef HAVE_IO_URING
+  {
+    xio_uring_t *u = xio_uring_get (stream);
+    if (u) {
+      int r = xio_uring_read (stream, u, IORING_OP_READ, s, buf, want, want, timeout, &have);
+      xio_uring_put (stream);
+      if (r != XIO_URING_FAIL)
+        return r < 0 ? r : (off_t)have;
+    }
+  }
+#endif
+
   while (have < want) {
     ssize_t ret;
     ret = _x_io_select (stream, s, XIO_READ_READY, timeout);
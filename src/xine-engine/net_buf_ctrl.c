@@ -1085,6 +1085,21 @@ int64_t xine_nbc_get_pos_pts (xine_nbc_t *this) {
   return r;
 }
 
+int xine_nbc_get_fill_ms (xine_nbc_t *this) {
+  int v = -1, a = -1;
+  if (!this)
+    return -1;
+  pthread_mutex_lock (&this->mutex);
+  if (this->has_video)
+    v = this->video.fill_pts;
+  if (this->has_audio)
+    a = this->audio.fill_pts + this->audio.out_pts;
+  pthread_mutex_unlock (&this->mutex);
+  if ((v < 0) || ((a >= 0) && (a < v)))
+    v = a;
+  return v < 0 ? -1 : v / 90;
+}
+
 xine_nbc_t *xine_nbc_init (xine_stream_t *stream) {
   xine_nbc_t *this;
   double video_fifo_factor, audio_fifo_factor;
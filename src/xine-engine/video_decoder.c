@@ -157,12 +157,20 @@ static void *video_decoder_loop (void *stream_gen) {
 
   while (running) {
     int handled, ignore;
+    int64_t pstats_t0 = 0;
     buf_element_t *buf;
 
     lprintf ("getting buffer...\n");
 
     buf = stream->s.video_fifo->tget (stream->s.video_fifo, running_ticket);
 
+    if (xine->pstats) {
+      int64_t put = xine_fifo_buf_time (buf);
+      pstats_t0 = xine_pstats_now ();
+      if (put)
+        xine_pstats_add (&stream->pstats.cur.video_queue, pstats_t0 - put);
+    }
+
     _x_extra_info_merge( stream->video_decoder_extra_info, buf->extra_info );
     stream->video_decoder_extra_info->seek_count = stream->video_seek_count;
 
@@ -267,6 +275,8 @@ static void *video_decoder_loop (void *stream_gen) {
 
         if (stream->video_decoder_plugin)
           stream->video_decoder_plugin->decode_data (stream->video_decoder_plugin, buf);
+        if (pstats_t0)
+          xine_pstats_add (&stream->pstats.cur.video_decode, xine_pstats_now () - pstats_t0);
 
         /* no need to lock again. it may have been reset from this thread inside
          * video_decoder_plugin->decode_data (), if at all.
@@ -627,7 +637,8 @@ int _x_video_decoder_init (xine_stream_t *s) {
     if (num_buffers > 5000)
       num_buffers = 5000;
 
-    stream->s.video_fifo = _x_fifo_buffer_new (num_buffers, 8192);
+    stream->s.video_fifo = _x_fifo_buffer_new_flags (num_buffers, 8192, FIFO_FLAG_SPSC | FIFO_FLAG_BUF_CACHE);
+    xine_fifo_stamp_set (stream->s.video_fifo, &((xine_private_t *)stream->s.xine)->pstats);
     if (stream->s.video_fifo == NULL) {
       xine_log (stream->s.xine, XINE_LOG_MSG, "video_decoder: can't allocated video fifo\n");
       return 0;
@@ -690,6 +701,12 @@ void _x_video_decoder_shutdown (xine_stream_t *s) {
   }
 
   if (stream->s.video_fifo) {
+    fifo_buffer_cache_stats_t stats;
+    if (_x_fifo_buffer_cache_stats (stream->s.video_fifo, &stats))
+      xprintf (stream->s.xine, XINE_VERBOSITY_DEBUG,
+        "video_decoder: buffer cache hits: alloc %u/%u, free %u/%u.\n",
+        (unsigned int)stats.alloc_hits, (unsigned int)(stats.alloc_hits + stats.alloc_misses),
+        (unsigned int)stats.free_hits, (unsigned int)(stats.free_hits + stats.free_misses));
     stream->s.video_fifo->dispose (stream->s.video_fifo);
     stream->s.video_fifo = NULL;
   }
@@ -59,6 +59,14 @@
 #define FIRST_FRAME_POLL_DELAY   3000
 #define FIRST_FRAME_MAX_POLL       10    /* poll n times at most */
 
+/* precise frame pacing (engine.performance.precise_pacing):
+ * wait on the trigger condition until VO_PACING_SLEEP_MARGIN before the frame
+ * is due, then clock_nanosleep () until VO_PACING_SPIN before, then spin. */
+#define VO_PACING_SLEEP_MARGIN     2000  /* us */
+#define VO_PACING_SPIN             300   /* us */
+#define VO_PACING_MISS             2000  /* us */
+#define VO_PACING_STATS_FRAMES     64
+
 /*
 #define ADD_KEYFRAME_INDEX
 */
@@ -69,6 +77,22 @@
  */
 #define EXPERIMENTAL_FRAME_QUEUE_OPTIMIZATION 1
 
+/* Lock free frame hand-off.
+ * Frame producers (decoders to display queue, frame unlockers to free queue)
+ * push to an atomic inbox stack. Consumers take the whole stack with a
+ * single exchange, and sort it into the mutex protected list when needed.
+ * This way, the render thread never waits for a decoder holding a queue
+ * mutex, and vo_frame_dec_lock () does not wait for vo_free_queue_get ()
+ * scanning for a matching format. */
+#if defined(__GNUC__) && (HAVE_ATOMIC_VARS > 0) && (HAVE_ATOMIC_VARS < 3)
+#  define VO_LF_QUEUE
+#  define VO_ATGET(_v) __atomic_load_n (&(_v), __ATOMIC_SEQ_CST)
+#  define VO_ATSET(_v,_n) __atomic_store_n (&(_v), (_n), __ATOMIC_SEQ_CST)
+#else
+#  define VO_ATGET(_v) (_v)
+#  define VO_ATSET(_v,_n) (_v) = (_n)
+#endif
+
 typedef struct vos_grab_video_frame_s vos_grab_video_frame_t;
 struct vos_grab_video_frame_s {
   xine_grab_video_frame_t grab_frame;
@@ -77,6 +101,7 @@ struct vos_grab_video_frame_s {
   int finished;
   xine_video_port_t *video_port;
   vo_frame_t *vo_frame;
+  vo_frame_t *held; /* zero copy mode */
   yuv2rgb_factory_t *yuv2rgb_factory;
   yuv2rgb_t *yuv2rgb;
   int vo_width, vo_height;
@@ -112,6 +137,10 @@ typedef struct {
     int                     num_buffers;
     int                     num_buffers_max;
     int                     locked_for_read;
+    /* lock free part, see VO_LF_QUEUE. */
+    vo_frame_t             *inbox;
+    int                     inbox_num;
+    int                     waiting;
   } free_queue;
 
   struct {
@@ -122,6 +151,10 @@ typedef struct {
     vo_frame_t            **add;
     int                     num_buffers;
     int                     locked_for_read;
+    /* lock free part, see VO_LF_QUEUE. */
+    vo_frame_t             *inbox;
+    int                     inbox_num;
+    int                     waiting;
     /* The flush protocol. */
     int                     discard_frames;
     int                     flushed;
@@ -165,6 +198,14 @@ typedef struct {
     /* Wakeup time. */
     struct timespec         now;
     int                     speed;
+    /* Frame pacing: planned display time of next frame (monotonic us),
+     * 0 if unknown, and last vsync aligned display time. */
+    int64_t                 pace_due;
+    int64_t                 pace_grid;
+    /* Frame pacing error stats, published to pace_* below. */
+    int64_t                 pace_sum;
+    int                     pace_num;
+    int                     pace_peak;
   } rp;
 
   /* Get grab_lock when
@@ -205,6 +246,13 @@ typedef struct {
 
   int                       disable_decoder_flush_from_video_out;
 
+  /* frame pacing config and stats, see vo_pace_wait (). */
+  int                       pace_precise;
+  int                       pace_period; /* vsync period in us, 0 = unknown */
+  int                       pace_error;
+  int                       pace_error_max;
+  int                       pace_misses;
+
   /* pts value when decoder delivered last video frame */
   int64_t                   last_delivery_pts;
 
@@ -220,6 +268,16 @@ typedef struct {
   int                       frame_drop_cpt;
   int                       frame_drop_suggested;
 
+  /* smooth frame drop scheduler, see vo_drop_schedule (). */
+  int                       drop_smooth;
+  struct {
+    int64_t                 last_time; /* last frame delivery (vpts) */
+    int                     interval;  /* average delivery interval (vpts << 4) */
+    int                     rate;      /* skip rate, 256 = every frame */
+    int                     acc;       /* error diffusion */
+    int                     nonref;    /* > 0 if stream recently had b-frames */
+  } drop;
+
   int                       crop_left, crop_right, crop_top, crop_bottom;
 
   struct {
@@ -416,12 +474,123 @@ static void vo_unref_obsolete (vos_t *this) {
  * frame queue (fifo)                                               *
  *******************************************************************/
 
+/* Sort list into queue by vpts. Keep arrival order for equal vpts.
+ * Most of the time, list is already sorted and newer than queue.
+ * Returns number of frames added. */
+static int vo_list_merge_vpts (vo_frame_t **first, vo_frame_t ***add, vo_frame_t *list) {
+  vo_frame_t **pos = first, *last = NULL;
+  int n = 0;
+
+  while (list) {
+    vo_frame_t *img = list, *f;
+    list = img->next;
+    if (last && (last->vpts > img->vpts))
+      pos = first;
+    while ((f = *pos) && (f->vpts <= img->vpts))
+      pos = &f->next;
+    img->next = f;
+    *pos = img;
+    if (!f)
+      *add = &img->next;
+    pos = &img->next;
+    last = img;
+    n++;
+  }
+  return n;
+}
+
+#ifdef VO_LF_QUEUE
+/* lock free, any thread. list order is not preserved.
+ * returns 1 if inbox was empty before. */
+static int vo_inbox_push (vo_frame_t **inbox, int *num, vo_frame_t *first, vo_frame_t **add, int n) {
+  vo_frame_t *top = __atomic_load_n (inbox, __ATOMIC_RELAXED);
+
+  do {
+    *add = top;
+  } while (!__atomic_compare_exchange_n (inbox, &top, first, 1, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED));
+  __atomic_fetch_add (num, n, __ATOMIC_RELAXED);
+  return top == NULL;
+}
+
+/* wait free, any thread. returns inbox in push order, and sets *add to its end. */
+static vo_frame_t *vo_inbox_take (vo_frame_t **inbox, int *num, vo_frame_t ***add, int *n) {
+  vo_frame_t *list = NULL, *f = __atomic_exchange_n (inbox, NULL, __ATOMIC_SEQ_CST);
+  int i = 0;
+
+  if (f)
+    *add = &f->next;
+  while (f) {
+    vo_frame_t *next = f->next;
+    f->next = list;
+    list = f;
+    f = next;
+    i++;
+  }
+  if (i)
+    __atomic_fetch_sub (num, i, __ATOMIC_RELAXED);
+  *n = i;
+  return list;
+}
+#endif
+
+/* have this->free_queue.mutex locked!! */
+static void vo_free_queue_drain (vos_t *this) {
+#ifdef VO_LF_QUEUE
+  vo_frame_t *list, **add = NULL;
+  int n;
+
+  if (!__atomic_load_n (&this->free_queue.inbox, __ATOMIC_RELAXED))
+    return;
+  list = vo_inbox_take (&this->free_queue.inbox, &this->free_queue.inbox_num, &add, &n);
+  if (!list)
+    return;
+  n += this->free_queue.first ? this->free_queue.num_buffers : 0;
+  *(this->free_queue.add) = list;
+  this->free_queue.add    = add;
+  this->free_queue.num_buffers = n;
+#else
+  (void)this;
+#endif
+}
+
+/* have this->display_queue.mutex locked!! */
+static void vo_display_queue_drain (vos_t *this) {
+#ifdef VO_LF_QUEUE
+  vo_frame_t *list, **add = NULL;
+  int n;
+
+  if (!__atomic_load_n (&this->display_queue.inbox, __ATOMIC_RELAXED))
+    return;
+  list = vo_inbox_take (&this->display_queue.inbox, &this->display_queue.inbox_num, &add, &n);
+  if (!list)
+    return;
+  if (!this->display_queue.first)
+    this->display_queue.num_buffers = 0;
+  this->display_queue.num_buffers +=
+    vo_list_merge_vpts (&this->display_queue.first, &this->display_queue.add, list);
+#else
+  (void)this;
+#endif
+}
+
+/* any thread, no lock needed. */
+static int vo_display_queue_pending (vos_t *this) {
+#ifdef VO_LF_QUEUE
+  if (__atomic_load_n (&this->display_queue.inbox, __ATOMIC_SEQ_CST))
+    return 1;
+#endif
+  return this->display_queue.first != NULL;
+}
+
 static void vo_free_queue_open (vos_t *this) {
 #ifndef HAVE_ZERO_SAFE_MEM
   this->free_queue.first           = NULL;
   this->free_queue.num_buffers     = 0;
   this->free_queue.num_buffers_max = 0;
   this->free_queue.locked_for_read = 0;
+  this->free_queue.inbox           = NULL;
+  this->free_queue.inbox_num       = 0;
+  this->free_queue.waiting         = 0;
 #endif
   this->free_queue.add             = &this->free_queue.first;
   pthread_mutex_init (&this->free_queue.mutex, NULL);
@@ -437,6 +606,9 @@ static void vo_display_queue_open (vos_t *this) {
   this->display_queue.flushed           = 0;
   this->display_queue.flush_extra       = 0;
   this->display_queue.num_flush_waiters = 0;
+  this->display_queue.inbox             = NULL;
+  this->display_queue.inbox_num         = 0;
+  this->display_queue.waiting           = 0;
 #endif
   this->display_queue.add               = &this->display_queue.first;
   pthread_mutex_init (&this->display_queue.mutex, NULL);
@@ -476,6 +648,7 @@ static vo_frame_t *vo_free_queue_get_all (vos_t *this) {
   vo_frame_t *list;
 
   pthread_mutex_lock (&this->free_queue.mutex);
+  vo_free_queue_drain (this);
   list = this->free_queue.first;
   this->free_queue.first = NULL;
   this->free_queue.add   = &this->free_queue.first;
@@ -488,6 +661,7 @@ static vo_frame_t *vo_display_queue_get_all (vos_t *this) {
   vo_frame_t *list;
 
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_drain (this);
   list = this->display_queue.first;
   this->display_queue.first = NULL;
   this->display_queue.add   = &this->display_queue.first;
@@ -514,6 +688,7 @@ static void vo_free_queue_read_lock (vos_t *this) {
 static void vo_free_queue_read_unlock (vos_t *this) {
   pthread_mutex_lock (&this->free_queue.mutex);
   this->free_queue.locked_for_read = 0;
+  vo_free_queue_drain (this);
   if (this->free_queue.first)
     pthread_cond_signal (&this->free_queue.not_empty);
   pthread_mutex_unlock (&this->free_queue.mutex);
@@ -527,8 +702,12 @@ static void vo_ticket_revoked (void *user_data, int flags) {
   xprintf (&this->xine->x, XINE_VERBOSITY_DEBUG, LOG_MODULE ": port ticket revoked%s%s.\n", s1, s2);
 }
 
-static void vo_display_reref_append (vos_t *this, vo_frame_t *img) {
-  xine_stream_private_t **s, *olds, *news;
+/* returns 1 if display queue was empty before. */
+static int vo_display_reref_append (vos_t *this, vo_frame_t *img) {
+  xine_stream_private_t **s, *news;
+#ifndef VO_LF_QUEUE
+  xine_stream_private_t *olds;
+#endif
   /* img already enqueue? (serious leak) */
   _x_assert (img->next == NULL);
   img->next = NULL;
@@ -537,6 +716,22 @@ static void vo_display_reref_append (vos_t *this, vo_frame_t *img) {
     ? this->display_queue.img_streams + img->id
     : &news;
   news = (xine_stream_private_t *)img->stream;
+#ifdef VO_LF_QUEUE
+  {
+    int empty;
+    /* stream change is rare, and needs the lock. */
+    if (__atomic_load_n (s, __ATOMIC_RELAXED) != news)
+      vo_reref (this, img);
+    empty = vo_inbox_push (&this->display_queue.inbox, &this->display_queue.inbox_num, img, &img->next, 1);
+    if (__atomic_load_n (&this->display_queue.waiting, __ATOMIC_SEQ_CST)) {
+      /* xine_get_next_video_frame () is waiting. */
+      pthread_mutex_lock (&this->display_queue.mutex);
+      pthread_cond_signal (&this->display_queue.not_empty);
+      pthread_mutex_unlock (&this->display_queue.mutex);
+    }
+    return empty;
+  }
+#else
   pthread_mutex_lock (&this->display_queue.mutex);
   olds = *s;
   if (olds != news) {
@@ -553,6 +748,7 @@ static void vo_display_reref_append (vos_t *this, vo_frame_t *img) {
     pthread_mutex_unlock (&this->display_queue.mutex);
     if (olds)
       xine_refs_sub (&olds->refs, 1); /* this may involve stream dispose. */
+    return n == 1;
   } else {
     int n = (this->display_queue.first ? this->display_queue.num_buffers : 0) + 1;
     *(this->display_queue.add) = img;
@@ -561,15 +757,27 @@ static void vo_display_reref_append (vos_t *this, vo_frame_t *img) {
     if (n > this->display_queue.locked_for_read)
       pthread_cond_signal (&this->display_queue.not_empty);
     pthread_mutex_unlock (&this->display_queue.mutex);
+    return n == 1;
   }
+#endif
 }
 
 static void vo_free_append (vos_t *this, vo_frame_t *img) {
+#ifndef VO_LF_QUEUE
   int n;
+#endif
 
   /* img already enqueue? (serious leak) */
   _x_assert (img->next==NULL);
 
+#ifdef VO_LF_QUEUE
+  vo_inbox_push (&this->free_queue.inbox, &this->free_queue.inbox_num, img, &img->next, 1);
+  if (__atomic_load_n (&this->free_queue.waiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock (&this->free_queue.mutex);
+    pthread_cond_signal (&this->free_queue.not_empty);
+    pthread_mutex_unlock (&this->free_queue.mutex);
+  }
+#else
   pthread_mutex_lock (&this->free_queue.mutex);
   img->next = NULL;
   n = (this->free_queue.first ? this->free_queue.num_buffers : 0) + 1;
@@ -579,12 +787,21 @@ static void vo_free_append (vos_t *this, vo_frame_t *img) {
   if (n > this->free_queue.locked_for_read)
     pthread_cond_signal (&this->free_queue.not_empty);
   pthread_mutex_unlock (&this->free_queue.mutex);
+#endif
 }
 
 static void vo_free_append_list (vos_t *this, vo_frame_t *img, vo_frame_t **add, int n) {
   if (!img)
     return;
 
+#ifdef VO_LF_QUEUE
+  vo_inbox_push (&this->free_queue.inbox, &this->free_queue.inbox_num, img, add, n);
+  if (__atomic_load_n (&this->free_queue.waiting, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock (&this->free_queue.mutex);
+    pthread_cond_broadcast (&this->free_queue.not_empty);
+    pthread_mutex_unlock (&this->free_queue.mutex);
+  }
+#else
   pthread_mutex_lock (&this->free_queue.mutex);
 
   *(this->free_queue.add) = img;
@@ -596,6 +813,7 @@ static void vo_free_append_list (vos_t *this, vo_frame_t *img, vo_frame_t **add,
   if (n > this->free_queue.locked_for_read)
     pthread_cond_broadcast (&this->free_queue.not_empty);
   pthread_mutex_unlock (&this->free_queue.mutex);
+#endif
 }
 
 static vo_frame_t *vo_free_queue_pop_int (vos_t *this) {
@@ -634,6 +852,7 @@ static vo_frame_t *vo_get_unblock_frame (vos_t *this) {
   vo_frame_t *f, **add;
   /* Try 1: free queue reserve. */
   pthread_mutex_lock (&this->free_queue.mutex);
+  vo_free_queue_drain (this);
   if (this->free_queue.first) {
     f = vo_free_queue_pop_int (this);
     pthread_mutex_unlock (&this->free_queue.mutex);
@@ -643,6 +862,7 @@ static vo_frame_t *vo_get_unblock_frame (vos_t *this) {
   pthread_mutex_unlock (&this->free_queue.mutex);
   /* Try 2: shared display queue. */
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_drain (this);
   add = &this->display_queue.first;
   while ((f = *add)) {
     if (f->lock_counter <= 2)
@@ -676,6 +896,7 @@ static vo_frame_t *vo_free_queue_get (vos_t *this,
   pthread_mutex_lock (&this->free_queue.mutex);
 
   do {
+    vo_free_queue_drain (this);
     add = &this->free_queue.first;
     if (this->free_queue.num_buffers > this->free_queue.locked_for_read) {
       img = *add;
@@ -743,7 +964,15 @@ static vo_frame_t *vo_free_queue_get (vos_t *this,
         struct timespec ts = {0, 0};
         xine_gettime (&ts);
         ts.tv_sec += 1;
+#ifdef VO_LF_QUEUE
+        /* tell frame unlockers to signal us, then test again. */
+        __atomic_fetch_add (&this->free_queue.waiting, 1, __ATOMIC_SEQ_CST);
+        if (!__atomic_load_n (&this->free_queue.inbox, __ATOMIC_SEQ_CST))
+          pthread_cond_timedwait (&this->free_queue.not_empty, &this->free_queue.mutex, &ts);
+        __atomic_fetch_sub (&this->free_queue.waiting, 1, __ATOMIC_RELAXED);
+#else
         pthread_cond_timedwait (&this->free_queue.not_empty, &this->free_queue.mutex, &ts);
+#endif
       }
     }
   } while (!img);
@@ -768,6 +997,7 @@ static vo_frame_t *vo_free_get_dupl (vos_t *this, vo_frame_t *s) {
   vo_frame_t *img, **add;
 
   pthread_mutex_lock (&this->free_queue.mutex);
+  vo_free_queue_drain (this);
 
   add = &this->free_queue.first;
   while ((img = *add)) {
@@ -886,7 +1116,8 @@ static void vo_wait_flush (vos_t *this) {
   this->trigger_drawing.draw = 1;
   pthread_cond_signal (&this->trigger_drawing.wake);
   pthread_mutex_unlock (&this->trigger_drawing.mutex);
-  while (this->display_queue.flush_extra || this->display_queue.first)
+  /* test inbox before flush_extra, see vo_ready_refill (). */
+  while (vo_display_queue_pending (this) || VO_ATGET (this->display_queue.flush_extra))
     pthread_cond_wait (&this->display_queue.done_flushing, &this->display_queue.mutex);
   this->display_queue.num_flush_waiters--;
 }
@@ -909,6 +1140,7 @@ static void vo_list_flush (vos_t *this, vo_frame_t *f) {
 static void vo_manual_flush (vos_t *this) {
   vo_frame_t *f;
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_drain (this);
   f = this->display_queue.first;
   this->display_queue.first = NULL;
   this->display_queue.add   = &this->display_queue.first;
@@ -922,6 +1154,20 @@ static void vo_manual_flush (vos_t *this) {
  * grabbing RGB images from displayed frames                        *
  *******************************************************************/
 
+static void vo_release_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
+  vos_grab_video_frame_t *frame = (vos_grab_video_frame_t *) frame_gen;
+
+  if (frame->held)
+    vo_frame_dec_lock (frame->held);
+  frame->held = NULL;
+  frame->grab_frame.format = 0;
+  frame->grab_frame.frame_width = 0;
+  frame->grab_frame.frame_height = 0;
+  frame->grab_frame.planes[0] = frame->grab_frame.planes[1] = frame->grab_frame.planes[2] = NULL;
+  frame->grab_frame.pitches[0] = frame->grab_frame.pitches[1] = frame->grab_frame.pitches[2] = 0;
+}
+
+
 static void vo_dispose_grab_video_frame(xine_grab_video_frame_t *frame_gen)
 {
   vos_grab_video_frame_t *frame = (vos_grab_video_frame_t *) frame_gen;
@@ -929,6 +1175,8 @@ static void vo_dispose_grab_video_frame(xine_grab_video_frame_t *frame_gen)
   if (frame->vo_frame)
     vo_frame_dec_lock(frame->vo_frame);
 
+  vo_release_grab_video_frame (frame_gen);
+
   if (frame->yuv2rgb)
     frame->yuv2rgb->dispose(frame->yuv2rgb);
 
@@ -941,13 +1189,11 @@ static void vo_dispose_grab_video_frame(xine_grab_video_frame_t *frame_gen)
 }
 
 
-static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
-  vos_grab_video_frame_t *frame = (vos_grab_video_frame_t *) frame_gen;
+/* get a locked reference to last or next displayed frame.
+ * returns 0 if successful, 1 on timeout and -1 on error. */
+static int vo_grab_get_frame (vos_grab_video_frame_t *frame, vo_frame_t **ret) {
   vos_t *this = (vos_t *) frame->video_port;
   vo_frame_t *vo_frame;
-  int format, y_stride, uv_stride;
-  int width, height;
-  uint8_t *base[3];
 
   if (frame->grab_frame.flags & XINE_GRAB_VIDEO_FRAME_FLAGS_WAIT_NEXT) {
     struct timespec ts = {0, 0};
@@ -1012,13 +1258,24 @@ static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
     frame->grab_frame.vpts = vo_frame->vpts;
   }
 
-  width = vo_frame->width;
-  height = vo_frame->height;
+  *ret = vo_frame;
+  return 0;
+}
+
+
+/* find cropped standard format planes of vo_frame.
+ * returns format, or 0 on error. */
+static int vo_grab_planes (vos_grab_video_frame_t *frame, vo_frame_t *vo_frame,
+  uint8_t *base[3], int *y_stride, int *uv_stride, int *width, int *height) {
+  int format;
+
+  *width = vo_frame->width;
+  *height = vo_frame->height;
 
   if (vo_frame->format == XINE_IMGFMT_YV12 || vo_frame->format == XINE_IMGFMT_YUY2) {
     format = vo_frame->format;
-    y_stride = vo_frame->pitches[0];
-    uv_stride = vo_frame->pitches[1];
+    *y_stride = vo_frame->pitches[0];
+    *uv_stride = vo_frame->pitches[1];
     base[0] = vo_frame->base[0];
     base[1] = vo_frame->base[1];
     base[2] = vo_frame->base[2];
@@ -1032,8 +1289,8 @@ static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
       frame->img_size = data.img_size;
       frame->img = calloc(data.img_size, sizeof(uint8_t));
       if (!frame->img) {
-        vo_frame_dec_lock(vo_frame);
-        return -1; /* error happened */
+        frame->img_size = 0;
+        return 0; /* error happened */
       }
     }
     data.img = frame->img;
@@ -1041,16 +1298,16 @@ static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
     format = data.format;
     if (format == XINE_IMGFMT_YV12) {
       base[0] = data.img;
-      base[1] = data.img + width * height;
-      base[2] = data.img + width * height + ((width * height) >> 2);
-      y_stride  = width;
-      uv_stride = width >> 1;
+      base[1] = data.img + *width * *height;
+      base[2] = data.img + *width * *height + ((*width * *height) >> 2);
+      *y_stride  = *width;
+      *uv_stride = *width >> 1;
     } else { // XINE_IMGFMT_YUY2
       base[0] = data.img;
       base[1] = NULL;
       base[2] = NULL;
-      y_stride  = width * 2;
-      uv_stride = 0;
+      *y_stride  = *width * 2;
+      *uv_stride = 0;
     }
   }
 
@@ -1062,28 +1319,37 @@ static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
     int crop_bottom =  vo_frame->crop_bottom + frame->grab_frame.crop_bottom;
 
     if (crop_left || crop_right || crop_top || crop_bottom) {
-      if ((width - crop_left - crop_right) >= 8)
-        width = width - crop_left - crop_right;
+      if ((*width - crop_left - crop_right) >= 8)
+        *width = *width - crop_left - crop_right;
       else
         crop_left = crop_right = 0;
 
-      if ((height - crop_top - crop_bottom) >= 8)
-        height = height - crop_top - crop_bottom;
+      if ((*height - crop_top - crop_bottom) >= 8)
+        *height = *height - crop_top - crop_bottom;
       else
         crop_top = crop_bottom = 0;
 
       if (format == XINE_IMGFMT_YV12) {
         size_t uv_offs;
-        base[0] += crop_top * y_stride + crop_left;
-        uv_offs = (crop_top >> 1) * uv_stride + (crop_left >> 1);
+        base[0] += crop_top * *y_stride + crop_left;
+        uv_offs = (crop_top >> 1) * *uv_stride + (crop_left >> 1);
         base[1] += uv_offs;
         base[2] += uv_offs;
       } else { // XINE_IMGFMT_YUY2
-        base[0] += crop_top * y_stride + crop_left * 2;
+        base[0] += crop_top * *y_stride + crop_left * 2;
       }
     }
   }
 
+  return format;
+}
+
+
+/* convert cropped planes of vo_frame to RGB grab_frame.img.
+ * returns 0 if successful, and -1 on error. */
+static int vo_grab_rgb (vos_grab_video_frame_t *frame, vo_frame_t *vo_frame, int format,
+  uint8_t *base[3], int y_stride, int uv_stride, int width, int height) {
+
   /* get pixel aspect ratio */
   {
     double sar = 1.0;
@@ -1115,20 +1381,16 @@ static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
   }
   if (frame->grab_frame.img == NULL) {
     frame->grab_frame.img = (uint8_t *) calloc(frame->grab_frame.width * frame->grab_frame.height, 3);
-    if (frame->grab_frame.img == NULL) {
-      vo_frame_dec_lock(vo_frame);
+    if (frame->grab_frame.img == NULL)
       return -1; /* error happened */
-    }
   }
 
   /* initialize yuv2rgb factory */
   if (!frame->yuv2rgb_factory) {
     int cm = VO_GET_FLAGS_CM (vo_frame->flags);
     frame->yuv2rgb_factory = yuv2rgb_factory_init(MODE_24_RGB, 0, NULL);
-    if (!frame->yuv2rgb_factory) {
-      vo_frame_dec_lock(vo_frame);
+    if (!frame->yuv2rgb_factory)
       return -1; /* error happened */
-    }
     if ((cm >> 1) == 2) /* color matrix undefined */
       cm = (cm & 1) |
         ((vo_frame->height - vo_frame->crop_top - vo_frame->crop_bottom >= 720) ||
@@ -1141,10 +1403,8 @@ static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
   /* retrieve a yuv2rgb converter */
   if (!frame->yuv2rgb) {
     frame->yuv2rgb = frame->yuv2rgb_factory->create_converter(frame->yuv2rgb_factory);
-    if (!frame->yuv2rgb) {
-      vo_frame_dec_lock(vo_frame);
+    if (!frame->yuv2rgb)
       return -1; /* error happened */
-    }
   }
 
   /* configure yuv2rgb converter */
@@ -1169,17 +1429,69 @@ static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
   else
     frame->yuv2rgb->yuy22rgb_fun(frame->yuv2rgb, frame->grab_frame.img, base[0]);
 
-  vo_frame_dec_lock(vo_frame);
   return 0;
 }
 
 
+static int vo_grab_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
+  vos_grab_video_frame_t *frame = (vos_grab_video_frame_t *) frame_gen;
+  vo_frame_t *vo_frame;
+  int format, y_stride, uv_stride, width, height, res;
+  uint8_t *base[3];
+
+  /* zero copy: drop previous frame first, it may still block the decoder. */
+  vo_release_grab_video_frame (frame_gen);
+
+  res = vo_grab_get_frame (frame, &vo_frame);
+  if (res)
+    return res;
+
+  format = vo_grab_planes (frame, vo_frame, base, &y_stride, &uv_stride, &width, &height);
+  if (!format) {
+    vo_frame_dec_lock(vo_frame);
+    return -1; /* error happened */
+  }
+
+  if (frame->grab_frame.flags & XINE_GRAB_VIDEO_FRAME_FLAGS_ZERO_COPY) {
+    /* just keep the reference. */
+    frame->held = vo_frame;
+    frame->grab_frame.format = format;
+    frame->grab_frame.frame_width = width;
+    frame->grab_frame.frame_height = height;
+    frame->grab_frame.planes[0] = base[0];
+    frame->grab_frame.planes[1] = base[1];
+    frame->grab_frame.planes[2] = base[2];
+    frame->grab_frame.pitches[0] = y_stride;
+    frame->grab_frame.pitches[1] = uv_stride;
+    frame->grab_frame.pitches[2] = uv_stride;
+    return 0;
+  }
+
+  res = vo_grab_rgb (frame, vo_frame, format, base, y_stride, uv_stride, width, height);
+  vo_frame_dec_lock(vo_frame);
+  return res;
+}
+
+
+static int vo_convert_grab_video_frame (xine_grab_video_frame_t *frame_gen) {
+  vos_grab_video_frame_t *frame = (vos_grab_video_frame_t *) frame_gen;
+
+  if (!frame->held)
+    return 1; /* no frame available */
+  return vo_grab_rgb (frame, frame->held, frame->grab_frame.format, frame->grab_frame.planes,
+    frame->grab_frame.pitches[0], frame->grab_frame.pitches[1],
+    frame->grab_frame.frame_width, frame->grab_frame.frame_height);
+}
+
+
 static xine_grab_video_frame_t *vo_new_grab_video_frame(xine_video_port_t *this_gen)
 {
   vos_grab_video_frame_t *frame = calloc(1, sizeof(vos_grab_video_frame_t));
   if (frame) {
     frame->grab_frame.dispose = vo_dispose_grab_video_frame;
     frame->grab_frame.grab = vo_grab_grab_video_frame;
+    frame->grab_frame.convert = vo_convert_grab_video_frame;
+    frame->grab_frame.release = vo_release_grab_video_frame;
     frame->grab_frame.vpts = -1;
     frame->grab_frame.timeout = XINE_GRAB_VIDEO_FRAME_DEFAULT_TIMEOUT;
     frame->video_port = this_gen;
@@ -1315,6 +1627,7 @@ static vo_frame_t *vo_get_frame (xine_video_port_t *this_gen,
     img->overlay_offset_x = 0;
     img->overlay_offset_y = 0;
     img->stream         = NULL;
+    img->draw_time      = 0;
 
     _x_extra_info_reset ( img->extra_info );
 
@@ -1343,8 +1656,8 @@ static vo_frame_t *vo_get_frame (xine_video_port_t *this_gen,
   {
     int frames_used;
     frames_used = this->frames_total;
-    frames_used -= this->free_queue.num_buffers;
-    frames_used -= this->display_queue.num_buffers;
+    frames_used -= this->free_queue.num_buffers + VO_ATGET (this->free_queue.inbox_num);
+    frames_used -= this->display_queue.num_buffers + VO_ATGET (this->display_queue.inbox_num);
     frames_used -= this->rp.ready_num;
     frames_used += this->frames_extref;
     if (frames_used > this->frames_peak_used)
@@ -1411,6 +1724,7 @@ static vo_frame_t * crop_frame( xine_video_port_t *this_gen, vo_frame_t *img ) {
 
   dupl->duration  = img->duration;
   dupl->is_first  = img->is_first;
+  dupl->draw_time = img->draw_time;
 
   dupl->stream    = img->stream;
 
@@ -1422,6 +1736,67 @@ static vo_frame_t * crop_frame( xine_video_port_t *this_gen, vo_frame_t *img ) {
   return dupl;
 }
 
+/* Smooth frame drop scheduler.
+ * Estimate decoder speed from frame delivery intervals, and turn the speed
+ * deficit plus the number of frames we are behind into a skip rate. Then,
+ * spread skip hints evenly over frames using error diffusion.
+ * Hint 2 asks decoders to skip non-reference frames only (libmpeg2 b-frames,
+ * ffmpeg AVDISCARD_NONREF). Hint 3 lets libmpeg2 also skip p-frames, and is
+ * only used when we are far behind, or the stream has no b-frames at all. */
+static int vo_drop_schedule (vos_t *this, vo_frame_t *img, int first_frame_flag) {
+  int duration = img->duration > 0 ? img->duration : DEFAULT_FRAME_DURATION;
+  int queued, behind = 0, speed, rate = 0;
+  int64_t d;
+
+  if (first_frame_flag >= 2) {
+    /* after seek, start over. */
+    this->drop.last_time = 0;
+    this->drop.rate      = 0;
+    this->drop.acc       = 0;
+  }
+
+  /* decoder throughput, 256 = real time. ignore pauses and seeks. */
+  d = this->last_delivery_pts - this->drop.last_time;
+  this->drop.last_time = this->last_delivery_pts;
+  if (this->drop.interval <= 0)
+    this->drop.interval = duration << 4;
+  if ((d >= 0) && (d <= 8 * duration))
+    this->drop.interval += ((d << 4) - this->drop.interval) >> 3;
+  /* long still frames would overflow int here. */
+  speed = this->drop.interval > 0 ? ((int64_t)duration << 12) / this->drop.interval : 256;
+  if (speed > 512)
+    speed = 512;
+
+  /* frame types, if decoder tells. */
+  if (img->picture_coding_type == 3)
+    this->drop.nonref = 64;
+  else if (img->picture_coding_type && (this->drop.nonref > 0))
+    this->drop.nonref--;
+
+  /* do not skip decoding until output fifo frames are consumed */
+  queued = this->display_queue.num_buffers + VO_ATGET (this->display_queue.inbox_num) + this->rp.ready_num;
+  if (queued < this->frame_drop_limit) {
+    behind = (this->last_delivery_pts - img->vpts) / duration + this->frame_drop_limit - queued;
+    if (behind > 0) {
+      rate = 256 - speed + behind * 32;
+      if (rate < 0)
+        rate = 0;
+      else if (rate > 256)
+        rate = 256;
+    }
+  }
+
+  this->drop.rate = (this->drop.rate * 3 + rate) >> 2;
+  this->drop.acc += this->drop.rate;
+  if (this->drop.acc < 256)
+    return 0;
+  this->drop.acc -= 256;
+
+  if ((behind >= 8) || ((behind >= 3) && img->picture_coding_type && (this->drop.nonref <= 0)))
+    return 3;
+  return 2;
+}
+
 static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
 
   xine_stream_private_t *stream = (xine_stream_private_t *)s;
@@ -1475,6 +1850,8 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
       }
     }
     img->stream = &stream->s;
+    if (this->xine->pstats)
+      img->draw_time = xine_pstats_now ();
     _x_extra_info_merge( img->extra_info, stream->video_decoder_extra_info );
     stream->s.metronom->got_video_frame (stream->s.metronom, img);
 #ifdef ADD_KEYFRAME_INDEX
@@ -1532,29 +1909,34 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
       this->frame_drop_cpt--;
     }
 
-    /* do not skip decoding until output fifo frames are consumed */
-    if (this->display_queue.num_buffers + this->rp.ready_num < this->frame_drop_limit) {
-      int duration = img->duration > 0 ? img->duration : DEFAULT_FRAME_DURATION;
-      frames_to_skip = (this->last_delivery_pts - img->vpts) / duration;
-      frames_to_skip = (frames_to_skip + this->frame_drop_limit) * 2;
-      if (frames_to_skip < 0)
-        frames_to_skip = 0;
-    } else {
-      frames_to_skip = 0;
-    }
-
-    /* Do not drop frames immediately, but remember this as suggestion and give
-     * decoder a further chance to supply frames.
-     * This avoids unnecessary frame drops in situations where there is only
-     * a very little number of image buffers, e. g. when using xxmc.
-     */
-    if (!frames_to_skip) {
-      this->frame_drop_suggested = 0;
+    if (this->drop_smooth) {
+      frames_to_skip = vo_drop_schedule (this, img, first_frame_flag);
     } else {
-      if (!this->frame_drop_suggested) {
-        this->frame_drop_suggested = 1;
+      /* do not skip decoding until output fifo frames are consumed */
+      if (this->display_queue.num_buffers + VO_ATGET (this->display_queue.inbox_num) + this->rp.ready_num
+        < this->frame_drop_limit) {
+        int duration = img->duration > 0 ? img->duration : DEFAULT_FRAME_DURATION;
+        frames_to_skip = (this->last_delivery_pts - img->vpts) / duration;
+        frames_to_skip = (frames_to_skip + this->frame_drop_limit) * 2;
+        if (frames_to_skip < 0)
+          frames_to_skip = 0;
+      } else {
         frames_to_skip = 0;
       }
+
+      /* Do not drop frames immediately, but remember this as suggestion and give
+       * decoder a further chance to supply frames.
+       * This avoids unnecessary frame drops in situations where there is only
+       * a very little number of image buffers, e. g. when using xxmc.
+       */
+      if (!frames_to_skip) {
+        this->frame_drop_suggested = 0;
+      } else {
+        if (!this->frame_drop_suggested) {
+          this->frame_drop_suggested = 1;
+          frames_to_skip = 0;
+        }
+      }
     }
 
     lprintf ("delivery diff : %" PRId64 ", current vpts is %" PRId64 ", %d frames to skip\n",
@@ -1654,9 +2036,7 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
 
     if (!img_already_locked)
       vo_frame_inc2_lock (img);
-    vo_display_reref_append (this, img);
-
-    if (img->is_first && (this->display_queue.first == img)) {
+    if (vo_display_reref_append (this, img) && img->is_first) {
       /* wake up render thread */
       pthread_mutex_lock (&this->trigger_drawing.mutex);
       this->trigger_drawing.draw = 1;
@@ -1751,11 +2131,34 @@ static int vo_frame_draw (vo_frame_t *img, xine_stream_t *s) {
 
 #define ADD_READY_FRAMES \
   if (this->rp.ready_num < 2) { \
-    if (!this->rp.ready_num || this->display_queue.first) \
+    if (!this->rp.ready_num || vo_display_queue_pending (this)) \
       vo_ready_refill (this); \
   }
 
 static void vo_ready_refill (vos_t *this) {
+#ifdef VO_LF_QUEUE
+  vo_frame_t *list, **add = NULL;
+  int n;
+
+  /* rare: another thread sorted the inbox into the shared queue. */
+  if (this->display_queue.first) {
+    pthread_mutex_lock (&this->display_queue.mutex);
+    list = this->display_queue.first;
+    this->display_queue.first = NULL;
+    this->display_queue.add = &this->display_queue.first;
+    this->display_queue.num_buffers = 0;
+    pthread_mutex_unlock (&this->display_queue.mutex);
+    this->rp.ready_num += vo_list_merge_vpts (&this->rp.ready_first, &this->rp.ready_add, list);
+  }
+  /* wait free. announce frames in flight before taking them,
+   * so vo_wait_flush () never sees them nowhere. */
+  if (__atomic_load_n (&this->display_queue.inbox, __ATOMIC_ACQUIRE)) {
+    VO_ATSET (this->display_queue.flush_extra, this->rp.ready_num + 1);
+    list = vo_inbox_take (&this->display_queue.inbox, &this->display_queue.inbox_num, &add, &n);
+    this->rp.ready_num += vo_list_merge_vpts (&this->rp.ready_first, &this->rp.ready_add, list);
+  }
+  VO_ATSET (this->display_queue.flush_extra, this->rp.ready_num);
+#else
   vo_frame_t *first, **add;
 
   pthread_mutex_lock (&this->display_queue.mutex);
@@ -1775,19 +2178,21 @@ static void vo_ready_refill (vos_t *this) {
 
   *(this->rp.ready_add) = first;
   this->rp.ready_add    = add;
+#endif
 }
 
 static vo_frame_t *vo_ready_get_all (vos_t *this) {
   vo_frame_t *first;
 
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_drain (this);
   first = this->display_queue.first;
   if (first) {
     this->display_queue.first = NULL;
     this->display_queue.add   = &this->display_queue.first;
     this->display_queue.num_buffers = 0;
   }
-  this->display_queue.flush_extra = 0;
+  VO_ATSET (this->display_queue.flush_extra, 0);
   this->rp.need_flush_signal = this->display_queue.num_flush_waiters;
   pthread_mutex_unlock (&this->display_queue.mutex);
 
@@ -1966,7 +2371,7 @@ static void check_redraw_needed (vos_t *this, int64_t vpts) {
   /* calling the frontend's frame output hook (via driver->redraw_needed () here)
    * while flushing (xine_stop ()) may freeze.
    */
-  if (!(this->display_queue.discard_frames && (this->rp.ready_first || this->display_queue.first))) {
+  if (!(this->display_queue.discard_frames && (this->rp.ready_first || vo_display_queue_pending (this)))) {
     if (this->driver->redraw_needed (this->driver))
       this->redraw_needed = 1;
   }
@@ -2096,6 +2501,10 @@ static vo_frame_t *next_frame (vos_t *this, int64_t *vpts) {
 
     {
       int64_t diff = *vpts - img->vpts, duration;
+      /* precise pacing wakes up right in time. dont miss a frame
+       * by a few clock ticks. */
+      if (this->pace_precise && (diff < 0) && (diff >= -90))
+        diff = 0;
       if (diff < 0) {
         /* still too early for this frame */
         *vpts = img->vpts;
@@ -2179,6 +2588,11 @@ static void overlay_and_display_frame (vos_t *this, vo_frame_t *img, int64_t vpt
     m = m->side_streams[0];
     /* Always post first frame time to make frontend relative seek work. */
     xine_current_extra_info_set (m, img->extra_info);
+    if (img->draw_time && this->xine->pstats) {
+      xine_pstats_add (&m->pstats.cur.video_ready, xine_pstats_now () - img->draw_time);
+      xine_pstats_add (&m->pstats.cur.video_late, (vpts - img->vpts) * 100 / 9);
+      img->draw_time = 0;
+    }
     /* First frame's native stream is the most common case.
      * Do it without streams lock.
      */
@@ -2219,7 +2633,7 @@ static void overlay_and_display_frame (vos_t *this, vo_frame_t *img, int64_t vpt
   /* calling the frontend's frame output hook (via driver->display_frame () here)
    * while flushing (xine_stop ()) may freeze.
    */
-  if (this->display_queue.discard_frames && (this->rp.ready_first || this->display_queue.first)) {
+  if (this->display_queue.discard_frames && (this->rp.ready_first || vo_display_queue_pending (this))) {
     img->free (img);
     this->redraw_needed = 0;
     return;
@@ -2353,6 +2767,72 @@ static void video_out_update_disable_flush_from_video_out(void *this_gen, xine_c
   this->disable_decoder_flush_from_video_out = entry->num_value;
 }
 
+static void video_out_update_precise_pacing (void *this_gen, xine_cfg_entry_t *entry) {
+  vos_t *this = (vos_t *)this_gen;
+  this->pace_precise = entry->num_value;
+}
+
+static void video_out_update_pacing_refresh_rate (void *this_gen, xine_cfg_entry_t *entry) {
+  vos_t *this = (vos_t *)this_gen;
+  this->pace_period = entry->num_value > 0 ? 1000000 / entry->num_value : 0;
+}
+
+/* frame is about to be displayed. measure against plan. */
+static void vo_pace_stats (vos_t *this) {
+  int64_t d;
+
+  if (!this->rp.pace_due)
+    return;
+  d = xine_pstats_now () - this->rp.pace_due;
+  this->rp.pace_grid = this->rp.pace_due;
+  this->rp.pace_due = 0;
+  if (d > VO_PACING_MISS)
+    this->pace_misses++;
+  if (d < 0)
+    d = -d;
+  if (d > 0x7fffffff)
+    d = 0x7fffffff;
+  this->rp.pace_sum += d;
+  if (d > this->rp.pace_peak)
+    this->rp.pace_peak = d;
+  if (++this->rp.pace_num >= VO_PACING_STATS_FRAMES) {
+    this->pace_error     = this->rp.pace_sum / this->rp.pace_num;
+    this->pace_error_max = this->rp.pace_peak;
+    this->rp.pace_sum  = 0;
+    this->rp.pace_num  = 0;
+    this->rp.pace_peak = 0;
+  }
+}
+
+/* snap planned display time to the vsync grid, if refresh rate is known.
+ * the grid follows our own previous display times, as we dont know the
+ * real vsync phase. always round up: next_frame () would reject a frame
+ * shown before its vpts, and we would spin until then. */
+static int64_t vo_pace_align (vos_t *this, int64_t due) {
+  int64_t p = this->pace_period, d = due - this->rp.pace_grid;
+
+  if ((p > 0) && (d >= 0) && (d < 1000000))
+    due = this->rp.pace_grid + (d + p - 1) / p * p;
+  return due;
+}
+
+/* we are close to due time now. sleep precisely, then spin the rest. */
+static void vo_pace_wait (int64_t due) {
+  int64_t t = due - VO_PACING_SPIN;
+#if defined(HAVE_POSIX_TIMERS) && defined(TIMER_ABSTIME)
+  struct timespec ts;
+
+  ts.tv_sec  = t / 1000000;
+  ts.tv_nsec = (t % 1000000) * 1000;
+  while (clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) ;
+#else
+  t -= xine_pstats_now ();
+  if (t > 0)
+    xine_usec_sleep (t);
+#endif
+  while (xine_pstats_now () < due) ;
+}
+
 static void *video_out_loop (void *this_gen) {
   vos_t *this = (vos_t *) this_gen;
 
@@ -2373,6 +2853,23 @@ static void *video_out_loop (void *this_gen) {
       "likely that these issues may reappear in case they haven't been fixed differently meanwhile.\n"),
     20, video_out_update_disable_flush_from_video_out, this);
 
+  this->pace_precise = this->xine->x.config->register_bool (this->xine->x.config,
+    "engine.performance.precise_pacing", 0,
+    _("precise video frame pacing"),
+    _("Wake up a little early, and wait for the exact frame display time with a short "
+      "busy loop. This reduces visible judder on 50/60 Hz displays, at the cost of "
+      "some cpu load."),
+    20, video_out_update_precise_pacing, this);
+  {
+    int rate = this->xine->x.config->register_num (this->xine->x.config,
+      "engine.performance.pacing_refresh_rate", 0,
+      _("display refresh rate for frame pacing"),
+      _("With precise frame pacing, show frames at multiples of this display refresh "
+        "period (Hz). 0 means unknown."),
+      20, video_out_update_pacing_refresh_rate, this);
+    this->pace_period = rate > 0 ? 1000000 / rate : 0;
+  }
+
   /*
    * here it is - the heart of xine (or rather: one of the hearts
    * of xine) : the video output loop
@@ -2385,14 +2882,16 @@ static void *video_out_loop (void *this_gen) {
   pthread_mutex_unlock (&this->trigger_drawing.mutex);
 
   while ( this->video_loop_running ) {
-    int64_t vpts, next_frame_vpts;
+    int64_t vpts, next_frame_vpts, mono;
     int64_t usec_to_sleep;
+    int due_reached;
 
     /* record current time as both speed dependent virtual presentation timestamp (vpts)
      * and absolute system time, and hope these are halfway in sync.
      */
     vpts = next_frame_vpts = this->clock->get_current_time (this->clock);
     xine_gettime (&this->rp.now);
+    mono = xine_pstats_now ();
     lprintf ("loop iteration at %" PRId64 "\n", vpts);
 
     this->rp.wakeups_total++;
@@ -2403,6 +2902,7 @@ static void *video_out_loop (void *this_gen) {
       /* if we have found a frame, display it */
       if (img) {
         lprintf ("displaying frame (id=%d)\n", img->id);
+        vo_pace_stats (this);
         overlay_and_display_frame (this, img, vpts);
         vo_grab_current_frame (this, img, vpts);
       } else if (this->redraw_needed) {
@@ -2429,7 +2929,7 @@ static void *video_out_loop (void *this_gen) {
      */
 
     if ((vpts - this->last_delivery_pts > 30000) &&
-        !this->display_queue.first && !this->rp.ready_first) {
+        !this->rp.ready_first && !vo_display_queue_pending (this)) {
       if (this->last_delivery_pts && !this->disable_decoder_flush_from_video_out) {
         xine_stream_private_t **s;
         xine_rwlock_rdlock (&this->streams_lock);
@@ -2479,10 +2979,21 @@ static void *video_out_loop (void *this_gen) {
       /* we don't know when the next frame is due, only wait a little */
       usec_to_sleep = this->rp.poll_time;
 
+    this->rp.pace_due = 0;
+    if (next_frame_vpts && this->rp.speed > 0) {
+      if (this->pace_precise) {
+        this->rp.pace_due = vo_pace_align (this, mono + usec_to_sleep);
+        usec_to_sleep = this->rp.pace_due - mono - VO_PACING_SLEEP_MARGIN;
+      } else {
+        this->rp.pace_due = mono + usec_to_sleep;
+      }
+    }
+
+    due_reached = 0;
     while (this->video_loop_running) {
       int timedout, wait;
 
-      if (this->display_queue.discard_frames && (this->rp.ready_first || this->display_queue.first))
+      if (this->display_queue.discard_frames && (this->rp.ready_first || vo_display_queue_pending (this)))
         break;
 
       if (this->rp.speed == XINE_SPEED_PAUSE) {
@@ -2492,8 +3003,10 @@ static void *video_out_loop (void *this_gen) {
 
       /* limit usec_to_sleep to maintain responsiveness */
       wait = usec_to_sleep;
-      if (wait <= 0)
+      if (wait <= 0) {
+        due_reached = 1;
         break;
+      }
       if (wait > this->rp.poll_limit)
         wait = this->rp.poll_limit;
 
@@ -2520,6 +3033,11 @@ static void *video_out_loop (void *this_gen) {
       if (!timedout && this->grab.last_frame)
         break;
     }
+
+    if (!due_reached)
+      this->rp.pace_due = 0;
+    else if (this->rp.pace_due && this->pace_precise)
+      vo_pace_wait (this->rp.pace_due);
   }
 
   /*
@@ -2573,6 +3091,7 @@ int xine_get_next_video_frame (xine_video_port_t *this_gen, xine_video_frame_t *
   struct timespec now = {0, 990000000};
 
   pthread_mutex_lock (&this->display_queue.mutex);
+  vo_display_queue_drain (this);
 
   while (!this->display_queue.first) {
     {
@@ -2596,8 +3115,17 @@ int xine_get_next_video_frame (xine_video_port_t *this_gen, xine_video_frame_t *
     }
     {
       struct timespec ts = now;
+#ifdef VO_LF_QUEUE
+      /* tell frame pushers to signal us, then test again. */
+      __atomic_fetch_add (&this->display_queue.waiting, 1, __ATOMIC_SEQ_CST);
+      if (!__atomic_load_n (&this->display_queue.inbox, __ATOMIC_SEQ_CST))
+        pthread_cond_timedwait (&this->display_queue.not_empty, &this->display_queue.mutex, &ts);
+      __atomic_fetch_sub (&this->display_queue.waiting, 1, __ATOMIC_RELAXED);
+#else
       pthread_cond_timedwait (&this->display_queue.not_empty, &this->display_queue.mutex, &ts);
+#endif
     }
+    vo_display_queue_drain (this);
   }
 
   /*
@@ -2694,17 +3222,31 @@ static int vo_get_property (xine_video_port_t *this_gen, int property) {
     break;
 
   case VO_PROP_BUFS_IN_FIFO:
-    ret = this->video_loop_running ? this->display_queue.num_buffers + this->rp.ready_num : -1;
+    ret = this->video_loop_running
+        ? this->display_queue.num_buffers + VO_ATGET (this->display_queue.inbox_num) + this->rp.ready_num
+        : -1;
     break;
 
   case VO_PROP_BUFS_FREE:
-    ret = this->video_loop_running ? this->free_queue.num_buffers : -1;
+    ret = this->video_loop_running ? this->free_queue.num_buffers + VO_ATGET (this->free_queue.inbox_num) : -1;
     break;
 
   case VO_PROP_BUFS_TOTAL:
     ret = this->video_loop_running ? this->free_queue.num_buffers_max : -1;
     break;
 
+  case VO_PROP_PACING_ERROR:
+    ret = this->pace_error;
+    break;
+
+  case VO_PROP_PACING_ERROR_MAX:
+    ret = this->pace_error_max;
+    break;
+
+  case VO_PROP_PACING_MISSES:
+    ret = this->pace_misses;
+    break;
+
   case VO_PROP_NUM_STREAMS:
     xine_rwlock_rdlock (&this->streams_lock);
     ret = this->num_null_streams + this->num_anon_streams + this->num_streams;
@@ -2812,7 +3354,7 @@ static int vo_set_property (xine_video_port_t *this_gen, int property, int value
       pthread_mutex_lock (&this->display_queue.mutex);
       if (this->display_queue.discard_frames) {
         if (this->display_queue.discard_frames == 1) {
-          if (this->video_loop_running && (this->display_queue.flush_extra || this->display_queue.first)) {
+          if (this->video_loop_running && (vo_display_queue_pending (this) || VO_ATGET (this->display_queue.flush_extra))) {
             /* Usually, render thread already did that in the meantime. Anyway, make sure display queue
                is empty, and more importantly, there are free frames for decoding when discard gets lifted. */
             vo_wait_flush (this);
@@ -3129,10 +3671,25 @@ xine_video_port_t *_x_vo_new_port (xine_t *xine, vo_driver_t *driver, int grabon
   this->frames_peak_used      = 0;
   this->frame_drop_cpt        = 0;
   this->frame_drop_suggested  = 0;
+  this->drop.last_time        = 0;
+  this->drop.interval         = 0;
+  this->drop.rate             = 0;
+  this->drop.acc              = 0;
+  this->drop.nonref           = 0;
   this->rp.ready_first        = NULL;
   this->rp.ready_num          = 0;
   this->rp.need_flush_signal  = 0;
   this->rp.last_flushed       = NULL;
+  this->rp.pace_due           = 0;
+  this->rp.pace_grid          = 0;
+  this->rp.pace_sum           = 0;
+  this->rp.pace_num           = 0;
+  this->rp.pace_peak          = 0;
+  this->pace_precise          = 0;
+  this->pace_period           = 0;
+  this->pace_error            = 0;
+  this->pace_error_max        = 0;
+  this->pace_misses           = 0;
 #  ifdef ADD_KEYFRAME_INDEX
   this->keyframe_mode         = 0;
 #  endif
@@ -3280,6 +3837,13 @@ xine_video_port_t *_x_vo_new_port (xine_t *xine, vo_driver_t *driver, int grabon
     _("When more than this percentage of frames are not shown, because they "
       "were not scheduled for display in time, xine sends a notification."),
     20, NULL, NULL);
+  this->drop_smooth =
+    xine->config->register_bool (xine->config, "engine.performance.smooth_frame_drop", 1,
+    _("spread frame drops evenly"),
+    _("When decoding is too slow, ask the decoder to skip frames at an even rate, "
+      "and prefer frames that no other frame depends on. Disable this to get the "
+      "old behaviour of skipping bursts of frames."),
+    20, NULL, NULL);
 
   if (grabonly) {
 
@@ -1164,6 +1164,10 @@ xine_stream_t *xine_stream_new (xine_t *this, xine_audio_port_t *ao, xine_video_
   pthread_mutex_init (&stream->first_frame.lock, NULL);
   pthread_cond_init  (&stream->first_frame.reached, NULL);
   pthread_mutex_init (&stream->index.lock, NULL);
+  pthread_mutex_init (&stream->pstats.lock, NULL);
+#ifdef HAVE_IO_URING
+  pthread_mutex_init (&stream->uring.lock, NULL);
+#endif
 
   /* warning: frontend_lock is a recursive mutex. it must NOT be
    * used with neither pthread_cond_wait() or pthread_cond_timedwait()
@@ -1224,7 +1228,11 @@ xine_stream_t *xine_stream_new (xine_t *this, xine_audio_port_t *ao, xine_video_
 
   err_mutex:
   pthread_mutex_unlock  (&this->streams_lock);
+#ifdef HAVE_IO_URING
+  pthread_mutex_destroy (&stream->uring.lock);
+#endif
   pthread_mutex_destroy (&stream->frontend_lock);
+  pthread_mutex_destroy (&stream->pstats.lock);
   pthread_mutex_destroy (&stream->index.lock);
   pthread_cond_destroy  (&stream->first_frame.reached);
   pthread_mutex_destroy (&stream->first_frame.lock);
@@ -1285,6 +1293,10 @@ static void xine_side_dispose_internal (xine_stream_private_t *stream) {
   pthread_cond_destroy  (&stream->demux.resume);
   pthread_mutex_destroy (&stream->demux.action_lock);
   pthread_mutex_destroy (&stream->demux.lock);
+#ifdef HAVE_IO_URING
+  _x_io_uring_free (&stream->s);
+  pthread_mutex_destroy (&stream->uring.lock);
+#endif
 
   free (stream->index.array);
   free (stream);
@@ -1419,6 +1431,9 @@ xine_stream_t *xine_get_side_stream (xine_stream_t *master, int index) {
   pthread_mutex_init (&s->demux.lock, NULL);
   pthread_mutex_init (&s->demux.action_lock, NULL);
   pthread_cond_init  (&s->demux.resume, NULL);
+#ifdef HAVE_IO_URING
+  pthread_mutex_init (&s->uring.lock, NULL);
+#endif
 
   /* some user config */
   s->disable_decoder_flush_at_discontinuity = m->disable_decoder_flush_at_discontinuity;
@@ -2570,6 +2585,7 @@ static void xine_dispose_internal (xine_stream_private_t *stream) {
   pthread_mutex_unlock (&xine->streams_lock);
 
   pthread_mutex_destroy (&stream->frontend_lock);
+  pthread_mutex_destroy (&stream->pstats.lock);
   pthread_mutex_destroy (&stream->index.lock);
   pthread_cond_destroy  (&stream->first_frame.reached);
   pthread_mutex_destroy (&stream->first_frame.lock);
@@ -2582,6 +2598,10 @@ static void xine_dispose_internal (xine_stream_private_t *stream) {
   pthread_mutex_destroy (&stream->demux.lock);
   xine_rwlock_destroy   (&stream->meta_lock);
   xine_rwlock_destroy   (&stream->info_lock);
+#ifdef HAVE_IO_URING
+  _x_io_uring_free (&stream->s);
+  pthread_mutex_destroy (&stream->uring.lock);
+#endif
 
   xine_refs_sub (&stream->current_extra_info_index, xine_refs_get (&stream->current_extra_info_index));
 
@@ -2888,6 +2908,23 @@ static void join_av_cb (void *this_gen, xine_cfg_entry_t *entry) {
   this->join_av = entry->num_value;
 }
 
+static void pstats_cb (void *this_gen, xine_cfg_entry_t *entry) {
+  xine_private_t *this = (xine_private_t *)this_gen;
+  this->pstats = entry->num_value;
+}
+
+static void pstats_log_cb (void *this_gen, xine_cfg_entry_t *entry) {
+  xine_private_t *this = (xine_private_t *)this_gen;
+  this->pstats_log = entry->num_value;
+}
+
+#ifdef HAVE_IO_URING
+static void io_uring_cb (void *this_gen, xine_cfg_entry_t *entry) {
+  xine_private_t *this = (xine_private_t *)this_gen;
+  this->io_uring = entry->num_value;
+}
+#endif
+
 void xine_init (xine_t *this_gen) {
   xine_private_t *this = (xine_private_t *)this_gen;
 
@@ -3018,6 +3055,36 @@ void xine_init (xine_t *this_gen) {
         "This mainly serves as a test for engine side streams."),
       20, join_av_cb, this);
 
+  /*
+   * pipeline latency statistics
+   */
+  this->pstats = this->x.config->register_bool (this->x.config,
+      "engine.performance.pipeline_stats", 0,
+      _("Collect pipeline latency statistics"),
+      _("Measure how long data waits in the engine queues, how long decoding takes, "
+        "and how far video and audio output are off schedule. Frontends can read "
+        "the results with xine_query_stats ()."),
+      20, pstats_cb, this);
+  this->pstats_log = this->x.config->register_num (this->x.config,
+      "engine.performance.pipeline_stats_log", 0,
+      _("Log pipeline latency statistics every n seconds"),
+      _("When pipeline statistics are enabled, write a summary to the xine log "
+        "this often. 0 disables logging."),
+      20, pstats_log_cb, this);
+
+#ifdef HAVE_IO_URING
+  /*
+   * network reads via io_uring
+   */
+  this->io_uring = this->x.config->register_bool (this->x.config,
+      "media.network.io_uring", 1,
+      _("Use io_uring for network reads"),
+      _("Wait for and receive network data with a single system call, "
+        "using the Linux io_uring interface. Falls back to the traditional "
+        "way automatically when the kernel does not support it."),
+      20, io_uring_cb, this);
+#endif
+
   /*
    * keep track of all opened streams
    */
@@ -3266,6 +3333,74 @@ int xine_get_pos_length (xine_stream_t *s, int *pos_stream, int *pos_time, int *
   return 1;
 }
 
+static void _pstats_get (xine_stream_private_t *stream, xine_pstats_t *stats, int reset) {
+  const xine_pstats_hist_t *c = &stream->pstats.cur.video_queue;
+  xine_pstats_hist_t *b = &stream->pstats.base.video_queue, *d = &stats->video_queue;
+  uint32_t i, j;
+
+  pthread_mutex_lock (&stream->pstats.lock);
+  for (i = 0; i < sizeof (xine_pstats_t) / sizeof (xine_pstats_hist_t); i++) {
+    d[i].count = c[i].count - b[i].count;
+    for (j = 0; j < XINE_PSTATS_BUCKETS; j++)
+      d[i].hist[j] = c[i].hist[j] - b[i].hist[j];
+    d[i].sum = c[i].sum - b[i].sum;
+    d[i].max = c[i].max;
+  }
+  if (reset)
+    stream->pstats.base = stream->pstats.cur;
+  pthread_mutex_unlock (&stream->pstats.lock);
+}
+
+int xine_query_stats (xine_stream_t *s, xine_pstats_t *stats, int reset) {
+  xine_stream_private_t *stream = (xine_stream_private_t *)s;
+  xine_private_t *xine;
+
+  if (!stream || !stats)
+    return 0;
+  xine = (xine_private_t *)stream->s.xine;
+  if (!xine->pstats)
+    return 0;
+  _pstats_get (stream->side_streams[0], stats, reset);
+  return 1;
+}
+
+static uint32_t _pstats_percentile (const xine_pstats_hist_t *h, uint32_t percent) {
+  uint32_t n, sum = 0, want = ((uint64_t)h->count * percent + 99) / 100;
+
+  for (n = 0; n < XINE_PSTATS_BUCKETS - 1; n++) {
+    sum += h->hist[n];
+    if (sum >= want)
+      break;
+  }
+  return (2u << n) - 1;
+}
+
+void xine_pstats_log (xine_stream_private_t *stream, int64_t now) {
+  static const char * const names[] = {
+    "video queue", "video decode", "video ready", "video late",
+    "audio queue", "audio decode", "audio sync"
+  };
+  xine_private_t *xine = (xine_private_t *)stream->s.xine;
+  xine_pstats_t stats;
+  const xine_pstats_hist_t *h = &stats.video_queue;
+  uint32_t i;
+
+  stream = stream->side_streams[0];
+  if (!xine->pstats || (xine->pstats_log <= 0) || (now < stream->pstats.next_log))
+    return;
+  stream->pstats.next_log = now + (int64_t)xine->pstats_log * 1000000;
+
+  _pstats_get (stream, &stats, 0);
+  for (i = 0; i < sizeof (names) / sizeof (names[0]); i++) {
+    if (!h[i].count)
+      continue;
+    xprintf (&xine->x, XINE_VERBOSITY_LOG,
+      "xine: pipeline %s: n=%u avg=%" PRId64 " p50<=%u p95<=%u max=%" PRId64 " us.\n",
+      names[i], (unsigned int)h[i].count, h[i].sum / h[i].count,
+      (unsigned int)_pstats_percentile (h + i, 50), (unsigned int)_pstats_percentile (h + i, 95), h[i].max);
+  }
+}
+
 static int _x_get_current_frame_data (xine_stream_t *stream,
 				      xine_current_frame_data_t *data,
 				      int flags, int img_size_unknown) {
@@ -803,6 +803,9 @@ uint32_t xine_get_stream_info (xine_stream_t *s, int info) {
   case XINE_STREAM_INFO_DVD_CHAPTER_COUNT:
   case XINE_STREAM_INFO_DVD_ANGLE_NUMBER:
   case XINE_STREAM_INFO_DVD_ANGLE_COUNT:
+  case XINE_STREAM_INFO_VARIANT_NUMBER:
+  case XINE_STREAM_INFO_VARIANT_COUNT:
+  case XINE_STREAM_INFO_VARIANT_BITRATE:
     return _x_stream_info_get_public (&stream->s, info);
 
   case XINE_STREAM_INFO_MAX_AUDIO_CHANNEL:
@@ -201,6 +201,11 @@ input_plugin_t *_x_rip_plugin_get_instance (xine_stream_t *stream, const char *f
 input_plugin_t *_x_cache_plugin_get_instance (xine_stream_t *stream) INTERNAL;
 ///@}
 
+#ifdef HAVE_IO_URING
+/* release the per stream io_uring (io_helper.c). */
+void _x_io_uring_free (xine_stream_t *stream) INTERNAL;
+#endif
+
 ///@{
 /**
  * @defgroup
@@ -219,6 +224,14 @@ void _x_audio_decoder_shutdown      (xine_stream_t *stream) INTERNAL;
  */
 void xine_probe_fast_memcpy(xine_t *xine) INTERNAL;
 
+/**
+ * @brief memcpy () for large blocks that will not be read again soon,
+ * like whole video frames. xine_fast_memcpy () switches to this
+ * at XINE_MEMCPY_LARGE bytes.
+ */
+#define XINE_MEMCPY_LARGE (256 << 10)
+extern void *(*_x_fast_memcpy_large) (void *to, const void *from, size_t len) INTERNAL;
+
 /**
  * @brief Make file descriptors and sockets uninheritable
  */
@@ -468,6 +481,13 @@ typedef struct {
   }                          ip_pref;
 
   uint32_t                   join_av:1;
+  /* use io_uring for network reads if available. */
+  uint32_t                   io_uring:1;
+
+  /* pipeline latency statistics (see xine_query_stats ()).
+   * pstats is read by fifo put directly. */
+  int                        pstats;
+  int                        pstats_log; /* seconds between log dumps, 0 = off */
 
   /* lock controlling speed change access.
    * if we should ever introduce per stream clock and ticket,
@@ -487,6 +507,8 @@ typedef struct {
   /* # define XINE_LIVE_PAUSE_OFF 0x7ffffffc */
 } xine_private_t;
   
+typedef struct xio_uring_s xio_uring_t;
+
 typedef struct xine_stream_private_st {
   xine_stream_t              s;
 
@@ -646,6 +668,23 @@ typedef struct xine_stream_private_st {
   input_class_t             *query_input_plugins[2];
 
   extra_info_t               ei[2];
+
+  /* pipeline latency statistics, master stream only. each histogram
+   * has a single writer thread, readers get a snapshot relative to base. */
+  struct {
+    pthread_mutex_t          lock;
+    xine_pstats_t            cur, base;
+    int64_t                  next_log;
+  } pstats;
+
+#ifdef HAVE_IO_URING
+  /* see io_helper.c. */
+  struct {
+    pthread_mutex_t          lock;
+    xio_uring_t             *ring;
+    int                      failed;
+  } uring;
+#endif
 } xine_stream_private_t;
 
 void xine_current_extra_info_set (xine_stream_private_t *stream, const extra_info_t *info) INTERNAL;
@@ -659,6 +698,41 @@ void xine_nbc_event (xine_stream_private_t *stream, uint32_t type) INTERNAL;
  * Return actual state. */
 int xine_fbc_set (fifo_buffer_t *fifo, int on) INTERNAL;
 
+/** Pipeline latency statistics helpers. */
+static inline int64_t xine_pstats_now (void) {
+  struct timespec ts = {0, 0};
+#ifdef HAVE_POSIX_TIMERS
+  clock_gettime (CLOCK_MONOTONIC, &ts);
+#else
+  xine_gettime (&ts);
+#endif
+  return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline void xine_pstats_add (xine_pstats_hist_t *h, int64_t us) {
+  uint32_t v, n = 0;
+  if (us < 0)
+    us = 0;
+  v = us > 0x7fffffff ? 0x7fffffff : us;
+  while ((v >>= 1))
+    n++;
+  if (n >= XINE_PSTATS_BUCKETS)
+    n = XINE_PSTATS_BUCKETS - 1;
+  h->hist[n]++;
+  h->count++;
+  h->sum += us;
+  if (us > h->max)
+    h->max = us;
+}
+
+/** dump stats to log now and then, if enabled. */
+void xine_pstats_log (xine_stream_private_t *stream, int64_t now) INTERNAL;
+
+/** let fifo put stamp bufs while *flag is set. */
+void xine_fifo_stamp_set (fifo_buffer_t *fifo, const int *flag) INTERNAL;
+/** time when buf was put, or 0 if unknown. */
+int64_t xine_fifo_buf_time (buf_element_t *buf) INTERNAL;
+
 /** The fast text feature. */
 typedef struct xine_fast_text_s xine_fast_text_t;
 /** load fast text from file. */
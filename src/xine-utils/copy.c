@@ -26,6 +26,7 @@
 #endif
 
 #include <xine/xineutils.h>
+#include "../xine-engine/xine_private.h"
 
 static void _copy_plane(uint8_t *restrict dst, const uint8_t *restrict src,
                         int dst_pitch, int src_pitch,
@@ -34,10 +35,14 @@ static void _copy_plane(uint8_t *restrict dst, const uint8_t *restrict src,
   if (src_pitch == dst_pitch) {
     xine_fast_memcpy(dst, src, src_pitch * height);
   } else {
+    /* a large plane will not fit the caches anyway, copy it line by line
+     * with the large block method. */
+    void *(*copy) (void *to, const void *from, size_t len) =
+      ((size_t)width * height >= XINE_MEMCPY_LARGE) ? _x_fast_memcpy_large : xine_fast_memcpy;
     int y;
 
     for (y = 0; y < height; y++) {
-      xine_fast_memcpy(dst, src, width);
+      copy(dst, src, width);
       src += src_pitch;
       dst += dst_pitch;
     }
@@ -94,7 +94,7 @@ static uint32_t arch_accel (void)
            "=S" (ebx),                  \
            "=c" (ecx),                  \
            "=d" (edx)                   \
-         : "a" (op)                     \
+         : "a" (op), "c" (0)            \
          : "cc")
 #elif !defined(__PIC__)
 #define cpuid(op,eax,ebx,ecx,edx)       \
@@ -103,7 +103,7 @@ static uint32_t arch_accel (void)
            "=b" (ebx),                  \
            "=c" (ecx),                  \
            "=d" (edx)                   \
-         : "a" (op)                     \
+         : "a" (op), "c" (0)            \
          : "cc")
 #else   /* PIC version : save ebx */
 #define cpuid(op,eax,ebx,ecx,edx)       \
@@ -115,7 +115,7 @@ static uint32_t arch_accel (void)
            "=S" (ebx),                  \
            "=c" (ecx),                  \
            "=d" (edx)                   \
-         : "a" (op)                     \
+         : "a" (op), "c" (0)            \
          : "cc")
 #endif
 
@@ -196,6 +196,12 @@ static uint32_t arch_accel (void)
       __asm__ (".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c" (0));
       if ((eax & 0x6) == 0x6) {
 	caps |= MM_ACCEL_X86_AVX;
+	cpuid (0x00000000, eax, ebx, ecx, edx);
+	if (eax >= 7) {
+	  cpuid (0x00000007, eax, ebx, ecx, edx);
+	  if (ebx & 0x00000020)
+	    caps |= MM_ACCEL_X86_AVX2;
+	}
       }
 
     }
@@ -387,6 +393,15 @@ static uint32_t arch_accel (void)
 #endif
 #endif /* ARCH_SPARC */
 
+#if defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+static uint32_t arch_accel (void)
+{
+  /* always there on aarch64, and explicitly enabled at build time on arm. */
+  return MM_ACCEL_ARM_NEON;
+}
+#define HAVE_ARCH_ACCEL_NEON
+#endif
+
 uint32_t xine_mm_accel (void)
 {
   static int initialized = 0;
@@ -406,7 +421,7 @@ uint32_t xine_mm_accel (void)
 #endif
 #endif
 
-#if defined(__i386__) || defined(__x86_64__) || (defined(ARCH_PPC) && defined(ENABLE_ALTIVEC)) || (defined(ARCH_SPARC) && defined(ENABLE_VIS))
+#if defined(__i386__) || defined(__x86_64__) || (defined(ARCH_PPC) && defined(ENABLE_ALTIVEC)) || (defined(ARCH_SPARC) && defined(ENABLE_VIS)) || defined(HAVE_ARCH_ACCEL_NEON)
     accel |= arch_accel();
 #endif
 
@@ -414,6 +429,15 @@ uint32_t xine_mm_accel (void)
       accel = 0;
     }
 
+    /* XINE_ACCEL_MASK is a debug only variable, for misc/xine-pixbench and for
+     * bisecting SIMD bugs. It is not a user setting, and apps should not set it.
+     * It can only remove detected flags, not add unsupported ones. */
+    {
+      const char *mask = getenv ("XINE_ACCEL_MASK");
+      if (mask && mask[0])
+        accel &= strtoul (mask, NULL, 0);
+    }
+
     initialized = 1;
   }
 
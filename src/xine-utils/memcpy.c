@@ -45,10 +45,15 @@
 #include <time.h>
 #endif
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h> /* clock_gettime */
 
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+#include <cpuid.h>
+#endif
+
 #define LOG_MODULE "memcpy"
 #define LOG_VERBOSE
 /*
@@ -593,6 +598,47 @@ static const struct {
 
 static uint64_t memcpy_timing[sizeof(memcpy_method)/sizeof(memcpy_method[0])] = { 0, };
 
+void *(*_x_fast_memcpy_large) (void *to, const void *from, size_t len) = memcpy;
+
+/* libc is hard to beat with small blocks. the tuned methods pay off with
+ * large ones, where their non temporal stores keep the caches clean. */
+static void *fast_memcpy_sized (void *to, const void *from, size_t len) {
+  if (len < XINE_MEMCPY_LARGE)
+    return memcpy (to, from, len);
+  return _x_fast_memcpy_large (to, from, len);
+}
+
+static void set_fast_memcpy (unsigned int method) {
+  _x_fast_memcpy_large = memcpy_method[method].function;
+  xine_fast_memcpy = (_x_fast_memcpy_large == memcpy) ? memcpy : fast_memcpy_sized;
+}
+
+/* the benchmark result is valid for a specific cpu model only. */
+static char memcpy_cpu[64] = "";
+
+static void memcpy_cpu_signature (char *buf, size_t size) {
+  uint32_t accel = xine_mm_accel ();
+#if (defined(__i386__) || defined(__x86_64__)) && defined(__GNUC__)
+  unsigned int eax, ebx, ecx, edx;
+  union {
+    unsigned int w[3];
+    char s[13];
+  } vendor;
+
+  if (__get_cpuid (0, &eax, &ebx, &ecx, &edx)) {
+    vendor.w[0] = ebx;
+    vendor.w[1] = edx;
+    vendor.w[2] = ecx;
+    vendor.s[12] = 0;
+    if (__get_cpuid (1, &eax, &ebx, &ecx, &edx)) {
+      snprintf (buf, size, "%s %08x %08x", vendor.s, eax, (unsigned int)accel);
+      return;
+    }
+  }
+#endif
+  snprintf (buf, size, "%08x", (unsigned int)accel);
+}
+
 #ifdef HAVE_POSIX_TIMERS
 /* Prefer clock_gettime() where available. */
 
@@ -640,7 +686,10 @@ static uint64_t rdtsc(int config_flags)
 #endif
 
 static int xine_probe_fast_memcpy_int (xine_t *xine) {
-#define BUFSIZE 1024*1024
+/* the methods are used for large blocks only, so test with frame sized ones
+ * that dont fit the caches. */
+#define BUFSIZE (4*1024*1024)
+#define LOOPS 12
   uint64_t     t;
   char        *buf1, *buf2;
   unsigned int i, j, best = 0;
@@ -660,7 +709,7 @@ static int xine_probe_fast_memcpy_int (xine_t *xine) {
   memset (buf2, 0, BUFSIZE);
 
   /* some initial activity to ensure that we're not running slowly :-) */
-  for (j = 0; j < 50; j++) {
+  for (j = 0; j < LOOPS; j++) {
     memcpy_method[1].function (buf2, buf1, BUFSIZE);
     memcpy_method[1].function (buf1, buf2, BUFSIZE);
   }
@@ -670,7 +719,7 @@ static int xine_probe_fast_memcpy_int (xine_t *xine) {
       continue;
 
     t = rdtsc (config_flags);
-    for (j = 0; j < 50; j++) {
+    for (j = 0; j < LOOPS; j++) {
       memcpy_method[i].function (buf2, buf1, BUFSIZE);
       memcpy_method[i].function (buf1, buf2, BUFSIZE);
     }
@@ -697,8 +746,11 @@ static void update_fast_memcpy (void *user_data, xine_cfg_entry_t *entry) {
   /* check if function is configured and valid for this machine */
   if ((method > 0) && ((size_t)method < sizeof (memcpy_method) / sizeof (memcpy_method[0]) - 1) &&
      ((config_flags & memcpy_method[method].cpu_require) == memcpy_method[method].cpu_require)) {
-    xprintf (xine, XINE_VERBOSITY_DEBUG, "xine_fast_memcpy (): using \"%s\"\n", memcpy_method[method].name);
-    xine_fast_memcpy = memcpy_method[method].function;
+    xprintf (xine, XINE_VERBOSITY_DEBUG, "xine_fast_memcpy (): using \"%s\" for %d bytes and more\n",
+      memcpy_method[method].name, XINE_MEMCPY_LARGE);
+    set_fast_memcpy (method);
+    /* remember the cpu this choice was made for. */
+    xine->config->update_string (xine->config, "engine.performance.memcpy_cpu", memcpy_cpu);
     return;
   }
 
@@ -712,6 +764,7 @@ static void update_fast_memcpy (void *user_data, xine_cfg_entry_t *entry) {
 void xine_probe_fast_memcpy(xine_t *xine)
 {
   unsigned int      method;
+  const char       *cpu;
   static const char *const memcpy_methods[] = {
     "probe", "libc",
 #if defined(ARCH_X86) && !defined(_MSC_VER)
@@ -726,6 +779,18 @@ void xine_probe_fast_memcpy(xine_t *xine)
     NULL
   };
 
+  memcpy_cpu_signature (memcpy_cpu, sizeof (memcpy_cpu));
+  cpu = xine->config->register_string (
+    xine->config,
+    "engine.performance.memcpy_cpu",
+    "",
+    _("cpu the memcopy method was chosen for"),
+    _("The memcopy method is benchmarked again when xine runs on a different cpu."),
+    30,
+    NULL,
+    NULL
+  );
+
   method = xine->config->register_enum (
     xine->config,
     "engine.performance.memcpy_method",
@@ -735,7 +800,8 @@ void xine_probe_fast_memcpy(xine_t *xine)
     _("The copying of large memory blocks is one of the most "
       "expensive operations on todays computers. Therefore xine "
       "provides various tuned methods to do this copying. "
-      "Usually, the best method is detected automatically."),
+      "Usually, the best method is detected automatically. "
+      "Small blocks are always copied by libc."),
     20,
     update_fast_memcpy,
     xine
@@ -746,5 +812,15 @@ void xine_probe_fast_memcpy(xine_t *xine)
     return;
   xine_fast_memcpy = memcpy;
 
+  if (method) {
+    if (cpu && cpu[0] && strcmp (cpu, memcpy_cpu)) {
+      xprintf (xine, XINE_VERBOSITY_DEBUG, "xine_fast_memcpy (): new cpu \"%s\", probing again\n", memcpy_cpu);
+      method = 0;
+    } else if (!cpu || !cpu[0]) {
+      /* old config, or method set by hand. keep it, and remember this cpu. */
+      xine->config->update_string (xine->config, "engine.performance.memcpy_cpu", memcpy_cpu);
+    }
+  }
+
   xine->config->update_num (xine->config, "engine.performance.memcpy_method", method);
 }
@@ -30,6 +30,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
+#include <pthread.h>
 
 #include "yuv2rgb_private.h"
 
@@ -95,6 +96,7 @@ static void yuv2rgb_dispose (yuv2rgb_t *this_gen)
   xine_free_aligned (this->y_buffer);
   xine_free_aligned (this->u_buffer);
   xine_free_aligned (this->v_buffer);
+  xine_free_aligned (this->band_buffer);
 #ifdef HAVE_MLIB
   xine_free_aligned (this->mlib_buffer);
   xine_free_aligned (this->mlib_resize_buffer);
@@ -2589,8 +2591,9 @@ static int _yuv2rgb_set_csc_levels (yuv2rgb_factory_t *this_gen,
 			 entry_size * div_round (cbu * (i-128), ygain));
   }
 
+  yuv2rgb_set_csc (&this->csc, brightness, contrast, saturation, colormatrix);
 #if defined(ARCH_X86)
-  mmx_yuv2rgb_set_csc_levels (this_gen, brightness, contrast, saturation, colormatrix);
+  mmx_yuv2rgb_set_csc_levels (this);
 #endif
 
   return 0;
@@ -3342,6 +3345,266 @@ static int yuy22rgb_c_init (yuv2rgb_factory_impl_t *this)
   return 0;
 }
 
+/*
+ * whole frame conversion. the frame is split into bands, and every band
+ * gets its own copy of the converter.
+ */
+
+#define YUV2RGB_MAX_BANDS 8
+/* dont split below this many source lines per band. */
+#define YUV2RGB_BAND_LINES 64
+
+typedef struct {
+  yuv2rgb_impl_t  impl;
+  uint8_t        *image;
+  const uint8_t  *py, *pu, *pv;
+} yuv2rgb_band_t;
+
+struct yuv2rgb_pool_s {
+  pthread_mutex_t  mutex;
+  pthread_cond_t   work_cond;
+  pthread_cond_t   done_cond;
+
+  yuv2rgb_band_t  *bands;
+  int              num_bands, next, pending;
+  int              busy, quit;
+
+  int              num_threads;
+  pthread_t        threads[YUV2RGB_MAX_BANDS];
+};
+
+static void yuv2rgb_band_run (yuv2rgb_band_t *band)
+{
+  yuv2rgb_t *intf = &band->impl.intf;
+
+  if (band->pu)
+    intf->yuv2rgb_fun (intf, band->image, band->py, band->pu, band->pv);
+  else
+    intf->yuy22rgb_fun (intf, band->image, band->py);
+}
+
+static void *yuv2rgb_pool_loop (void *data)
+{
+  yuv2rgb_pool_t *pool = data;
+
+  pthread_mutex_lock (&pool->mutex);
+  while (!pool->quit) {
+    yuv2rgb_band_t *band;
+
+    if (pool->next >= pool->num_bands) {
+      pthread_cond_wait (&pool->work_cond, &pool->mutex);
+      continue;
+    }
+    band = pool->bands + pool->next++;
+    pthread_mutex_unlock (&pool->mutex);
+
+    yuv2rgb_band_run (band);
+
+    pthread_mutex_lock (&pool->mutex);
+    if (--pool->pending == 0)
+      pthread_cond_signal (&pool->done_cond);
+  }
+  pthread_mutex_unlock (&pool->mutex);
+  return NULL;
+}
+
+static void yuv2rgb_pool_delete (yuv2rgb_pool_t *pool)
+{
+  int i;
+
+  pthread_mutex_lock (&pool->mutex);
+  pool->quit = 1;
+  pthread_cond_broadcast (&pool->work_cond);
+  pthread_mutex_unlock (&pool->mutex);
+  for (i = 0; i < pool->num_threads; i++)
+    pthread_join (pool->threads[i], NULL);
+  pthread_cond_destroy (&pool->done_cond);
+  pthread_cond_destroy (&pool->work_cond);
+  pthread_mutex_destroy (&pool->mutex);
+  free (pool);
+}
+
+static yuv2rgb_pool_t *yuv2rgb_pool_new (int threads)
+{
+  yuv2rgb_pool_t *pool = calloc (1, sizeof (*pool));
+  int i;
+
+  if (!pool)
+    return NULL;
+  pthread_mutex_init (&pool->mutex, NULL);
+  pthread_cond_init (&pool->work_cond, NULL);
+  pthread_cond_init (&pool->done_cond, NULL);
+  for (i = 0; i < threads; i++) {
+    if (pthread_create (pool->threads + i, NULL, yuv2rgb_pool_loop, pool))
+      break;
+  }
+  pool->num_threads = i;
+  if (!i) {
+    yuv2rgb_pool_delete (pool);
+    return NULL;
+  }
+  return pool;
+}
+
+static yuv2rgb_pool_t *yuv2rgb_get_pool (yuv2rgb_factory_impl_t *factory)
+{
+  yuv2rgb_pool_t *pool;
+
+  pthread_mutex_lock (&factory->pool_lock);
+  if (!factory->pool && (factory->band_threads > 0)) {
+    factory->pool = yuv2rgb_pool_new (factory->band_threads);
+    if (!factory->pool)
+      factory->band_threads = 0;
+  }
+  pool = factory->pool;
+  pthread_mutex_unlock (&factory->pool_lock);
+  return pool;
+}
+
+/* find an even band start near line s, where the scaler does restart
+ * with the least vertical phase error. */
+static int yuv2rgb_band_start (yuv2rgb_impl_t *this, int s)
+{
+  int best = s & ~1, best_err = -1, i;
+
+  if (!this->do_scale)
+    return best;
+  for (i = (s & ~1) - 16; i <= (s & ~1) + 16; i += 2) {
+    int64_t err;
+
+    if ((i <= 0) || (i >= this->source_height))
+      continue;
+    err = (int64_t)((i * this->dest_height) / this->source_height) * this->step_dy - (int64_t)i * 32768;
+    if (err < 0)
+      err = -err;
+    if ((best_err < 0) || (err < best_err)) {
+      best_err = err;
+      best = i;
+    }
+  }
+  return best;
+}
+
+/* returns 0 if the frame was not converted. */
+static int yuv2rgb_bands (yuv2rgb_impl_t *this, uint8_t *image,
+                          const uint8_t *py, const uint8_t *pu, const uint8_t *pv)
+{
+  yuv2rgb_band_t bands[YUV2RGB_MAX_BANDS];
+  yuv2rgb_pool_t *pool;
+  int n, i, s0, y0, buf_size = 0;
+
+  n = this->source_height / YUV2RGB_BAND_LINES;
+  if (n > this->factory->band_threads + 1)
+    n = this->factory->band_threads + 1;
+  if (n > YUV2RGB_MAX_BANDS)
+    n = YUV2RGB_MAX_BANDS;
+  if (n < 2)
+    return 0;
+
+  /* scaling needs private line buffers. */
+  if (this->do_scale) {
+    buf_size = (2 * this->dest_width + 2 * ((this->dest_width + 1) / 2) + 31) & ~31;
+    if (this->band_buffer_size < n * buf_size) {
+      xine_freep_aligned (&this->band_buffer);
+      this->band_buffer_size = 0;
+      this->band_buffer = xine_malloc_aligned (n * buf_size);
+      if (!this->band_buffer)
+        return 0;
+      this->band_buffer_size = n * buf_size;
+    }
+  }
+
+  s0 = y0 = 0;
+  for (i = 0; i < n; i++) {
+    yuv2rgb_band_t *band = bands + i;
+    int s1, y1;
+
+    s1 = (i == n - 1) ? this->source_height
+       : yuv2rgb_band_start (this, ((i + 1) * this->source_height) / n);
+    y1 = (i == n - 1) ? this->dest_height : (s1 * this->dest_height) / this->source_height;
+    /* each band must yield some output lines. */
+    if (y1 - y0 < 2)
+      return 0;
+
+    memcpy (&band->impl, this, sizeof (band->impl));
+    band->impl.slice_offset = s0;
+    band->impl.slice_height = s1 - s0;
+    band->image = image;
+    band->py    = py + s0 * this->y_stride;
+    band->pu    = pu ? pu + (s0 >> 1) * this->uv_stride : NULL;
+    band->pv    = pv ? pv + (s0 >> 1) * this->uv_stride : NULL;
+    if (this->do_scale) {
+      uint8_t *buf = this->band_buffer + i * buf_size;
+      band->impl.y_buffer = buf;
+      band->impl.u_buffer = buf + 2 * this->dest_width;
+      band->impl.v_buffer = buf + 2 * this->dest_width + (this->dest_width + 1) / 2;
+    }
+    s0 = s1;
+    y0 = y1;
+  }
+
+  pool = yuv2rgb_get_pool (this->factory);
+  if (!pool)
+    return 0;
+
+  pthread_mutex_lock (&pool->mutex);
+  /* another converter of this factory is using the pool. */
+  if (pool->busy) {
+    pthread_mutex_unlock (&pool->mutex);
+    return 0;
+  }
+  pool->busy      = 1;
+  pool->bands     = bands;
+  pool->num_bands = n;
+  pool->next      = 0;
+  pool->pending   = n;
+  pthread_cond_broadcast (&pool->work_cond);
+
+  /* do our share. */
+  while (pool->next < pool->num_bands) {
+    yuv2rgb_band_t *band = pool->bands + pool->next++;
+
+    pthread_mutex_unlock (&pool->mutex);
+    yuv2rgb_band_run (band);
+    pthread_mutex_lock (&pool->mutex);
+    pool->pending--;
+  }
+  while (pool->pending)
+    pthread_cond_wait (&pool->done_cond, &pool->mutex);
+
+  pool->busy      = 0;
+  pool->bands     = NULL;
+  pool->num_bands = 0;
+  pool->next      = 0;
+  pthread_mutex_unlock (&pool->mutex);
+  return 1;
+}
+
+static void yuv2rgb_frame (yuv2rgb_t *this_gen, uint8_t *restrict image,
+                           const uint8_t *restrict py, const uint8_t *restrict pu,
+                           const uint8_t *restrict pv)
+{
+  yuv2rgb_impl_t *this = (yuv2rgb_impl_t *)this_gen;
+
+  if ((this->factory->band_threads > 0) && yuv2rgb_bands (this, image, py, pu, pv))
+    return;
+  this->slice_height = this->source_height;
+  this->slice_offset = 0;
+  this_gen->yuv2rgb_fun (this_gen, image, py, pu, pv);
+}
+
+static void yuy22rgb_frame (yuv2rgb_t *this_gen, uint8_t *restrict image,
+                            const uint8_t *restrict p)
+{
+  yuv2rgb_impl_t *this = (yuv2rgb_impl_t *)this_gen;
+
+  if ((this->factory->band_threads > 0) && yuv2rgb_bands (this, image, p, NULL, NULL))
+    return;
+  this->slice_height = this->source_height;
+  this->slice_offset = 0;
+  this_gen->yuy22rgb_fun (this_gen, image, p);
+}
+
 static yuv2rgb_t *yuv2rgb_create_converter (yuv2rgb_factory_t *this_gen) {
 
   yuv2rgb_factory_impl_t *factory = (yuv2rgb_factory_impl_t*)this_gen;
@@ -3360,6 +3623,8 @@ static yuv2rgb_t *yuv2rgb_create_converter (yuv2rgb_factory_t *this_gen) {
   intf->yuv2rgb_fun              = factory->yuv2rgb_fun;
   intf->yuy22rgb_fun             = factory->yuy22rgb_fun;
   intf->yuv2rgb_single_pixel_fun = factory->yuv2rgb_single_pixel_fun;
+  intf->yuv2rgb_frame_fun        = yuv2rgb_frame;
+  intf->yuy22rgb_frame_fun       = yuy22rgb_frame;
 
   this->swapped                  = factory->swapped;
   this->cmap                     = factory->cmap;
@@ -3380,6 +3645,16 @@ static yuv2rgb_t *yuv2rgb_create_converter (yuv2rgb_factory_t *this_gen) {
   this->table_bU                 = factory->table_bU;
   this->table_mmx                = factory->table_mmx;
 
+  this->csc                      = &factory->csc;
+  this->yuv2rgb_row              = factory->yuv2rgb_row;
+  this->yuy22rgb_row             = factory->yuy22rgb_row;
+  this->yuy22rgb_scaled          = factory->yuy22rgb_scaled;
+  this->pixel_bytes              = factory->pixel_bytes;
+
+  this->factory                  = factory;
+  this->band_buffer              = NULL;
+  this->band_buffer_size         = 0;
+
   return intf;
 }
 
@@ -3391,6 +3666,9 @@ static void yuv2rgb_factory_dispose (yuv2rgb_factory_t *this_gen) {
 
   yuv2rgb_factory_impl_t *this = (yuv2rgb_factory_impl_t*)this_gen;
 
+  if (this->pool)
+    yuv2rgb_pool_delete (this->pool);
+  pthread_mutex_destroy (&this->pool_lock);
   _x_freep (&this->table_base);
   xine_freep_aligned(&this->table_mmx);
   free (this);
@@ -3401,7 +3679,7 @@ yuv2rgb_factory_t* yuv2rgb_factory_init (int mode, int swapped,
 
   yuv2rgb_factory_impl_t *this;
   yuv2rgb_factory_t      *intf;
-#if defined(ARCH_X86) || defined(HAVE_MLIB)
+#if defined(ARCH_X86) || defined(HAVE_MLIB) || defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
   uint32_t mm = xine_mm_accel();
 #endif
 
@@ -3420,17 +3698,57 @@ yuv2rgb_factory_t* yuv2rgb_factory_init (int mode, int swapped,
   this->table_base          = NULL;
   this->table_mmx           = NULL;
 
+  this->yuv2rgb_row         = NULL;
+  this->yuy22rgb_row        = NULL;
+  this->yuy22rgb_scaled     = NULL;
+  this->pixel_bytes         = 0;
+
+  /* the calling thread converts 1 band as well. */
+  this->band_threads        = xine_cpu_count ();
+  if (this->band_threads > YUV2RGB_MAX_BANDS)
+    this->band_threads = YUV2RGB_MAX_BANDS;
+  this->band_threads--;
+  pthread_mutex_init (&this->pool_lock, NULL);
+  this->pool                = NULL;
 
   if (_yuv2rgb_set_csc_levels (intf, 0, 128, 128, CM_DEFAULT) < 0) {
     goto failed;
   }
 
+  /*
+   * c yuy22rgb function, the simd versions below fall back to it for scaling
+   */
+
+  if (yuy22rgb_c_init (this) < 0) {
+    goto failed;
+  }
+
   /*
    * auto-probe for the best yuv2rgb function
    */
 
   this->yuv2rgb_fun = NULL;
 #if defined(ARCH_X86)
+  if ((this->yuv2rgb_fun == NULL) && (mm & MM_ACCEL_X86_AVX2)) {
+
+    yuv2rgb_init_avx2 (this);
+
+#ifdef LOG
+    if (this->yuv2rgb_fun != NULL)
+      printf ("yuv2rgb: using AVX2 for colour space transform\n");
+#endif
+  }
+
+  if ((this->yuv2rgb_fun == NULL) && (mm & MM_ACCEL_X86_SSE2)) {
+
+    yuv2rgb_init_sse2 (this);
+
+#ifdef LOG
+    if (this->yuv2rgb_fun != NULL)
+      printf ("yuv2rgb: using SSE2 for colour space transform\n");
+#endif
+  }
+
   if ((this->yuv2rgb_fun == NULL) && (mm & MM_ACCEL_X86_MMXEXT)) {
 
     yuv2rgb_init_mmxext (this);
@@ -3451,11 +3769,26 @@ yuv2rgb_factory_t* yuv2rgb_factory_init (int mode, int swapped,
 #endif
   }
 #endif
+#if defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+  if ((this->yuv2rgb_fun == NULL) && (mm & MM_ACCEL_ARM_NEON)) {
+
+    yuv2rgb_init_neon (this);
+
+#ifdef LOG
+    if (this->yuv2rgb_fun != NULL)
+      printf ("yuv2rgb: using NEON for colour space transform\n");
+#endif
+  }
+#endif
 #ifdef HAVE_MLIB
   if ((this->yuv2rgb_fun == NULL) && (mm & MM_ACCEL_MLIB)) {
 
     yuv2rgb_init_mlib (this);
 
+    /* mlib converts whole frames with shared buffers. */
+    if (this->yuv2rgb_fun != NULL)
+      this->band_threads = 0;
+
 #ifdef LOG
     if (this->yuv2rgb_fun != NULL)
       printf ("yuv2rgb: using medialib for colour space transform\n");
@@ -3470,15 +3803,6 @@ yuv2rgb_factory_t* yuv2rgb_factory_init (int mode, int swapped,
     }
   }
 
-  /*
-   * auto-probe for the best yuy22rgb function
-   */
-
-  /* FIXME: implement mmx/mlib functions */
-  if (yuy22rgb_c_init (this) < 0) {
-    goto failed;
-  }
-
   /*
    * set up single pixel function
    */
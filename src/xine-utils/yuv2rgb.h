@@ -114,6 +114,13 @@ struct yuv2rgb_s {
    */
 
   yuv2rgb_single_pixel_fun_t yuv2rgb_single_pixel_fun;
+
+  /*
+   * convert a whole frame, like yuv2rgb_fun/yuy22rgb_fun after configure ().
+   * large frames are split into bands that are converted in parallel.
+   */
+  yuv2rgb_fun_t     yuv2rgb_frame_fun;
+  yuy22rgb_fun_t    yuy22rgb_frame_fun;
 };
 
 /*
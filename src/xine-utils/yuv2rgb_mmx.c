@@ -68,22 +68,10 @@ struct mmx_csc_s {
   mmx_t Y_coeff;
 };
 
-extern const int32_t Inverse_Table_6_9[8][4];
-
-void mmx_yuv2rgb_set_csc_levels(yuv2rgb_factory_t *this_gen,
-  int brightness, int contrast, int saturation, int colormatrix)
+void mmx_yuv2rgb_set_csc_levels(yuv2rgb_factory_impl_t *this)
 {
-  yuv2rgb_factory_impl_t *this = (yuv2rgb_factory_impl_t*)this_gen;
-  int i, cty;
-
-  int yoffset = -16;
-  int ygain = ((1 << 16) * 255) / 219;
-
-  int cm = (colormatrix >> 1) & 7;
-  int crv = Inverse_Table_6_9[cm][0];
-  int cbu = Inverse_Table_6_9[cm][1];
-  int cgu = Inverse_Table_6_9[cm][2];
-  int cgv = Inverse_Table_6_9[cm][3];
+  const yuv2rgb_csc_t *c = &this->csc;
+  int i;
 
   mmx_csc_t *csc;
 
@@ -92,41 +80,17 @@ void mmx_yuv2rgb_set_csc_levels(yuv2rgb_factory_t *this_gen,
     this->table_mmx = xine_mallocz_aligned(sizeof(mmx_csc_t));
   }
 
-  /* full range mode */
-  if (colormatrix & 1) {
-    yoffset = 0;
-    ygain = (1 << 16);
-
-    crv = (crv * 112 + 63) / 127;
-    cbu = (cbu * 112 + 63) / 127;
-    cgu = (cgu * 112 + 63) / 127;
-    cgv = (cgv * 112 + 63) / 127;
-  }
-
-  yoffset += brightness;
-  /* TV set behaviour: contrast affects color difference as well */
-  saturation = (contrast * saturation + 64) >> 7;
-
   csc = (mmx_csc_t *) this->table_mmx;
 
-  crv = (crv * saturation + 512) / 1024;
-  cbu = (cbu * saturation + 512) / 1024;
-  cbu = (cbu > 32767) ? 32767 : cbu;
-  cgu = (cgu * saturation + 512) / 1024;
-  cgv = (cgv * saturation + 512) / 1024;
-  cty = (ygain * contrast + 512) / 1024;
-
-  /* the 8 is "+0,5" for later rounding */
-  yoffset = ((cty * (yoffset << 7)) >> 16) + 8;
-
+  /* coefficients were set up by yuv2rgb_set_csc () already */
   for (i=0; i < 4; i++) {
-    csc->U_green.w[i] = -cgu;
-    csc->U_blue.w[i]  =  cbu;
-    csc->V_red.w[i]   =  crv;
-    csc->V_green.w[i] = -cgv;
-    csc->Y_coeff.w[i] =  cty;
+    csc->U_green.w[i] = c->u_green;
+    csc->U_blue.w[i]  = c->u_blue;
+    csc->V_red.w[i]   = c->v_red;
+    csc->V_green.w[i] = c->v_green;
+    csc->Y_coeff.w[i] = c->y_coeff;
 
-    csc->addYw.w[i]   = yoffset;
+    csc->addYw.w[i]   = c->y_offset;
 
     csc->x0080w.w[i]  = 128;
     csc->x00ffw.w[i]  = 0xff;
@@ -28,6 +28,7 @@
 #define YUV2RGB_PRIVATE_H
 
 #include <inttypes.h>
+#include <pthread.h>
 
 #ifdef HAVE_MLIB
 #include <mlib_video.h>
@@ -42,6 +43,26 @@ typedef void (*scale_line_func_t) (const uint8_t *restrict source,
                                    uint8_t       *restrict dest,
                                    int width, int step);
 
+/* 16 bit fixed point coefficients, shared by the mmx and simd converters. */
+typedef struct {
+  int16_t y_coeff, y_offset;
+  int16_t u_blue, u_green;
+  int16_t v_red, v_green;
+} yuv2rgb_csc_t;
+
+/* convert 1 line of width pixels. */
+typedef void (*yuv2rgb_row_fun_t) (uint8_t       *restrict dest,
+                                   const uint8_t *restrict py,
+                                   const uint8_t *restrict pu,
+                                   const uint8_t *restrict pv,
+                                   int width, const yuv2rgb_csc_t *csc);
+
+typedef void (*yuy22rgb_row_fun_t) (uint8_t       *restrict dest,
+                                    const uint8_t *restrict p,
+                                    int width, const yuv2rgb_csc_t *csc);
+
+typedef struct yuv2rgb_pool_s yuv2rgb_pool_t;
+
 struct yuv2rgb_impl_s {
 
   yuv2rgb_t         intf;
@@ -67,6 +88,18 @@ struct yuv2rgb_impl_s {
   const uint8_t    *cmap;
   scale_line_func_t scale_line;
 
+  /* simd line converters, see yuv2rgb_simd.c */
+  const yuv2rgb_csc_t *csc;
+  yuv2rgb_row_fun_t   yuv2rgb_row;
+  yuy22rgb_row_fun_t  yuy22rgb_row;
+  yuy22rgb_fun_t      yuy22rgb_scaled;
+  int                 pixel_bytes;
+
+  /* band threading for whole frames */
+  yuv2rgb_factory_impl_t *factory;
+  uint8_t          *band_buffer;
+  int               band_buffer_size;
+
 #ifdef HAVE_MLIB
   uint8_t          *mlib_buffer;
   uint8_t          *mlib_resize_buffer;
@@ -88,19 +121,36 @@ struct yuv2rgb_factory_impl_s {
   int      table_gV[256];
   void    *table_bU[256];
   void    *table_mmx;
+  yuv2rgb_csc_t csc;
 
   /* preselected functions for mode/swap/hardware */
   yuv2rgb_fun_t               yuv2rgb_fun;
   yuy22rgb_fun_t              yuy22rgb_fun;
   yuv2rgb_single_pixel_fun_t  yuv2rgb_single_pixel_fun;
+
+  /* simd line converters, and the c function for scaled yuy2 */
+  yuv2rgb_row_fun_t           yuv2rgb_row;
+  yuy22rgb_row_fun_t          yuy22rgb_row;
+  yuy22rgb_fun_t              yuy22rgb_scaled;
+  int                         pixel_bytes;
+
+  /* whole frame band threading, pool is created on first use */
+  int                         band_threads;
+  pthread_mutex_t             pool_lock;
+  yuv2rgb_pool_t             *pool;
 };
 
-void mmx_yuv2rgb_set_csc_levels(yuv2rgb_factory_t *this,
-                                int brightness, int contrast, int saturation,
-                                int colormatrix);
+void yuv2rgb_set_csc (yuv2rgb_csc_t *csc,
+                      int brightness, int contrast, int saturation,
+                      int colormatrix);
+
+void mmx_yuv2rgb_set_csc_levels(yuv2rgb_factory_impl_t *this);
 void yuv2rgb_init_mmxext (yuv2rgb_factory_impl_t *this);
 void yuv2rgb_init_mmx (yuv2rgb_factory_impl_t *this);
 void yuv2rgb_init_mlib (yuv2rgb_factory_impl_t *this);
+void yuv2rgb_init_sse2 (yuv2rgb_factory_impl_t *this);
+void yuv2rgb_init_avx2 (yuv2rgb_factory_impl_t *this);
+void yuv2rgb_init_neon (yuv2rgb_factory_impl_t *this);
 
 
 #endif /* YUV2RGB_PRIVATE_H */
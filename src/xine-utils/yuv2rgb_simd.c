@@ -0,0 +1,665 @@
+/*
+ * yuv2rgb_simd.c
+ *
+ * Copyright (C) 2001-2021 the xine project
+ * This file is part of xine, a free video player.
+ *
+ * xine is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * xine is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110, USA
+ *
+ * SSE2, AVX2 and NEON colour space conversion to 32 and 16 (565) bit rgb.
+ * YV12 and YUY2 input. The integer arithmetic is the same as in
+ * yuv2rgb_mmx.c, so all versions give the same output:
+ *   y = ((cty * (y << 7)) >> 16) + yoffset;
+ *   u = (u - 128) << 7;
+ *   v = (v - 128) << 7;
+ *   r = (y + ((crv * v) >> 16)) >> 4;
+ *   g = (y + ((cgu * u) >> 16) + ((cgv * v) >> 16)) >> 4;
+ *   b = (y + ((cbu * u) >> 16)) >> 4;
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include <xine/xineutils.h>
+
+#include "yuv2rgb_private.h"
+
+#if defined(ARCH_X86) && (defined(__SSE2__) || defined(HAVE_AVX2))
+#  define YUV2RGB_SSE2
+#endif
+#if defined(ARCH_X86) && defined(HAVE_AVX2)
+#  define YUV2RGB_AVX2
+#endif
+#if (defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)) && !defined(WORDS_BIGENDIAN)
+#  define YUV2RGB_NEON
+#endif
+
+#if defined(YUV2RGB_SSE2) || defined(YUV2RGB_AVX2)
+#  include <immintrin.h>
+#endif
+#ifdef YUV2RGB_NEON
+#  include <arm_neon.h>
+#endif
+
+extern const int32_t Inverse_Table_6_9[8][4];
+
+void yuv2rgb_set_csc (yuv2rgb_csc_t *csc,
+  int brightness, int contrast, int saturation, int colormatrix)
+{
+  int cty;
+
+  int yoffset = -16;
+  int ygain = ((1 << 16) * 255) / 219;
+
+  int cm = (colormatrix >> 1) & 7;
+  int crv = Inverse_Table_6_9[cm][0];
+  int cbu = Inverse_Table_6_9[cm][1];
+  int cgu = Inverse_Table_6_9[cm][2];
+  int cgv = Inverse_Table_6_9[cm][3];
+
+  /* full range mode */
+  if (colormatrix & 1) {
+    yoffset = 0;
+    ygain = (1 << 16);
+
+    crv = (crv * 112 + 63) / 127;
+    cbu = (cbu * 112 + 63) / 127;
+    cgu = (cgu * 112 + 63) / 127;
+    cgv = (cgv * 112 + 63) / 127;
+  }
+
+  yoffset += brightness;
+  /* TV set behaviour: contrast affects color difference as well */
+  saturation = (contrast * saturation + 64) >> 7;
+
+  crv = (crv * saturation + 512) / 1024;
+  cbu = (cbu * saturation + 512) / 1024;
+  cbu = (cbu > 32767) ? 32767 : cbu;
+  cgu = (cgu * saturation + 512) / 1024;
+  cgv = (cgv * saturation + 512) / 1024;
+  cty = (ygain * contrast + 512) / 1024;
+
+  /* the 8 is "+0,5" for later rounding */
+  yoffset = ((cty * (yoffset << 7)) >> 16) + 8;
+
+  csc->y_coeff  = cty;
+  csc->y_offset = yoffset;
+  csc->u_blue   = cbu;
+  csc->u_green  = -cgu;
+  csc->v_red    = crv;
+  csc->v_green  = -cgv;
+}
+
+#if defined(YUV2RGB_SSE2) || defined(YUV2RGB_AVX2) || defined(YUV2RGB_NEON)
+
+/*
+ * plain c version of the simd arithmetic, for the line ends.
+ */
+
+static inline int csc_sat (int v) {
+  return v < -32768 ? -32768 : v > 32767 ? 32767 : v;
+}
+
+static inline int csc_clip (int v) {
+  v >>= 4;
+  return v < 0 ? 0 : v > 255 ? 255 : v;
+}
+
+static inline void csc_pixel (uint8_t *dest, int x, int mode, const yuv2rgb_csc_t *csc,
+                              int y, int u, int v) {
+  int r, g, b;
+
+  y = csc_sat (((y << 7) * csc->y_coeff >> 16) + csc->y_offset);
+  u = (u - 128) << 7;
+  v = (v - 128) << 7;
+  b = csc_clip (csc_sat (y + (u * csc->u_blue >> 16)));
+  g = csc_clip (csc_sat (y + csc_sat ((u * csc->u_green >> 16) + (v * csc->v_green >> 16))));
+  r = csc_clip (csc_sat (y + (v * csc->v_red >> 16)));
+
+  switch (mode) {
+  case MODE_32_RGB:
+    ((uint32_t *)dest)[x] = (r << 16) | (g << 8) | b;
+    break;
+  case MODE_32_BGR:
+    ((uint32_t *)dest)[x] = (b << 16) | (g << 8) | r;
+    break;
+  case MODE_16_RGB:
+    ((uint16_t *)dest)[x] = ((r & 0xf8) << 8) | ((g & 0xfc) << 3) | (b >> 3);
+    break;
+  case MODE_16_BGR:
+    ((uint16_t *)dest)[x] = ((b & 0xf8) << 8) | ((g & 0xfc) << 3) | (r >> 3);
+    break;
+  }
+}
+
+static inline void csc_row_tail (uint8_t *dest, const uint8_t *py, const uint8_t *pu,
+                                 const uint8_t *pv, int x, int width, int mode,
+                                 const yuv2rgb_csc_t *csc) {
+  for (; x < width; x++)
+    csc_pixel (dest, x, mode, csc, py[x], pu[x >> 1], pv[x >> 1]);
+}
+
+static inline void csc_yuy2_tail (uint8_t *dest, const uint8_t *p, int x, int width,
+                                  int mode, const yuv2rgb_csc_t *csc) {
+  for (; x < width; x++)
+    csc_pixel (dest, x, mode, csc, p[2 * x], p[4 * (x >> 1) + 1], p[4 * (x >> 1) + 3]);
+}
+
+/*
+ * line converter wrappers, with the mode being a constant.
+ */
+
+#define ROW_FUNCS(isa,attr)                                                       \
+static attr void isa##_row_32rgb (uint8_t *restrict dest, const uint8_t *restrict py, \
+  const uint8_t *restrict pu, const uint8_t *restrict pv, int width, const yuv2rgb_csc_t *csc) { \
+  isa##_row (dest, py, pu, pv, width, csc, MODE_32_RGB);                          \
+}                                                                                 \
+static attr void isa##_row_32bgr (uint8_t *restrict dest, const uint8_t *restrict py, \
+  const uint8_t *restrict pu, const uint8_t *restrict pv, int width, const yuv2rgb_csc_t *csc) { \
+  isa##_row (dest, py, pu, pv, width, csc, MODE_32_BGR);                          \
+}                                                                                 \
+static attr void isa##_row_16rgb (uint8_t *restrict dest, const uint8_t *restrict py, \
+  const uint8_t *restrict pu, const uint8_t *restrict pv, int width, const yuv2rgb_csc_t *csc) { \
+  isa##_row (dest, py, pu, pv, width, csc, MODE_16_RGB);                          \
+}                                                                                 \
+static attr void isa##_row_16bgr (uint8_t *restrict dest, const uint8_t *restrict py, \
+  const uint8_t *restrict pu, const uint8_t *restrict pv, int width, const yuv2rgb_csc_t *csc) { \
+  isa##_row (dest, py, pu, pv, width, csc, MODE_16_BGR);                          \
+}                                                                                 \
+static attr void isa##_yuy2_32rgb (uint8_t *restrict dest, const uint8_t *restrict p, \
+  int width, const yuv2rgb_csc_t *csc) {                                          \
+  isa##_yuy2 (dest, p, width, csc, MODE_32_RGB);                                  \
+}                                                                                 \
+static attr void isa##_yuy2_32bgr (uint8_t *restrict dest, const uint8_t *restrict p, \
+  int width, const yuv2rgb_csc_t *csc) {                                          \
+  isa##_yuy2 (dest, p, width, csc, MODE_32_BGR);                                  \
+}                                                                                 \
+static attr void isa##_yuy2_16rgb (uint8_t *restrict dest, const uint8_t *restrict p, \
+  int width, const yuv2rgb_csc_t *csc) {                                          \
+  isa##_yuy2 (dest, p, width, csc, MODE_16_RGB);                                  \
+}                                                                                 \
+static attr void isa##_yuy2_16bgr (uint8_t *restrict dest, const uint8_t *restrict p, \
+  int width, const yuv2rgb_csc_t *csc) {                                          \
+  isa##_yuy2 (dest, p, width, csc, MODE_16_BGR);                                  \
+}                                                                                 \
+static const yuv2rgb_row_fun_t isa##_rows[4] = {                                  \
+  isa##_row_32rgb, isa##_row_32bgr, isa##_row_16rgb, isa##_row_16bgr             \
+};                                                                                \
+static const yuy22rgb_row_fun_t isa##_yuy2_rows[4] = {                            \
+  isa##_yuy2_32rgb, isa##_yuy2_32bgr, isa##_yuy2_16rgb, isa##_yuy2_16bgr         \
+};
+
+#endif
+
+#ifdef YUV2RGB_SSE2
+
+#define SSE2_FUNC __attribute__ ((target ("sse2")))
+
+typedef struct {
+  __m128i cty, yoff, ub, ug, vr, vg;
+} sse2_csc_t;
+
+static inline SSE2_FUNC void sse2_csc_init (sse2_csc_t *k, const yuv2rgb_csc_t *csc) {
+  k->cty  = _mm_set1_epi16 (csc->y_coeff);
+  k->yoff = _mm_set1_epi16 (csc->y_offset);
+  k->ub   = _mm_set1_epi16 (csc->u_blue);
+  k->ug   = _mm_set1_epi16 (csc->u_green);
+  k->vr   = _mm_set1_epi16 (csc->v_red);
+  k->vg   = _mm_set1_epi16 (csc->v_green);
+}
+
+/* 8 pixels. y, u and v are 16 bit, u and v already doubled. */
+static inline SSE2_FUNC void sse2_8px (uint8_t *dest, __m128i y, __m128i u, __m128i v,
+                                       const sse2_csc_t *k, int mode) {
+  __m128i zero = _mm_setzero_si128 ();
+  __m128i max = _mm_set1_epi16 (255);
+  __m128i c128 = _mm_set1_epi16 (128);
+  __m128i r, g, b;
+
+  y = _mm_adds_epi16 (_mm_mulhi_epi16 (_mm_slli_epi16 (y, 7), k->cty), k->yoff);
+  u = _mm_slli_epi16 (_mm_sub_epi16 (u, c128), 7);
+  v = _mm_slli_epi16 (_mm_sub_epi16 (v, c128), 7);
+
+  b = _mm_adds_epi16 (y, _mm_mulhi_epi16 (u, k->ub));
+  g = _mm_adds_epi16 (y, _mm_adds_epi16 (_mm_mulhi_epi16 (u, k->ug), _mm_mulhi_epi16 (v, k->vg)));
+  r = _mm_adds_epi16 (y, _mm_mulhi_epi16 (v, k->vr));
+  b = _mm_min_epi16 (_mm_max_epi16 (_mm_srai_epi16 (b, 4), zero), max);
+  g = _mm_min_epi16 (_mm_max_epi16 (_mm_srai_epi16 (g, 4), zero), max);
+  r = _mm_min_epi16 (_mm_max_epi16 (_mm_srai_epi16 (r, 4), zero), max);
+
+  if ((mode == MODE_32_BGR) || (mode == MODE_16_BGR)) {
+    __m128i t = r;
+    r = b;
+    b = t;
+  }
+
+  if ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) {
+    __m128i gb = _mm_or_si128 (b, _mm_slli_epi16 (g, 8));
+    _mm_storeu_si128 ((__m128i *)dest, _mm_unpacklo_epi16 (gb, r));
+    _mm_storeu_si128 ((__m128i *)(dest + 16), _mm_unpackhi_epi16 (gb, r));
+  } else {
+    __m128i p = _mm_slli_epi16 (_mm_and_si128 (r, _mm_set1_epi16 (0xf8)), 8);
+    p = _mm_or_si128 (p, _mm_slli_epi16 (_mm_and_si128 (g, _mm_set1_epi16 (0xfc)), 3));
+    p = _mm_or_si128 (p, _mm_srli_epi16 (b, 3));
+    _mm_storeu_si128 ((__m128i *)dest, p);
+  }
+}
+
+static inline SSE2_FUNC void sse2_row (uint8_t *dest, const uint8_t *py, const uint8_t *pu,
+                                       const uint8_t *pv, int width, const yuv2rgb_csc_t *csc,
+                                       int mode) {
+  int bpp = ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) ? 4 : 2;
+  __m128i zero = _mm_setzero_si128 ();
+  sse2_csc_t k;
+  int x;
+
+  sse2_csc_init (&k, csc);
+  for (x = 0; x + 16 <= width; x += 16) {
+    __m128i y = _mm_loadu_si128 ((const __m128i *)(py + x));
+    __m128i u = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(pu + x / 2)), zero);
+    __m128i v = _mm_unpacklo_epi8 (_mm_loadl_epi64 ((const __m128i *)(pv + x / 2)), zero);
+
+    sse2_8px (dest + x * bpp, _mm_unpacklo_epi8 (y, zero),
+              _mm_unpacklo_epi16 (u, u), _mm_unpacklo_epi16 (v, v), &k, mode);
+    sse2_8px (dest + (x + 8) * bpp, _mm_unpackhi_epi8 (y, zero),
+              _mm_unpackhi_epi16 (u, u), _mm_unpackhi_epi16 (v, v), &k, mode);
+  }
+  csc_row_tail (dest, py, pu, pv, x, width, mode, csc);
+}
+
+static inline SSE2_FUNC void sse2_yuy2 (uint8_t *dest, const uint8_t *p, int width,
+                                        const yuv2rgb_csc_t *csc, int mode) {
+  int bpp = ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) ? 4 : 2;
+  __m128i lo8 = _mm_set1_epi16 (0x00ff);
+  __m128i lo16 = _mm_set1_epi32 (0x0000ffff);
+  sse2_csc_t k;
+  int x;
+
+  sse2_csc_init (&k, csc);
+  for (x = 0; x + 8 <= width; x += 8) {
+    /* Y0 U0 Y1 V0 ... */
+    __m128i a = _mm_loadu_si128 ((const __m128i *)(p + 2 * x));
+    __m128i c = _mm_srli_epi16 (a, 8);
+    __m128i u = _mm_and_si128 (c, lo16);
+    __m128i v = _mm_srli_epi32 (c, 16);
+
+    sse2_8px (dest + x * bpp, _mm_and_si128 (a, lo8),
+              _mm_or_si128 (u, _mm_slli_epi32 (u, 16)),
+              _mm_or_si128 (v, _mm_slli_epi32 (v, 16)), &k, mode);
+  }
+  csc_yuy2_tail (dest, p, x, width, mode, csc);
+}
+
+ROW_FUNCS (sse2, SSE2_FUNC)
+
+#endif /* YUV2RGB_SSE2 */
+
+#ifdef YUV2RGB_AVX2
+
+#define AVX2_FUNC __attribute__ ((target ("avx2")))
+
+typedef struct {
+  __m256i cty, yoff, ub, ug, vr, vg;
+} avx2_csc_t;
+
+static inline AVX2_FUNC void avx2_csc_init (avx2_csc_t *k, const yuv2rgb_csc_t *csc) {
+  k->cty  = _mm256_set1_epi16 (csc->y_coeff);
+  k->yoff = _mm256_set1_epi16 (csc->y_offset);
+  k->ub   = _mm256_set1_epi16 (csc->u_blue);
+  k->ug   = _mm256_set1_epi16 (csc->u_green);
+  k->vr   = _mm256_set1_epi16 (csc->v_red);
+  k->vg   = _mm256_set1_epi16 (csc->v_green);
+}
+
+/* 16 pixels, see sse2_8px (). */
+static inline AVX2_FUNC void avx2_16px (uint8_t *dest, __m256i y, __m256i u, __m256i v,
+                                        const avx2_csc_t *k, int mode) {
+  __m256i zero = _mm256_setzero_si256 ();
+  __m256i max = _mm256_set1_epi16 (255);
+  __m256i c128 = _mm256_set1_epi16 (128);
+  __m256i r, g, b;
+
+  y = _mm256_adds_epi16 (_mm256_mulhi_epi16 (_mm256_slli_epi16 (y, 7), k->cty), k->yoff);
+  u = _mm256_slli_epi16 (_mm256_sub_epi16 (u, c128), 7);
+  v = _mm256_slli_epi16 (_mm256_sub_epi16 (v, c128), 7);
+
+  b = _mm256_adds_epi16 (y, _mm256_mulhi_epi16 (u, k->ub));
+  g = _mm256_adds_epi16 (y, _mm256_adds_epi16 (_mm256_mulhi_epi16 (u, k->ug),
+                                               _mm256_mulhi_epi16 (v, k->vg)));
+  r = _mm256_adds_epi16 (y, _mm256_mulhi_epi16 (v, k->vr));
+  b = _mm256_min_epi16 (_mm256_max_epi16 (_mm256_srai_epi16 (b, 4), zero), max);
+  g = _mm256_min_epi16 (_mm256_max_epi16 (_mm256_srai_epi16 (g, 4), zero), max);
+  r = _mm256_min_epi16 (_mm256_max_epi16 (_mm256_srai_epi16 (r, 4), zero), max);
+
+  if ((mode == MODE_32_BGR) || (mode == MODE_16_BGR)) {
+    __m256i t = r;
+    r = b;
+    b = t;
+  }
+
+  if ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) {
+    /* unpack works per 128 bit lane: lo = pixels 0-3, 8-11, hi = 4-7, 12-15. */
+    __m256i gb = _mm256_or_si256 (b, _mm256_slli_epi16 (g, 8));
+    __m256i lo = _mm256_unpacklo_epi16 (gb, r);
+    __m256i hi = _mm256_unpackhi_epi16 (gb, r);
+    _mm256_storeu_si256 ((__m256i *)dest, _mm256_permute2x128_si256 (lo, hi, 0x20));
+    _mm256_storeu_si256 ((__m256i *)(dest + 32), _mm256_permute2x128_si256 (lo, hi, 0x31));
+  } else {
+    __m256i p = _mm256_slli_epi16 (_mm256_and_si256 (r, _mm256_set1_epi16 (0xf8)), 8);
+    p = _mm256_or_si256 (p, _mm256_slli_epi16 (_mm256_and_si256 (g, _mm256_set1_epi16 (0xfc)), 3));
+    p = _mm256_or_si256 (p, _mm256_srli_epi16 (b, 3));
+    _mm256_storeu_si256 ((__m256i *)dest, p);
+  }
+}
+
+static inline AVX2_FUNC void avx2_row (uint8_t *dest, const uint8_t *py, const uint8_t *pu,
+                                       const uint8_t *pv, int width, const yuv2rgb_csc_t *csc,
+                                       int mode) {
+  int bpp = ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) ? 4 : 2;
+  avx2_csc_t k;
+  int x;
+
+  avx2_csc_init (&k, csc);
+  for (x = 0; x + 16 <= width; x += 16) {
+    __m256i y = _mm256_cvtepu8_epi16 (_mm_loadu_si128 ((const __m128i *)(py + x)));
+    __m256i u = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *)(pu + x / 2)));
+    __m256i v = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((const __m128i *)(pv + x / 2)));
+
+    avx2_16px (dest + x * bpp, y,
+               _mm256_or_si256 (u, _mm256_slli_epi32 (u, 16)),
+               _mm256_or_si256 (v, _mm256_slli_epi32 (v, 16)), &k, mode);
+  }
+  csc_row_tail (dest, py, pu, pv, x, width, mode, csc);
+}
+
+static inline AVX2_FUNC void avx2_yuy2 (uint8_t *dest, const uint8_t *p, int width,
+                                        const yuv2rgb_csc_t *csc, int mode) {
+  int bpp = ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) ? 4 : 2;
+  __m256i lo8 = _mm256_set1_epi16 (0x00ff);
+  __m256i lo16 = _mm256_set1_epi32 (0x0000ffff);
+  avx2_csc_t k;
+  int x;
+
+  avx2_csc_init (&k, csc);
+  for (x = 0; x + 16 <= width; x += 16) {
+    __m256i a = _mm256_loadu_si256 ((const __m256i *)(p + 2 * x));
+    __m256i c = _mm256_srli_epi16 (a, 8);
+    __m256i u = _mm256_and_si256 (c, lo16);
+    __m256i v = _mm256_srli_epi32 (c, 16);
+
+    avx2_16px (dest + x * bpp, _mm256_and_si256 (a, lo8),
+               _mm256_or_si256 (u, _mm256_slli_epi32 (u, 16)),
+               _mm256_or_si256 (v, _mm256_slli_epi32 (v, 16)), &k, mode);
+  }
+  csc_yuy2_tail (dest, p, x, width, mode, csc);
+}
+
+ROW_FUNCS (avx2, AVX2_FUNC)
+
+#endif /* YUV2RGB_AVX2 */
+
+#ifdef YUV2RGB_NEON
+
+/* 8 pixels, see sse2_8px (). vqdmulh gives (2 * a * b) >> 16, and shifting
+ * that right once more is the same as pmulhw. */
+static inline void neon_8px (const yuv2rgb_csc_t *csc, uint8x8_t y8, int16x8_t u, int16x8_t v,
+                             uint8x8_t *r, uint8x8_t *g, uint8x8_t *b) {
+  int16x8_t y = vreinterpretq_s16_u16 (vmovl_u8 (y8));
+  int16x8_t c;
+
+  y = vshrq_n_s16 (vqdmulhq_n_s16 (vshlq_n_s16 (y, 7), csc->y_coeff), 1);
+  y = vqaddq_s16 (y, vdupq_n_s16 (csc->y_offset));
+
+  c = vshrq_n_s16 (vqdmulhq_n_s16 (u, csc->u_blue), 1);
+  *b = vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (y, c), 4));
+  c = vqaddq_s16 (vshrq_n_s16 (vqdmulhq_n_s16 (u, csc->u_green), 1),
+                  vshrq_n_s16 (vqdmulhq_n_s16 (v, csc->v_green), 1));
+  *g = vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (y, c), 4));
+  c = vshrq_n_s16 (vqdmulhq_n_s16 (v, csc->v_red), 1);
+  *r = vqmovun_s16 (vshrq_n_s16 (vqaddq_s16 (y, c), 4));
+}
+
+static inline uint16x8_t neon_565 (uint8x8_t r, uint8x8_t g, uint8x8_t b) {
+  uint16x8_t p = vshll_n_u8 (r, 8);
+  p = vsriq_n_u16 (p, vshll_n_u8 (g, 8), 5);
+  return vsriq_n_u16 (p, vshll_n_u8 (b, 8), 11);
+}
+
+/* 16 pixels from 16 y and 8 u, v bytes. */
+static inline void neon_16px (uint8_t *dest, uint8x16_t y, uint8x8_t u8, uint8x8_t v8,
+                              const yuv2rgb_csc_t *csc, int mode) {
+  int16x8_t c128 = vdupq_n_s16 (128);
+  int16x8_t u = vshlq_n_s16 (vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (u8)), c128), 7);
+  int16x8_t v = vshlq_n_s16 (vsubq_s16 (vreinterpretq_s16_u16 (vmovl_u8 (v8)), c128), 7);
+  int16x8x2_t uu = vzipq_s16 (u, u);
+  int16x8x2_t vv = vzipq_s16 (v, v);
+  uint8x8_t r0, g0, b0, r1, g1, b1, t;
+
+  neon_8px (csc, vget_low_u8 (y), uu.val[0], vv.val[0], &r0, &g0, &b0);
+  neon_8px (csc, vget_high_u8 (y), uu.val[1], vv.val[1], &r1, &g1, &b1);
+
+  if ((mode == MODE_32_BGR) || (mode == MODE_16_BGR)) {
+    t = r0; r0 = b0; b0 = t;
+    t = r1; r1 = b1; b1 = t;
+  }
+
+  if ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) {
+    uint8x16x4_t px;
+    px.val[0] = vcombine_u8 (b0, b1);
+    px.val[1] = vcombine_u8 (g0, g1);
+    px.val[2] = vcombine_u8 (r0, r1);
+    px.val[3] = vdupq_n_u8 (0);
+    vst4q_u8 (dest, px);
+  } else {
+    vst1q_u16 ((uint16_t *)dest, neon_565 (r0, g0, b0));
+    vst1q_u16 ((uint16_t *)dest + 8, neon_565 (r1, g1, b1));
+  }
+}
+
+static inline void neon_row (uint8_t *dest, const uint8_t *py, const uint8_t *pu,
+                             const uint8_t *pv, int width, const yuv2rgb_csc_t *csc,
+                             int mode) {
+  int bpp = ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) ? 4 : 2;
+  int x;
+
+  for (x = 0; x + 16 <= width; x += 16)
+    neon_16px (dest + x * bpp, vld1q_u8 (py + x), vld1_u8 (pu + x / 2), vld1_u8 (pv + x / 2),
+               csc, mode);
+  csc_row_tail (dest, py, pu, pv, x, width, mode, csc);
+}
+
+static inline void neon_yuy2 (uint8_t *dest, const uint8_t *p, int width,
+                              const yuv2rgb_csc_t *csc, int mode) {
+  int bpp = ((mode == MODE_32_RGB) || (mode == MODE_32_BGR)) ? 4 : 2;
+  int x;
+
+  for (x = 0; x + 16 <= width; x += 16) {
+    /* val[0] = Y0 Y1 ..., val[1] = U0 V0 U1 V1 ... */
+    uint8x16x2_t a = vld2q_u8 (p + 2 * x);
+    uint8x8x2_t uv = vuzp_u8 (vget_low_u8 (a.val[1]), vget_high_u8 (a.val[1]));
+
+    neon_16px (dest + x * bpp, a.val[0], uv.val[0], uv.val[1], csc, mode);
+  }
+  csc_yuy2_tail (dest, p, x, width, mode, csc);
+}
+
+ROW_FUNCS (neon, )
+
+#endif /* YUV2RGB_NEON */
+
+#if defined(YUV2RGB_SSE2) || defined(YUV2RGB_AVX2) || defined(YUV2RGB_NEON)
+
+/*
+ * frame/slice level, same scheme as yuv2rgb_mmx.c.
+ */
+
+static void simd_yuv420 (yuv2rgb_t *this_gen, uint8_t *image,
+                         const uint8_t *py, const uint8_t *pu, const uint8_t *pv)
+{
+  yuv2rgb_impl_t *this = (yuv2rgb_impl_t *)this_gen;
+  yuv2rgb_row_fun_t row = this->yuv2rgb_row;
+  const yuv2rgb_csc_t *csc = this->csc;
+  int rgb_stride = this->rgb_stride;
+  int y_stride   = this->y_stride;
+  int uv_stride  = this->uv_stride;
+  int height, dst_height;
+
+  if (!this->do_scale) {
+
+    height = this_gen->next_slice (this_gen, &image);
+
+    for (dst_height = 0; dst_height < height; dst_height++) {
+      row (image, py, pu, pv, this->source_width, csc);
+      py += y_stride;
+      image += rgb_stride;
+      if (dst_height & 1) {
+        pu += uv_stride;
+        pv += uv_stride;
+      }
+    }
+
+  } else {
+
+    scale_line_func_t scale_line = this->scale_line;
+    int line_bytes = this->dest_width * this->pixel_bytes;
+    int dy = 0;
+
+    scale_line (pu, this->u_buffer, this->dest_width >> 1, this->step_dx);
+    scale_line (pv, this->v_buffer, this->dest_width >> 1, this->step_dx);
+    scale_line (py, this->y_buffer, this->dest_width, this->step_dx);
+
+    dst_height = this_gen->next_slice (this_gen, &image);
+
+    for (height = 0;; ) {
+
+      row (image, this->y_buffer, this->u_buffer, this->v_buffer, this->dest_width, csc);
+
+      dy += this->step_dy;
+      image += rgb_stride;
+
+      while (--dst_height > 0 && dy < 32768) {
+        xine_fast_memcpy (image, image - rgb_stride, line_bytes);
+        dy += this->step_dy;
+        image += rgb_stride;
+      }
+
+      if (dst_height <= 0)
+        break;
+
+      do {
+        dy -= 32768;
+        py += y_stride;
+
+        scale_line (py, this->y_buffer, this->dest_width, this->step_dx);
+
+        if (height & 1) {
+          pu += uv_stride;
+          pv += uv_stride;
+
+          scale_line (pu, this->u_buffer, this->dest_width >> 1, this->step_dx);
+          scale_line (pv, this->v_buffer, this->dest_width >> 1, this->step_dx);
+        }
+        height++;
+      } while (dy >= 32768);
+    }
+  }
+}
+
+static void simd_yuy22rgb (yuv2rgb_t *this_gen, uint8_t *image, const uint8_t *p)
+{
+  yuv2rgb_impl_t *this = (yuv2rgb_impl_t *)this_gen;
+  yuy22rgb_row_fun_t row = this->yuy22rgb_row;
+  int height;
+
+  /* scaling is left to the c version. */
+  if (this->do_scale) {
+    this->yuy22rgb_scaled (this_gen, image, p);
+    return;
+  }
+
+  height = this_gen->next_slice (this_gen, &image);
+  while (height-- > 0) {
+    row (image, p, this->source_width, this->csc);
+    p += this->y_stride;
+    image += this->rgb_stride;
+  }
+}
+
+static int simd_mode_index (yuv2rgb_factory_impl_t *this)
+{
+  if (this->swapped)
+    return -1;
+  switch (this->mode) {
+  case MODE_32_RGB:
+    return 0;
+  case MODE_32_BGR:
+    return 1;
+  case MODE_16_RGB:
+    return 2;
+  case MODE_16_BGR:
+    return 3;
+  default:
+    return -1;
+  }
+}
+
+static void simd_init (yuv2rgb_factory_impl_t *this,
+                       const yuv2rgb_row_fun_t *rows, const yuy22rgb_row_fun_t *yuy2_rows)
+{
+  int i = simd_mode_index (this);
+
+  if (i < 0)
+    return;
+
+  this->yuv2rgb_row     = rows[i];
+  this->yuy22rgb_row    = yuy2_rows[i];
+  this->pixel_bytes     = (i < 2) ? 4 : 2;
+  this->yuv2rgb_fun     = simd_yuv420;
+  /* keep the c version for scaling. */
+  this->yuy22rgb_scaled = this->yuy22rgb_fun;
+  this->yuy22rgb_fun    = simd_yuy22rgb;
+}
+
+#endif
+
+void yuv2rgb_init_sse2 (yuv2rgb_factory_impl_t *this)
+{
+#ifdef YUV2RGB_SSE2
+  simd_init (this, sse2_rows, sse2_yuy2_rows);
+#else
+  (void)this;
+#endif
+}
+
+void yuv2rgb_init_avx2 (yuv2rgb_factory_impl_t *this)
+{
+#ifdef YUV2RGB_AVX2
+  simd_init (this, avx2_rows, avx2_yuy2_rows);
+#else
+  (void)this;
+#endif
+}
+
+void yuv2rgb_init_neon (yuv2rgb_factory_impl_t *this)
+{
+#ifdef YUV2RGB_NEON
+  simd_init (this, neon_rows, neon_yuy2_rows);
+#else
+  (void)this;
+#endif
+}
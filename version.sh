@@ -35,9 +35,9 @@ XINE_VERSION_PATCH=
 # Release series number (usually $XINE_MAJOR.$XINE_MINOR)
 XINE_VERSION_SERIES=1.2
 
-XINE_LT_CURRENT=12
+XINE_LT_CURRENT=13
 XINE_LT_REVISION=0
-XINE_LT_AGE=10
+XINE_LT_AGE=11
 
 if [ -f "`dirname $0`/.cvsversion" ]; then
     HG_REV="`hg summary | sed -e '1s/^parent: \([0-9]*\):.*$/\1/;1q'`"